@@ -3,6 +3,7 @@
 #include "SDL.h"
 
 #include "Core/Input.h"
+#include "Core/JobSystem.h"
 #include "Renderer/GraphicsContext.h"
 #include "Renderer/IRenderer.h"
 
@@ -37,7 +38,8 @@ void BaseApplication::Init()
     SDL_Init(SDL_INIT_VIDEO);
     InitWindow();
 
-    gfx::Init(window_);
+    jobs::Init();
+    gfx::Init(window_, frame_pacing_, dynamic_resolution_settings_);
 }
 
 void BaseApplication::MainLoop()
@@ -62,6 +64,7 @@ void BaseApplication::Cleanup()
     LOG("Tearing down application...");
 
     gfx::Shutdown();
+    jobs::Shutdown();
     DestroyWindow();
     SDL_Quit();
 }
@@ -101,6 +104,11 @@ void BaseApplication::HandleSDLEvent(const SDL_Event& sdl_event)
     {
         window_->HandleSDLEvent(sdl_event);
     }
+
+    if (sdl_event.type == SDL_WINDOWEVENT && sdl_event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED && gfx::IsInitialized())
+    {
+        gfx::RequestResize(static_cast<uint32>(sdl_event.window.data1), static_cast<uint32>(sdl_event.window.data2));
+    }
 }
 
 void BaseApplication::Render()
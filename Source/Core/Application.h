@@ -1,6 +1,8 @@
 #pragma once
 #include "Core/TickTimer.h"
 #include "Core/Window.h"
+#include "Renderer/DynamicResolution.h"
+#include "Renderer/FrameResource.h"
 
 class BaseApplication
 {
@@ -18,6 +20,12 @@ public:
 
     Window* GetWindow() const { return window_; }
 
+    // Has to be set before Run()
+    void SetFramePacing(gfx::FramePacing frame_pacing) { frame_pacing_ = frame_pacing; }
+
+    // Has to be set before Run()
+    void SetDynamicResolution(const gfx::DynamicResolutionSettings& settings) { dynamic_resolution_settings_ = settings; }
+
 protected:
     virtual void Init();
     void MainLoop();
@@ -34,6 +42,8 @@ protected:
     std::string application_name_;
     Window* window_ = nullptr;
     TickTimer tick_timer_;
+    gfx::FramePacing frame_pacing_ = gfx::FramePacing::LOW_LATENCY;
+    gfx::DynamicResolutionSettings dynamic_resolution_settings_;
 
 private:
     static inline BaseApplication* instance_ = nullptr;
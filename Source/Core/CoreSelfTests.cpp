@@ -0,0 +1,71 @@
+#include "Core/CoreSelfTests.h"
+
+#include <random>
+
+#include "Core/JobSystem.h"
+#include "Core/RadixSort.h"
+#include "Core/SelfTest.h"
+
+bool RunSortSelfTest()
+{
+    SelfTest test("Sort self test");
+    if (jobs::GetNumThreads() == 1)
+    {
+        LOG_WARN("Sort self test: single threaded, only the one chunk path runs");
+    }
+
+    const auto is_sorted_and_stable = [](const std::vector<RadixSortEntry>& entries)
+    {
+        for (size_t i = 1; i < entries.size(); ++i)
+        {
+            const RadixSortEntry& previous = entries[i - 1];
+            if (previous.key > entries[i].key || (previous.key == entries[i].key && previous.value > entries[i].value))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Values are the original positions, so stable output has them ascending within equal keys
+    std::mt19937_64 rng(42);
+    std::vector<RadixSortEntry> entries;
+    std::vector<RadixSortEntry> expected;
+    std::vector<RadixSortEntry> scratch;
+    const auto sort_and_compare = [&](uint32 count, uint64 key_mask)
+    {
+        entries.resize(count);
+        for (uint32 i = 0; i < count; ++i)
+        {
+            entries[i] = { .key = rng() & key_mask, .value = i };
+        }
+
+        expected = entries;
+        std::stable_sort(expected.begin(), expected.end(), [](const RadixSortEntry& a, const RadixSortEntry& b)
+        {
+            return a.key < b.key;
+        });
+
+        RadixSort(entries, scratch);
+        return is_sorted_and_stable(entries) && std::equal(entries.begin(), entries.end(), expected.begin(), [](const RadixSortEntry& a, const RadixSortEntry& b)
+        {
+            return a.key == b.key && a.value == b.value;
+        });
+    };
+
+    test.Expect(sort_and_compare(0, ~0ull) && sort_and_compare(1, ~0ull), "empty and single entries to be left alone");
+    test.Expect(sort_and_compare(1000, ~0ull), "1K full 64-bit keys in one chunk to match std::stable_sort");
+    test.Expect(sort_and_compare(100000, ~0ull), "100K full 64-bit keys to match std::stable_sort");
+    test.Expect(sort_and_compare(1000000, ~0ull), "1M full 64-bit keys to match std::stable_sort");
+
+    // Only passes 0, 2 and 5 move entries, an odd number, so the result comes back from scratch
+    test.Expect(sort_and_compare(200000, 0x0000'FF00'00FF'00FFull), "200K keys with skipped passes to match std::stable_sort");
+
+    // 16 distinct keys, stability decides the order of almost every entry
+    test.Expect(sort_and_compare(200000, 0xF000'0000'0000'0000ull), "200K keys with many duplicates to stay stable");
+
+    // Reuses the scratch of the previous, larger sort
+    test.Expect(sort_and_compare(50000, 0x0000'0000'FFFF'FFFFull), "a smaller sort reusing scratch to match std::stable_sort");
+
+    return test.Finish();
+}
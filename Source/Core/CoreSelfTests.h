@@ -0,0 +1,10 @@
+#pragma once
+
+/**
+ * @brief Sorts random keys with RadixSort, enough of them to split into several chunks, and compares against std::stable_sort:
+ * full 64-bit keys, keys with skipped passes and keys with many duplicates. Expects the job system to be initialized,
+ * with a single thread only the one chunk path runs.
+ * Runs without a window or device, like all self tests. Failures are logged, not asserted, so release builds report them too.
+ * @return True if every check passed.
+ */
+bool RunSortSelfTest();
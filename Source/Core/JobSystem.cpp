@@ -0,0 +1,184 @@
+#include "Core/JobSystem.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    struct JobGroup
+    {
+        const std::function<void(uint32)>* fn = nullptr;
+        uint32 num_jobs = 0;
+        std::atomic<uint32> next_job = 0;
+        std::atomic<uint32> num_finished = 0;
+    };
+
+    std::vector<std::thread> workers;
+    std::deque<SharedPtr<JobGroup>> pending_groups;
+    std::mutex mutex;
+    std::condition_variable wake_condition;
+    bool is_shutting_down = false;
+
+    thread_local uint32 thread_idx = 0;
+
+    // Runs jobs of the given group until none are left. Returns true if it ran at least one.
+    bool ExecuteJobs(JobGroup& group)
+    {
+        bool did_work = false;
+        uint32 job_idx = group.next_job.fetch_add(1, std::memory_order_relaxed);
+        while (job_idx < group.num_jobs)
+        {
+            (*group.fn)(job_idx);
+            group.num_finished.fetch_add(1, std::memory_order_acq_rel);
+            did_work = true;
+            job_idx = group.next_job.fetch_add(1, std::memory_order_relaxed);
+        }
+        return did_work;
+    }
+
+    // Picks the oldest group which still has unclaimed jobs
+    SharedPtr<JobGroup> AcquireGroup()
+    {
+        while (pending_groups.empty() == false)
+        {
+            SharedPtr<JobGroup>& group = pending_groups.front();
+            if (group->next_job.load(std::memory_order_relaxed) < group->num_jobs)
+            {
+                return group;
+            }
+            pending_groups.pop_front();
+        }
+        return nullptr;
+    }
+
+    void WorkerMain(uint32 idx)
+    {
+        thread_idx = idx;
+        while (true)
+        {
+            SharedPtr<JobGroup> group;
+            {
+                std::unique_lock lock(mutex);
+                wake_condition.wait(lock, [] { return is_shutting_down || pending_groups.empty() == false; });
+                if (is_shutting_down)
+                {
+                    return;
+                }
+                group = AcquireGroup();
+            }
+
+            if (group != nullptr)
+            {
+                ExecuteJobs(*group);
+            }
+        }
+    }
+}
+
+void jobs::Init(uint32 num_workers)
+{
+    CHECK(workers.empty());
+    if (num_workers == 0)
+    {
+        num_workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    LOG("Initializing job system with {} worker threads", num_workers);
+    is_shutting_down = false;
+    workers.reserve(num_workers);
+    for (uint32 i = 0; i < num_workers; ++i)
+    {
+        workers.emplace_back(WorkerMain, i + 1);
+    }
+}
+
+void jobs::Shutdown()
+{
+    {
+        std::scoped_lock lock(mutex);
+        is_shutting_down = true;
+    }
+    wake_condition.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+    pending_groups.clear();
+}
+
+uint32 jobs::GetNumThreads()
+{
+    return static_cast<uint32>(workers.size()) + 1;
+}
+
+uint32 jobs::GetThreadIdx()
+{
+    return thread_idx;
+}
+
+void jobs::Dispatch(uint32 num_jobs, const std::function<void(uint32 job_idx)>& fn)
+{
+    if (num_jobs == 0)
+    {
+        return;
+    }
+
+    if (workers.empty() || num_jobs == 1)
+    {
+        for (uint32 i = 0; i < num_jobs; ++i)
+        {
+            fn(i);
+        }
+        return;
+    }
+
+    SharedPtr<JobGroup> group = MakeShared<JobGroup>();
+    group->fn = &fn;
+    group->num_jobs = num_jobs;
+    {
+        std::scoped_lock lock(mutex);
+        pending_groups.push_back(group);
+    }
+    wake_condition.notify_all();
+
+    // Help out, then keep running other pending jobs until ours are finished. This makes nested dispatches safe.
+    ExecuteJobs(*group);
+    while (group->num_finished.load(std::memory_order_acquire) < num_jobs)
+    {
+        SharedPtr<JobGroup> other_group;
+        {
+            std::scoped_lock lock(mutex);
+            other_group = AcquireGroup();
+        }
+
+        if (other_group == nullptr || ExecuteJobs(*other_group) == false)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void jobs::ParallelFor(uint32 count, uint32 min_batch_size, const std::function<void(uint32 begin, uint32 end)>& fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // A few batches per thread so uneven batches even out
+    static constexpr uint32 BATCHES_PER_THREAD = 4;
+    const uint32 max_batches = GetNumThreads() * BATCHES_PER_THREAD;
+    const uint32 batch_size = std::max({ 1u, min_batch_size, (count + max_batches - 1) / max_batches });
+    const uint32 num_batches = (count + batch_size - 1) / batch_size;
+
+    Dispatch(num_batches, [&](uint32 batch_idx)
+    {
+        const uint32 begin = batch_idx * batch_size;
+        const uint32 end = std::min(begin + batch_size, count);
+        fn(begin, end);
+    });
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace jobs
+{
+    /**
+     * @brief Spawns the worker threads. Without Init() all jobs run inline on the calling thread.
+     * @param num_workers Number of worker threads. 0 picks hardware concurrency - 1.
+     */
+    void Init(uint32 num_workers = 0);
+    void Shutdown();
+
+    // Workers + the calling thread
+    uint32 GetNumThreads();
+
+    /**
+     * @brief Index of the calling thread in [0, GetNumThreads()). 0 for the main thread.
+     * Useful to index per-thread scratch data.
+     */
+    uint32 GetThreadIdx();
+
+    /**
+     * @brief Runs fn(job_idx) for job_idx in [0, num_jobs) across all threads and blocks until all jobs are done.
+     * The calling thread participates, so this may be called from within a job.
+     */
+    void Dispatch(uint32 num_jobs, const std::function<void(uint32 job_idx)>& fn);
+
+    /**
+     * @brief Splits [0, count) into batches of at least min_batch_size elements and runs fn(begin, end) for each batch in parallel.
+     * Blocks until all batches are done.
+     */
+    void ParallelFor(uint32 count, uint32 min_batch_size, const std::function<void(uint32 begin, uint32 end)>& fn);
+}
@@ -236,6 +236,18 @@ Mat4 Mat4::Invert() const
     return XMMatrixInverse(&det, mat);
 }
 
+Mat4 Mat4::InvertPerspective() const
+{
+    // Row vectors: (x, y, z, 1) * P = (x * _11, y * _22, z * _33 + _43, z). Off center or oblique projections need Invert().
+    CHECK_MSG(_12 == 0.0f && _13 == 0.0f && _14 == 0.0f && _21 == 0.0f && _23 == 0.0f && _24 == 0.0f
+        && _31 == 0.0f && _32 == 0.0f && _34 == 1.0f && _41 == 0.0f && _42 == 0.0f && _44 == 0.0f && _43 != 0.0f,
+        "Matrix is not laid out like PerspectiveFovLH's");
+    return Mat4(1.0f / _11, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f / _22, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f / _43,
+        0.0f, 0.0f, 1.0f, -_33 / _43);
+}
+
 Mat4 Mat4::Translation(const Vec3& v)
 {
     return XMMatrixTranslation(v.x, v.y, v.z);
@@ -293,7 +305,7 @@ Mat4 Mat4::PerspectiveFovLH(float fov_y_rad, float aspect_ratio, float near_z, f
 
 Mat4 Mat4::OrthographicLH(float view_width, float view_height, float near_z, float far_z)
 {
-    return XMMatrixOrthographicLH(view_height, view_height, near_z, far_z);
+    return XMMatrixOrthographicLH(view_width, view_height, near_z, far_z);
 }
 
 Mat4 Mat4::OrthographicLH(float view_left, float view_right, float view_bottom, float view_top, float near_z, float far_z)
@@ -313,6 +325,126 @@ Mat4 operator*(const Mat4& mat_a, const Mat4& mat_b)
 
 //////////////////////////////////////////////////////////////////////////
 
+Affine3x4::Affine3x4(const Mat4& m)
+{
+    CHECK_MSG(std::abs(m._14) < 1e-5f && std::abs(m._24) < 1e-5f && std::abs(m._34) < 1e-5f && std::abs(m._44 - 1.0f) < 1e-5f,
+        "Matrix is not affine, last column is ({}, {}, {}, {})", m._14, m._24, m._34, m._44);
+    const XMMATRIX transposed = XMMatrixTranspose(XMLoadFloat4x4(&m));
+    XMStoreFloat4(&rows[0], transposed.r[0]);
+    XMStoreFloat4(&rows[1], transposed.r[1]);
+    XMStoreFloat4(&rows[2], transposed.r[2]);
+}
+
+Mat4 Affine3x4::ToMat4() const
+{
+    const XMMATRIX m(XMLoadFloat4(&rows[0]), XMLoadFloat4(&rows[1]), XMLoadFloat4(&rows[2]), g_XMIdentityR3);
+    return XMMatrixTranspose(m);
+}
+
+Vec3 Affine3x4::TransformPoint(const Vec3& p) const
+{
+    const XMVECTOR point = XMVectorSetW(XMLoadFloat3(&p), 1.0f);
+    return Vec3(
+        XMVectorGetX(XMVector4Dot(XMLoadFloat4(&rows[0]), point)),
+        XMVectorGetX(XMVector4Dot(XMLoadFloat4(&rows[1]), point)),
+        XMVectorGetX(XMVector4Dot(XMLoadFloat4(&rows[2]), point)));
+}
+
+Vec3 Affine3x4::TransformVector(const Vec3& v) const
+{
+    const XMVECTOR vec = XMLoadFloat3(&v);
+    return Vec3(
+        XMVectorGetX(XMVector3Dot(XMLoadFloat4(&rows[0]), vec)),
+        XMVectorGetX(XMVector3Dot(XMLoadFloat4(&rows[1]), vec)),
+        XMVectorGetX(XMVector3Dot(XMLoadFloat4(&rows[2]), vec)));
+}
+
+Affine3x4 Affine3x4::InverseOrthonormal() const
+{
+    const XMVECTOR row_0 = XMLoadFloat4(&rows[0]);
+    const XMVECTOR row_1 = XMLoadFloat4(&rows[1]);
+    const XMVECTOR row_2 = XMLoadFloat4(&rows[2]);
+
+    // Columns of the 3x3 part become the rows of the inverse, w is zero after the transpose
+    const XMMATRIX transposed = XMMatrixTranspose(XMMATRIX(row_0, row_1, row_2, XMVectorZero()));
+
+    // -R^T * t, one lane per output component
+    XMVECTOR translation = XMVectorMultiply(row_0, XMVectorSplatW(row_0));
+    translation = XMVectorMultiplyAdd(row_1, XMVectorSplatW(row_1), translation);
+    translation = XMVectorMultiplyAdd(row_2, XMVectorSplatW(row_2), translation);
+    translation = XMVectorNegate(translation);
+
+    Affine3x4 out;
+    XMStoreFloat4(&out.rows[0], XMVectorSelect(transposed.r[0], XMVectorSplatX(translation), g_XMSelect0001));
+    XMStoreFloat4(&out.rows[1], XMVectorSelect(transposed.r[1], XMVectorSplatY(translation), g_XMSelect0001));
+    XMStoreFloat4(&out.rows[2], XMVectorSelect(transposed.r[2], XMVectorSplatZ(translation), g_XMSelect0001));
+    return out;
+}
+
+Affine3x4 Affine3x4::InverseAffine() const
+{
+    const XMVECTOR row_0 = XMLoadFloat4(&rows[0]);
+    const XMVECTOR row_1 = XMLoadFloat4(&rows[1]);
+    const XMVECTOR row_2 = XMLoadFloat4(&rows[2]);
+
+    // Rows of the inverse 3x3 part are the cross products of its columns, divided by the determinant
+    const XMMATRIX transposed = XMMatrixTranspose(XMMATRIX(row_0, row_1, row_2, XMVectorZero()));
+    const XMVECTOR column_0 = transposed.r[0];
+    const XMVECTOR column_1 = transposed.r[1];
+    const XMVECTOR column_2 = transposed.r[2];
+    const XMVECTOR translation = transposed.r[3];
+
+    const XMVECTOR cross_12 = XMVector3Cross(column_1, column_2);
+    const XMVECTOR det = XMVector3Dot(column_0, cross_12);
+    CHECK_MSG(std::abs(XMVectorGetX(det)) > 1e-12f, "Affine transform is not invertible");
+    const XMVECTOR inv_det = XMVectorReciprocal(det);
+
+    const XMVECTOR inv_row_0 = XMVectorMultiply(cross_12, inv_det);
+    const XMVECTOR inv_row_1 = XMVectorMultiply(XMVector3Cross(column_2, column_0), inv_det);
+    const XMVECTOR inv_row_2 = XMVectorMultiply(XMVector3Cross(column_0, column_1), inv_det);
+
+    Affine3x4 out;
+    XMStoreFloat4(&out.rows[0], XMVectorSelect(inv_row_0, XMVectorNegate(XMVector3Dot(inv_row_0, translation)), g_XMSelect0001));
+    XMStoreFloat4(&out.rows[1], XMVectorSelect(inv_row_1, XMVectorNegate(XMVector3Dot(inv_row_1, translation)), g_XMSelect0001));
+    XMStoreFloat4(&out.rows[2], XMVectorSelect(inv_row_2, XMVectorNegate(XMVector3Dot(inv_row_2, translation)), g_XMSelect0001));
+    return out;
+}
+
+Affine3x4 Affine3x4::SRT(const Vec3& scaling, const Quat& rotation, const Vec3& translation)
+{
+    // Affine by construction, so this skips the checked conversion from Mat4
+    const XMMATRIX transposed = XMMatrixTranspose(Mat4::SRT(scaling, rotation, translation));
+    Affine3x4 out;
+    XMStoreFloat4(&out.rows[0], transposed.r[0]);
+    XMStoreFloat4(&out.rows[1], transposed.r[1]);
+    XMStoreFloat4(&out.rows[2], transposed.r[2]);
+    return out;
+}
+
+const Affine3x4 Affine3x4::IDENTITY = {};
+
+Affine3x4 operator*(const Affine3x4& a, const Affine3x4& b)
+{
+    // In column form the result is B * A, each row of B picks a combination of A's rows plus its own translation
+    const XMVECTOR a_row_0 = XMLoadFloat4(&a.rows[0]);
+    const XMVECTOR a_row_1 = XMLoadFloat4(&a.rows[1]);
+    const XMVECTOR a_row_2 = XMLoadFloat4(&a.rows[2]);
+
+    Affine3x4 out;
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        const XMVECTOR b_row = XMLoadFloat4(&b.rows[i]);
+        XMVECTOR result = XMVectorMultiply(XMVectorSplatX(b_row), a_row_0);
+        result = XMVectorMultiplyAdd(XMVectorSplatY(b_row), a_row_1, result);
+        result = XMVectorMultiplyAdd(XMVectorSplatZ(b_row), a_row_2, result);
+        result = XMVectorMultiplyAdd(XMVectorSplatW(b_row), g_XMIdentityR3, result);
+        XMStoreFloat4(&out.rows[i], result);
+    }
+    return out;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void Quat::Normalize()
 {
     const XMVECTOR q = XMLoadFloat4(this);
@@ -413,9 +545,9 @@ Quat Quat::Lerp(const Quat& a, const Quat& b, float t)
 //////////////////////////////////////////////////////////////////////////
 
 Box::Box(float in_min_x, float in_max_x, float in_min_y, float in_max_y, float in_min_z, float in_max_z) :
-    min_x(in_min_x), max_x(in_min_x),
-    min_y(in_min_y), max_y(in_min_y),
-    min_z(in_min_z), max_z(in_min_z)
+    min_x(in_min_x), max_x(in_max_x),
+    min_y(in_min_y), max_y(in_max_y),
+    min_z(in_min_z), max_z(in_max_z)
 {
     center = CalculateCenter();
 }
@@ -439,3 +571,136 @@ Vec3 Box::CalculateCenter()
     const Vec3 center = { (min_x + max_x) * 0.5f, (min_y + max_y) * 0.5f, (min_z + max_z) * 0.5f };
     return center;
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+Vec3 Ray::GetInverseDirection() const
+{
+    static constexpr float MAX = std::numeric_limits<float>::max();
+    return Vec3(std::clamp(1.0f / direction.x, -MAX, MAX), std::clamp(1.0f / direction.y, -MAX, MAX), std::clamp(1.0f / direction.z, -MAX, MAX));
+}
+
+bool Ray::IntersectBox(const Box& box, float& out_distance) const
+{
+    // Finite, so every t is a number and the min / max below don't depend on operand order
+    const Vec3 inv_dir = GetInverseDirection();
+    const float t_x1 = (box.min_x - origin.x) * inv_dir.x;
+    const float t_x2 = (box.max_x - origin.x) * inv_dir.x;
+    const float t_y1 = (box.min_y - origin.y) * inv_dir.y;
+    const float t_y2 = (box.max_y - origin.y) * inv_dir.y;
+    const float t_z1 = (box.min_z - origin.z) * inv_dir.z;
+    const float t_z2 = (box.max_z - origin.z) * inv_dir.z;
+    const float t_entry = std::max({ std::min(t_x1, t_x2), std::min(t_y1, t_y2), std::min(t_z1, t_z2), 0.0f });
+    const float t_exit = std::min({ std::max(t_x1, t_x2), std::max(t_y1, t_y2), std::max(t_z1, t_z2), max_distance });
+    out_distance = t_entry;
+    return t_entry <= t_exit;
+}
+
+bool Ray::IntersectTriangle(const Vec3& v0, const Vec3& v1, const Vec3& v2, float& out_distance, float& out_u, float& out_v) const
+{
+    const XMVECTOR ray_origin = XMLoadFloat3(&origin);
+    const XMVECTOR ray_direction = XMLoadFloat3(&direction);
+    const XMVECTOR p0 = XMLoadFloat3(&v0);
+    const XMVECTOR edge_1 = XMVectorSubtract(XMLoadFloat3(&v1), p0);
+    const XMVECTOR edge_2 = XMVectorSubtract(XMLoadFloat3(&v2), p0);
+
+    const XMVECTOR p = XMVector3Cross(ray_direction, edge_2);
+    const float det = XMVectorGetX(XMVector3Dot(edge_1, p));
+    if (std::abs(det) < 1e-12f)
+    {
+        return false;
+    }
+
+    const float inv_det = 1.0f / det;
+    const XMVECTOR s = XMVectorSubtract(ray_origin, p0);
+    const float u = XMVectorGetX(XMVector3Dot(s, p)) * inv_det;
+    if (u < 0.0f || u > 1.0f)
+    {
+        return false;
+    }
+
+    const XMVECTOR q = XMVector3Cross(s, edge_1);
+    const float v = XMVectorGetX(XMVector3Dot(ray_direction, q)) * inv_det;
+    if (v < 0.0f || u + v > 1.0f)
+    {
+        return false;
+    }
+
+    const float t = XMVectorGetX(XMVector3Dot(edge_2, q)) * inv_det;
+    if (t < 0.0f || t > max_distance)
+    {
+        return false;
+    }
+
+    out_distance = t;
+    out_u = u;
+    out_v = v;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+Frustum::Frustum(const Mat4& m)
+{
+    const Plane column_1 = { m._11, m._21, m._31, m._41 };
+    const Plane column_2 = { m._12, m._22, m._32, m._42 };
+    const Plane column_3 = { m._13, m._23, m._33, m._43 };
+    const Plane column_4 = { m._14, m._24, m._34, m._44 };
+    const auto add = [](const Plane& a, const Plane& b) { return Plane{ a.nx + b.nx, a.ny + b.ny, a.nz + b.nz, a.d + b.d }; };
+    const auto sub = [](const Plane& a, const Plane& b) { return Plane{ a.nx - b.nx, a.ny - b.ny, a.nz - b.nz, a.d - b.d }; };
+    planes = {
+        add(column_4, column_1),
+        sub(column_4, column_1),
+        add(column_4, column_2),
+        sub(column_4, column_2),
+        column_3,
+        sub(column_4, column_3)
+    };
+}
+
+bool Frustum::Intersects(const Box& box) const
+{
+    const float center_x = (box.min_x + box.max_x) * 0.5f;
+    const float center_y = (box.min_y + box.max_y) * 0.5f;
+    const float center_z = (box.min_z + box.max_z) * 0.5f;
+    const float extent_x = (box.max_x - box.min_x) * 0.5f;
+    const float extent_y = (box.max_y - box.min_y) * 0.5f;
+    const float extent_z = (box.max_z - box.min_z) * 0.5f;
+
+    for (const Plane& plane : planes)
+    {
+        const float distance = plane.nx * center_x + plane.ny * center_y + plane.nz * center_z + plane.d;
+        const float radius = std::abs(plane.nx) * extent_x + std::abs(plane.ny) * extent_y + std::abs(plane.nz) * extent_z;
+        if (distance + radius < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+Containment Frustum::Classify(const Box& box) const
+{
+    const float center_x = (box.min_x + box.max_x) * 0.5f;
+    const float center_y = (box.min_y + box.max_y) * 0.5f;
+    const float center_z = (box.min_z + box.max_z) * 0.5f;
+    const float extent_x = (box.max_x - box.min_x) * 0.5f;
+    const float extent_y = (box.max_y - box.min_y) * 0.5f;
+    const float extent_z = (box.max_z - box.min_z) * 0.5f;
+
+    Containment result = Containment::INSIDE;
+    for (const Plane& plane : planes)
+    {
+        const float distance = plane.nx * center_x + plane.ny * center_y + plane.nz * center_z + plane.d;
+        const float radius = std::abs(plane.nx) * extent_x + std::abs(plane.ny) * extent_y + std::abs(plane.nz) * extent_z;
+        if (distance + radius < 0.0f)
+        {
+            return Containment::OUTSIDE;
+        }
+        if (distance - radius < 0.0f)
+        {
+            result = Containment::INTERSECTS;
+        }
+    }
+    return result;
+}
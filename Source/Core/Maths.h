@@ -276,6 +276,12 @@ struct Mat4 : public DirectX::XMFLOAT4X4
     Mat4 Transpose() const;
     Mat4 Invert() const;
 
+    /**
+     * @brief Closed form inverse for matrices laid out like PerspectiveFovLH's, skips Invert()'s general 4x4 inverse.
+     * Checks the layout, off center and oblique projections have to use Invert().
+     */
+    Mat4 InvertPerspective() const;
+
     static Mat4 Translation(const Vec3& v);
     static Mat4 Translation(float x, float y, float z);
     static Mat4 RotationX(float rad);
@@ -435,9 +441,56 @@ Mat4 operator* (const Mat4& mat_a, const Mat4& mat_b);
 
 //////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief Affine transform without the constant last column of a Mat4, 48 instead of 64 bytes.
+ * Stored transposed, so each row yields one component of the result: p'.x = dot(rows[0], (p, 1)) and so on.
+ * This matches a row_major float3x4 in HLSL used as mul(m, float4(p, 1)).
+ * Composition follows Mat4's row vector order, a * b applies a first.
+ */
+struct Affine3x4
+{
+    Affine3x4() = default;
+
+    /**
+     * @brief The last column of m has to be (0, 0, 0, 1).
+     */
+    explicit Affine3x4(const Mat4& m);
+
+    Mat4 ToMat4() const;
+
+    Vec3 TransformPoint(const Vec3& p) const;
+    Vec3 TransformVector(const Vec3& v) const;
+
+    Vec3 GetTranslation() const
+    {
+        return { rows[0].w, rows[1].w, rows[2].w };
+    }
+
+    /**
+     * @brief Inverse of a rotation plus translation, the rotation is simply transposed. Wrong for scaled or sheared transforms.
+     */
+    Affine3x4 InverseOrthonormal() const;
+
+    /**
+     * @brief Inverse of any invertible affine transform, the 3x3 part is inverted via cross products.
+     */
+    Affine3x4 InverseAffine() const;
+
+    static Affine3x4 SRT(const Vec3& scaling, const Quat& rotation, const Vec3& translation);
+
+    Vec4 rows[3] = { Vec4(1.0f, 0.0f, 0.0f, 0.0f), Vec4(0.0f, 1.0f, 0.0f, 0.0f), Vec4(0.0f, 0.0f, 1.0f, 0.0f) };
+
+    static const Affine3x4 IDENTITY;
+};
+static_assert(sizeof(Affine3x4) == 48, "Affine3x4 is uploaded as float3x4");
+
+Affine3x4 operator* (const Affine3x4& a, const Affine3x4& b);
+
+//////////////////////////////////////////////////////////////////////////
+
 struct Box
 {
-    Box();
+    Box() = default;
 
     Box(float in_min_x, float in_max_x,
         float in_min_y, float in_max_y,
@@ -447,7 +500,7 @@ struct Box
 
     float getWidth() { return std::abs(max_x - min_x); }
     float getHeight() { return std::abs(max_y - min_y); }
-    float getDepth() { return std::abs(max_z - min_y); }
+    float getDepth() { return std::abs(max_z - min_z); }
 
     Vec3 center = Vec3::ZERO;
     float min_x = std::numeric_limits<float>::max();
@@ -468,3 +521,72 @@ struct Sphere
     Vec3 center = Vec3::ZERO;
     float radius = 0.0f;
 };
+
+//////////////////////////////////////////////////////////////////////////
+
+struct Ray
+{
+    Ray() = default;
+    Ray(const Vec3& in_origin, const Vec3& in_direction, float in_max_distance = std::numeric_limits<float>::max())
+        : origin(in_origin), direction(in_direction), max_distance(in_max_distance) {}
+
+    Vec3 GetPoint(float distance) const
+    {
+        return { origin.x + direction.x * distance, origin.y + direction.y * distance, origin.z + direction.z * distance };
+    }
+
+    /**
+     * @brief 1 / direction for slab tests, clamped to +-FLT_MAX. An infinity for a zero component would turn into NaN
+     * when multiplied by the zero distance of an origin lying on a slab plane.
+     */
+    Vec3 GetInverseDirection() const;
+
+    /**
+     * @brief Slab test. out_distance is where the ray enters the box, 0 if it starts inside.
+     */
+    bool IntersectBox(const Box& box, float& out_distance) const;
+
+    /**
+     * @brief Two sided Moeller-Trumbore test. out_u and out_v are the barycentrics of v1 and v2.
+     */
+    bool IntersectTriangle(const Vec3& v0, const Vec3& v1, const Vec3& v2, float& out_distance, float& out_u, float& out_v) const;
+
+    Vec3 origin = Vec3::ZERO;
+    Vec3 direction = Vec3::FORWARD;     // Distances are in multiples of it, so it doesn't have to be normalized
+    float max_distance = std::numeric_limits<float>::max();
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Plane n.x * x + n.y * y + n.z * z + d, inside where positive. Not normalized.
+ */
+struct Plane
+{
+    float nx = 0.0f;
+    float ny = 0.0f;
+    float nz = 0.0f;
+    float d = 0.0f;
+};
+
+enum class Containment : uint8
+{
+    OUTSIDE,
+    INTERSECTS,
+    INSIDE
+};
+
+/**
+ * @brief Planes of a view projection matrix, extracted with Gribb / Hartmann for row vectors and D3D's [0, w] depth range.
+ * Box tests are conservative: boxes near a frustum corner may pass although they are outside.
+ */
+struct Frustum
+{
+    explicit Frustum(const Mat4& view_projection);
+
+    bool Intersects(const Box& box) const;
+    Containment Classify(const Box& box) const;
+
+    // Left, right, bottom, top, near, far
+    std::array<Plane, 6> planes;
+};
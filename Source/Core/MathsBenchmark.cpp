@@ -0,0 +1,110 @@
+#include "Core/MathsBenchmark.h"
+
+#include <chrono>
+#include <random>
+
+namespace
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    double ElapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    float MaxDifference(const Mat4& a, const Mat4& b)
+    {
+        float max_difference = 0.0f;
+        for (uint32 row = 0; row < 4; ++row)
+        {
+            for (uint32 column = 0; column < 4; ++column)
+            {
+                max_difference = std::max(max_difference, std::abs(a.m[row][column] - b.m[row][column]));
+            }
+        }
+        return max_difference;
+    }
+
+    /**
+     * @brief Runs invert_fn over all inputs num_iterations times.
+     * @return Nanoseconds per inverse
+     */
+    template<typename InputType, typename OutputType, typename InvertFunction>
+    double TimeInverse(const std::vector<InputType>& inputs, std::vector<OutputType>& outputs, uint32 num_iterations, InvertFunction&& invert_fn)
+    {
+        const auto start = Clock::now();
+        for (uint32 iteration = 0; iteration < num_iterations; ++iteration)
+        {
+            for (size_t i = 0; i < inputs.size(); ++i)
+            {
+                outputs[i] = invert_fn(inputs[i]);
+            }
+        }
+        return ElapsedMs(start) * 1e6 / (static_cast<double>(inputs.size()) * num_iterations);
+    }
+}
+
+void RunInverseBenchmark(uint32 num_transforms, uint32 num_iterations)
+{
+    CHECK(num_transforms > 0 && num_iterations > 0);
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> angle(-PI, PI);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+    // Transforms like the scene's entities, plus rigid ones like views
+    std::vector<Mat4> matrices(num_transforms);
+    std::vector<Affine3x4> transforms(num_transforms);
+    std::vector<Affine3x4> rigid_transforms(num_transforms);
+    std::vector<Mat4> rigid_matrices(num_transforms);
+    std::vector<Mat4> view_projections(num_transforms);
+    const Mat4 projection = Mat4::PerspectiveFovLH(MathUtils::DegToRad(90.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    for (uint32 i = 0; i < num_transforms; ++i)
+    {
+        const Quat rotation = Quat::FromPitchYawRoll(angle(rng), angle(rng), angle(rng));
+        const Vec3 translation(position(rng), position(rng), position(rng));
+        transforms[i] = Affine3x4::SRT(Vec3(scale(rng), scale(rng), scale(rng)), rotation, translation);
+        matrices[i] = transforms[i].ToMat4();
+        rigid_transforms[i] = Affine3x4::SRT(Vec3::ONE, rotation, translation);
+        rigid_matrices[i] = rigid_transforms[i].ToMat4();
+        view_projections[i] = rigid_matrices[i] * projection;
+    }
+
+    std::vector<Mat4> general_inverses(num_transforms);
+    std::vector<Affine3x4> affine_inverses(num_transforms);
+    const double general_ns = TimeInverse(matrices, general_inverses, num_iterations, [](const Mat4& m) { return m.Invert(); });
+    const double affine_ns = TimeInverse(transforms, affine_inverses, num_iterations, [](const Affine3x4& m) { return m.InverseAffine(); });
+    float max_affine_difference = 0.0f;
+    for (uint32 i = 0; i < num_transforms; ++i)
+    {
+        max_affine_difference = std::max(max_affine_difference, MaxDifference(affine_inverses[i].ToMat4(), general_inverses[i]));
+    }
+
+    std::vector<Mat4> rigid_general_inverses(num_transforms);
+    const double rigid_general_ns = TimeInverse(rigid_matrices, rigid_general_inverses, num_iterations, [](const Mat4& m) { return m.Invert(); });
+    const double orthonormal_ns = TimeInverse(rigid_transforms, affine_inverses, num_iterations, [](const Affine3x4& m) { return m.InverseOrthonormal(); });
+    float max_orthonormal_difference = 0.0f;
+    for (uint32 i = 0; i < num_transforms; ++i)
+    {
+        max_orthonormal_difference = std::max(max_orthonormal_difference, MaxDifference(affine_inverses[i].ToMat4(), rigid_general_inverses[i]));
+    }
+
+    // Camera caches the projection inverse, so only the view is inverted per view projection
+    const Mat4 inv_projection = projection.InvertPerspective();
+    const double view_projection_ns = TimeInverse(view_projections, general_inverses, num_iterations, [](const Mat4& m) { return m.Invert(); });
+    const double split_view_projection_ns = TimeInverse(rigid_transforms, rigid_general_inverses, num_iterations,
+        [&inv_projection](const Affine3x4& view) { return inv_projection * view.InverseAffine().ToMat4(); });
+    float max_view_projection_difference = 0.0f;
+    for (uint32 i = 0; i < num_transforms; ++i)
+    {
+        max_view_projection_difference = std::max(max_view_projection_difference, MaxDifference(rigid_general_inverses[i], general_inverses[i]));
+    }
+
+    LOG("Inverse benchmark: {} transforms, {} iterations", num_transforms, num_iterations);
+    LOG("Scaled: Mat4::Invert {:.2f} ns, InverseAffine {:.2f} ns ({:.2f}x), max difference {:.2e}",
+        general_ns, affine_ns, general_ns / affine_ns, max_affine_difference);
+    LOG("Rigid: Mat4::Invert {:.2f} ns, InverseOrthonormal {:.2f} ns ({:.2f}x), max difference {:.2e}",
+        rigid_general_ns, orthonormal_ns, rigid_general_ns / orthonormal_ns, max_orthonormal_difference);
+    LOG("View projection: Mat4::Invert {:.2f} ns, inverse(P) * inverse(V) {:.2f} ns ({:.2f}x), max difference {:.2e}",
+        view_projection_ns, split_view_projection_ns, view_projection_ns / split_view_projection_ns, max_view_projection_difference);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+/**
+ * @brief Times Mat4::Invert() against the Affine3x4 inverses for random scale, rotation and translation transforms, and
+ * the general inverse of a view projection against Camera's inverse(P) * inverse(V). Logs the cost per inverse and the
+ * largest deviation from the general inverse.
+ * Runs without a window or device.
+ */
+void RunInverseBenchmark(uint32 num_transforms = 1000000, uint32 num_iterations = 16);
@@ -0,0 +1,141 @@
+#include "Core/RadixSort.h"
+
+#include "Core/JobSystem.h"
+
+namespace
+{
+    constexpr uint32 RADIX_BITS = 8;
+    constexpr uint32 RADIX_SIZE = 1 << RADIX_BITS;
+    constexpr uint32 NUM_PASSES = 64 / RADIX_BITS;
+
+    // Below this a single chunk is faster than the overhead of going wide
+    constexpr uint32 MIN_ENTRIES_PER_CHUNK = 16 * 1024;
+
+    using Histogram = std::array<uint32, RADIX_SIZE>;
+
+    inline uint32 GetDigit(uint64 key, uint32 pass)
+    {
+        return static_cast<uint32>(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1);
+    }
+}
+
+void RadixSort(std::vector<RadixSortEntry>& entries, std::vector<RadixSortEntry>& scratch)
+{
+    const uint32 count = static_cast<uint32>(entries.size());
+    if (count < 2)
+    {
+        return;
+    }
+
+    scratch.resize(count);
+
+    const uint32 num_chunks = std::clamp(count / MIN_ENTRIES_PER_CHUNK, 1u, jobs::GetNumThreads());
+    const uint32 chunk_size = (count + num_chunks - 1) / num_chunks;
+
+    // Histograms for all passes in one read over the input. Their totals don't depend on the order, so they decide which passes
+    // are skipped. Per chunk they're only valid for the first executed pass, later passes read chunks of the permuted entries.
+    std::vector<std::array<Histogram, NUM_PASSES>> chunk_histograms(num_chunks);
+    jobs::Dispatch(num_chunks, [&](uint32 chunk_idx)
+    {
+        std::array<Histogram, NUM_PASSES>& histograms = chunk_histograms[chunk_idx];
+        for (Histogram& histogram : histograms)
+        {
+            histogram.fill(0);
+        }
+
+        const uint32 begin = chunk_idx * chunk_size;
+        const uint32 end = std::min(begin + chunk_size, count);
+        for (uint32 i = begin; i < end; ++i)
+        {
+            const uint64 key = entries[i].key;
+            for (uint32 pass = 0; pass < NUM_PASSES; ++pass)
+            {
+                ++histograms[pass][GetDigit(key, pass)];
+            }
+        }
+    });
+
+    RadixSortEntry* src = entries.data();
+    RadixSortEntry* dst = scratch.data();
+    std::vector<Histogram> chunk_counts(num_chunks);
+    std::vector<Histogram> chunk_offsets(num_chunks);
+    bool is_first_pass = true;
+
+    for (uint32 pass = 0; pass < NUM_PASSES; ++pass)
+    {
+        // Skip passes where every key has the same digit, they wouldn't change the order
+        bool is_trivial_pass = false;
+        for (uint32 digit = 0; digit < RADIX_SIZE; ++digit)
+        {
+            uint32 total = 0;
+            for (uint32 chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx)
+            {
+                total += chunk_histograms[chunk_idx][pass][digit];
+            }
+
+            if (total != 0)
+            {
+                is_trivial_pass = total == count;
+                break;
+            }
+        }
+
+        if (is_trivial_pass)
+        {
+            continue;
+        }
+
+        if (is_first_pass || num_chunks == 1)
+        {
+            for (uint32 chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx)
+            {
+                chunk_counts[chunk_idx] = chunk_histograms[chunk_idx][pass];
+            }
+        }
+        else
+        {
+            jobs::Dispatch(num_chunks, [&](uint32 chunk_idx)
+            {
+                Histogram& counts = chunk_counts[chunk_idx];
+                counts.fill(0);
+                const uint32 begin = chunk_idx * chunk_size;
+                const uint32 end = std::min(begin + chunk_size, count);
+                for (uint32 i = begin; i < end; ++i)
+                {
+                    ++counts[GetDigit(src[i].key, pass)];
+                }
+            });
+        }
+        is_first_pass = false;
+
+        // Exclusive prefix sum, digit major, chunk minor. Keeps the sort stable across chunks.
+        uint32 offset = 0;
+        for (uint32 digit = 0; digit < RADIX_SIZE; ++digit)
+        {
+            for (uint32 chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx)
+            {
+                chunk_offsets[chunk_idx][digit] = offset;
+                offset += chunk_counts[chunk_idx][digit];
+            }
+        }
+
+        jobs::Dispatch(num_chunks, [&](uint32 chunk_idx)
+        {
+            Histogram& offsets = chunk_offsets[chunk_idx];
+            const uint32 begin = chunk_idx * chunk_size;
+            const uint32 end = std::min(begin + chunk_size, count);
+            for (uint32 i = begin; i < end; ++i)
+            {
+                dst[offsets[GetDigit(src[i].key, pass)]++] = src[i];
+            }
+        });
+
+        std::swap(src, dst);
+    }
+
+    // Odd number of executed passes leaves the result in scratch
+    if (src != entries.data())
+    {
+        std::copy(scratch.begin(), scratch.end(), entries.begin());
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+struct RadixSortEntry
+{
+    uint64 key = 0;
+    uint32 value = 0;   // Payload, usually an index into the array being sorted
+};
+
+/**
+ * @brief Stable LSD radix sort on 64-bit keys, 8 bits per pass.
+ * Histograms and scatters are parallelized over chunks of the input via the job system.
+ * Passes where all keys share the same digit are skipped, so keys only using a few bits only pay for those.
+ * @param entries Entries to sort. Sorted in place.
+ * @param scratch Temporary storage, resized as needed. Keep it around between calls to avoid reallocations.
+ */
+void RadixSort(std::vector<RadixSortEntry>& entries, std::vector<RadixSortEntry>& scratch);
@@ -0,0 +1,192 @@
+#pragma once
+#include <span>
+
+#include "Core/SimdLanes.h"
+
+/**
+ * @brief Eight rays in SoA layout, one per SIMD lane. For coherent rays, e.g. a tile of camera rays or the rays of a probe.
+ * Lanes without a ray have a negative max distance, which no intersection test accepts.
+ */
+struct alignas(32) RayPacket
+{
+    float origin_x[simd::NUM_LANES];
+    float origin_y[simd::NUM_LANES];
+    float origin_z[simd::NUM_LANES];
+    float dir_x[simd::NUM_LANES];
+    float dir_y[simd::NUM_LANES];
+    float dir_z[simd::NUM_LANES];
+    float inv_dir_x[simd::NUM_LANES];
+    float inv_dir_y[simd::NUM_LANES];
+    float inv_dir_z[simd::NUM_LANES];
+    float max_distance[simd::NUM_LANES];
+
+    // Up to NUM_LANES rays
+    static RayPacket Load(std::span<const Ray> rays)
+    {
+        CHECK(rays.size() <= simd::NUM_LANES);
+        RayPacket packet;
+        for (uint32 lane = 0; lane < simd::NUM_LANES; ++lane)
+        {
+            const Ray ray = lane < rays.size() ? rays[lane] : Ray(Vec3::ZERO, Vec3::FORWARD, -1.0f);
+            packet.origin_x[lane] = ray.origin.x;
+            packet.origin_y[lane] = ray.origin.y;
+            packet.origin_z[lane] = ray.origin.z;
+            packet.dir_x[lane] = ray.direction.x;
+            packet.dir_y[lane] = ray.direction.y;
+            packet.dir_z[lane] = ray.direction.z;
+            const Vec3 inv_dir = ray.GetInverseDirection();
+            packet.inv_dir_x[lane] = inv_dir.x;
+            packet.inv_dir_y[lane] = inv_dir.y;
+            packet.inv_dir_z[lane] = inv_dir.z;
+            packet.max_distance[lane] = ray.max_distance;
+        }
+        return packet;
+    }
+};
+
+/**
+ * @brief Eight triangles in SoA layout as v0 and the edges to v1 and v2. Unused lanes are degenerate and never hit.
+ */
+struct alignas(32) TriangleLanes
+{
+    float v0_x[simd::NUM_LANES] = {};
+    float v0_y[simd::NUM_LANES] = {};
+    float v0_z[simd::NUM_LANES] = {};
+    float edge_1_x[simd::NUM_LANES] = {};
+    float edge_1_y[simd::NUM_LANES] = {};
+    float edge_1_z[simd::NUM_LANES] = {};
+    float edge_2_x[simd::NUM_LANES] = {};
+    float edge_2_y[simd::NUM_LANES] = {};
+    float edge_2_z[simd::NUM_LANES] = {};
+};
+
+// Per lane distance and barycentrics of v1 and v2
+struct TriangleLaneHits
+{
+    simd::FloatLanes distance;
+    simd::FloatLanes u;
+    simd::FloatLanes v;
+};
+
+namespace ray_kernels
+{
+    static inline constexpr float MIN_DETERMINANT = 1e-12f;
+
+    /**
+     * @brief Slab test of all rays of the packet against one box.
+     * @return Bit i is set if ray i enters the box within its max distance, out_entry holds where
+     */
+    inline uint32 IntersectBox(const RayPacket& packet, float min_x, float min_y, float min_z, float max_x, float max_y, float max_z, simd::FloatLanes& out_entry)
+    {
+        using namespace simd;
+        const FloatLanes origin_x = Load(packet.origin_x);
+        const FloatLanes origin_y = Load(packet.origin_y);
+        const FloatLanes origin_z = Load(packet.origin_z);
+        const FloatLanes inv_dir_x = Load(packet.inv_dir_x);
+        const FloatLanes inv_dir_y = Load(packet.inv_dir_y);
+        const FloatLanes inv_dir_z = Load(packet.inv_dir_z);
+
+        const FloatLanes t_x1 = (Splat(min_x) - origin_x) * inv_dir_x;
+        const FloatLanes t_x2 = (Splat(max_x) - origin_x) * inv_dir_x;
+        const FloatLanes t_y1 = (Splat(min_y) - origin_y) * inv_dir_y;
+        const FloatLanes t_y2 = (Splat(max_y) - origin_y) * inv_dir_y;
+        const FloatLanes t_z1 = (Splat(min_z) - origin_z) * inv_dir_z;
+        const FloatLanes t_z2 = (Splat(max_z) - origin_z) * inv_dir_z;
+
+        const FloatLanes entry = Max(Max(Min(t_x1, t_x2), Min(t_y1, t_y2)), Max(Min(t_z1, t_z2), Splat(0.0f)));
+        const FloatLanes exit = Min(Min(Max(t_x1, t_x2), Max(t_y1, t_y2)), Min(Max(t_z1, t_z2), Load(packet.max_distance)));
+        out_entry = entry;
+        return MoveMask(entry <= exit);
+    }
+
+    inline uint32 IntersectBox(const RayPacket& packet, const Box& box, simd::FloatLanes& out_entry)
+    {
+        return IntersectBox(packet, box.min_x, box.min_y, box.min_z, box.max_x, box.max_y, box.max_z, out_entry);
+    }
+
+    /**
+     * @brief Moeller-Trumbore for all rays of the packet against one triangle, two sided.
+     * @return Bit i is set if ray i hits the triangle within its max distance
+     */
+    inline uint32 IntersectTriangle(const RayPacket& packet, const Vec3& v0, const Vec3& edge_1, const Vec3& edge_2, TriangleLaneHits& out_hits)
+    {
+        using namespace simd;
+        const FloatLanes dir_x = Load(packet.dir_x);
+        const FloatLanes dir_y = Load(packet.dir_y);
+        const FloatLanes dir_z = Load(packet.dir_z);
+        const FloatLanes e1_x = Splat(edge_1.x);
+        const FloatLanes e1_y = Splat(edge_1.y);
+        const FloatLanes e1_z = Splat(edge_1.z);
+        const FloatLanes e2_x = Splat(edge_2.x);
+        const FloatLanes e2_y = Splat(edge_2.y);
+        const FloatLanes e2_z = Splat(edge_2.z);
+
+        // p = dir x edge_2, det = edge_1 . p
+        const FloatLanes p_x = dir_y * e2_z - dir_z * e2_y;
+        const FloatLanes p_y = dir_z * e2_x - dir_x * e2_z;
+        const FloatLanes p_z = dir_x * e2_y - dir_y * e2_x;
+        const FloatLanes det = e1_x * p_x + e1_y * p_y + e1_z * p_z;
+        const FloatLanes inv_det = Splat(1.0f) / det;
+
+        const FloatLanes s_x = Load(packet.origin_x) - Splat(v0.x);
+        const FloatLanes s_y = Load(packet.origin_y) - Splat(v0.y);
+        const FloatLanes s_z = Load(packet.origin_z) - Splat(v0.z);
+        const FloatLanes u = (s_x * p_x + s_y * p_y + s_z * p_z) * inv_det;
+
+        // q = s x edge_1
+        const FloatLanes q_x = s_y * e1_z - s_z * e1_y;
+        const FloatLanes q_y = s_z * e1_x - s_x * e1_z;
+        const FloatLanes q_z = s_x * e1_y - s_y * e1_x;
+        const FloatLanes v = (dir_x * q_x + dir_y * q_y + dir_z * q_z) * inv_det;
+        const FloatLanes t = (e2_x * q_x + e2_y * q_y + e2_z * q_z) * inv_det;
+
+        const FloatLanes zero = Splat(0.0f);
+        const MaskLanes is_hit = (Max(det, zero - det) > Splat(MIN_DETERMINANT))
+            & (u >= zero) & (v >= zero) & (u + v <= Splat(1.0f))
+            & (t >= zero) & (t <= Load(packet.max_distance));
+        out_hits = { t, u, v };
+        return MoveMask(is_hit);
+    }
+
+    /**
+     * @brief Moeller-Trumbore for one ray against eight triangles, two sided.
+     * @return Bit i is set if the ray hits triangle i within max_distance
+     */
+    inline uint32 IntersectTriangles(const Ray& ray, float max_distance, const TriangleLanes& triangles, TriangleLaneHits& out_hits)
+    {
+        using namespace simd;
+        const FloatLanes dir_x = Splat(ray.direction.x);
+        const FloatLanes dir_y = Splat(ray.direction.y);
+        const FloatLanes dir_z = Splat(ray.direction.z);
+        const FloatLanes e1_x = Load(triangles.edge_1_x);
+        const FloatLanes e1_y = Load(triangles.edge_1_y);
+        const FloatLanes e1_z = Load(triangles.edge_1_z);
+        const FloatLanes e2_x = Load(triangles.edge_2_x);
+        const FloatLanes e2_y = Load(triangles.edge_2_y);
+        const FloatLanes e2_z = Load(triangles.edge_2_z);
+
+        const FloatLanes p_x = dir_y * e2_z - dir_z * e2_y;
+        const FloatLanes p_y = dir_z * e2_x - dir_x * e2_z;
+        const FloatLanes p_z = dir_x * e2_y - dir_y * e2_x;
+        const FloatLanes det = e1_x * p_x + e1_y * p_y + e1_z * p_z;
+        const FloatLanes inv_det = Splat(1.0f) / det;
+
+        const FloatLanes s_x = Splat(ray.origin.x) - Load(triangles.v0_x);
+        const FloatLanes s_y = Splat(ray.origin.y) - Load(triangles.v0_y);
+        const FloatLanes s_z = Splat(ray.origin.z) - Load(triangles.v0_z);
+        const FloatLanes u = (s_x * p_x + s_y * p_y + s_z * p_z) * inv_det;
+
+        const FloatLanes q_x = s_y * e1_z - s_z * e1_y;
+        const FloatLanes q_y = s_z * e1_x - s_x * e1_z;
+        const FloatLanes q_z = s_x * e1_y - s_y * e1_x;
+        const FloatLanes v = (dir_x * q_x + dir_y * q_y + dir_z * q_z) * inv_det;
+        const FloatLanes t = (e2_x * q_x + e2_y * q_y + e2_z * q_z) * inv_det;
+
+        const FloatLanes zero = Splat(0.0f);
+        const MaskLanes is_hit = (Max(det, zero - det) > Splat(MIN_DETERMINANT))
+            & (u >= zero) & (v >= zero) & (u + v <= Splat(1.0f))
+            & (t >= zero) & (t <= Splat(max_distance));
+        out_hits = { t, u, v };
+        return MoveMask(is_hit);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+/**
+ * @brief Counts failed expectations of a self test. Unlike CHECK it stays active in release builds and keeps going after a failure.
+ */
+class SelfTest
+{
+public:
+    explicit SelfTest(const char* name)
+        : name_(name)
+    {
+    }
+
+    void Expect(bool condition, const char* description)
+    {
+        ++num_checks_;
+        if (condition == false)
+        {
+            ++num_failures_;
+            LOG_ERROR("{}: expected {}", name_, description);
+        }
+    }
+
+    bool Finish() const
+    {
+        if (num_failures_ > 0)
+        {
+            LOG_ERROR("{}: {} of {} checks failed", name_, num_failures_, num_checks_);
+            return false;
+        }
+
+        LOG("{}: all {} checks passed", name_, num_checks_);
+        return true;
+    }
+
+private:
+    const char* name_;
+    uint32 num_checks_ = 0;
+    uint32 num_failures_ = 0;
+};
+
+inline bool IsNear(double a, double b, double tolerance = 1e-9)
+{
+    return std::abs(a - b) <= tolerance;
+}
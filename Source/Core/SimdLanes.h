@@ -0,0 +1,114 @@
+#pragma once
+#if defined(__AVX2__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+/**
+ * Eight lanes of floats and of 32 bit masks. One AVX2 register if the build enables it, two SSE2 registers otherwise,
+ * so code written against these types processes 8 elements per step either way. The default build sticks to SSE2, which
+ * every x64 CPU has. MSVC only defines __AVX2__ with /arch:AVX2, and a binary built with it faults on CPUs without AVX2.
+ * Comparisons return all ones / all zeros per lane, which Select() and the bitwise ops work with.
+ */
+namespace simd
+{
+    static inline constexpr uint32 NUM_LANES = 8;
+
+#if defined(__AVX2__)
+    struct FloatLanes
+    {
+        __m256 v;
+    };
+
+    struct MaskLanes
+    {
+        __m256i v;
+    };
+
+    inline FloatLanes Splat(float f) { return { _mm256_set1_ps(f) }; }
+    inline FloatLanes Load(const float* p) { return { _mm256_load_ps(p) }; }
+    inline void Store(float* p, FloatLanes a) { _mm256_store_ps(p, a.v); }
+    inline FloatLanes operator+(FloatLanes a, FloatLanes b) { return { _mm256_add_ps(a.v, b.v) }; }
+    inline FloatLanes operator-(FloatLanes a, FloatLanes b) { return { _mm256_sub_ps(a.v, b.v) }; }
+    inline FloatLanes operator*(FloatLanes a, FloatLanes b) { return { _mm256_mul_ps(a.v, b.v) }; }
+    inline FloatLanes operator/(FloatLanes a, FloatLanes b) { return { _mm256_div_ps(a.v, b.v) }; }
+    inline FloatLanes Min(FloatLanes a, FloatLanes b) { return { _mm256_min_ps(a.v, b.v) }; }
+    inline FloatLanes Max(FloatLanes a, FloatLanes b) { return { _mm256_max_ps(a.v, b.v) }; }
+    inline FloatLanes Sqrt(FloatLanes a) { return { _mm256_sqrt_ps(a.v) }; }
+    inline MaskLanes operator>=(FloatLanes a, FloatLanes b) { return { _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)) }; }
+    inline MaskLanes operator<=(FloatLanes a, FloatLanes b) { return { _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)) }; }
+    inline MaskLanes operator>(FloatLanes a, FloatLanes b) { return { _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)) }; }
+    inline MaskLanes operator<(FloatLanes a, FloatLanes b) { return { _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)) }; }
+
+    inline MaskLanes SplatMask(uint32 m) { return { _mm256_set1_epi32(static_cast<int>(m)) }; }
+    inline MaskLanes LoadMask(const uint32* p) { return { _mm256_load_si256(reinterpret_cast<const __m256i*>(p)) }; }
+    inline void StoreMask(uint32* p, MaskLanes a) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), a.v); }
+    inline MaskLanes operator&(MaskLanes a, MaskLanes b) { return { _mm256_and_si256(a.v, b.v) }; }
+    inline MaskLanes operator|(MaskLanes a, MaskLanes b) { return { _mm256_or_si256(a.v, b.v) }; }
+    inline MaskLanes AndNot(MaskLanes not_a, MaskLanes b) { return { _mm256_andnot_si256(not_a.v, b.v) }; }
+    inline MaskLanes operator==(MaskLanes a, MaskLanes b) { return { _mm256_cmpeq_epi32(a.v, b.v) }; }
+    inline FloatLanes Select(MaskLanes m, FloatLanes a, FloatLanes b) { return { _mm256_blendv_ps(b.v, a.v, _mm256_castsi256_ps(m.v)) }; }
+    inline MaskLanes Select(MaskLanes m, MaskLanes a, MaskLanes b) { return { _mm256_blendv_epi8(b.v, a.v, m.v) }; }
+    inline bool Any(MaskLanes m) { return _mm256_testz_si256(m.v, m.v) == 0; }
+
+    // Bit i is set if lane i is
+    inline uint32 MoveMask(MaskLanes m) { return static_cast<uint32>(_mm256_movemask_ps(_mm256_castsi256_ps(m.v))); }
+#else
+    struct FloatLanes
+    {
+        __m128 lo;
+        __m128 hi;
+    };
+
+    struct MaskLanes
+    {
+        __m128i lo;
+        __m128i hi;
+    };
+
+    inline FloatLanes Splat(float f) { return { _mm_set1_ps(f), _mm_set1_ps(f) }; }
+    inline FloatLanes Load(const float* p) { return { _mm_load_ps(p), _mm_load_ps(p + 4) }; }
+    inline void Store(float* p, FloatLanes a) { _mm_store_ps(p, a.lo); _mm_store_ps(p + 4, a.hi); }
+    inline FloatLanes operator+(FloatLanes a, FloatLanes b) { return { _mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi) }; }
+    inline FloatLanes operator-(FloatLanes a, FloatLanes b) { return { _mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi) }; }
+    inline FloatLanes operator*(FloatLanes a, FloatLanes b) { return { _mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi) }; }
+    inline FloatLanes operator/(FloatLanes a, FloatLanes b) { return { _mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi) }; }
+    inline FloatLanes Min(FloatLanes a, FloatLanes b) { return { _mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi) }; }
+    inline FloatLanes Max(FloatLanes a, FloatLanes b) { return { _mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi) }; }
+    inline FloatLanes Sqrt(FloatLanes a) { return { _mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi) }; }
+    inline MaskLanes operator>=(FloatLanes a, FloatLanes b) { return { _mm_castps_si128(_mm_cmpge_ps(a.lo, b.lo)), _mm_castps_si128(_mm_cmpge_ps(a.hi, b.hi)) }; }
+    inline MaskLanes operator<=(FloatLanes a, FloatLanes b) { return { _mm_castps_si128(_mm_cmple_ps(a.lo, b.lo)), _mm_castps_si128(_mm_cmple_ps(a.hi, b.hi)) }; }
+    inline MaskLanes operator>(FloatLanes a, FloatLanes b) { return { _mm_castps_si128(_mm_cmpgt_ps(a.lo, b.lo)), _mm_castps_si128(_mm_cmpgt_ps(a.hi, b.hi)) }; }
+    inline MaskLanes operator<(FloatLanes a, FloatLanes b) { return { _mm_castps_si128(_mm_cmplt_ps(a.lo, b.lo)), _mm_castps_si128(_mm_cmplt_ps(a.hi, b.hi)) }; }
+
+    inline MaskLanes SplatMask(uint32 m) { return { _mm_set1_epi32(static_cast<int>(m)), _mm_set1_epi32(static_cast<int>(m)) }; }
+    inline MaskLanes LoadMask(const uint32* p) { return { _mm_load_si128(reinterpret_cast<const __m128i*>(p)), _mm_load_si128(reinterpret_cast<const __m128i*>(p + 4)) }; }
+    inline void StoreMask(uint32* p, MaskLanes a) { _mm_store_si128(reinterpret_cast<__m128i*>(p), a.lo); _mm_store_si128(reinterpret_cast<__m128i*>(p + 4), a.hi); }
+    inline MaskLanes operator&(MaskLanes a, MaskLanes b) { return { _mm_and_si128(a.lo, b.lo), _mm_and_si128(a.hi, b.hi) }; }
+    inline MaskLanes operator|(MaskLanes a, MaskLanes b) { return { _mm_or_si128(a.lo, b.lo), _mm_or_si128(a.hi, b.hi) }; }
+    inline MaskLanes AndNot(MaskLanes not_a, MaskLanes b) { return { _mm_andnot_si128(not_a.lo, b.lo), _mm_andnot_si128(not_a.hi, b.hi) }; }
+    inline MaskLanes operator==(MaskLanes a, MaskLanes b) { return { _mm_cmpeq_epi32(a.lo, b.lo), _mm_cmpeq_epi32(a.hi, b.hi) }; }
+
+    // No blendv before SSE4.1
+    inline FloatLanes Select(MaskLanes m, FloatLanes a, FloatLanes b)
+    {
+        const __m128 m_lo = _mm_castsi128_ps(m.lo);
+        const __m128 m_hi = _mm_castsi128_ps(m.hi);
+        return { _mm_or_ps(_mm_and_ps(m_lo, a.lo), _mm_andnot_ps(m_lo, b.lo)), _mm_or_ps(_mm_and_ps(m_hi, a.hi), _mm_andnot_ps(m_hi, b.hi)) };
+    }
+
+    inline MaskLanes Select(MaskLanes m, MaskLanes a, MaskLanes b)
+    {
+        return (m & a) | AndNot(m, b);
+    }
+
+    inline bool Any(MaskLanes m) { return _mm_movemask_epi8(_mm_or_si128(m.lo, m.hi)) != 0; }
+
+    // Bit i is set if lane i is
+    inline uint32 MoveMask(MaskLanes m)
+    {
+        return static_cast<uint32>(_mm_movemask_ps(_mm_castsi128_ps(m.lo)) | (_mm_movemask_ps(_mm_castsi128_ps(m.hi)) << 4));
+    }
+#endif
+}
@@ -6,20 +6,19 @@
 
 #include "Core/Application.h"
 #include "Core/FileIO.h"
+#include "Core/JobSystem.h"
 #include "Renderer/Camera.h"
 #include "Renderer/GraphicsContext.h"
 
-Renderer::Renderer()
+namespace
 {
-    const uint8 backbuffer_idx = gfx::current_backbuffer_idx;
-    const ComPtr<ID3D12CommandAllocator>& command_allocator = gfx::command_allocators[backbuffer_idx];
-    const ComPtr<ID3D12GraphicsCommandList>& command_list = gfx::command_lists[backbuffer_idx];
-
-    command_allocator->Reset();
-    command_list->Reset(command_allocator.Get(), nullptr);
+    constexpr float CLEAR_COLOR[4] = { 100.0f / 255.0f, 149.0f / 255.0f, 237.0f / 255.0f, 255.0f / 255.0f };
+}
 
+Renderer::Renderer()
+{
     // Global Descriptor Heaps
-    for (int i = 0; i < gfx::NUM_FRAMES_IN_FLIGHT; ++i)
+    for (uint32 i = 0; i < gfx::num_frames_in_flight; ++i)
     {
         D3D12_DESCRIPTOR_HEAP_DESC descriptor_heap_desc = {};
         descriptor_heap_desc.NumDescriptors = 512;
@@ -39,36 +38,14 @@ Renderer::Renderer()
             &heap_properties,
             D3D12_HEAP_FLAG_NONE,
             &buffer_desc,
-            D3D12_RESOURCE_STATE_COPY_DEST, // Start in copy destination state
+            D3D12_RESOURCE_STATE_COMMON, // Copy queue promotes to COPY_DEST, decays back to COMMON once the copy is done
             nullptr,
             IID_PPV_ARGS(&index_buffer_));
         index_buffer_->SetName(L"Index Buffer Resource Heap");
     }
 
-    // Create upload heap to upload index buffer
-    ComPtr<ID3D12Resource> index_buffer_upload_heap;
-    {
-        const D3D12_HEAP_PROPERTIES heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        const CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(index_buffer_size);
-        gfx::device->CreateCommittedResource(
-            &heap_properties, // upload heap
-            D3D12_HEAP_FLAG_NONE, // no flags
-            &buffer_desc, // resource description for a buffer
-            D3D12_RESOURCE_STATE_GENERIC_READ, // GPU will read from this buffer and copy its contents to the default heap
-            nullptr,
-            IID_PPV_ARGS(&index_buffer_upload_heap));
-        index_buffer_upload_heap->SetName(L"Upload Index Buffer Resource Heap");
-    }
-
-    // Copy index buffer to upload heap and then to default heap
-    {
-        D3D12_SUBRESOURCE_DATA index_buffer_data = {};
-        index_buffer_data.pData = (void*)CubeMeshData::INDICES.data(); // pointer to our index array
-        index_buffer_data.RowPitch = index_buffer_size;
-        index_buffer_data.SlicePitch = index_buffer_size;
-        UpdateSubresources(command_list.Get(), index_buffer_.Get(), index_buffer_upload_heap.Get(), 0, 0, 1, &index_buffer_data);
-    }
-    gfx::TransitionResource(command_list, index_buffer_, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+    // Upload index buffer via copy queue
+    gfx::upload_queue.UploadBuffer(index_buffer_, CubeMeshData::INDICES.data(), index_buffer_size);
 
     // Create index buffer view
     index_buffer_view_.BufferLocation = index_buffer_->GetGPUVirtualAddress();
@@ -87,39 +64,15 @@ Renderer::Renderer()
             &heap_properties,
             D3D12_HEAP_FLAG_NONE,
             &buffer_desc,
-            D3D12_RESOURCE_STATE_COPY_DEST, // Start in copy destination state
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
             IID_PPV_ARGS(&vertex_pos_buffer_));
         vertex_pos_buffer_->SetName(L"Vertex Pos Buffer");
     }
 
-    // Create upload heap to upload index buffer
-    ComPtr<ID3D12Resource> pos_upload_heap;
-    {
-        const D3D12_HEAP_PROPERTIES heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        const CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(pos_buffer_size);
-        gfx::device->CreateCommittedResource(
-            &heap_properties, // upload heap
-            D3D12_HEAP_FLAG_NONE, // no flags
-            &buffer_desc, // resource description for a buffer
-            D3D12_RESOURCE_STATE_GENERIC_READ, // GPU will read from this buffer and copy its contents to the default heap
-            nullptr,
-            IID_PPV_ARGS(&pos_upload_heap));
-        pos_upload_heap->SetName(L"Upload Vertex Pos Buffer");
-    }
-
-    // Copy vertex buffer to upload heap and then to default heap
-    {
-        D3D12_SUBRESOURCE_DATA buffer_data = {};
-        buffer_data.pData = reinterpret_cast<BYTE*>(CubeMeshData::POS.data()); // pointer to our index array
-        buffer_data.RowPitch = pos_buffer_size;
-        buffer_data.SlicePitch = pos_buffer_size;
-        UpdateSubresources(command_list.Get(), vertex_pos_buffer_.Get(), pos_upload_heap.Get(), 0, 0, 1, &buffer_data);
-    }
-    gfx::TransitionResource(command_list, vertex_pos_buffer_, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    gfx::upload_queue.UploadBuffer(vertex_pos_buffer_, CubeMeshData::POS.data(), pos_buffer_size);
 
-    // Create SRVs
-    for (int i = 0; i < gfx::NUM_FRAMES_IN_FLIGHT; ++i)
+    // Create SRV
     {
         D3D12_SHADER_RESOURCE_VIEW_DESC view_desc = {};
         view_desc.Format = DXGI_FORMAT::DXGI_FORMAT_UNKNOWN;
@@ -131,8 +84,7 @@ Renderer::Renderer()
             .StructureByteStride = sizeof(Vec4),
             .Flags = D3D12_BUFFER_SRV_FLAGS::D3D12_BUFFER_SRV_FLAG_NONE
         };
-        const D3D12_CPU_DESCRIPTOR_HANDLE destination_handle = gfx::GetResourceDescriptorByIdx(descriptor_heaps_cbv_uav_srv[i], i);
-        gfx::device->CreateShaderResourceView(vertex_pos_buffer_.Get(), &view_desc, destination_handle);
+        position_buffer_srv_staging_idx_ = gfx::view_cache.AcquireSRV(vertex_pos_buffer_.Get(), &view_desc);
     }
 
     // --- UVs
@@ -146,39 +98,15 @@ Renderer::Renderer()
             &heap_properties,
             D3D12_HEAP_FLAG_NONE,
             &buffer_desc,
-            D3D12_RESOURCE_STATE_COPY_DEST, // Start in copy destination state
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
             IID_PPV_ARGS(&vertex_uv_buffer_));
         vertex_uv_buffer_->SetName(L"Vertex UV Buffer");
     }
 
-    // Create upload heap to upload index buffer
-    ComPtr<ID3D12Resource> uv_upload_heap;
-    {
-        const D3D12_HEAP_PROPERTIES heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        const CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(uv_buffer_size);
-        gfx::device->CreateCommittedResource(
-            &heap_properties, // upload heap
-            D3D12_HEAP_FLAG_NONE, // no flags
-            &buffer_desc, // resource description for a buffer
-            D3D12_RESOURCE_STATE_GENERIC_READ, // GPU will read from this buffer and copy its contents to the default heap
-            nullptr,
-            IID_PPV_ARGS(&uv_upload_heap));
-        uv_upload_heap->SetName(L"Upload Vertex UV Buffer");
-    }
-
-    // Copy buffer to upload heap and then to default heap
-    {
-        D3D12_SUBRESOURCE_DATA buffer_data = {};
-        buffer_data.pData = reinterpret_cast<uint8*>(CubeMeshData::UVS.data()); // pointer to our index array
-        buffer_data.RowPitch = uv_buffer_size;
-        buffer_data.SlicePitch = uv_buffer_size;
-        UpdateSubresources(command_list.Get(), vertex_uv_buffer_.Get(), uv_upload_heap.Get(), 0, 0, 1, &buffer_data);
-    }
-    gfx::TransitionResource(command_list, vertex_uv_buffer_, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    gfx::upload_queue.UploadBuffer(vertex_uv_buffer_, CubeMeshData::UVS.data(), uv_buffer_size);
 
-    // Create SRVs
-    for (int i = 0; i < gfx::NUM_FRAMES_IN_FLIGHT; ++i)
+    // Create SRV
     {
         D3D12_SHADER_RESOURCE_VIEW_DESC view_desc = {};
         view_desc.Format = DXGI_FORMAT::DXGI_FORMAT_UNKNOWN;
@@ -190,12 +118,11 @@ Renderer::Renderer()
             .StructureByteStride = sizeof(Vec2),
             .Flags = D3D12_BUFFER_SRV_FLAGS::D3D12_BUFFER_SRV_FLAG_NONE
         };
-        const D3D12_CPU_DESCRIPTOR_HANDLE destination_handle = gfx::GetResourceDescriptorByIdx(descriptor_heaps_cbv_uav_srv[i], i + gfx::NUM_FRAMES_IN_FLIGHT);
-        gfx::device->CreateShaderResourceView(vertex_uv_buffer_.Get(), &view_desc, destination_handle);
+        uv_buffer_srv_staging_idx_ = gfx::view_cache.AcquireSRV(vertex_uv_buffer_.Get(), &view_desc);
     }
 
     // -- Scene Data Constant Buffer
-    for (int i = 0; i < gfx::NUM_FRAMES_IN_FLIGHT; ++i)
+    for (uint32 i = 0; i < gfx::num_frames_in_flight; ++i)
     {
         const D3D12_HEAP_PROPERTIES heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
         const CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(CBufferSceneData));
@@ -213,8 +140,46 @@ Renderer::Renderer()
         D3D12_CONSTANT_BUFFER_VIEW_DESC view_desc = {};
         view_desc.BufferLocation = cbuffer_heaps[i]->GetGPUVirtualAddress();
         view_desc.SizeInBytes = (uint32) MathUtils::AlignToBytes(sizeof(CBufferSceneData), 256);    // CB size is required to be 256-byte aligned.
-        const D3D12_CPU_DESCRIPTOR_HANDLE destination_handle = gfx::GetResourceDescriptorByIdx(descriptor_heaps_cbv_uav_srv[i], i + gfx::NUM_FRAMES_IN_FLIGHT * 2);
-        gfx::device->CreateConstantBufferView(&view_desc, destination_handle);
+        scene_cbv_staging_idxs_[i] = gfx::view_cache.AcquireCBV(view_desc);
+    }
+
+    // -- Instance Data
+    for (uint32 i = 0; i < gfx::num_frames_in_flight; ++i)
+    {
+        const D3D12_HEAP_PROPERTIES heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        const CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(gfx::InstanceData) * MAX_INSTANCES);
+        gfx::device->CreateCommittedResource(
+            &heap_properties,
+            D3D12_HEAP_FLAG_NONE,
+            &buffer_desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&instance_buffers_[i]));
+        instance_buffers_[i]->SetName(L"Instance Buffer");
+        static const CD3DX12_RANGE ZERO_READ_RANGE(0, 0); // no CPU read
+        DX_VERIFY(instance_buffers_[i]->Map(0, &ZERO_READ_RANGE, reinterpret_cast<void**>(&instance_buffer_ptrs_[i])));
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC view_desc = {};
+        view_desc.Format = DXGI_FORMAT::DXGI_FORMAT_UNKNOWN;
+        view_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        view_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        view_desc.Buffer = {
+            .FirstElement = 0,
+            .NumElements = MAX_INSTANCES,
+            .StructureByteStride = sizeof(gfx::InstanceData),
+            .Flags = D3D12_BUFFER_SRV_FLAGS::D3D12_BUFFER_SRV_FLAG_NONE
+        };
+        instance_buffer_srv_staging_idxs_[i] = gfx::view_cache.AcquireSRV(instance_buffers_[i].Get(), &view_desc);
+    }
+
+    // -- Fill the frame heaps. The copies are written when each frame starts recording, see Render().
+    for (uint32 i = 0; i < gfx::num_frames_in_flight; ++i)
+    {
+        ID3D12DescriptorHeap* frame_heap = descriptor_heaps_cbv_uav_srv[i].Get();
+        gfx::staging_descriptor_heap.QueueCopy(position_buffer_srv_staging_idx_, frame_heap, POSITION_BUFFER_SRV_SLOT);
+        gfx::staging_descriptor_heap.QueueCopy(uv_buffer_srv_staging_idx_, frame_heap, UV_BUFFER_SRV_SLOT);
+        gfx::staging_descriptor_heap.QueueCopy(scene_cbv_staging_idxs_[i], frame_heap, SCENE_CBV_SLOT);
+        gfx::staging_descriptor_heap.QueueCopy(instance_buffer_srv_staging_idxs_[i], frame_heap, INSTANCE_BUFFER_SRV_SLOT);
     }
 
     // -- Shaders
@@ -255,107 +220,250 @@ Renderer::Renderer()
     pso_desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
     DX_VERIFY(gfx::device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&pso)));
 
-    // -- Finalize command list & Submit
-    DX_VERIFY(command_list->Close());
-    ID3D12CommandList* const submitted_command_lists[] = { command_list.Get() };
-    gfx::command_queue_direct->ExecuteCommandLists(_countof(submitted_command_lists), submitted_command_lists);
-    gfx::FlushAllQueues();
+    // -- Upscale Pass
+    {
+        String upscale_vs_path = "Assets/Shaders/upscale_vs.cso";
+        std::vector<uint8> upscale_vs_data = FileIO::ReadFile(upscale_vs_path);
+        String upscale_ps_path = "Assets/Shaders/upscale_ps.cso";
+        std::vector<uint8> upscale_ps_data = FileIO::ReadFile(upscale_ps_path);
+
+        D3D12_ROOT_PARAMETER upscale_root_parameters[1];
+        upscale_root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE::D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        upscale_root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        upscale_root_parameters[0].Constants.ShaderRegister = 0;
+        upscale_root_parameters[0].Constants.RegisterSpace = 0;
+        upscale_root_parameters[0].Constants.Num32BitValues = sizeof(UpscaleConstants) / sizeof(uint32);
+
+        const CD3DX12_STATIC_SAMPLER_DESC linear_clamp_sampler(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR,
+            D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
+
+        CD3DX12_ROOT_SIGNATURE_DESC upscale_root_signature_desc;
+        upscale_root_signature_desc.Init(ARRAYSIZE(upscale_root_parameters), upscale_root_parameters, 1, &linear_clamp_sampler, root_signature_flags);
+        ComPtr<ID3DBlob> serialized_upscale_root_signature;
+        DX_VERIFY(D3D12SerializeRootSignature(&upscale_root_signature_desc, D3D_ROOT_SIGNATURE_VERSION_1, &serialized_upscale_root_signature, nullptr));
+        DX_VERIFY(gfx::device->CreateRootSignature(0, serialized_upscale_root_signature->GetBufferPointer(), serialized_upscale_root_signature->GetBufferSize(), IID_PPV_ARGS(&upscale_root_signature_)));
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC upscale_pso_desc = {};
+        upscale_pso_desc.pRootSignature = upscale_root_signature_.Get();
+        upscale_pso_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        upscale_pso_desc.VS = { upscale_vs_data.data(), upscale_vs_data.size() };
+        upscale_pso_desc.PS = { upscale_ps_data.data(), upscale_ps_data.size() };
+        upscale_pso_desc.NumRenderTargets = 1;
+        upscale_pso_desc.RTVFormats[0] = DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        upscale_pso_desc.DSVFormat = DXGI_FORMAT::DXGI_FORMAT_UNKNOWN;
+        upscale_pso_desc.SampleDesc = { .Count = 1, .Quality = 0 };
+        upscale_pso_desc.SampleMask = 0xffffffff;
+        upscale_pso_desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+        upscale_pso_desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+        upscale_pso_desc.DepthStencilState.DepthEnable = FALSE;
+        upscale_pso_desc.DepthStencilState.StencilEnable = FALSE;
+        DX_VERIFY(gfx::device->CreateGraphicsPipelineState(&upscale_pso_desc, IID_PPV_ARGS(&upscale_pso_)));
+    }
+
+    // -- Draw Prototypes
+    {
+        gfx::DrawCommand cube_draw = {};
+        cube_draw.pso = pso.Get();
+        cube_draw.root_signature = root_signature.Get();
+        cube_draw.index_buffer_view = &index_buffer_view_;
+        cube_draw.num_root_constants = sizeof(PerDrawConstants) / sizeof(uint32);
+        cube_draw.index_count = static_cast<uint32>(CubeMeshData::INDICES.size());
+        static constexpr uint32 INSTANCE_OFFSET_CONSTANT_IDX = offsetof(PerDrawConstants, instance_offset) / sizeof(uint32);
+        cube_prototype_idx_ = instance_batcher_.AddPrototype(cube_draw, INSTANCE_OFFSET_CONSTANT_IDX);
+    }
 
-    // -- Create depth buffer
-    D3D12_VIEWPORT viewport = gfx::GetViewport();
-    RecreateDepthBuffer(static_cast<int32>(viewport.Width), static_cast<int32>(viewport.Height));
+    // -- Kick off uploads. The direct queue waits GPU-side for them before the first frame executes.
+    gfx::upload_queue.Sync(gfx::command_queue_direct);
+
+    // -- Create render targets
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC descriptor_heap_desc = {};
+        descriptor_heap_desc.NumDescriptors = 1;
+        descriptor_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+        descriptor_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+        DX_VERIFY(gfx::device->CreateDescriptorHeap(&descriptor_heap_desc, IID_PPV_ARGS(&descriptor_heap_scene_rtv_)));
+    }
+    const Vec2 output_resolution = gfx::GetOutputResolution();
+    RecreateRenderTargets(static_cast<int32>(output_resolution.x), static_cast<int32>(output_resolution.y));
 
     // -- Misc scene setup
     camera.SetPosition(Vec3(0.0f, 0.0f, -10.0f));
     camera.LookAt(Vec3::ZERO);
+    scene_.CreateEntity({});
 }
 
 void Renderer::Render()
 {
+    if (gfx::ApplyPendingResize())
+    {
+        const Vec2 output_resolution = gfx::GetOutputResolution();
+        RecreateRenderTargets(static_cast<int32>(output_resolution.x), static_cast<int32>(output_resolution.y));
+    }
+
+    // The frame's heap is no longer in use by the GPU, so views queued since it was last recorded can land now
+    gfx::staging_descriptor_heap.Flush(descriptor_heaps_cbv_uav_srv.Get().Get());
+
     camera.Update();
 
     const uint8 backbuffer_idx = gfx::current_backbuffer_idx;
 
-    const ComPtr<ID3D12CommandAllocator>& command_allocator = gfx::command_allocators[backbuffer_idx];
-    const ComPtr<ID3D12GraphicsCommandList>& command_list = gfx::command_lists[backbuffer_idx];
-
     const ComPtr<ID3D12Resource>& backbuffer_rtv = gfx::backbuffers[backbuffer_idx];
     D3D12_CPU_DESCRIPTOR_HANDLE backbuffer_rtv_handle = gfx::GetRTVDescriptorByIdx(gfx::descriptor_heap_rtv, backbuffer_idx);
     D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle = gfx::GetRTVDescriptorByIdx(gfx::descriptor_heap_dsv, 0);
+    D3D12_CPU_DESCRIPTOR_HANDLE scene_rtv_handle = gfx::GetRTVDescriptorByIdx(descriptor_heap_scene_rtv_, 0);
+
+    // The scene is rendered into the top left corner of the scene targets, sized by the dynamic resolution scale
+    const D3D12_VIEWPORT viewport = gfx::GetViewport();
+    const D3D12_RECT scissor_rect = { 0, 0, static_cast<LONG>(viewport.Width), static_cast<LONG>(viewport.Height) };
+
+    // Set Descriptor heaps for each command list
+    // These have to be set before Root Signature!
+    ID3D12DescriptorHeap* descriptor_heaps[] = { descriptor_heaps_cbv_uav_srv.Get().Get() };
 
-    command_allocator->Reset();
-    command_list->Reset(command_allocator.Get(), nullptr);
+    ID3D12GraphicsCommandList* command_list = gfx::command_recorder.AcquireList();
+    command_context_.Begin(command_list);
+    command_context_stats_ = {};
+    gfx::gpu_profiler.BeginFrame(command_list);
 
     // -- Clear
     {
-        static constexpr float CLEAR_COLOR[4] = { 100.0f / 255.0f, 149.0f / 255.0f, 237.0f / 255.0f, 255.0f / 255.0f };
-        gfx::TransitionResource(command_list, backbuffer_rtv, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-        command_list->ClearRenderTargetView(backbuffer_rtv_handle, CLEAR_COLOR, 0, nullptr /* clear entire rtv */);
-        command_list->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+        gfx::ScopedGPUMarker marker(gfx::gpu_profiler, command_list, "Clear");
+        gfx::TransitionResource(command_list, scene_color_, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        command_list->ClearRenderTargetView(scene_rtv_handle, CLEAR_COLOR, 1, &scissor_rect);
+        command_list->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 1, &scissor_rect);
     }
 
-    // -- Setup Pipeline State
+    const uint32 main_pass_marker = gfx::gpu_profiler.BeginMarker(command_list, "Main Pass");
+
+    // -- Update Resources
+    PerDrawConstants& per_draw_constants = per_draw_constants_.Get();
     {
-        command_list->SetPipelineState(pso.Get());
-        command_list->IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY::D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);   // Same as in PSO
-        command_list->IASetIndexBuffer(&index_buffer_view_);
+        per_draw_constants.position_buffer_idx = POSITION_BUFFER_SRV_SLOT;
+        per_draw_constants.uv_buffer_idx = UV_BUFFER_SRV_SLOT;
+        per_draw_constants.scene_cbuffer_idx = SCENE_CBV_SLOT;
+        per_draw_constants.instance_buffer_idx = INSTANCE_BUFFER_SRV_SLOT;
 
-        D3D12_VIEWPORT viewport = gfx::GetViewport();
-        command_list->RSSetViewports(1, &viewport);
-        static D3D12_RECT SCISSOR_RECT = { 0, 0, static_cast<LONG>(viewport.Width), static_cast<LONG>(viewport.Height) };
-        command_list->RSSetScissorRects(1, &SCISSOR_RECT); // Have to set in DX12
+        // Scene Data
+        cbuffer.view_projection = camera.GetViewProjection();
+        memcpy(cbuffer_gpu_ptrs.Get(), &cbuffer, sizeof(cbuffer));
+    }
 
-        static constexpr bool IS_CONTIGUOUS_ARRAY = false;
-        command_list->OMSetRenderTargets(1, &backbuffer_rtv_handle, IS_CONTIGUOUS_ARRAY, &dsv_handle);
+    // -- Build Draws
+    {
+        draw_list_.Reset();
+        instance_batcher_.Reset();
+
+        // Descriptor indices are the same for all cubes, only the instance offset differs per batch
+        gfx::DrawCommand& cube_draw = instance_batcher_.GetPrototype(cube_prototype_idx_);
+        memcpy(cube_draw.root_constants.data(), &per_draw_constants, sizeof(PerDrawConstants));
+
+        scene_.UpdateTransforms();
+        scene_.CullFrustum(camera.GetViewProjection(), visible_entities_);
+
+        // The cube is the only mesh so far, so every entity uses its prototype
+        const std::span<const Affine3x4> world_transforms = scene_.GetWorldTransforms();
+        const std::span<const uint32> mesh_ids = scene_.GetMeshIds();
+        const std::span<const uint32> material_ids = scene_.GetMaterialIds();
+        for (const uint32 entity_idx : visible_entities_)
+        {
+            const Affine3x4& transform = world_transforms[entity_idx];
+            const float view_depth = Vec3::Distance(camera.GetPosition(), transform.GetTranslation());
+            const uint32 depth_bucket = gfx::DrawKey::QuantizeDepth(view_depth, camera.GetNearClip(), camera.GetFarClip());
+            const uint64 group_key = gfx::DrawKey::Make(0, 0, material_ids[entity_idx], 0, mesh_ids[entity_idx]);
+            instance_batcher_.Add(group_key, cube_prototype_idx_, depth_bucket, { .world = transform });
+        }
+        instance_batcher_.Build(instance_buffer_ptrs_.Get(), MAX_INSTANCES, draw_list_);
+
+        draw_list_.Sort();
     }
 
-    // Set Descriptor heaps for each command list
-    // These have to be set before Root Signature!
-    ID3D12DescriptorHeap* descriptor_heaps[] = { descriptor_heaps_cbv_uav_srv[backbuffer_idx].Get() };
-    command_list->SetDescriptorHeaps(ARRAYSIZE(descriptor_heaps), descriptor_heaps);
+    // -- Record Draws
+    // Split across worker threads, one list per batch. Each list starts without state, so each sets up the pass.
+    {
+        thread_command_context_stats_.assign(jobs::GetNumThreads(), {});
+        gfx::command_recorder.RecordParallel(draw_list_.GetNumDraws(), MIN_DRAWS_PER_COMMAND_LIST,
+            [&](ID3D12GraphicsCommandList* batch_command_list, uint32 begin, uint32 end)
+            {
+                gfx::CommandContext context;
+                context.Begin(batch_command_list);
+                context.SetDescriptorHeaps(ARRAYSIZE(descriptor_heaps), descriptor_heaps);
+                context.IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY::D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);   // Same as in PSO
+                context.RSSetViewport(viewport);
+                context.RSSetScissorRect(scissor_rect); // Have to set in DX12
+                context.OMSetRenderTarget(scene_rtv_handle, &dsv_handle);
+
+                // PSO, root signature and index buffer are bound by the draw list
+                draw_list_.Submit(context, begin, end);
+                thread_command_context_stats_[jobs::GetThreadIdx()] += context.GetStats();
+            });
+
+        for (const gfx::CommandContextStats& thread_stats : thread_command_context_stats_)
+        {
+            command_context_stats_ += thread_stats;
+        }
+    }
 
-    command_list->SetGraphicsRootSignature(root_signature.Get());   // Same as in PSO
+    command_list = gfx::command_recorder.AcquireList();
+    command_context_.Begin(command_list);
+    gfx::gpu_profiler.EndMarker(command_list, main_pass_marker);
 
-    // -- Update Resources
+    // -- Upscale scene color to the backbuffer
     {
-        per_draw_constants_[backbuffer_idx].position_buffer_idx = backbuffer_idx;
-        per_draw_constants_[backbuffer_idx].uv_buffer_idx = backbuffer_idx + gfx::NUM_FRAMES_IN_FLIGHT;
-        per_draw_constants_[backbuffer_idx].scene_cbuffer_idx = backbuffer_idx + gfx::NUM_FRAMES_IN_FLIGHT * 2;
-        command_list->SetGraphicsRoot32BitConstants(0, sizeof(PerDrawConstants) / sizeof(uint32), &per_draw_constants_[backbuffer_idx], 0u);
+        gfx::ScopedGPUMarker marker(gfx::gpu_profiler, command_list, "Upscale");
+        gfx::TransitionResource(command_list, scene_color_, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        gfx::TransitionResource(command_list, backbuffer_rtv, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-        // Scene Data
-        cbuffer.wvp = Mat4::IDENTITY * camera.GetViewProjection();
-        memcpy(cbuffer_gpu_ptrs[backbuffer_idx], &cbuffer, sizeof(cbuffer));
+        command_context_.SetDescriptorHeaps(ARRAYSIZE(descriptor_heaps), descriptor_heaps);
+        command_context_.SetPipelineState(upscale_pso_.Get());
+        command_context_.SetGraphicsRootSignature(upscale_root_signature_.Get());
+
+        const D3D12_RESOURCE_DESC scene_color_desc = scene_color_->GetDesc();
+        const Vec2 scene_color_size(static_cast<float>(scene_color_desc.Width), static_cast<float>(scene_color_desc.Height));
+        UpscaleConstants upscale_constants;
+        upscale_constants.uv_scale = Vec2(viewport.Width / scene_color_size.x, viewport.Height / scene_color_size.y);
+        upscale_constants.uv_max = Vec2((viewport.Width - 0.5f) / scene_color_size.x, (viewport.Height - 0.5f) / scene_color_size.y);
+        upscale_constants.source_texture_idx = SCENE_COLOR_SRV_SLOT;
+        command_context_.SetGraphicsRoot32BitConstants(0, sizeof(UpscaleConstants) / sizeof(uint32), &upscale_constants, 0u);
+
+        const Vec2 output_resolution = gfx::GetOutputResolution();
+        const CD3DX12_VIEWPORT output_viewport(0.0f, 0.0f, output_resolution.x, output_resolution.y);
+        const D3D12_RECT output_scissor_rect = { 0, 0, static_cast<LONG>(output_resolution.x), static_cast<LONG>(output_resolution.y) };
+        command_context_.RSSetViewport(output_viewport);
+        command_context_.RSSetScissorRect(output_scissor_rect);
+        command_context_.OMSetRenderTarget(backbuffer_rtv_handle, nullptr);
+        command_context_.DrawInstanced(3, 1, 0, 0);  // Fullscreen triangle
     }
 
-    // -- Draw
-    {
-        command_list->DrawIndexedInstanced(static_cast<uint32>(CubeMeshData::INDICES.size()), 1, 0, 0, 0);
-    }
+    command_context_stats_ += command_context_.GetStats();
+    frame_command_list_ = command_list;
 }
 
 void Renderer::Present()
 {
     CHECK(gfx::IsInitialized());
+    CHECK(frame_command_list_ != nullptr);
     const uint8 backbuffer_idx = gfx::current_backbuffer_idx;
     const ComPtr<ID3D12Resource>& backbuffer_rtv = gfx::backbuffers[backbuffer_idx];
-    const ComPtr<ID3D12GraphicsCommandList>& command_list = gfx::command_lists[backbuffer_idx];
 
-    gfx::TransitionResource(command_list, backbuffer_rtv, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+    gfx::TransitionResource(frame_command_list_, backbuffer_rtv, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+    gfx::gpu_profiler.EndFrame(frame_command_list_);
+    frame_command_list_ = nullptr;
 
-    // Finalize command list
-    DX_VERIFY(command_list->Close());
+    // Make sure everything uploaded during this frame has landed before the GPU consumes it
+    gfx::upload_queue.Sync(gfx::command_queue_direct);
 
-    // Submit the work to the GPU
-    ID3D12CommandList* const submitted_command_lists[] = { command_list.Get() };
-    gfx::command_queue_direct->ExecuteCommandLists(_countof(submitted_command_lists), submitted_command_lists);
+    // Submit all lists of the frame in recording order with a single ExecuteCommandLists
+    gfx::command_recorder.Submit();
 
     gfx::Present();
 }
 
-void Renderer::RecreateDepthBuffer(int32 width, int32 height)
+void Renderer::RecreateRenderTargets(int32 width, int32 height)
 {
-    gfx::FlushAllQueues();
+    // Frames in flight may still use the old targets, keep them alive until they are done.
+    // Overwriting the DSV & RTV itself is fine, they are consumed when the command list is recorded.
+    gfx::deferred_release_queue.Release(std::move(depth_buffer_));
+    gfx::deferred_release_queue.Release(std::move(scene_color_));
 
     width = std::max(1, width);     // Could be 0 when minimized, but 0 is invalid
     height = std::max(1, height);
@@ -382,6 +490,40 @@ void Renderer::RecreateDepthBuffer(int32 width, int32 height)
     dsv_desc.Texture2D.MipSlice = 0;
     dsv_desc.Flags = D3D12_DSV_FLAG_NONE;
     gfx::device->CreateDepthStencilView(depth_buffer_.Get(), &dsv_desc, gfx::descriptor_heap_dsv->GetCPUDescriptorHandleForHeapStart());
+
+    // -- Scene color
+    D3D12_CLEAR_VALUE color_clear_value = {};
+    color_clear_value.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    std::copy(std::begin(CLEAR_COLOR), std::end(CLEAR_COLOR), color_clear_value.Color);
+    CD3DX12_RESOURCE_DESC color_desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, width, height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+    DX_VERIFY(gfx::device->CreateCommittedResource(
+        &heap_properties,
+        D3D12_HEAP_FLAG_NONE,
+        &color_desc,
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,    // Each frame starts with a transition to RENDER_TARGET
+        &color_clear_value,
+        IID_PPV_ARGS(&scene_color_)
+    ));
+    scene_color_->SetName(L"Scene Color");
+    gfx::device->CreateRenderTargetView(scene_color_.Get(), nullptr, descriptor_heap_scene_rtv_->GetCPUDescriptorHandleForHeapStart());
+
+    // Unlike RTVs, shader visible SRVs are read when the GPU executes. The view is created once in the staging heap
+    // and each frame's heap picks it up when that frame starts recording, so no frame in flight observes the overwrite.
+    // The cache keeps the old view's slot and resource alive until the current frame is done.
+    if (scene_color_srv_staging_idx_ != INVALID_STAGING_IDX)
+    {
+        gfx::view_cache.Release(scene_color_srv_staging_idx_);
+    }
+    D3D12_SHADER_RESOURCE_VIEW_DESC view_desc = {};
+    view_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    view_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    view_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    view_desc.Texture2D.MipLevels = 1;
+    scene_color_srv_staging_idx_ = gfx::view_cache.AcquireSRV(scene_color_.Get(), &view_desc);
+    for (uint32 i = 0; i < gfx::num_frames_in_flight; ++i)
+    {
+        gfx::staging_descriptor_heap.QueueCopy(scene_color_srv_staging_idx_, descriptor_heaps_cbv_uav_srv[i].Get(), SCENE_COLOR_SRV_SLOT);
+    }
 }
 
 IRenderer* CreateRenderer()
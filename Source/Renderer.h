@@ -12,13 +12,18 @@
 #include "Renderer/Mesh.h"
 #include "Renderer/IRenderer.h"
 #include "Renderer/GraphicsContext.h"
+#include "Renderer/FrameResource.h"
+#include "Renderer/CommandContext.h"
 #include "Renderer/DXUtils.h"
+#include "Renderer/DrawList.h"
+#include "Renderer/InstanceBatcher.h"
 #include "Renderer/Camera.h"
+#include "Scene/Scene.h"
 
 DECLSPEC_ALIGN(256)
 struct CBufferSceneData
 {
-    Mat4 wvp;
+    Mat4 view_projection;
 };
 
 struct PerDrawConstants
@@ -26,6 +31,16 @@ struct PerDrawConstants
     uint32 position_buffer_idx = 0;
     uint32 uv_buffer_idx = 0;
     uint32 scene_cbuffer_idx = 0;
+    uint32 instance_buffer_idx = 0;
+    uint32 instance_offset = 0;     // Filled in by the instance batcher
+};
+
+// Matches UpscaleConstants in upscale_ps.hlsl
+struct UpscaleConstants
+{
+    Vec2 uv_scale;
+    Vec2 uv_max;
+    uint32 source_texture_idx = 0;
 };
 
 class Renderer : public IRenderer
@@ -44,30 +59,78 @@ public:
     virtual void Render() override final;
     virtual void Present() override final;
 
-    void RecreateDepthBuffer(int32 width, int32 height);
+    // Issued vs. filtered state changes of the last recorded frame, summed over all its command lists
+    const gfx::CommandContextStats& GetCommandContextStats() const
+    {
+        return command_context_stats_;
+    }
+
+    /**
+     * @brief Recreates scene color & depth targets. They are sized for the output resolution,
+     * so changing the render scale only changes the viewport and never reallocates them.
+     */
+    void RecreateRenderTargets(int32 width, int32 height);
 
 private:
     using MeshData = CubeMeshData;
 
+    static inline constexpr uint32 MAX_INSTANCES = 4096;
+    static inline constexpr uint32 MIN_DRAWS_PER_COMMAND_LIST = 256;
+
+    // Shader visible heap layout, the same for every frame in flight's heap
+    static inline constexpr uint32 POSITION_BUFFER_SRV_SLOT = 0;
+    static inline constexpr uint32 UV_BUFFER_SRV_SLOT = 1;
+    static inline constexpr uint32 SCENE_CBV_SLOT = 2;
+    static inline constexpr uint32 INSTANCE_BUFFER_SRV_SLOT = 3;
+    static inline constexpr uint32 SCENE_COLOR_SRV_SLOT = 4;
+
+    // Marks views which haven't been acquired from the view cache yet
+    static inline constexpr uint32 INVALID_STAGING_IDX = std::numeric_limits<uint32>::max();
+
     Camera camera;
 
     // Per Frame Context
-    std::array<ComPtr<ID3D12DescriptorHeap>, 2> descriptor_heaps_cbv_uav_srv;
-    std::array<void*, 2> cbuffer_gpu_ptrs;
+    gfx::FrameResource<ComPtr<ID3D12DescriptorHeap>> descriptor_heaps_cbv_uav_srv;
+
+    // Views acquired from the view cache. Shared ones are created once and copied into every frame's heap.
+    uint32 position_buffer_srv_staging_idx_ = 0;
+    uint32 uv_buffer_srv_staging_idx_ = 0;
+    gfx::FrameResource<uint32> scene_cbv_staging_idxs_;
+    gfx::FrameResource<uint32> instance_buffer_srv_staging_idxs_;
+    uint32 scene_color_srv_staging_idx_ = INVALID_STAGING_IDX;
+    gfx::FrameResource<void*> cbuffer_gpu_ptrs;
 
     CBufferSceneData cbuffer;
-    std::array<ComPtr<ID3D12Resource>, 2> cbuffer_heaps;
-    std::array<PerDrawConstants, 2> per_draw_constants_;
+    gfx::FrameResource<ComPtr<ID3D12Resource>> cbuffer_heaps;
+    gfx::FrameResource<PerDrawConstants> per_draw_constants_;
+    gfx::FrameResource<ComPtr<ID3D12Resource>> instance_buffers_;
+    gfx::FrameResource<gfx::InstanceData*> instance_buffer_ptrs_;
 
     ComPtr<ID3D12Resource> index_buffer_;
     D3D12_INDEX_BUFFER_VIEW index_buffer_view_;
     ComPtr<ID3D12Resource> vertex_pos_buffer_;
     ComPtr<ID3D12Resource> vertex_uv_buffer_;
     ComPtr<ID3D12Resource> depth_buffer_;
+    ComPtr<ID3D12Resource> scene_color_;
+    ComPtr<ID3D12DescriptorHeap> descriptor_heap_scene_rtv_;
 
     ComPtr<ID3D12RootSignature> root_signature;
     ComPtr<ID3DBlob> serialized_root_signature;
     ComPtr<ID3D12PipelineState> pso;
+
+    ComPtr<ID3D12RootSignature> upscale_root_signature_;
+    ComPtr<ID3D12PipelineState> upscale_pso_;
+
+    gfx::CommandContext command_context_;   // Main thread lists
+    gfx::CommandContextStats command_context_stats_;
+    std::vector<gfx::CommandContextStats> thread_command_context_stats_;
+    ID3D12GraphicsCommandList* frame_command_list_ = nullptr;  // Last list of the frame, closed by Present()
+    gfx::DrawList draw_list_;
+    gfx::InstanceBatcher instance_batcher_;
+    uint32 cube_prototype_idx_ = 0;
+
+    Scene scene_;
+    std::vector<uint32> visible_entities_;
 };
 
 IRenderer* CreateRenderer();
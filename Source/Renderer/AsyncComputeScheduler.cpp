@@ -0,0 +1,289 @@
+#include "Renderer/AsyncComputeScheduler.h"
+
+#include "Renderer/GraphicsContext.h"
+
+namespace gfx
+{
+    namespace
+    {
+        static_assert(static_cast<uint32>(PassQueue::COUNT) == 2, "Scheduler synchronizes exactly two queues");
+
+        PassQueue GetOtherQueue(PassQueue queue)
+        {
+            return queue == PassQueue::GRAPHICS ? PassQueue::ASYNC_COMPUTE : PassQueue::GRAPHICS;
+        }
+
+        CommandListPool& GetCommandPool(PassQueue queue)
+        {
+            return queue == PassQueue::ASYNC_COMPUTE ? command_pool_compute : command_pool_direct;
+        }
+
+        const ComPtr<ID3D12CommandQueue>& GetCommandQueue(PassQueue queue)
+        {
+            return queue == PassQueue::ASYNC_COMPUTE ? command_queue_compute : command_queue_direct;
+        }
+
+        TimelineFence& GetTimeline(PassQueue queue)
+        {
+            return queue == PassQueue::ASYNC_COMPUTE ? fence_compute : fence_direct;
+        }
+    }
+
+    void D3D12QueueBackend::Submit(PassQueue queue, std::span<const PassHandle> passes, const std::vector<PassDesc>& pass_descs)
+    {
+        const ComPtr<ID3D12CommandQueue>& command_queue = GetCommandQueue(queue);
+        upload_queue.Sync(command_queue);
+
+        CommandListPool& pool = GetCommandPool(queue);
+        PooledCommandList command_list = pool.Acquire(static_cast<uint32>(passes.size()));
+        for (const PassHandle pass : passes)
+        {
+            pass_descs[pass].record(command_list.command_list.Get());
+        }
+        DX_VERIFY(command_list.command_list->Close());
+
+        ID3D12CommandList* const submitted_command_lists[] = { command_list.command_list.Get() };
+        command_queue->ExecuteCommandLists(_countof(submitted_command_lists), submitted_command_lists);
+
+        // The last segment of every queue signals, so this value is always reached
+        pool.Release(std::move(command_list), GetTimeline(queue).GetNextValue(), static_cast<uint32>(passes.size()));
+    }
+
+    uint64 D3D12QueueBackend::Signal(PassQueue queue)
+    {
+        return GetTimeline(queue).Signal();
+    }
+
+    void D3D12QueueBackend::Wait(PassQueue waiting_queue, PassQueue signaling_queue, uint64 value)
+    {
+        GetTimeline(signaling_queue).EnqueueWait(GetCommandQueue(waiting_queue), value);
+    }
+
+    void NullQueueBackend::Submit(PassQueue queue, std::span<const PassHandle> passes, const std::vector<PassDesc>& pass_descs)
+    {
+        if (pass_start_times_.size() < pass_descs.size())
+        {
+            pass_start_times_.resize(pass_descs.size(), 0.0);
+            pass_end_times_.resize(pass_descs.size(), 0.0);
+        }
+
+        double& queue_time = queue_times_[static_cast<uint32>(queue)];
+        for (const PassHandle pass : passes)
+        {
+            pass_start_times_[pass] = queue_time;
+            queue_time += pass_descs[pass].estimated_cost_ms;
+            pass_end_times_[pass] = queue_time;
+        }
+    }
+
+    uint64 NullQueueBackend::Signal(PassQueue queue)
+    {
+        std::vector<double>& signal_times = signal_times_[static_cast<uint32>(queue)];
+        signal_times.push_back(queue_times_[static_cast<uint32>(queue)]);
+        return signal_times.size();
+    }
+
+    void NullQueueBackend::Wait(PassQueue waiting_queue, PassQueue signaling_queue, uint64 value)
+    {
+        const std::vector<double>& signal_times = signal_times_[static_cast<uint32>(signaling_queue)];
+        if (value == 0 || value > signal_times.size())
+        {
+            // Nothing submitted so far signals this value, the queue would hang
+            ++num_invalid_waits_;
+            return;
+        }
+
+        double& queue_time = queue_times_[static_cast<uint32>(waiting_queue)];
+        queue_time = std::max(queue_time, signal_times[value - 1]);
+    }
+
+    void NullQueueBackend::Reset()
+    {
+        queue_times_ = {};
+        for (std::vector<double>& signal_times : signal_times_)
+        {
+            signal_times.clear();
+        }
+        pass_start_times_.clear();
+        pass_end_times_.clear();
+        num_invalid_waits_ = 0;
+    }
+
+    SimulatedTimeline NullQueueBackend::Evaluate(const std::vector<PassDesc>& pass_descs) const
+    {
+        CHECK_MSG(pass_end_times_.size() == pass_descs.size(), "Evaluated passes don't match the executed ones");
+
+        SimulatedTimeline timeline;
+        timeline.num_invalid_waits = num_invalid_waits_;
+        timeline.makespan_ms = *std::max_element(queue_times_.begin(), queue_times_.end());
+
+        for (PassHandle pass = 0; pass < pass_descs.size(); ++pass)
+        {
+            timeline.serial_ms += pass_descs[pass].estimated_cost_ms;
+            for (const PassHandle dependency : pass_descs[pass].dependencies)
+            {
+                if (pass_start_times_[pass] < pass_end_times_[dependency])
+                {
+                    LOG_ERROR("Pass '{}' starts at {:.3f} ms before its dependency '{}' finished at {:.3f} ms",
+                        pass_descs[pass].name, pass_start_times_[pass], pass_descs[dependency].name, pass_end_times_[dependency]);
+                    ++timeline.num_dependency_violations;
+                }
+            }
+        }
+
+        timeline.overlap_ms = timeline.serial_ms - timeline.makespan_ms;
+        return timeline;
+    }
+
+    void AsyncComputeScheduler::Reset()
+    {
+        passes_.clear();
+        segments_.clear();
+        stats_ = {};
+        is_compiled_ = false;
+    }
+
+    PassHandle AsyncComputeScheduler::AddPass(PassDesc&& desc)
+    {
+        CHECK(desc.queue < PassQueue::COUNT);
+        const PassHandle handle = static_cast<PassHandle>(passes_.size());
+        for (const PassHandle dependency : desc.dependencies)
+        {
+            CHECK_MSG(dependency < handle, "Dependencies have to be added before the passes reading them");
+        }
+
+        passes_.push_back(std::move(desc));
+        is_compiled_ = false;
+        return handle;
+    }
+
+    void AsyncComputeScheduler::Compile(bool allow_async)
+    {
+        static constexpr uint32 INVALID_IDX = QueueSegment::INVALID_IDX;
+        static constexpr uint32 NUM_QUEUES = static_cast<uint32>(PassQueue::COUNT);
+
+        segments_.clear();
+        stats_ = {};
+
+        std::vector<uint32> pass_segments(passes_.size(), INVALID_IDX);
+        std::array<uint32, NUM_QUEUES> open_segments;
+        std::array<uint32, NUM_QUEUES> waited_segments;    // Latest segment of the other queue each queue waited for
+        open_segments.fill(INVALID_IDX);
+        waited_segments.fill(INVALID_IDX);
+
+        auto get_queue = [&](PassHandle pass)
+        {
+            return allow_async ? passes_[pass].queue : PassQueue::GRAPHICS;
+        };
+
+        for (PassHandle pass = 0; pass < passes_.size(); ++pass)
+        {
+            const PassQueue queue = get_queue(pass);
+            const uint32 queue_idx = static_cast<uint32>(queue);
+            const uint32 other_queue_idx = static_cast<uint32>(GetOtherQueue(queue));
+
+            // Segments are numbered in submission order, so the latest producing segment covers all earlier ones
+            uint32 required_segment = INVALID_IDX;
+            for (const PassHandle dependency : passes_[pass].dependencies)
+            {
+                if (get_queue(dependency) != queue)
+                {
+                    const uint32 dependency_segment = pass_segments[dependency];
+                    required_segment = required_segment == INVALID_IDX ? dependency_segment : std::max(required_segment, dependency_segment);
+                }
+            }
+
+            const bool needs_wait = required_segment != INVALID_IDX &&
+                (waited_segments[queue_idx] == INVALID_IDX || required_segment > waited_segments[queue_idx]);
+            if (needs_wait)
+            {
+                // Signal as early as possible, later work on the producing queue goes into a new segment
+                segments_[required_segment].signal = true;
+                if (open_segments[other_queue_idx] == required_segment)
+                {
+                    open_segments[other_queue_idx] = INVALID_IDX;
+                }
+                open_segments[queue_idx] = INVALID_IDX;
+            }
+
+            if (open_segments[queue_idx] == INVALID_IDX)
+            {
+                open_segments[queue_idx] = static_cast<uint32>(segments_.size());
+                segments_.push_back({ .queue = queue, .wait_segment_idx = needs_wait ? required_segment : INVALID_IDX });
+                if (needs_wait)
+                {
+                    waited_segments[queue_idx] = required_segment;
+                }
+            }
+
+            segments_[open_segments[queue_idx]].passes.push_back(pass);
+            pass_segments[pass] = open_segments[queue_idx];
+
+            ++stats_.num_passes;
+            if (queue == PassQueue::ASYNC_COMPUTE)
+            {
+                ++stats_.num_async_passes;
+            }
+        }
+
+        // Join async compute back into graphics, so the direct queue timeline covers the whole frame
+        std::array<uint32, NUM_QUEUES> last_segments;
+        last_segments.fill(INVALID_IDX);
+        for (uint32 segment_idx = 0; segment_idx < segments_.size(); ++segment_idx)
+        {
+            last_segments[static_cast<uint32>(segments_[segment_idx].queue)] = segment_idx;
+        }
+
+        const uint32 last_compute_segment = last_segments[static_cast<uint32>(PassQueue::ASYNC_COMPUTE)];
+        const uint32 graphics_waited_segment = waited_segments[static_cast<uint32>(PassQueue::GRAPHICS)];
+        if (last_compute_segment != INVALID_IDX && (graphics_waited_segment == INVALID_IDX || graphics_waited_segment < last_compute_segment))
+        {
+            last_segments[static_cast<uint32>(PassQueue::GRAPHICS)] = static_cast<uint32>(segments_.size());
+            segments_.push_back({ .queue = PassQueue::GRAPHICS, .wait_segment_idx = last_compute_segment });
+        }
+
+        // Every queue signals after its last segment, so the GPU's progress through the schedule is observable
+        for (const uint32 last_segment : last_segments)
+        {
+            if (last_segment != INVALID_IDX)
+            {
+                segments_[last_segment].signal = true;
+            }
+        }
+
+        stats_.num_segments = static_cast<uint32>(segments_.size());
+        for (const QueueSegment& segment : segments_)
+        {
+            stats_.num_signals += segment.signal ? 1 : 0;
+            stats_.num_waits += segment.wait_segment_idx != INVALID_IDX ? 1 : 0;
+        }
+
+        is_compiled_ = true;
+    }
+
+    void AsyncComputeScheduler::Execute(IQueueBackend& backend) const
+    {
+        CHECK_MSG(is_compiled_, "Schedule has to be compiled before it can be executed");
+
+        std::vector<uint64> signaled_values(segments_.size(), 0);
+        for (uint32 segment_idx = 0; segment_idx < segments_.size(); ++segment_idx)
+        {
+            const QueueSegment& segment = segments_[segment_idx];
+            if (segment.wait_segment_idx != QueueSegment::INVALID_IDX)
+            {
+                CHECK(signaled_values[segment.wait_segment_idx] != 0);
+                backend.Wait(segment.queue, segments_[segment.wait_segment_idx].queue, signaled_values[segment.wait_segment_idx]);
+            }
+
+            if (segment.passes.empty() == false)
+            {
+                backend.Submit(segment.queue, segment.passes, passes_);
+            }
+
+            if (segment.signal)
+            {
+                signaled_values[segment_idx] = backend.Signal(segment.queue);
+            }
+        }
+    }
+}
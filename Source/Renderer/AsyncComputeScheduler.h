@@ -0,0 +1,173 @@
+#pragma once
+#include <span>
+
+#include "Renderer/DXUtils.h"
+
+namespace gfx
+{
+    enum class PassQueue : uint8
+    {
+        GRAPHICS,       // Direct queue
+        ASYNC_COMPUTE,  // Compute queue, runs concurrently with graphics work it doesn't depend on
+        COUNT
+    };
+
+    inline const char* ToString(PassQueue queue)
+    {
+        switch (queue)
+        {
+        case PassQueue::GRAPHICS:       return "Graphics";
+        case PassQueue::ASYNC_COMPUTE:  return "Async Compute";
+        default:                        return "Unknown";
+        }
+    }
+
+    using PassHandle = uint32;
+    using PassRecordFunction = std::function<void(ID3D12GraphicsCommandList* command_list)>;
+
+    struct PassDesc
+    {
+        const char* name = "";
+        PassQueue queue = PassQueue::GRAPHICS;
+        std::vector<PassHandle> dependencies;   // Passes whose output this one reads. Have to be added before it.
+        double estimated_cost_ms = 0.0;         // Only used by the simulated timeline
+        PassRecordFunction record;              // Lists start without any bound state
+    };
+
+    /**
+     * @brief Contiguous run of passes on one queue, submitted with a single ExecuteCommandLists.
+     * Segment boundaries are the only places the scheduler synchronizes queues.
+     */
+    struct QueueSegment
+    {
+        static inline constexpr uint32 INVALID_IDX = std::numeric_limits<uint32>::max();
+
+        PassQueue queue = PassQueue::GRAPHICS;
+        std::vector<PassHandle> passes;         // May be empty for a pure join
+        uint32 wait_segment_idx = INVALID_IDX;  // Segment on the other queue to wait for before executing
+        bool signal = false;                    // Signals its queue timeline after executing
+    };
+
+    struct AsyncComputeScheduleStats
+    {
+        uint32 num_passes = 0;
+        uint32 num_async_passes = 0;
+        uint32 num_segments = 0;
+        uint32 num_signals = 0;
+        uint32 num_waits = 0;
+    };
+
+    /**
+     * @brief Executes a compiled schedule. Segments arrive in submission order and every wait refers to a value
+     * returned by an earlier Signal() call.
+     */
+    class IQueueBackend
+    {
+    public:
+        virtual ~IQueueBackend() = default;
+
+        virtual void Submit(PassQueue queue, std::span<const PassHandle> passes, const std::vector<PassDesc>& pass_descs) = 0;
+
+        // @return The signaled timeline value
+        virtual uint64 Signal(PassQueue queue) = 0;
+
+        // GPU-side wait, the calling thread never blocks
+        virtual void Wait(PassQueue waiting_queue, PassQueue signaling_queue, uint64 value) = 0;
+    };
+
+    /**
+     * @brief Records passes on lists from the direct and compute command list pools and synchronizes the
+     * queues via their timeline fences.
+     */
+    class D3D12QueueBackend : public IQueueBackend
+    {
+    public:
+        virtual void Submit(PassQueue queue, std::span<const PassHandle> passes, const std::vector<PassDesc>& pass_descs) override;
+        virtual uint64 Signal(PassQueue queue) override;
+        virtual void Wait(PassQueue waiting_queue, PassQueue signaling_queue, uint64 value) override;
+    };
+
+    struct SimulatedTimeline
+    {
+        double serial_ms = 0.0;     // Sum of all pass costs, i.e. the frame without any overlap
+        double makespan_ms = 0.0;   // Time until every queue is idle
+        double overlap_ms = 0.0;    // Time saved by running queues concurrently
+        uint32 num_dependency_violations = 0;   // Passes starting before one of their dependencies finished
+        uint32 num_invalid_waits = 0;           // Waits for values which have not been signaled, i.e. deadlocks
+    };
+
+    /**
+     * @brief Simulates the queues on a timeline instead of touching a device.
+     * Each pass occupies its queue for its estimated cost, signals record the queue's current time and waits
+     * stall a queue until the signal's time. Queues are assumed not to slow each other down, so the overlap
+     * is an upper bound of what the hardware delivers.
+     */
+    class NullQueueBackend : public IQueueBackend
+    {
+    public:
+        virtual void Submit(PassQueue queue, std::span<const PassHandle> passes, const std::vector<PassDesc>& pass_descs) override;
+        virtual uint64 Signal(PassQueue queue) override;
+        virtual void Wait(PassQueue waiting_queue, PassQueue signaling_queue, uint64 value) override;
+
+        void Reset();
+
+        /**
+         * @brief Checks every dependency edge of the executed passes against the simulated start and end times.
+         */
+        SimulatedTimeline Evaluate(const std::vector<PassDesc>& pass_descs) const;
+
+    private:
+        static inline constexpr uint32 NUM_QUEUES = static_cast<uint32>(PassQueue::COUNT);
+
+        std::array<double, NUM_QUEUES> queue_times_ = {};
+        std::array<std::vector<double>, NUM_QUEUES> signal_times_;  // Indexed by timeline value - 1
+        std::vector<double> pass_start_times_;
+        std::vector<double> pass_end_times_;
+        uint32 num_invalid_waits_ = 0;
+    };
+
+    /**
+     * @brief Places passes on the graphics or the async compute queue and synchronizes them at dependency edges.
+     * Passes are submitted in the order they have been added, which has to be a valid topological order.
+     * Consecutive passes on a queue share a segment until a pass depends on work of the other queue the segment
+     * hasn't waited for yet. Only then the producing segment signals and the consuming one waits, so independent
+     * work on both queues overlaps. Async compute work is joined back into the graphics queue at the end, which
+     * keeps frame resource lifetimes tied to the direct queue timeline.
+     */
+    class AsyncComputeScheduler
+    {
+    public:
+        void Reset();
+
+        PassHandle AddPass(PassDesc&& desc);
+
+        /**
+         * @brief Builds the segments and their synchronization. Has to be called before Execute().
+         * @param allow_async If false, async compute passes run on the graphics queue. Useful for comparisons.
+         */
+        void Compile(bool allow_async = true);
+
+        void Execute(IQueueBackend& backend) const;
+
+        const std::vector<PassDesc>& GetPasses() const
+        {
+            return passes_;
+        }
+
+        const std::vector<QueueSegment>& GetSegments() const
+        {
+            return segments_;
+        }
+
+        const AsyncComputeScheduleStats& GetStats() const
+        {
+            return stats_;
+        }
+
+    private:
+        std::vector<PassDesc> passes_;
+        std::vector<QueueSegment> segments_;
+        AsyncComputeScheduleStats stats_;
+        bool is_compiled_ = false;
+    };
+}
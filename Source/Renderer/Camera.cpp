@@ -60,6 +60,8 @@ const Mat4& Camera::GetProjection()
 void Camera::SetProjection(const Mat4& projection)
 {
     projection_ = projection;
+    inv_projection_ = projection.Invert();
+    is_view_projection_dirty_ = true;
 }
 
 const Mat4& Camera::GetView()
@@ -199,6 +201,7 @@ void Camera::Update()
 void Camera::RecalculateProjection()
 {
     projection_ = Mat4::PerspectiveFovLH(fov_, aspect_ratio_, near_clip_, far_clip_);
+    inv_projection_ = projection_.InvertPerspective();
     is_projection_dirty_ = false;
     is_view_projection_dirty_ = true;
 }
@@ -213,6 +216,7 @@ void Camera::RecalculateView()
 void Camera::RecalculateViewProjection()
 {
     view_projection_ = view_ * projection_;
-    inv_view_projection_ = view_projection_.Invert();
+    // inverse(V * P) = inverse(P) * inverse(V). The view is affine and the projection inverse is cached, so no general 4x4 inverse is needed.
+    inv_view_projection_ = inv_projection_ * Affine3x4(view_).InverseAffine().ToMat4();
     is_view_projection_dirty_ = false;
 }
@@ -83,6 +83,7 @@ private:
     bool is_view_dirty_ = true;
 
     Mat4 projection_;
+    Mat4 inv_projection_;
     bool is_projection_dirty_ = true;
 
     Mat4 view_projection_;
@@ -0,0 +1,321 @@
+#include "Renderer/ClusteredLightCulling.h"
+
+#include <bit>
+#include <chrono>
+
+#include "Core/JobSystem.h"
+#include "Core/SimdLanes.h"
+#include "Renderer/Camera.h"
+
+namespace gfx
+{
+    namespace
+    {
+        using namespace simd;
+        using Clock = std::chrono::high_resolution_clock;
+
+        inline Vec3 TransformPoint(const Vec3& p, const Mat4& m)
+        {
+            return Vec3(
+                p.x * m._11 + p.y * m._21 + p.z * m._31 + m._41,
+                p.x * m._12 + p.y * m._22 + p.z * m._32 + m._42,
+                p.x * m._13 + p.y * m._23 + p.z * m._33 + m._43);
+        }
+
+        inline Vec3 TransformDirection(const Vec3& d, const Mat4& m)
+        {
+            return Vec3(
+                d.x * m._11 + d.y * m._21 + d.z * m._31,
+                d.x * m._12 + d.y * m._22 + d.z * m._32,
+                d.x * m._13 + d.y * m._23 + d.z * m._33);
+        }
+    }
+
+    void ClusteredLightCulling::Init(uint32 num_tiles_x, uint32 num_tiles_y, uint32 num_slices)
+    {
+        CHECK(num_tiles_x > 0 && num_tiles_y > 0 && num_slices > 0);
+        num_tiles_x_ = num_tiles_x;
+        num_tiles_y_ = num_tiles_y;
+        num_slices_ = num_slices;
+        num_groups_per_slice_ = (num_tiles_x * num_tiles_y + NUM_LANES - 1) / NUM_LANES;
+
+        cluster_groups_.resize(num_groups_per_slice_ * num_slices);
+        slice_min_z_.resize(num_slices);
+        slice_max_z_.resize(num_slices);
+        slice_hits_.resize(num_slices);
+        slice_light_indices_.resize(num_slices);
+        cluster_ranges_.resize(GetNumClusters());
+
+        // Forces the bounds to be built on the first Build()
+        near_clip_ = 0.0f;
+        far_clip_ = 0.0f;
+    }
+
+    void ClusteredLightCulling::Build(Camera& camera, std::span<const Light> lights)
+    {
+        CHECK(num_slices_ > 0);
+        const auto start = Clock::now();
+
+        const Mat4& projection = camera.GetProjection();
+        if (memcmp(&projection, &projection_, sizeof(Mat4)) != 0 || camera.GetNearClip() != near_clip_ || camera.GetFarClip() != far_clip_)
+        {
+            RebuildClusterBounds(projection, camera.GetNearClip(), camera.GetFarClip());
+        }
+
+        // Lights move to view space once, so the per cluster tests don't need to transform anything
+        const Mat4& view = camera.GetView();
+        view_lights_.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); ++i)
+        {
+            const Light& light = lights[i];
+            ViewLight& view_light = view_lights_[i];
+            view_light.position = TransformPoint(light.position, view);
+            view_light.range = light.range;
+            view_light.direction = TransformDirection(light.direction, view);
+            view_light.cos_angle = std::cos(light.outer_cone_angle);
+            view_light.sin_angle = std::sin(light.outer_cone_angle);
+            view_light.is_spot = light.type == LightType::SPOT;
+
+            const float light_min_z = view_light.position.z - light.range;
+            const float light_max_z = view_light.position.z + light.range;
+            if (light.range <= 0.0f || light_max_z < near_clip_ || light_min_z > far_clip_)
+            {
+                // Empty slice range, skipped by every slice
+                view_light.min_slice = 1;
+                view_light.max_slice = 0;
+                continue;
+            }
+            view_light.min_slice = GetSliceIdx(light_min_z);
+            view_light.max_slice = GetSliceIdx(light_max_z);
+        }
+
+        jobs::Dispatch(num_slices_, [this](uint32 slice) { AssignSlice(slice); });
+
+        // Slices wrote offsets relative to their own index lists, which are concatenated in slice order
+        const uint32 num_clusters_per_slice = num_tiles_x_ * num_tiles_y_;
+        uint32 num_indices = 0;
+        stats_ = {};
+        for (uint32 slice = 0; slice < num_slices_; ++slice)
+        {
+            for (uint32 i = 0; i < num_clusters_per_slice; ++i)
+            {
+                ClusterRange& range = cluster_ranges_[slice * num_clusters_per_slice + i];
+                range.offset += num_indices;
+                stats_.max_lights_per_cluster = std::max(stats_.max_lights_per_cluster, range.count);
+                stats_.num_empty_clusters += range.count == 0 ? 1 : 0;
+            }
+            num_indices += static_cast<uint32>(slice_light_indices_[slice].size());
+        }
+
+        light_indices_.resize(num_indices);
+        for (uint32 slice = 0, offset = 0; slice < num_slices_; ++slice)
+        {
+            std::copy(slice_light_indices_[slice].begin(), slice_light_indices_[slice].end(), light_indices_.begin() + offset);
+            offset += static_cast<uint32>(slice_light_indices_[slice].size());
+        }
+
+        stats_.num_lights = static_cast<uint32>(lights.size());
+        stats_.num_light_indices = num_indices;
+        stats_.build_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    uint32 ClusteredLightCulling::GetSliceIdx(float view_z) const
+    {
+        if (view_z <= near_clip_)
+        {
+            return 0;
+        }
+        const float slice = std::log(view_z) * slice_scale_ + slice_bias_;
+        return std::min(static_cast<uint32>(std::max(slice, 0.0f)), num_slices_ - 1);
+    }
+
+    uint32 ClusteredLightCulling::GetClusterIdx(float u, float v, float view_z) const
+    {
+        const uint32 tile_x = std::min(static_cast<uint32>(std::max(u, 0.0f) * num_tiles_x_), num_tiles_x_ - 1);
+        const uint32 tile_y = std::min(static_cast<uint32>(std::max(v, 0.0f) * num_tiles_y_), num_tiles_y_ - 1);
+        return (GetSliceIdx(view_z) * num_tiles_y_ + tile_y) * num_tiles_x_ + tile_x;
+    }
+
+    void ClusteredLightCulling::RebuildClusterBounds(const Mat4& projection, float near_clip, float far_clip)
+    {
+        CHECK(near_clip > 0.0f && far_clip > near_clip);
+        projection_ = projection;
+        near_clip_ = near_clip;
+        far_clip_ = far_clip;
+
+        // z_k = near * (far / near)^(k / num_slices), solved for k
+        const float log_depth_ratio = std::log(far_clip / near_clip);
+        slice_scale_ = num_slices_ / log_depth_ratio;
+        slice_bias_ = -static_cast<float>(num_slices_) * std::log(near_clip) / log_depth_ratio;
+
+        const uint32 num_clusters_per_slice = num_tiles_x_ * num_tiles_y_;
+        for (uint32 slice = 0; slice < num_slices_; ++slice)
+        {
+            const float z_near = near_clip * std::pow(far_clip / near_clip, static_cast<float>(slice) / num_slices_);
+            const float z_far = near_clip * std::pow(far_clip / near_clip, static_cast<float>(slice + 1) / num_slices_);
+            slice_min_z_[slice] = z_near;
+            slice_max_z_[slice] = z_far;
+
+            for (uint32 i = 0; i < num_groups_per_slice_ * NUM_LANES; ++i)
+            {
+                ClusterGroup& group = cluster_groups_[slice * num_groups_per_slice_ + i / NUM_LANES];
+                const uint32 lane = i % NUM_LANES;
+                if (i >= num_clusters_per_slice)
+                {
+                    // Padding, never hit
+                    group.min_x[lane] = group.min_y[lane] = std::numeric_limits<float>::max();
+                    group.max_x[lane] = group.max_y[lane] = std::numeric_limits<float>::lowest();
+                    group.center_x[lane] = group.center_y[lane] = group.center_z[lane] = 0.0f;
+                    group.radius[lane] = 0.0f;
+                    continue;
+                }
+
+                // Tile corners in NDC, tile row 0 at the top of the screen
+                const uint32 tile_x = i % num_tiles_x_;
+                const uint32 tile_y = i / num_tiles_x_;
+                const float ndc_min_x = -1.0f + 2.0f * tile_x / num_tiles_x_;
+                const float ndc_max_x = -1.0f + 2.0f * (tile_x + 1) / num_tiles_x_;
+                const float ndc_max_y = 1.0f - 2.0f * tile_y / num_tiles_y_;
+                const float ndc_min_y = 1.0f - 2.0f * (tile_y + 1) / num_tiles_y_;
+
+                // The tile's frustum between the slice planes, which widens with depth, so the extremes are at either plane
+                float min_x = std::numeric_limits<float>::max();
+                float max_x = std::numeric_limits<float>::lowest();
+                float min_y = std::numeric_limits<float>::max();
+                float max_y = std::numeric_limits<float>::lowest();
+                for (const float z : { z_near, z_far })
+                {
+                    for (const float ndc_x : { ndc_min_x, ndc_max_x })
+                    {
+                        const float x = (ndc_x - projection._31) * z / projection._11;
+                        min_x = std::min(min_x, x);
+                        max_x = std::max(max_x, x);
+                    }
+                    for (const float ndc_y : { ndc_min_y, ndc_max_y })
+                    {
+                        const float y = (ndc_y - projection._32) * z / projection._22;
+                        min_y = std::min(min_y, y);
+                        max_y = std::max(max_y, y);
+                    }
+                }
+
+                group.min_x[lane] = min_x;
+                group.min_y[lane] = min_y;
+                group.max_x[lane] = max_x;
+                group.max_y[lane] = max_y;
+                group.center_x[lane] = (min_x + max_x) * 0.5f;
+                group.center_y[lane] = (min_y + max_y) * 0.5f;
+                group.center_z[lane] = (z_near + z_far) * 0.5f;
+                const float half_x = (max_x - min_x) * 0.5f;
+                const float half_y = (max_y - min_y) * 0.5f;
+                const float half_z = (z_far - z_near) * 0.5f;
+                group.radius[lane] = std::sqrt(half_x * half_x + half_y * half_y + half_z * half_z);
+            }
+        }
+    }
+
+    void ClusteredLightCulling::AssignSlice(uint32 slice)
+    {
+        const uint32 num_clusters_per_slice = num_tiles_x_ * num_tiles_y_;
+        ClusterRange* ranges = &cluster_ranges_[slice * num_clusters_per_slice];
+        for (uint32 i = 0; i < num_clusters_per_slice; ++i)
+        {
+            ranges[i] = {};
+        }
+
+        std::vector<GroupHit>& hits = slice_hits_[slice];
+        hits.clear();
+
+        const FloatLanes zero = Splat(0.0f);
+        const ClusterGroup* groups = &cluster_groups_[slice * num_groups_per_slice_];
+        const uint32 num_tail_lanes = num_clusters_per_slice - (num_groups_per_slice_ - 1) * NUM_LANES;
+        const float slice_min_z = slice_min_z_[slice];
+        const float slice_max_z = slice_max_z_[slice];
+        for (uint32 light_idx = 0; light_idx < view_lights_.size(); ++light_idx)
+        {
+            const ViewLight& light = view_lights_[light_idx];
+            if (slice < light.min_slice || slice > light.max_slice)
+            {
+                continue;
+            }
+
+            // Sphere vs AABB as squared distance to the box, the z part is the same for the whole slice
+            const float distance_z = std::max(slice_min_z - light.position.z, 0.0f) + std::max(light.position.z - slice_max_z, 0.0f);
+            const float remaining_radius_sq = light.range * light.range - distance_z * distance_z;
+            if (remaining_radius_sq < 0.0f)
+            {
+                continue;
+            }
+
+            const FloatLanes light_x = Splat(light.position.x);
+            const FloatLanes light_y = Splat(light.position.y);
+            const FloatLanes light_z = Splat(light.position.z);
+            const FloatLanes radius_sq = Splat(remaining_radius_sq);
+            const FloatLanes range = Splat(light.range);
+            const FloatLanes direction_x = Splat(light.direction.x);
+            const FloatLanes direction_y = Splat(light.direction.y);
+            const FloatLanes direction_z = Splat(light.direction.z);
+            const FloatLanes cos_angle = Splat(light.cos_angle);
+            const FloatLanes sin_angle = Splat(light.sin_angle);
+
+            for (uint32 group_idx = 0; group_idx < num_groups_per_slice_; ++group_idx)
+            {
+                const ClusterGroup& group = groups[group_idx];
+                const FloatLanes distance_x = Max(Load(group.min_x) - light_x, zero) + Max(light_x - Load(group.max_x), zero);
+                const FloatLanes distance_y = Max(Load(group.min_y) - light_y, zero) + Max(light_y - Load(group.max_y), zero);
+                MaskLanes is_hit = distance_x * distance_x + distance_y * distance_y <= radius_sq;
+
+                if (light.is_spot && Any(is_hit))
+                {
+                    // Cone vs the cluster's bounding sphere: distance of the sphere center to the cone's side,
+                    // plus culling spheres entirely in front of the range or behind the apex
+                    const FloatLanes to_center_x = Load(group.center_x) - light_x;
+                    const FloatLanes to_center_y = Load(group.center_y) - light_y;
+                    const FloatLanes to_center_z = Load(group.center_z) - light_z;
+                    const FloatLanes length_sq = to_center_x * to_center_x + to_center_y * to_center_y + to_center_z * to_center_z;
+                    const FloatLanes along_axis = to_center_x * direction_x + to_center_y * direction_y + to_center_z * direction_z;
+                    const FloatLanes distance_to_axis = Sqrt(Max(length_sq - along_axis * along_axis, zero));
+                    const FloatLanes distance_to_cone = cos_angle * distance_to_axis - along_axis * sin_angle;
+                    const FloatLanes sphere_radius = Load(group.radius);
+                    is_hit = is_hit & (distance_to_cone <= sphere_radius) & (along_axis <= sphere_radius + range) & (along_axis >= zero - sphere_radius);
+                }
+
+                uint32 lane_mask = MoveMask(is_hit);
+                if (group_idx == num_groups_per_slice_ - 1)
+                {
+                    lane_mask &= (1u << num_tail_lanes) - 1;
+                }
+                if (lane_mask == 0)
+                {
+                    continue;
+                }
+
+                hits.push_back({ .light_idx = light_idx, .group_idx = group_idx, .lane_mask = lane_mask });
+                for (uint32 bits = lane_mask; bits != 0; bits &= bits - 1)
+                {
+                    ++ranges[group_idx * NUM_LANES + std::countr_zero(bits)].count;
+                }
+            }
+        }
+
+        // Counts to offsets, then scatter with the counts as cursors. Hits are in light order, so each cluster's lights are too.
+        uint32 num_indices = 0;
+        for (uint32 i = 0; i < num_clusters_per_slice; ++i)
+        {
+            ranges[i].offset = num_indices;
+            num_indices += ranges[i].count;
+            ranges[i].count = 0;
+        }
+
+        std::vector<uint32>& indices = slice_light_indices_[slice];
+        indices.resize(num_indices);
+        for (const GroupHit& hit : hits)
+        {
+            for (uint32 bits = hit.lane_mask; bits != 0; bits &= bits - 1)
+            {
+                ClusterRange& range = ranges[hit.group_idx * NUM_LANES + std::countr_zero(bits)];
+                indices[range.offset + range.count++] = hit.light_idx;
+            }
+        }
+    }
+}
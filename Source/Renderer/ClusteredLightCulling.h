@@ -0,0 +1,166 @@
+#pragma once
+#include <span>
+
+class Camera;
+
+namespace gfx
+{
+    enum class LightType : uint32
+    {
+        POINT,
+        SPOT
+    };
+
+    // World space, laid out to be uploaded as is next to the cluster buffers
+    struct Light
+    {
+        Vec3 position;
+        float range = 1.0f;
+        Vec3 color = Vec3::ONE;
+        LightType type = LightType::POINT;
+        Vec3 direction = Vec3::FORWARD;     // Spot lights only, normalized
+        float outer_cone_angle = PI_HALF * 0.5f;    // Spot lights only, half angle in radians
+    };
+
+    // Light index list range of one cluster
+    struct ClusterRange
+    {
+        uint32 offset = 0;
+        uint32 count = 0;
+    };
+
+    struct ClusteredLightCullingStats
+    {
+        uint32 num_lights = 0;
+        uint32 num_light_indices = 0;
+        uint32 max_lights_per_cluster = 0;
+        uint32 num_empty_clusters = 0;
+        double build_ms = 0.0;
+    };
+
+    /**
+     * @brief Assigns lights to a froxel grid, i.e. the camera frustum split into screen tiles and depth slices.
+     * Slices are spaced exponentially between the near and far plane, so clusters stay roughly cubic.
+     * Lights are tested against view space cluster AABBs 8 clusters at a time: point lights with a sphere test,
+     * spot lights additionally with a cone test against the AABB's bounding sphere. Slices are assigned in parallel.
+     * The result is a compact light index list plus offset / count per cluster, clusters ordered x, then y, then slice.
+     * Lights within a cluster keep their order from the input.
+     */
+    class ClusteredLightCulling
+    {
+    public:
+        static inline constexpr uint32 DEFAULT_TILES_X = 16;
+        static inline constexpr uint32 DEFAULT_TILES_Y = 9;
+        static inline constexpr uint32 DEFAULT_NUM_SLICES = 24;
+
+        void Init(uint32 num_tiles_x = DEFAULT_TILES_X, uint32 num_tiles_y = DEFAULT_TILES_Y, uint32 num_slices = DEFAULT_NUM_SLICES);
+
+        /**
+         * @brief Assigns lights for the camera's current view. Cluster bounds are only rebuilt when the projection changed.
+         */
+        void Build(Camera& camera, std::span<const Light> lights);
+
+        const std::vector<ClusterRange>& GetClusterRanges() const
+        {
+            return cluster_ranges_;
+        }
+
+        const std::vector<uint32>& GetLightIndices() const
+        {
+            return light_indices_;
+        }
+
+        uint32 GetNumClusters() const
+        {
+            return num_tiles_x_ * num_tiles_y_ * num_slices_;
+        }
+
+        /**
+         * @brief Depth slice of a view space depth is log(z) * scale + bias, clamped to the slice range.
+         * The same two constants let shaders find their cluster.
+         */
+        float GetSliceScale() const
+        {
+            return slice_scale_;
+        }
+
+        float GetSliceBias() const
+        {
+            return slice_bias_;
+        }
+
+        uint32 GetSliceIdx(float view_z) const;
+
+        // @param u, v Screen position in [0, 1], v pointing down
+        uint32 GetClusterIdx(float u, float v, float view_z) const;
+
+        const ClusteredLightCullingStats& GetStats() const
+        {
+            return stats_;
+        }
+
+    private:
+        // SoA bounds of 8 neighbouring clusters in a slice
+        struct alignas(32) ClusterGroup
+        {
+            float min_x[8];
+            float min_y[8];
+            float max_x[8];
+            float max_y[8];
+            float center_x[8];
+            float center_y[8];
+            float center_z[8];
+            float radius[8];
+        };
+
+        // Light in view space with everything the tests need per light
+        struct ViewLight
+        {
+            Vec3 position;
+            float range = 0.0f;
+            Vec3 direction;
+            float cos_angle = 0.0f;
+            float sin_angle = 0.0f;
+            bool is_spot = false;
+            uint32 min_slice = 0;
+            uint32 max_slice = 0;
+        };
+
+        // A light hitting some of a group's clusters
+        struct GroupHit
+        {
+            uint32 light_idx = 0;
+            uint32 group_idx = 0;
+            uint32 lane_mask = 0;
+        };
+
+        void RebuildClusterBounds(const Mat4& projection, float near_clip, float far_clip);
+        void AssignSlice(uint32 slice);
+
+        uint32 num_tiles_x_ = 0;
+        uint32 num_tiles_y_ = 0;
+        uint32 num_slices_ = 0;
+        uint32 num_groups_per_slice_ = 0;
+
+        // Projection the cluster bounds were built for
+        Mat4 projection_;
+        float near_clip_ = 0.0f;
+        float far_clip_ = 0.0f;
+        float slice_scale_ = 0.0f;
+        float slice_bias_ = 0.0f;
+
+        std::vector<ClusterGroup> cluster_groups_;  // num_groups_per_slice_ per slice
+        std::vector<float> slice_min_z_;
+        std::vector<float> slice_max_z_;
+
+        std::vector<ViewLight> view_lights_;
+
+        // Per slice, reused across frames
+        std::vector<std::vector<GroupHit>> slice_hits_;
+        std::vector<std::vector<uint32>> slice_light_indices_;
+
+        std::vector<ClusterRange> cluster_ranges_;
+        std::vector<uint32> light_indices_;
+        ClusteredLightCullingStats stats_;
+    };
+}
@@ -0,0 +1,403 @@
+#pragma once
+#include <numeric>
+
+#include "Renderer/DXUtils.h"
+
+namespace gfx
+{
+    enum class StateCall : uint8
+    {
+        DESCRIPTOR_HEAPS,
+        ROOT_SIGNATURE,
+        PIPELINE_STATE,
+        PRIMITIVE_TOPOLOGY,
+        INDEX_BUFFER,
+        VIEWPORT,
+        SCISSOR_RECT,
+        RENDER_TARGETS,
+        ROOT_CONSTANTS,
+        COUNT
+    };
+
+    inline const char* ToString(StateCall call)
+    {
+        switch (call)
+        {
+        case StateCall::DESCRIPTOR_HEAPS:
+            return "SetDescriptorHeaps";
+        case StateCall::ROOT_SIGNATURE:
+            return "SetGraphicsRootSignature";
+        case StateCall::PIPELINE_STATE:
+            return "SetPipelineState";
+        case StateCall::PRIMITIVE_TOPOLOGY:
+            return "IASetPrimitiveTopology";
+        case StateCall::INDEX_BUFFER:
+            return "IASetIndexBuffer";
+        case StateCall::VIEWPORT:
+            return "RSSetViewports";
+        case StateCall::SCISSOR_RECT:
+            return "RSSetScissorRects";
+        case StateCall::RENDER_TARGETS:
+            return "OMSetRenderTargets";
+        case StateCall::ROOT_CONSTANTS:
+            return "SetGraphicsRoot32BitConstants";
+        default:
+            CHECK_NO_ENTRY();
+            return "Unknown";
+        }
+    }
+
+    struct CommandContextStats
+    {
+        std::array<uint32, static_cast<size_t>(StateCall::COUNT)> num_issued = {};
+        std::array<uint32, static_cast<size_t>(StateCall::COUNT)> num_filtered = {};
+
+        uint32 GetTotalIssued() const
+        {
+            return std::accumulate(num_issued.begin(), num_issued.end(), 0u);
+        }
+
+        uint32 GetTotalFiltered() const
+        {
+            return std::accumulate(num_filtered.begin(), num_filtered.end(), 0u);
+        }
+
+        CommandContextStats& operator+=(const CommandContextStats& other)
+        {
+            for (size_t i = 0; i < num_issued.size(); ++i)
+            {
+                num_issued[i] += other.num_issued[i];
+                num_filtered[i] += other.num_filtered[i];
+            }
+            return *this;
+        }
+    };
+
+    /**
+     * @brief Wraps a graphics command list, caches bound state and drops calls which would not change it.
+     * Root constants are compared per 32-bit value, so re-setting identical values is filtered as well.
+     * Templated on the command list type so the filter can run against a recording null list without a device.
+     * State set directly on the underlying command list is not tracked, call Invalidate() afterwards.
+     */
+    template<typename CommandListType>
+    class CommandContextT
+    {
+    public:
+        static inline constexpr uint32 MAX_TRACKED_ROOT_PARAMETERS = 8;
+        static inline constexpr uint32 MAX_TRACKED_ROOT_CONSTANTS = 32;    // Per root parameter
+
+        /**
+         * @brief Starts tracking a freshly reset command list. Resets cached state and the per frame stats.
+         */
+        void Begin(CommandListType* command_list)
+        {
+            CHECK(command_list != nullptr);
+            command_list_ = command_list;
+            stats_ = {};
+            Invalidate();
+        }
+
+        // Forgets all cached state, the next call of each kind is issued
+        void Invalidate()
+        {
+            descriptor_heaps_.fill(nullptr);
+            num_descriptor_heaps_ = 0;
+            root_signature_ = nullptr;
+            pso_ = nullptr;
+            primitive_topology_ = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+            index_buffer_view_.reset();
+            viewport_.reset();
+            scissor_rect_.reset();
+            render_targets_.reset();
+            InvalidateRootConstants();
+        }
+
+        void SetDescriptorHeaps(uint32 num_heaps, ID3D12DescriptorHeap* const* heaps)
+        {
+            CHECK(num_heaps <= descriptor_heaps_.size());
+            if (num_heaps == num_descriptor_heaps_ && std::equal(heaps, heaps + num_heaps, descriptor_heaps_.begin()))
+            {
+                Filter(StateCall::DESCRIPTOR_HEAPS);
+                return;
+            }
+
+            std::copy(heaps, heaps + num_heaps, descriptor_heaps_.begin());
+            num_descriptor_heaps_ = num_heaps;
+            command_list_->SetDescriptorHeaps(num_heaps, heaps);
+            Issue(StateCall::DESCRIPTOR_HEAPS);
+        }
+
+        void SetGraphicsRootSignature(ID3D12RootSignature* root_signature)
+        {
+            // Re-setting the same root signature keeps root arguments intact, switching it invalidates them
+            if (root_signature == root_signature_)
+            {
+                Filter(StateCall::ROOT_SIGNATURE);
+                return;
+            }
+
+            root_signature_ = root_signature;
+            InvalidateRootConstants();
+            command_list_->SetGraphicsRootSignature(root_signature);
+            Issue(StateCall::ROOT_SIGNATURE);
+        }
+
+        void SetPipelineState(ID3D12PipelineState* pso)
+        {
+            if (pso == pso_)
+            {
+                Filter(StateCall::PIPELINE_STATE);
+                return;
+            }
+
+            pso_ = pso;
+            command_list_->SetPipelineState(pso);
+            Issue(StateCall::PIPELINE_STATE);
+        }
+
+        void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitive_topology)
+        {
+            if (primitive_topology == primitive_topology_)
+            {
+                Filter(StateCall::PRIMITIVE_TOPOLOGY);
+                return;
+            }
+
+            primitive_topology_ = primitive_topology;
+            command_list_->IASetPrimitiveTopology(primitive_topology);
+            Issue(StateCall::PRIMITIVE_TOPOLOGY);
+        }
+
+        void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* index_buffer_view)
+        {
+            CHECK(index_buffer_view != nullptr);
+            if (index_buffer_view_.has_value() &&
+                index_buffer_view_->BufferLocation == index_buffer_view->BufferLocation &&
+                index_buffer_view_->SizeInBytes == index_buffer_view->SizeInBytes &&
+                index_buffer_view_->Format == index_buffer_view->Format)
+            {
+                Filter(StateCall::INDEX_BUFFER);
+                return;
+            }
+
+            index_buffer_view_ = *index_buffer_view;
+            command_list_->IASetIndexBuffer(index_buffer_view);
+            Issue(StateCall::INDEX_BUFFER);
+        }
+
+        // Single viewport only, which is all we use
+        void RSSetViewport(const D3D12_VIEWPORT& viewport)
+        {
+            if (viewport_.has_value() && memcmp(&*viewport_, &viewport, sizeof(D3D12_VIEWPORT)) == 0)
+            {
+                Filter(StateCall::VIEWPORT);
+                return;
+            }
+
+            viewport_ = viewport;
+            command_list_->RSSetViewports(1, &viewport);
+            Issue(StateCall::VIEWPORT);
+        }
+
+        void RSSetScissorRect(const D3D12_RECT& scissor_rect)
+        {
+            if (scissor_rect_.has_value() && memcmp(&*scissor_rect_, &scissor_rect, sizeof(D3D12_RECT)) == 0)
+            {
+                Filter(StateCall::SCISSOR_RECT);
+                return;
+            }
+
+            scissor_rect_ = scissor_rect;
+            command_list_->RSSetScissorRects(1, &scissor_rect);
+            Issue(StateCall::SCISSOR_RECT);
+        }
+
+        /**
+         * @brief Binds a single render target and an optional depth stencil view.
+         */
+        void OMSetRenderTarget(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv)
+        {
+            const RenderTargets render_targets = { .rtv = rtv.ptr, .dsv = dsv != nullptr ? dsv->ptr : 0 };
+            if (render_targets_.has_value() && render_targets_->rtv == render_targets.rtv && render_targets_->dsv == render_targets.dsv)
+            {
+                Filter(StateCall::RENDER_TARGETS);
+                return;
+            }
+
+            render_targets_ = render_targets;
+            static constexpr bool IS_CONTIGUOUS_ARRAY = false;
+            command_list_->OMSetRenderTargets(1, &rtv, IS_CONTIGUOUS_ARRAY, dsv);
+            Issue(StateCall::RENDER_TARGETS);
+        }
+
+        /**
+         * @brief Sets root constants, dropping the call if all values are already bound.
+         * Only the range which actually changed is uploaded.
+         */
+        void SetGraphicsRoot32BitConstants(uint32 root_parameter_idx, uint32 num_values, const void* data, uint32 dest_offset)
+        {
+            CHECK(data != nullptr);
+            if (root_parameter_idx >= MAX_TRACKED_ROOT_PARAMETERS || dest_offset + num_values > MAX_TRACKED_ROOT_CONSTANTS)
+            {
+                // Out of the tracked range, pass through
+                command_list_->SetGraphicsRoot32BitConstants(root_parameter_idx, num_values, data, dest_offset);
+                Issue(StateCall::ROOT_CONSTANTS);
+                return;
+            }
+
+            RootConstants& bound = root_constants_[root_parameter_idx];
+            const uint32* values = static_cast<const uint32*>(data);
+
+            uint32 first_changed = num_values;
+            uint32 last_changed = 0;
+            for (uint32 i = 0; i < num_values; ++i)
+            {
+                const uint32 idx = dest_offset + i;
+                const bool is_bound = (bound.valid_mask & (1u << idx)) != 0 && bound.values[idx] == values[i];
+                if (is_bound == false)
+                {
+                    first_changed = std::min(first_changed, i);
+                    last_changed = i;
+                    bound.values[idx] = values[i];
+                    bound.valid_mask |= 1u << idx;
+                }
+            }
+
+            if (first_changed == num_values)
+            {
+                Filter(StateCall::ROOT_CONSTANTS);
+                return;
+            }
+
+            command_list_->SetGraphicsRoot32BitConstants(root_parameter_idx, last_changed - first_changed + 1, values + first_changed, dest_offset + first_changed);
+            Issue(StateCall::ROOT_CONSTANTS);
+        }
+
+        void DrawIndexedInstanced(uint32 index_count, uint32 instance_count, uint32 start_index, int32 base_vertex, uint32 start_instance)
+        {
+            command_list_->DrawIndexedInstanced(index_count, instance_count, start_index, base_vertex, start_instance);
+        }
+
+        void DrawInstanced(uint32 vertex_count, uint32 instance_count, uint32 start_vertex, uint32 start_instance)
+        {
+            command_list_->DrawInstanced(vertex_count, instance_count, start_vertex, start_instance);
+        }
+
+        // For calls which do not affect bound state, e.g. barriers and clears
+        CommandListType* GetCommandList() const
+        {
+            return command_list_;
+        }
+
+        const CommandContextStats& GetStats() const
+        {
+            return stats_;
+        }
+
+    private:
+        struct RenderTargets
+        {
+            SIZE_T rtv = 0;
+            SIZE_T dsv = 0;
+        };
+
+        struct RootConstants
+        {
+            std::array<uint32, MAX_TRACKED_ROOT_CONSTANTS> values = {};
+            uint32 valid_mask = 0;
+        };
+        static_assert(MAX_TRACKED_ROOT_CONSTANTS <= sizeof(RootConstants::valid_mask) * 8);
+
+        void InvalidateRootConstants()
+        {
+            for (RootConstants& root_constants : root_constants_)
+            {
+                root_constants.valid_mask = 0;
+            }
+        }
+
+        void Issue(StateCall call)
+        {
+            ++stats_.num_issued[static_cast<size_t>(call)];
+        }
+
+        void Filter(StateCall call)
+        {
+            ++stats_.num_filtered[static_cast<size_t>(call)];
+        }
+
+        CommandListType* command_list_ = nullptr;
+
+        std::array<ID3D12DescriptorHeap*, 2> descriptor_heaps_ = {};   // At most one CBV_SRV_UAV and one sampler heap
+        uint32 num_descriptor_heaps_ = 0;
+        ID3D12RootSignature* root_signature_ = nullptr;
+        ID3D12PipelineState* pso_ = nullptr;
+        D3D12_PRIMITIVE_TOPOLOGY primitive_topology_ = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+        std::optional<D3D12_INDEX_BUFFER_VIEW> index_buffer_view_;
+        std::optional<D3D12_VIEWPORT> viewport_;
+        std::optional<D3D12_RECT> scissor_rect_;
+        std::optional<RenderTargets> render_targets_;
+        std::array<RootConstants, MAX_TRACKED_ROOT_PARAMETERS> root_constants_ = {};
+
+        CommandContextStats stats_;
+    };
+
+    using CommandContext = CommandContextT<ID3D12GraphicsCommandList>;
+
+    /**
+     * @brief Records the calls which reach it instead of talking to a device.
+     * Plugged into CommandContextT to verify which calls the state filter lets through.
+     */
+    class RecordingCommandList
+    {
+    public:
+        struct RecordedCall
+        {
+            StateCall call = StateCall::COUNT;  // COUNT for draws
+            uint32 num_values = 0;              // Root constants only
+            uint32 dest_offset = 0;             // Root constants only
+        };
+
+        void SetDescriptorHeaps(uint32, ID3D12DescriptorHeap* const*) { Record(StateCall::DESCRIPTOR_HEAPS); }
+        void SetGraphicsRootSignature(ID3D12RootSignature*) { Record(StateCall::ROOT_SIGNATURE); }
+        void SetPipelineState(ID3D12PipelineState*) { Record(StateCall::PIPELINE_STATE); }
+        void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) { Record(StateCall::PRIMITIVE_TOPOLOGY); }
+        void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW*) { Record(StateCall::INDEX_BUFFER); }
+        void RSSetViewports(uint32, const D3D12_VIEWPORT*) { Record(StateCall::VIEWPORT); }
+        void RSSetScissorRects(uint32, const D3D12_RECT*) { Record(StateCall::SCISSOR_RECT); }
+        void OMSetRenderTargets(uint32, const D3D12_CPU_DESCRIPTOR_HANDLE*, BOOL, const D3D12_CPU_DESCRIPTOR_HANDLE*) { Record(StateCall::RENDER_TARGETS); }
+
+        void SetGraphicsRoot32BitConstants(uint32, uint32 num_values, const void*, uint32 dest_offset)
+        {
+            calls_.push_back({ .call = StateCall::ROOT_CONSTANTS, .num_values = num_values, .dest_offset = dest_offset });
+        }
+
+        void DrawIndexedInstanced(uint32, uint32, uint32, int32, uint32) { Record(StateCall::COUNT); }
+        void DrawInstanced(uint32, uint32, uint32, uint32) { Record(StateCall::COUNT); }
+
+        const std::vector<RecordedCall>& GetCalls() const
+        {
+            return calls_;
+        }
+
+        uint32 GetNumCalls(StateCall call) const
+        {
+            return static_cast<uint32>(std::count_if(calls_.begin(), calls_.end(), [call](const RecordedCall& recorded) { return recorded.call == call; }));
+        }
+
+        void Clear()
+        {
+            calls_.clear();
+        }
+
+    private:
+        void Record(StateCall call)
+        {
+            calls_.push_back({ .call = call });
+        }
+
+        std::vector<RecordedCall> calls_;
+    };
+
+    using RecordingCommandContext = CommandContextT<RecordingCommandList>;
+}
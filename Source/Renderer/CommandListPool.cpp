@@ -0,0 +1,138 @@
+#include "Renderer/CommandListPool.h"
+
+#include "Renderer/GraphicsContext.h"
+
+namespace gfx
+{
+    void CommandListPool::Init(D3D12_COMMAND_LIST_TYPE type, TimelineFence& fence, const wchar_t* name)
+    {
+        CHECK(fence.GetFence() != nullptr);
+        type_ = type;
+        fence_ = &fence;
+        name_ = name;
+    }
+
+    void CommandListPool::Shutdown()
+    {
+        std::scoped_lock lock(mutex_);
+        if (pending_allocators_.empty() == false)
+        {
+            // The last release may be tagged with a value which will never be signaled now, all signaled work is enough
+            fence_->Wait(std::min(pending_allocators_.back().fence_value, fence_->GetLastSignaledValue()));
+        }
+        pending_allocators_.clear();
+        ready_allocators_.clear();
+        free_command_lists_.clear();
+        num_allocators_ = 0;
+        num_command_lists_ = 0;
+        fence_ = nullptr;
+    }
+
+    PooledCommandList CommandListPool::Acquire(uint32 size_hint)
+    {
+        PooledCommandList result;
+        {
+            std::scoped_lock lock(mutex_);
+            RetireCompletedAllocators();
+
+            if (ready_allocators_.empty() == false)
+            {
+                // Smallest allocator which already fits the hint. If none does, the largest one has the least left to grow.
+                auto best_it = ready_allocators_.end();
+                for (auto it = ready_allocators_.begin(); it != ready_allocators_.end(); ++it)
+                {
+                    if (best_it == ready_allocators_.end())
+                    {
+                        best_it = it;
+                        continue;
+                    }
+
+                    const bool fits = it->capacity >= size_hint;
+                    const bool best_fits = best_it->capacity >= size_hint;
+                    if ((fits && (best_fits == false || it->capacity < best_it->capacity)) ||
+                        (fits == false && best_fits == false && it->capacity > best_it->capacity))
+                    {
+                        best_it = it;
+                    }
+                }
+
+                result.allocator = std::move(best_it->allocator);
+                result.capacity = best_it->capacity;
+                *best_it = std::move(ready_allocators_.back());
+                ready_allocators_.pop_back();
+            }
+            else
+            {
+                ++num_allocators_;
+            }
+
+            if (free_command_lists_.empty() == false)
+            {
+                result.command_list = std::move(free_command_lists_.back());
+                free_command_lists_.pop_back();
+            }
+            else
+            {
+                ++num_command_lists_;
+            }
+        }
+
+        // Device calls don't need the lock
+        if (result.allocator == nullptr)
+        {
+            result.allocator = CreateCommandAllocator(type_);
+            result.allocator->SetName(name_.c_str());
+        }
+        else
+        {
+            DX_VERIFY(result.allocator->Reset());
+        }
+
+        if (result.command_list == nullptr)
+        {
+            result.command_list = CreateGraphicsCommandList(result.allocator, type_);
+            result.command_list->SetName(name_.c_str());
+        }
+        DX_VERIFY(result.command_list->Reset(result.allocator.Get(), nullptr));
+
+        return result;
+    }
+
+    void CommandListPool::Release(PooledCommandList&& command_list, uint64 fence_value, uint32 used_size)
+    {
+        CHECK(command_list.allocator != nullptr && command_list.command_list != nullptr);
+
+        std::scoped_lock lock(mutex_);
+
+        // Usually released in submission order, so this appends
+        const auto insert_it = std::upper_bound(pending_allocators_.begin(), pending_allocators_.end(), fence_value,
+            [](uint64 value, const PendingAllocator& pending) { return value < pending.fence_value; });
+        pending_allocators_.insert(insert_it, {
+            .allocator = std::move(command_list.allocator),
+            .capacity = std::max(command_list.capacity, used_size),
+            .fence_value = fence_value });
+
+        // A list may be reset as soon as ExecuteCommandLists returned
+        free_command_lists_.push_back(std::move(command_list.command_list));
+        command_list = {};
+    }
+
+    CommandListPoolStats CommandListPool::GetStats() const
+    {
+        std::scoped_lock lock(mutex_);
+        return {
+            .num_allocators = num_allocators_,
+            .num_command_lists = num_command_lists_,
+            .num_allocators_in_flight = static_cast<uint32>(pending_allocators_.size()) };
+    }
+
+    void CommandListPool::RetireCompletedAllocators()
+    {
+        while (pending_allocators_.empty() == false && fence_->IsComplete(pending_allocators_.front().fence_value))
+        {
+            PendingAllocator& pending = pending_allocators_.front();
+            ready_allocators_.push_back({ .allocator = std::move(pending.allocator), .capacity = pending.capacity });
+            pending_allocators_.pop_front();
+        }
+    }
+}
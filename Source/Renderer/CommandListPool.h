@@ -0,0 +1,90 @@
+#pragma once
+#include <mutex>
+
+#include "Renderer/DXUtils.h"
+#include "Renderer/TimelineFence.h"
+
+namespace gfx
+{
+    struct PooledCommandList
+    {
+        ComPtr<ID3D12CommandAllocator> allocator;
+        ComPtr<ID3D12GraphicsCommandList> command_list;
+        uint32 capacity = 0;    // Largest usage the allocator has seen, in the unit of the size hints
+    };
+
+    struct CommandListPoolStats
+    {
+        uint32 num_allocators = 0;
+        uint32 num_command_lists = 0;
+        uint32 num_allocators_in_flight = 0;
+    };
+
+    /**
+     * @brief Hands out open allocator / list pairs for one queue type and recycles them by fence value.
+     * Lists are reusable as soon as they have been submitted, allocators only once the queue timeline passed
+     * the value they have been released with. Allocators keep their memory across resets, so a request is
+     * served with the ready allocator whose past usage fits its size hint best. Small passes do not bloat
+     * large allocators and large passes do not regrow small ones.
+     * Thread safe.
+     */
+    class CommandListPool
+    {
+    public:
+        void Init(D3D12_COMMAND_LIST_TYPE type, TimelineFence& fence, const wchar_t* name);
+        void Shutdown();
+
+        /**
+         * @brief Returns an open list backed by an allocator which is not in use by the GPU.
+         * @param size_hint Expected amount of work recorded, e.g. number of draws. Only used to pick an allocator.
+         */
+        PooledCommandList Acquire(uint32 size_hint = 0);
+
+        /**
+         * @brief Returns a submitted pair to the pool. The list has to be closed.
+         * @param fence_value Timeline value after which the GPU is done with the allocator.
+         * @param used_size Amount of work actually recorded, in the unit of the size hints.
+         */
+        void Release(PooledCommandList&& command_list, uint64 fence_value, uint32 used_size);
+
+        D3D12_COMMAND_LIST_TYPE GetType() const
+        {
+            return type_;
+        }
+
+        TimelineFence& GetFence() const
+        {
+            CHECK(fence_ != nullptr);
+            return *fence_;
+        }
+
+        CommandListPoolStats GetStats() const;
+
+    private:
+        struct PendingAllocator
+        {
+            ComPtr<ID3D12CommandAllocator> allocator;
+            uint32 capacity = 0;
+            uint64 fence_value = 0;
+        };
+
+        struct ReadyAllocator
+        {
+            ComPtr<ID3D12CommandAllocator> allocator;
+            uint32 capacity = 0;
+        };
+
+        void RetireCompletedAllocators();
+
+        D3D12_COMMAND_LIST_TYPE type_ = D3D12_COMMAND_LIST_TYPE_DIRECT;
+        TimelineFence* fence_ = nullptr;
+        std::wstring name_;
+
+        mutable std::mutex mutex_;
+        std::deque<PendingAllocator> pending_allocators_;   // Sorted by fence value
+        std::vector<ReadyAllocator> ready_allocators_;
+        std::vector<ComPtr<ID3D12GraphicsCommandList>> free_command_lists_;
+        uint32 num_allocators_ = 0;
+        uint32 num_command_lists_ = 0;
+    };
+}
@@ -0,0 +1,99 @@
+#include "Renderer/DeferredReleaseQueue.h"
+
+#include "Renderer/GraphicsContext.h"
+
+namespace gfx
+{
+    void DeferredReleaseQueue::Release(ComPtr<IUnknown> object)
+    {
+        Release(std::move(object), gfx::fence_direct, gfx::fence_direct.GetNextValue());
+    }
+
+    void DeferredReleaseQueue::Release(ComPtr<IUnknown> object, TimelineFence& fence, uint64 fence_value)
+    {
+        if (object == nullptr)
+        {
+            return;
+        }
+
+        Push(fence, { .fence_value = fence_value, .object = std::move(object) });
+    }
+
+    void DeferredReleaseQueue::Enqueue(std::function<void()> release_fn)
+    {
+        Enqueue(std::move(release_fn), gfx::fence_direct, gfx::fence_direct.GetNextValue());
+    }
+
+    void DeferredReleaseQueue::Enqueue(std::function<void()> release_fn, TimelineFence& fence, uint64 fence_value)
+    {
+        CHECK(release_fn);
+        Push(fence, { .fence_value = fence_value, .release_fn = std::move(release_fn) });
+    }
+
+    void DeferredReleaseQueue::Process()
+    {
+        std::vector<Entry> released_entries;
+        {
+            std::scoped_lock lock(mutex_);
+            for (auto& [fence, entries] : entries_)
+            {
+                while (entries.empty() == false && fence->IsComplete(entries.front().fence_value))
+                {
+                    released_entries.push_back(std::move(entries.front()));
+                    entries.pop_front();
+                }
+            }
+        }
+
+        // Run callbacks outside the lock, they might hand new objects to us
+        for (Entry& entry : released_entries)
+        {
+            ReleaseEntry(entry);
+        }
+    }
+
+    void DeferredReleaseQueue::Flush()
+    {
+        std::unordered_map<TimelineFence*, std::deque<Entry>> released_entries;
+        {
+            std::scoped_lock lock(mutex_);
+            released_entries.swap(entries_);
+        }
+
+        for (auto& [fence, entries] : released_entries)
+        {
+            for (Entry& entry : entries)
+            {
+                ReleaseEntry(entry);
+            }
+        }
+    }
+
+    size_t DeferredReleaseQueue::GetNumPending() const
+    {
+        std::scoped_lock lock(mutex_);
+        size_t num_pending = 0;
+        for (const auto& [fence, entries] : entries_)
+        {
+            num_pending += entries.size();
+        }
+        return num_pending;
+    }
+
+    void DeferredReleaseQueue::Push(TimelineFence& fence, Entry&& entry)
+    {
+        std::scoped_lock lock(mutex_);
+        std::deque<Entry>& entries = entries_[&fence];
+        CHECK_MSG(entries.empty() || entries.back().fence_value <= entry.fence_value, "Deferred releases should be pushed in timeline order");
+        entries.push_back(std::move(entry));
+    }
+
+    void DeferredReleaseQueue::ReleaseEntry(Entry& entry)
+    {
+        entry.object.Reset();
+        if (entry.release_fn)
+        {
+            entry.release_fn();
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <mutex>
+
+#include "Renderer/DXUtils.h"
+#include "Renderer/TimelineFence.h"
+
+namespace gfx
+{
+    /**
+     * @brief Defers freeing GPU objects until the GPU is done with them.
+     * Everything handed over is tagged with a timeline value and released once that value has completed,
+     * so resources can be replaced mid-frame without draining the queues.
+     * By default the tag is the direct queue value which will mark the end of the frame currently being recorded.
+     */
+    class DeferredReleaseQueue
+    {
+    public:
+        /**
+         * @brief Keeps the object alive until the direct queue finished the current frame.
+         */
+        void Release(ComPtr<IUnknown> object);
+
+        /**
+         * @brief Keeps the object alive until the given timeline reached the given value.
+         */
+        void Release(ComPtr<IUnknown> object, TimelineFence& fence, uint64 fence_value);
+
+        /**
+         * @brief Runs the callback once the direct queue finished the current frame.
+         * Use this to return descriptor indices or sub-allocations to their allocator.
+         */
+        void Enqueue(std::function<void()> release_fn);
+
+        /**
+         * @brief Runs the callback once the given timeline reached the given value.
+         */
+        void Enqueue(std::function<void()> release_fn, TimelineFence& fence, uint64 fence_value);
+
+        /**
+         * @brief Releases everything whose timeline value has completed. Non-blocking, call once per frame.
+         */
+        void Process();
+
+        /**
+         * @brief Releases everything immediately. Only valid once the GPU is idle, e.g. on shutdown.
+         */
+        void Flush();
+
+        size_t GetNumPending() const;
+
+    private:
+        struct Entry
+        {
+            uint64 fence_value = 0;
+            ComPtr<IUnknown> object;
+            std::function<void()> release_fn;
+        };
+
+        void Push(TimelineFence& fence, Entry&& entry);
+        static void ReleaseEntry(Entry& entry);
+
+        // One queue per timeline. Values are pushed in increasing order, so we only ever have to look at the front.
+        std::unordered_map<TimelineFence*, std::deque<Entry>> entries_;
+        mutable std::mutex mutex_;
+    };
+}
@@ -0,0 +1,243 @@
+#include "Renderer/DescriptorViewCache.h"
+
+#include "Renderer/GraphicsContext.h"
+#include "Renderer/StagingDescriptorHeap.h"
+
+namespace gfx
+{
+    D3D12DescriptorViewBackend::D3D12DescriptorViewBackend(StagingDescriptorHeap& staging_heap)
+        : staging_heap_(staging_heap)
+    {
+    }
+
+    uint32 D3D12DescriptorViewBackend::AllocateSlot()
+    {
+        return staging_heap_.Allocate();
+    }
+
+    void D3D12DescriptorViewBackend::CreateSRV(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc, uint32 staging_idx)
+    {
+        gfx::device->CreateShaderResourceView(resource, desc, staging_heap_.GetCPUHandle(staging_idx));
+    }
+
+    void D3D12DescriptorViewBackend::CreateUAV(ID3D12Resource* resource, ID3D12Resource* counter_resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc, uint32 staging_idx)
+    {
+        gfx::device->CreateUnorderedAccessView(resource, counter_resource, desc, staging_heap_.GetCPUHandle(staging_idx));
+    }
+
+    void D3D12DescriptorViewBackend::CreateCBV(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, uint32 staging_idx)
+    {
+        gfx::device->CreateConstantBufferView(&desc, staging_heap_.GetCPUHandle(staging_idx));
+    }
+
+    void D3D12DescriptorViewBackend::DeferredFree(uint32 staging_idx, ComPtr<ID3D12Resource> resource, ComPtr<ID3D12Resource> counter_resource)
+    {
+        StagingDescriptorHeap* staging_heap = &staging_heap_;
+        gfx::deferred_release_queue.Enqueue([staging_heap, staging_idx] { staging_heap->Free(staging_idx); });
+        if (resource != nullptr)
+        {
+            gfx::deferred_release_queue.Release(std::move(resource));
+        }
+        if (counter_resource != nullptr)
+        {
+            gfx::deferred_release_queue.Release(std::move(counter_resource));
+        }
+    }
+
+    void D3D12DescriptorViewBackend::FreeSlot(uint32 staging_idx)
+    {
+        staging_heap_.Free(staging_idx);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    uint32 NullDescriptorViewBackend::AllocateSlot()
+    {
+        ++num_allocated_slots_;
+        if (free_slots_.empty())
+        {
+            return next_slot_++;
+        }
+
+        const uint32 staging_idx = free_slots_.back();
+        free_slots_.pop_back();
+        return staging_idx;
+    }
+
+    void NullDescriptorViewBackend::CreateSRV(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc, uint32 staging_idx)
+    {
+        ++num_created_views_;
+    }
+
+    void NullDescriptorViewBackend::CreateUAV(ID3D12Resource* resource, ID3D12Resource* counter_resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc, uint32 staging_idx)
+    {
+        ++num_created_views_;
+    }
+
+    void NullDescriptorViewBackend::CreateCBV(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, uint32 staging_idx)
+    {
+        ++num_created_views_;
+    }
+
+    void NullDescriptorViewBackend::DeferredFree(uint32 staging_idx, ComPtr<ID3D12Resource> resource, ComPtr<ID3D12Resource> counter_resource)
+    {
+        deferred_frees_.push_back(staging_idx);
+    }
+
+    void NullDescriptorViewBackend::FreeSlot(uint32 staging_idx)
+    {
+        CHECK(staging_idx < next_slot_ && num_allocated_slots_ > 0);
+        free_slots_.push_back(staging_idx);
+        --num_allocated_slots_;
+    }
+
+    void NullDescriptorViewBackend::FlushDeferredFrees()
+    {
+        for (const uint32 staging_idx : deferred_frees_)
+        {
+            FreeSlot(staging_idx);
+        }
+        deferred_frees_.clear();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    void DescriptorViewCache::Init(UniquePtr<IDescriptorViewBackend> backend)
+    {
+        CHECK(backend != nullptr);
+        backend_ = std::move(backend);
+    }
+
+    void DescriptorViewCache::Shutdown()
+    {
+        std::scoped_lock lock(mutex_);
+        for (auto& [key, view] : views_)
+        {
+            backend_->FreeSlot(view.staging_idx);
+        }
+        views_.clear();
+        keys_by_staging_idx_.clear();
+        stats_ = {};
+        backend_.reset();
+    }
+
+    uint32 DescriptorViewCache::AcquireSRV(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc)
+    {
+        CHECK(resource != nullptr || desc != nullptr);   // Null descriptors need a desc to know their dimension
+        const ViewKey key = MakeKey(ViewType::SRV, resource, nullptr, desc);
+
+        std::scoped_lock lock(mutex_);
+        return AcquireLocked(key, [&](uint32 staging_idx)
+        {
+            backend_->CreateSRV(resource, desc, staging_idx);
+        });
+    }
+
+    uint32 DescriptorViewCache::AcquireUAV(ID3D12Resource* resource, ID3D12Resource* counter_resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc)
+    {
+        CHECK(resource != nullptr || desc != nullptr);
+        const ViewKey key = MakeKey(ViewType::UAV, resource, counter_resource, desc);
+
+        std::scoped_lock lock(mutex_);
+        return AcquireLocked(key, [&](uint32 staging_idx)
+        {
+            backend_->CreateUAV(resource, counter_resource, desc, staging_idx);
+        });
+    }
+
+    uint32 DescriptorViewCache::AcquireCBV(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc)
+    {
+        // CBVs only know their GPU address, which is already unique per resource
+        const ViewKey key = MakeKey(ViewType::CBV, nullptr, nullptr, &desc);
+
+        std::scoped_lock lock(mutex_);
+        return AcquireLocked(key, [&](uint32 staging_idx)
+        {
+            backend_->CreateCBV(desc, staging_idx);
+        });
+    }
+
+    void DescriptorViewCache::Release(uint32 staging_idx)
+    {
+        std::scoped_lock lock(mutex_);
+        const auto key_it = keys_by_staging_idx_.find(staging_idx);
+        CHECK_MSG(key_it != keys_by_staging_idx_.end(), "Staging index {} is not a cached view", staging_idx);
+
+        const auto view_it = views_.find(key_it->second);
+        CHECK(view_it != views_.end() && view_it->second.ref_count > 0);
+        --stats_.num_references;
+        if (--view_it->second.ref_count > 0)
+        {
+            return;
+        }
+
+        // The entry goes right away, a new request for the same view creates a fresh one
+        backend_->DeferredFree(staging_idx, std::move(view_it->second.resource), std::move(view_it->second.counter_resource));
+        views_.erase(view_it);
+        keys_by_staging_idx_.erase(key_it);
+        --stats_.num_views;
+    }
+
+    DescriptorViewCacheStats DescriptorViewCache::GetStats() const
+    {
+        std::scoped_lock lock(mutex_);
+        return stats_;
+    }
+
+    size_t DescriptorViewCache::ViewKeyHasher::operator()(const ViewKey& key) const
+    {
+        size_t hash = 0;
+        Hash::HashCombine(hash, reinterpret_cast<uintptr_t>(key.resource), reinterpret_cast<uintptr_t>(key.counter_resource),
+            static_cast<uint8>(key.type), key.has_desc);
+        for (const uint64 word : key.desc_words)
+        {
+            Hash::HashCombine(hash, word);
+        }
+        return hash;
+    }
+
+    template<typename DescType>
+    DescriptorViewCache::ViewKey DescriptorViewCache::MakeKey(ViewType type, ID3D12Resource* resource, ID3D12Resource* counter_resource, const DescType* desc)
+    {
+        static_assert(sizeof(DescType) <= MAX_DESC_WORDS * sizeof(uint64), "View desc doesn't fit into the key");
+
+        ViewKey key;
+        key.resource = resource;
+        key.counter_resource = counter_resource;
+        key.type = type;
+        key.has_desc = desc != nullptr;
+        if (desc != nullptr)
+        {
+            memcpy(key.desc_words.data(), desc, sizeof(DescType));
+        }
+        return key;
+    }
+
+    uint32 DescriptorViewCache::AcquireLocked(const ViewKey& key, const std::function<void(uint32 staging_idx)>& create_fn)
+    {
+        CHECK(backend_ != nullptr);
+        ++stats_.num_references;
+
+        const auto view_it = views_.find(key);
+        if (view_it != views_.end())
+        {
+            ++view_it->second.ref_count;
+            ++stats_.num_hits;
+            return view_it->second.staging_idx;
+        }
+
+        const uint32 staging_idx = backend_->AllocateSlot();
+        create_fn(staging_idx);
+
+        CachedView view;
+        view.staging_idx = staging_idx;
+        view.ref_count = 1;
+        view.resource = key.resource;
+        view.counter_resource = key.counter_resource;
+        views_.emplace(key, std::move(view));
+        keys_by_staging_idx_.emplace(staging_idx, key);
+        ++stats_.num_views;
+        ++stats_.num_misses;
+        return staging_idx;
+    }
+}
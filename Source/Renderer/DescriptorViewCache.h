@@ -0,0 +1,171 @@
+#pragma once
+#include <mutex>
+
+#include "Renderer/DXUtils.h"
+
+namespace gfx
+{
+    class StagingDescriptorHeap;
+
+    struct DescriptorViewCacheStats
+    {
+        uint32 num_views = 0;       // Distinct views alive
+        uint32 num_references = 0;  // Sum of their reference counts
+        uint64 num_hits = 0;
+        uint64 num_misses = 0;
+    };
+
+    /**
+     * @brief Everything the view cache needs from the device: staging slots, view creation and freeing.
+     */
+    class IDescriptorViewBackend
+    {
+    public:
+        virtual ~IDescriptorViewBackend() = default;
+
+        virtual uint32 AllocateSlot() = 0;
+
+        virtual void CreateSRV(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc, uint32 staging_idx) = 0;
+        virtual void CreateUAV(ID3D12Resource* resource, ID3D12Resource* counter_resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc, uint32 staging_idx) = 0;
+        virtual void CreateCBV(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, uint32 staging_idx) = 0;
+
+        // Frames in flight may still read copies of the view, so the slot and the resources have to outlive the current frame
+        virtual void DeferredFree(uint32 staging_idx, ComPtr<ID3D12Resource> resource, ComPtr<ID3D12Resource> counter_resource) = 0;
+
+        // Only valid once the GPU is idle, e.g. on shutdown
+        virtual void FreeSlot(uint32 staging_idx) = 0;
+    };
+
+    /**
+     * @brief Creates views in the staging descriptor heap and defers frees via the deferred release queue.
+     */
+    class D3D12DescriptorViewBackend : public IDescriptorViewBackend
+    {
+    public:
+        explicit D3D12DescriptorViewBackend(StagingDescriptorHeap& staging_heap);
+
+        virtual uint32 AllocateSlot() override;
+        virtual void CreateSRV(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc, uint32 staging_idx) override;
+        virtual void CreateUAV(ID3D12Resource* resource, ID3D12Resource* counter_resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc, uint32 staging_idx) override;
+        virtual void CreateCBV(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, uint32 staging_idx) override;
+        virtual void DeferredFree(uint32 staging_idx, ComPtr<ID3D12Resource> resource, ComPtr<ID3D12Resource> counter_resource) override;
+        virtual void FreeSlot(uint32 staging_idx) override;
+
+    private:
+        StagingDescriptorHeap& staging_heap_;
+    };
+
+    /**
+     * @brief Hands out slot indices without touching a device and only counts view creations.
+     * Deferred frees are held until FlushDeferredFrees(), which stands in for the end of the frame.
+     */
+    class NullDescriptorViewBackend : public IDescriptorViewBackend
+    {
+    public:
+        virtual uint32 AllocateSlot() override;
+        virtual void CreateSRV(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc, uint32 staging_idx) override;
+        virtual void CreateUAV(ID3D12Resource* resource, ID3D12Resource* counter_resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc, uint32 staging_idx) override;
+        virtual void CreateCBV(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, uint32 staging_idx) override;
+        virtual void DeferredFree(uint32 staging_idx, ComPtr<ID3D12Resource> resource, ComPtr<ID3D12Resource> counter_resource) override;
+        virtual void FreeSlot(uint32 staging_idx) override;
+
+        void FlushDeferredFrees();
+
+        uint32 GetNumCreatedViews() const
+        {
+            return num_created_views_;
+        }
+
+        uint32 GetNumAllocatedSlots() const
+        {
+            return num_allocated_slots_;
+        }
+
+        uint32 GetNumDeferredFrees() const
+        {
+            return static_cast<uint32>(deferred_frees_.size());
+        }
+
+    private:
+        uint32 next_slot_ = 0;
+        uint32 num_created_views_ = 0;
+        uint32 num_allocated_slots_ = 0;
+        std::vector<uint32> free_slots_;
+        std::vector<uint32> deferred_frees_;
+    };
+
+    /**
+     * @brief Deduplicates CBVs, SRVs and UAVs by resource and view description.
+     * Views live in the backend's staging slots. Acquiring a view which already exists only bumps its reference count
+     * and returns the same staging index, so systems asking for the same view share one slot and one creation.
+     * Descriptions are compared bytewise, so zero initialize them (= {}) to keep padding from causing misses.
+     * Cached views keep their resources alive. Thread safe.
+     */
+    class DescriptorViewCache
+    {
+    public:
+        void Init(UniquePtr<IDescriptorViewBackend> backend);
+        void Shutdown();
+
+        // @param desc nullptr for the resource's default view
+        uint32 AcquireSRV(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc);
+        uint32 AcquireUAV(ID3D12Resource* resource, ID3D12Resource* counter_resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc);
+        uint32 AcquireCBV(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc);
+
+        /**
+         * @brief Drops a reference. The last one has the backend free the staging slot and the resource once the current frame is done.
+         */
+        void Release(uint32 staging_idx);
+
+        DescriptorViewCacheStats GetStats() const;
+
+    private:
+        enum class ViewType : uint8
+        {
+            CBV,
+            SRV,
+            UAV
+        };
+
+        static inline constexpr uint32 MAX_DESC_WORDS = 8;
+
+        struct ViewKey
+        {
+            ID3D12Resource* resource = nullptr;
+            ID3D12Resource* counter_resource = nullptr;
+            ViewType type = ViewType::SRV;
+            bool has_desc = false;
+            std::array<uint64, MAX_DESC_WORDS> desc_words = {};
+
+            bool operator==(const ViewKey& other) const = default;
+        };
+
+        struct ViewKeyHasher
+        {
+            size_t operator()(const ViewKey& key) const;
+        };
+
+        struct CachedView
+        {
+            uint32 staging_idx = 0;
+            uint32 ref_count = 0;
+            ComPtr<ID3D12Resource> resource;
+            ComPtr<ID3D12Resource> counter_resource;
+        };
+
+        template<typename DescType>
+        static ViewKey MakeKey(ViewType type, ID3D12Resource* resource, ID3D12Resource* counter_resource, const DescType* desc);
+
+        /**
+         * @brief Returns the cached view's index, or allocates a slot and runs create_fn on it. Expects the lock to be held.
+         */
+        uint32 AcquireLocked(const ViewKey& key, const std::function<void(uint32 staging_idx)>& create_fn);
+
+        UniquePtr<IDescriptorViewBackend> backend_;
+
+        mutable std::mutex mutex_;
+        std::unordered_map<ViewKey, CachedView, ViewKeyHasher> views_;
+        std::unordered_map<uint32, ViewKey> keys_by_staging_idx_;
+        DescriptorViewCacheStats stats_;
+    };
+}
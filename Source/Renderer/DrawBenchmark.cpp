@@ -0,0 +1,184 @@
+#include "Renderer/DrawBenchmark.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+#include "Core/JobSystem.h"
+#include "Core/RadixSort.h"
+#include "Renderer/DrawList.h"
+#include "Renderer/ParallelCommandRecorder.h"
+
+namespace gfx
+{
+    namespace
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        double ElapsedMs(Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+    }
+
+    void RunSortBenchmark(uint32 num_iterations)
+    {
+        CHECK(num_iterations > 0);
+        std::mt19937 rng(1337);
+        LOG("Sort benchmark: {} threads, {} iterations", jobs::GetNumThreads(), num_iterations);
+
+        for (const uint32 num_draws : { 10000u, 100000u, 1000000u })
+        {
+            // A few passes and PSOs, many materials and meshes, depth spread over all buckets
+            std::uniform_int_distribution<uint32> pass(0, 3);
+            std::uniform_int_distribution<uint32> pso(0, 63);
+            std::uniform_int_distribution<uint32> material(0, 1023);
+            std::uniform_int_distribution<uint32> depth_bucket(0, (1u << DrawKey::DEPTH_BITS) - 1);
+            std::uniform_int_distribution<uint32> mesh(0, 4095);
+            std::vector<RadixSortEntry> unsorted(num_draws);
+            for (uint32 i = 0; i < num_draws; ++i)
+            {
+                unsorted[i] = { .key = DrawKey::Make(pass(rng), pso(rng), material(rng), depth_bucket(rng), mesh(rng)), .value = i };
+            }
+
+            std::vector<RadixSortEntry> radix_sorted;
+            std::vector<RadixSortEntry> std_sorted;
+            std::vector<RadixSortEntry> scratch;
+            double radix_ms = 0.0;
+            double std_sort_ms = 0.0;
+            for (uint32 iteration = 0; iteration < num_iterations; ++iteration)
+            {
+                radix_sorted = unsorted;
+                const auto radix_start = Clock::now();
+                RadixSort(radix_sorted, scratch);
+                radix_ms += ElapsedMs(radix_start);
+
+                // Values break ties, which gives the same order as the stable radix sort
+                std_sorted = unsorted;
+                const auto std_sort_start = Clock::now();
+                std::sort(std_sorted.begin(), std_sorted.end(), [](const RadixSortEntry& a, const RadixSortEntry& b)
+                {
+                    return a.key != b.key ? a.key < b.key : a.value < b.value;
+                });
+                std_sort_ms += ElapsedMs(std_sort_start);
+            }
+
+            const bool is_same_order = std::equal(radix_sorted.begin(), radix_sorted.end(), std_sorted.begin(), [](const RadixSortEntry& a, const RadixSortEntry& b)
+            {
+                return a.key == b.key && a.value == b.value;
+            });
+            if (is_same_order == false)
+            {
+                // Logged rather than checked so release builds report it too. -sort_selftest covers more key distributions.
+                LOG_ERROR("RadixSort and std::sort disagree for {} draws", num_draws);
+            }
+
+            radix_ms /= num_iterations;
+            std_sort_ms /= num_iterations;
+            LOG("{:>8} draws: RadixSort {:.3f} ms, std::sort {:.3f} ms ({:.1f}x)", num_draws, radix_ms, std_sort_ms, std_sort_ms / radix_ms);
+        }
+    }
+
+    void RunRecordBenchmark(uint32 num_draws, uint32 min_draws_per_list, uint32 num_iterations)
+    {
+        CHECK(num_draws > 0 && num_iterations > 0);
+        std::mt19937 rng(1337);
+
+        // Handles are only compared by the command context, never dereferenced
+        static constexpr uint32 NUM_PSOS = 8;
+        static constexpr uint32 NUM_MESHES = 64;
+        std::vector<D3D12_INDEX_BUFFER_VIEW> index_buffer_views(NUM_MESHES);
+        for (uint32 mesh_idx = 0; mesh_idx < NUM_MESHES; ++mesh_idx)
+        {
+            index_buffer_views[mesh_idx] = { .BufferLocation = 0x10000 * (mesh_idx + 1), .SizeInBytes = 72, .Format = DXGI_FORMAT_R16_UINT };
+        }
+
+        std::uniform_int_distribution<uint32> pso(0, NUM_PSOS - 1);
+        std::uniform_int_distribution<uint32> mesh(0, NUM_MESHES - 1);
+        std::uniform_int_distribution<uint32> depth_bucket(0, (1u << DrawKey::DEPTH_BITS) - 1);
+        DrawList draw_list;
+        for (uint32 draw_idx = 0; draw_idx < num_draws; ++draw_idx)
+        {
+            const uint32 pso_idx = pso(rng);
+            const uint32 mesh_idx = mesh(rng);
+            DrawCommand command;
+            command.pso = reinterpret_cast<ID3D12PipelineState*>(static_cast<uintptr_t>(0x100 * (pso_idx + 1)));
+            command.root_signature = reinterpret_cast<ID3D12RootSignature*>(static_cast<uintptr_t>(pso_idx < NUM_PSOS / 2 ? 0x10 : 0x20));
+            command.index_buffer_view = &index_buffer_views[mesh_idx];
+            command.num_root_constants = 5;
+            command.root_constants = { 0, 1, 2, 3, draw_idx };  // Descriptor indices, then the instance offset
+            command.index_count = 36;
+            draw_list.Add(DrawKey::Make(0, pso_idx, 0, depth_bucket(rng), mesh_idx), command);
+        }
+        draw_list.Sort();
+
+        const D3D12_VIEWPORT viewport = { .TopLeftX = 0.0f, .TopLeftY = 0.0f, .Width = 1920.0f, .Height = 1080.0f, .MinDepth = 0.0f, .MaxDepth = 1.0f };
+        const D3D12_RECT scissor_rect = { .left = 0, .top = 0, .right = 1920, .bottom = 1080 };
+        const D3D12_CPU_DESCRIPTOR_HANDLE rtv = { .ptr = 0x1000 };
+        const D3D12_CPU_DESCRIPTOR_HANDLE dsv = { .ptr = 0x2000 };
+
+        std::vector<uint32> thread_counts;
+        const uint32 num_cores = std::max(1u, std::thread::hardware_concurrency());
+        for (uint32 num_threads = 1; num_threads < num_cores; num_threads *= 2)
+        {
+            thread_counts.push_back(num_threads);
+        }
+        thread_counts.push_back(num_cores);
+
+        LOG("Record benchmark: {} draws sorted in {:.3f} ms on {} threads, at least {} per list, {} iterations",
+            num_draws, draw_list.GetStats().sort_time_ms, jobs::GetNumThreads(), min_draws_per_list, num_iterations);
+        double single_thread_ms = 0.0;
+        for (const uint32 num_threads : thread_counts)
+        {
+            // Without workers everything runs inline, which is the single threaded baseline
+            jobs::Shutdown();
+            if (num_threads > 1)
+            {
+                jobs::Init(num_threads - 1);
+            }
+
+            const uint32 batch_size = ParallelCommandRecorder::GetBatchSize(num_draws, min_draws_per_list);
+            const uint32 num_batches = (num_draws + batch_size - 1) / batch_size;
+            std::vector<RecordingCommandList> command_lists(num_batches);
+            std::vector<CommandContextStats> batch_stats(num_batches);
+
+            double total_ms = 0.0;
+            for (uint32 iteration = 0; iteration < num_iterations; ++iteration)
+            {
+                const auto record_start = Clock::now();
+                jobs::Dispatch(num_batches, [&](uint32 batch_idx)
+                {
+                    const uint32 begin = batch_idx * batch_size;
+                    const uint32 end = std::min(begin + batch_size, num_draws);
+
+                    // Same per list setup as the renderer's batches
+                    RecordingCommandList& command_list = command_lists[batch_idx];
+                    command_list.Clear();
+                    RecordingCommandContext context;
+                    context.Begin(&command_list);
+                    context.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+                    context.RSSetViewport(viewport);
+                    context.RSSetScissorRect(scissor_rect);
+                    context.OMSetRenderTarget(rtv, &dsv);
+                    draw_list.Submit(context, begin, end);
+                    batch_stats[batch_idx] = context.GetStats();
+                });
+                total_ms += ElapsedMs(record_start);
+            }
+
+            CommandContextStats stats;
+            for (const CommandContextStats& stats_of_batch : batch_stats)
+            {
+                stats += stats_of_batch;
+            }
+
+            const double frame_ms = total_ms / num_iterations;
+            single_thread_ms = num_threads == 1 ? frame_ms : single_thread_ms;
+            LOG("{:>3} threads: {:>3} lists, {:.3f} ms per frame, {:.2f}x, {} state calls issued, {} filtered",
+                num_threads, num_batches, frame_ms, single_thread_ms / frame_ms, stats.GetTotalIssued(), stats.GetTotalFiltered());
+        }
+
+        jobs::Shutdown();
+        jobs::Init();
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace gfx
+{
+    /**
+     * @brief Sorts random DrawKey keys with RadixSort and with std::sort for 10K, 100K and 1M draws and logs the average
+     * time of both. Runs without a window or device. Expects the job system to be initialized.
+     */
+    void RunSortBenchmark(uint32 num_iterations = 16);
+
+    /**
+     * @brief Records a sorted DrawList of num_draws draws into RecordingCommandLists, split into batches the way
+     * ParallelCommandRecorder splits them, with 1, 2, 4, ... threads up to the core count. Logs the time per frame and
+     * the speedup over one thread.
+     * Restarts the job system for every thread count and leaves it initialized with the default worker count.
+     */
+    void RunRecordBenchmark(uint32 num_draws = 50000, uint32 min_draws_per_list = 256, uint32 num_iterations = 32);
+}
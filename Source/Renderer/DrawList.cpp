@@ -0,0 +1,34 @@
+#include "Renderer/DrawList.h"
+
+#include <chrono>
+
+namespace gfx
+{
+    void DrawList::Reset()
+    {
+        commands_.clear();
+        sort_entries_.clear();
+        is_sorted_ = true;
+        stats_ = {};
+    }
+
+    void DrawList::Add(uint64 sort_key, const DrawCommand& command)
+    {
+        CHECK(command.pso != nullptr);
+        CHECK(command.root_signature != nullptr);
+        CHECK(command.num_root_constants <= MAX_ROOT_CONSTANTS);
+
+        sort_entries_.push_back({ .key = sort_key, .value = static_cast<uint32>(commands_.size()) });
+        commands_.push_back(command);
+        is_sorted_ = false;
+    }
+
+    void DrawList::Sort()
+    {
+        const auto sort_start = std::chrono::high_resolution_clock::now();
+        RadixSort(sort_entries_, sort_scratch_);
+        stats_.sort_time_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sort_start).count();
+        stats_.num_draws = GetNumDraws();
+        is_sorted_ = true;
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include "Core/RadixSort.h"
+#include "Renderer/CommandContext.h"
+#include "Renderer/DXUtils.h"
+
+namespace gfx
+{
+    /**
+     * 64-bit draw sort key, compared as a plain integer. Most significant fields first:
+     * [63..60] pass | [59..48] PSO | [47..32] material | [31..16] depth bucket | [15..0] mesh
+     * Sorting by it groups draws by pass and pipeline state first, then front-to-back within the same state.
+     * The mesh is the tie breaker so draws sharing an index buffer end up adjacent.
+     */
+    struct DrawKey
+    {
+        static inline constexpr uint32 PASS_BITS = 4;
+        static inline constexpr uint32 PSO_BITS = 12;
+        static inline constexpr uint32 MATERIAL_BITS = 16;
+        static inline constexpr uint32 DEPTH_BITS = 16;
+        static inline constexpr uint32 MESH_BITS = 16;
+
+        static inline constexpr uint32 MESH_SHIFT = 0;
+        static inline constexpr uint32 DEPTH_SHIFT = MESH_SHIFT + MESH_BITS;
+        static inline constexpr uint32 MATERIAL_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+        static inline constexpr uint32 PSO_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+        static inline constexpr uint32 PASS_SHIFT = PSO_SHIFT + PSO_BITS;
+        static_assert(PASS_SHIFT + PASS_BITS == 64);
+
+        static uint64 Make(uint32 pass, uint32 pso, uint32 material, uint32 depth_bucket, uint32 mesh)
+        {
+            CHECK(pass < (1u << PASS_BITS));
+            CHECK(pso < (1u << PSO_BITS));
+            CHECK(material < (1u << MATERIAL_BITS));
+            CHECK(depth_bucket < (1u << DEPTH_BITS));
+            CHECK(mesh < (1u << MESH_BITS));
+            return (static_cast<uint64>(pass) << PASS_SHIFT) |
+                (static_cast<uint64>(pso) << PSO_SHIFT) |
+                (static_cast<uint64>(material) << MATERIAL_SHIFT) |
+                (static_cast<uint64>(depth_bucket) << DEPTH_SHIFT) |
+                (static_cast<uint64>(mesh) << MESH_SHIFT);
+        }
+
+        /**
+         * @brief Maps view space depth in [near_z, far_z] linearly to a depth bucket.
+         */
+        static uint32 QuantizeDepth(float view_depth, float near_z, float far_z)
+        {
+            const float normalized_depth = std::clamp((view_depth - near_z) / (far_z - near_z), 0.0f, 1.0f);
+            return static_cast<uint32>(normalized_depth * static_cast<float>((1u << DEPTH_BITS) - 1));
+        }
+    };
+
+    static inline constexpr uint32 MAX_ROOT_CONSTANTS = 16;
+
+    struct DrawCommand
+    {
+        ID3D12PipelineState* pso = nullptr;
+        ID3D12RootSignature* root_signature = nullptr;
+        const D3D12_INDEX_BUFFER_VIEW* index_buffer_view = nullptr;
+
+        // Root constants bound at root parameter 0
+        std::array<uint32, MAX_ROOT_CONSTANTS> root_constants = {};
+        uint32 num_root_constants = 0;
+
+        uint32 index_count = 0;
+        uint32 start_index = 0;
+        int32 base_vertex = 0;
+        uint32 instance_count = 1;
+        uint32 start_instance = 0;
+    };
+
+    // Issued vs. filtered state changes are counted by the CommandContext the list is submitted to
+    struct DrawListStats
+    {
+        uint32 num_draws = 0;
+        double sort_time_ms = 0.0;
+    };
+
+    /**
+     * @brief Collects draws for a frame, sorts them by key and submits them in sorted order.
+     * Sorting puts draws sharing state next to each other, so the command context can drop most state changes.
+     */
+    class DrawList
+    {
+    public:
+        void Reset();
+
+        void Add(uint64 sort_key, const DrawCommand& command);
+
+        /**
+         * @brief Sorts the draws by key with a parallel radix sort.
+         */
+        void Sort();
+
+        /**
+         * @brief Records the sorted draws [begin, end).
+         * Descriptor heaps have to be set on the context beforehand. Redundant state is filtered by the context.
+         * Different ranges may be submitted from different threads concurrently.
+         */
+        template<typename CommandListType>
+        void Submit(CommandContextT<CommandListType>& context, uint32 begin, uint32 end)
+        {
+            CHECK_MSG(is_sorted_, "Sort() the draw list before submitting it");
+            CHECK(begin <= end && end <= sort_entries_.size());
+
+            for (uint32 i = begin; i < end; ++i)
+            {
+                const DrawCommand& command = commands_[sort_entries_[i].value];
+                context.SetPipelineState(command.pso);
+                context.SetGraphicsRootSignature(command.root_signature);
+                context.IASetIndexBuffer(command.index_buffer_view);
+                if (command.num_root_constants > 0)
+                {
+                    context.SetGraphicsRoot32BitConstants(0, command.num_root_constants, command.root_constants.data(), 0u);
+                }
+
+                context.DrawIndexedInstanced(command.index_count, command.instance_count, command.start_index, command.base_vertex, command.start_instance);
+            }
+        }
+
+        template<typename CommandListType>
+        void Submit(CommandContextT<CommandListType>& context)
+        {
+            Submit(context, 0, GetNumDraws());
+        }
+
+        uint32 GetNumDraws() const
+        {
+            return static_cast<uint32>(commands_.size());
+        }
+
+        const DrawListStats& GetStats() const
+        {
+            return stats_;
+        }
+
+    private:
+        std::vector<DrawCommand> commands_;
+        std::vector<RadixSortEntry> sort_entries_;
+        std::vector<RadixSortEntry> sort_scratch_;
+        bool is_sorted_ = true;
+        DrawListStats stats_;
+    };
+}
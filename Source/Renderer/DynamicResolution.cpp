@@ -0,0 +1,63 @@
+#include "Renderer/DynamicResolution.h"
+
+namespace gfx
+{
+    void DynamicResolutionController::Init(const DynamicResolutionSettings& settings)
+    {
+        CHECK(settings.target_frame_ms >= 0.0f);
+        CHECK(settings.min_scale > 0.0f && settings.min_scale <= settings.max_scale && settings.max_scale <= 1.0f);
+        CHECK(settings.scale_step > 0.0f);
+        settings_ = settings;
+        Reset();
+
+        if (IsEnabled())
+        {
+            LOG("Dynamic resolution: target {:.2f} ms, scale [{:.2f}, {:.2f}]", settings_.target_frame_ms, settings_.min_scale, settings_.max_scale);
+        }
+    }
+
+    void DynamicResolutionController::Reset()
+    {
+        scale_ = settings_.max_scale;
+        integral_ = 0.0f;
+        last_gpu_frame_ms_ = 0.0;
+        last_measured_ms_ = 0.0;
+    }
+
+    float DynamicResolutionController::Update(double cpu_frame_ms, double gpu_frame_ms)
+    {
+        if (IsEnabled() == false)
+        {
+            return scale_;
+        }
+
+        if (gpu_frame_ms > 0.0)
+        {
+            last_gpu_frame_ms_ = gpu_frame_ms;
+        }
+        last_measured_ms_ = last_gpu_frame_ms_;
+        if (last_measured_ms_ <= 0.0)
+        {
+            return scale_;
+        }
+
+        // Normalized, positive if there is headroom
+        const float error = static_cast<float>((settings_.target_frame_ms - last_measured_ms_) / settings_.target_frame_ms);
+
+        // CPU bound frames miss the target at any resolution, and their GPU time includes idle gaps waiting for submissions.
+        // Lowering the scale would only blur the image, so it's held, without integrating the error either.
+        if (error < 0.0f && cpu_frame_ms > settings_.target_frame_ms)
+        {
+            return scale_;
+        }
+
+        // Area relative to max_scale^2. Clamping the integral to the reachable range prevents windup while pinned at a limit.
+        const float min_area = (settings_.min_scale * settings_.min_scale) / (settings_.max_scale * settings_.max_scale);
+        integral_ = std::clamp(integral_ + settings_.integral_gain * error, min_area - 1.0f, 0.0f);
+        const float area = std::clamp(1.0f + integral_ + settings_.proportional_gain * error, min_area, 1.0f);
+
+        const float scale = settings_.max_scale * std::sqrt(area);
+        scale_ = std::clamp(std::round(scale / settings_.scale_step) * settings_.scale_step, settings_.min_scale, settings_.max_scale);
+        return scale_;
+    }
+}
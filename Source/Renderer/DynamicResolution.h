@@ -0,0 +1,66 @@
+#pragma once
+
+namespace gfx
+{
+    struct DynamicResolutionSettings
+    {
+        float target_frame_ms = 1000.0f / 60.0f;    // 0 disables dynamic resolution
+        float min_scale = 0.5f;                     // Per axis
+        float max_scale = 1.0f;                     // Per axis
+        float proportional_gain = 0.3f;
+        float integral_gain = 0.05f;
+        float scale_step = 1.0f / 64.0f;            // Scale is snapped to multiples of this to avoid changing the viewport for tiny adjustments
+    };
+
+    /**
+     * @brief PI controller picking a render scale so frame times converge to a target frame time.
+     * The controller works on the rendered area (scale^2), since GPU cost mostly scales with the number of shaded pixels.
+     * It's driven by GPU frame times only. GPU timings arrive a few frames late and not every frame, so the last one is held
+     * until a new one arrives. Lowering the resolution can't speed up the CPU, so while the CPU misses the target the scale
+     * is held instead of lowered.
+     */
+    class DynamicResolutionController
+    {
+    public:
+        void Init(const DynamicResolutionSettings& settings);
+
+        /**
+         * @brief Feeds a new frame time measurement into the controller.
+         * @param cpu_frame_ms CPU time between the last two presents, minus the time blocked waiting for the GPU.
+         * @param gpu_frame_ms GPU time of the latest timed frame. 0 if no new one arrived, which keeps the last one.
+         * @return The new render scale per axis.
+         */
+        float Update(double cpu_frame_ms, double gpu_frame_ms);
+
+        // Back to max_scale, dropping accumulated error and the held GPU time. Called when the output resolution changed.
+        void Reset();
+
+        bool IsEnabled() const
+        {
+            return settings_.target_frame_ms > 0.0f;
+        }
+
+        // Render scale per axis in [min_scale, max_scale]
+        float GetScale() const
+        {
+            return scale_;
+        }
+
+        double GetLastMeasuredMs() const
+        {
+            return last_measured_ms_;
+        }
+
+        const DynamicResolutionSettings& GetSettings() const
+        {
+            return settings_;
+        }
+
+    private:
+        DynamicResolutionSettings settings_;
+        float scale_ = 1.0f;
+        float integral_ = 0.0f;
+        double last_gpu_frame_ms_ = 0.0;
+        double last_measured_ms_ = 0.0;
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+namespace gfx
+{
+    static inline constexpr uint32 MIN_FRAMES_IN_FLIGHT = 2;
+    static inline constexpr uint32 MAX_FRAMES_IN_FLIGHT = 4;
+
+    /**
+     * Trade-off between input latency and GPU utilization.
+     * More frames in flight give the CPU more headroom before it has to wait for the GPU, at the cost of latency.
+     */
+    enum class FramePacing : uint8
+    {
+        LOW_LATENCY,    // 2 frames in flight
+        BALANCED,       // 3 frames in flight
+        THROUGHPUT      // 4 frames in flight
+    };
+
+    inline uint32 GetNumFramesInFlight(FramePacing pacing)
+    {
+        switch (pacing)
+        {
+        case FramePacing::LOW_LATENCY:
+            return 2;
+        case FramePacing::BALANCED:
+            return 3;
+        case FramePacing::THROUGHPUT:
+            return 4;
+        default:
+            CHECK_NO_ENTRY();
+            return MIN_FRAMES_IN_FLIGHT;
+        }
+    }
+
+    inline const char* ToString(FramePacing pacing)
+    {
+        switch (pacing)
+        {
+        case FramePacing::LOW_LATENCY:
+            return "Low Latency";
+        case FramePacing::BALANCED:
+            return "Balanced";
+        case FramePacing::THROUGHPUT:
+            return "Throughput";
+        default:
+            CHECK_NO_ENTRY();
+            return "Unknown";
+        }
+    }
+
+    // Defined in GraphicsContext.cpp
+    uint32 GetNumFramesInFlight();
+    uint32 GetFrameInFlightIdx();
+
+    /**
+     * @brief Holds one instance of T per frame in flight.
+     * Storage is sized for MAX_FRAMES_IN_FLIGHT so the actual count can be picked at startup without reallocating,
+     * iteration only covers the frames in flight which are in use.
+     */
+    template<typename T>
+    class FrameResource
+    {
+    public:
+        using Storage = std::array<T, MAX_FRAMES_IN_FLIGHT>;
+
+        // The instance belonging to the frame currently being recorded
+        T& Get()
+        {
+            return resources_[GetFrameInFlightIdx()];
+        }
+
+        const T& Get() const
+        {
+            return resources_[GetFrameInFlightIdx()];
+        }
+
+        T& operator[](uint32 frame_idx)
+        {
+            CHECK(frame_idx < Size());
+            return resources_[frame_idx];
+        }
+
+        const T& operator[](uint32 frame_idx) const
+        {
+            CHECK(frame_idx < Size());
+            return resources_[frame_idx];
+        }
+
+        uint32 Size() const
+        {
+            return GetNumFramesInFlight();
+        }
+
+        typename Storage::iterator begin() { return resources_.begin(); }
+        typename Storage::iterator end() { return resources_.begin() + Size(); }
+        typename Storage::const_iterator begin() const { return resources_.begin(); }
+        typename Storage::const_iterator end() const { return resources_.begin() + Size(); }
+
+    private:
+        Storage resources_ = {};
+    };
+}
@@ -0,0 +1,168 @@
+#include "Renderer/GPUProfiler.h"
+
+#include "d3dx12.h"
+
+#include "Renderer/GraphicsContext.h"
+
+namespace gfx
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    void D3D12TimestampBackend::Init(uint32 max_queries_per_frame)
+    {
+        max_queries_per_frame_ = max_queries_per_frame;
+        const uint32 num_queries = max_queries_per_frame_ * GetNumFramesInFlight();
+
+        D3D12_QUERY_HEAP_DESC query_heap_desc = {};
+        query_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        query_heap_desc.Count = num_queries;
+        DX_VERIFY(gfx::device->CreateQueryHeap(&query_heap_desc, IID_PPV_ARGS(&query_heap_)));
+        query_heap_->SetName(L"GPU Profiler Timestamps");
+
+        const D3D12_HEAP_PROPERTIES heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+        const CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint64) * num_queries);
+        DX_VERIFY(gfx::device->CreateCommittedResource(
+            &heap_properties,
+            D3D12_HEAP_FLAG_NONE,
+            &buffer_desc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&readback_buffer_)));
+        readback_buffer_->SetName(L"GPU Profiler Readback");
+
+        // Timestamps are only comparable within the queue they were recorded on
+        DX_VERIFY(gfx::command_queue_direct->GetTimestampFrequency(&frequency_));
+    }
+
+    void D3D12TimestampBackend::Shutdown()
+    {
+        readback_buffer_.Reset();
+        query_heap_.Reset();
+    }
+
+    uint64 D3D12TimestampBackend::GetFrequency() const
+    {
+        return frequency_;
+    }
+
+    void D3D12TimestampBackend::WriteTimestamp(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 query_idx)
+    {
+        command_list->EndQuery(query_heap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frame_idx * max_queries_per_frame_ + query_idx);
+    }
+
+    void D3D12TimestampBackend::Resolve(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 num_queries)
+    {
+        const uint32 first_query = frame_idx * max_queries_per_frame_;
+        command_list->ResolveQueryData(query_heap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first_query, num_queries,
+            readback_buffer_.Get(), sizeof(uint64) * first_query);
+    }
+
+    void D3D12TimestampBackend::ReadTimestamps(uint32 frame_idx, uint32 num_queries, uint64* out_ticks)
+    {
+        const size_t offset = sizeof(uint64) * frame_idx * max_queries_per_frame_;
+        const D3D12_RANGE read_range = { offset, offset + sizeof(uint64) * num_queries };
+        static const D3D12_RANGE EMPTY_WRITE_RANGE = { 0, 0 }; // no CPU write
+
+        void* mapped_ptr = nullptr;
+        DX_VERIFY(readback_buffer_->Map(0, &read_range, &mapped_ptr));
+        memcpy(out_ticks, static_cast<uint8*>(mapped_ptr) + offset, sizeof(uint64) * num_queries);
+        readback_buffer_->Unmap(0, &EMPTY_WRITE_RANGE);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    void GPUProfiler::Init(UniquePtr<ITimestampBackend> backend)
+    {
+        CHECK(backend != nullptr);
+        backend_ = std::move(backend);
+        backend_->Init(MAX_MARKERS_PER_FRAME * 2 + 2);  // Begin + end per marker, plus frame begin and end
+        for (FrameData& frame : frames_)
+        {
+            frame = {};
+            frame.markers.reserve(MAX_MARKERS_PER_FRAME);
+        }
+        history_.Clear();
+    }
+
+    void GPUProfiler::Shutdown()
+    {
+        backend_->Shutdown();
+        backend_.reset();
+    }
+
+    void GPUProfiler::BeginFrame(ID3D12GraphicsCommandList* command_list)
+    {
+        FrameData& frame = frames_.Get();
+        if (frame.has_results)
+        {
+            CollectResults(frame);
+        }
+
+        frame.frame_idx = gfx::current_frame_idx;
+        frame.markers.clear();
+        frame.num_queries = 0;
+        frame.has_results = false;
+        current_depth_ = 0;
+        cpu_frame_start_ = Clock::now();
+
+        AllocateQuery(command_list);
+    }
+
+    void GPUProfiler::EndFrame(ID3D12GraphicsCommandList* command_list)
+    {
+        CHECK_MSG(current_depth_ == 0, "Unbalanced GPU markers");
+        FrameData& frame = frames_.Get();
+        AllocateQuery(command_list);
+        backend_->Resolve(command_list, GetFrameInFlightIdx(), frame.num_queries);
+
+        frame.cpu_frame_ms = std::chrono::duration<double, std::milli>(Clock::now() - cpu_frame_start_).count();
+        frame.has_results = true;
+    }
+
+    uint32 GPUProfiler::BeginMarker(ID3D12GraphicsCommandList* command_list, const char* name)
+    {
+        FrameData& frame = frames_.Get();
+        if (frame.markers.size() >= MAX_MARKERS_PER_FRAME)
+        {
+            ++current_depth_;
+            return INVALID_QUERY;
+        }
+
+        TimestampMarker& marker = frame.markers.emplace_back();
+        marker.name = name;
+        marker.depth = current_depth_++;
+        marker.begin_query = AllocateQuery(command_list);
+        return static_cast<uint32>(frame.markers.size() - 1);
+    }
+
+    void GPUProfiler::EndMarker(ID3D12GraphicsCommandList* command_list, uint32 marker)
+    {
+        CHECK(current_depth_ > 0);
+        --current_depth_;
+        if (marker == INVALID_QUERY)
+        {
+            return;
+        }
+
+        FrameData& frame = frames_.Get();
+        CHECK(marker < frame.markers.size());
+        frame.markers[marker].end_query = AllocateQuery(command_list);
+    }
+
+    uint32 GPUProfiler::AllocateQuery(ID3D12GraphicsCommandList* command_list)
+    {
+        FrameData& frame = frames_.Get();
+        const uint32 query_idx = frame.num_queries++;
+        backend_->WriteTimestamp(command_list, GetFrameInFlightIdx(), query_idx);
+        return query_idx;
+    }
+
+    void GPUProfiler::CollectResults(FrameData& frame)
+    {
+        CHECK(frame.num_queries >= 2);
+        ticks_scratch_.resize(frame.num_queries);
+        backend_->ReadTimestamps(GetFrameInFlightIdx(), frame.num_queries, ticks_scratch_.data());
+        history_.AddFrame(frame.frame_idx, frame.markers, ticks_scratch_, backend_->GetFrequency(), frame.cpu_frame_ms);
+        frame.has_results = false;
+    }
+}
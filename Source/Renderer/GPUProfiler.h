@@ -0,0 +1,109 @@
+#pragma once
+#include <chrono>
+
+#include "Renderer/DXUtils.h"
+#include "Renderer/FrameResource.h"
+#include "Renderer/GPUTimestamps.h"
+
+namespace gfx
+{
+    /**
+     * @brief Timestamp query heap on the direct queue, resolved into one readback region per frame in flight.
+     */
+    class D3D12TimestampBackend : public ITimestampBackend
+    {
+    public:
+        virtual void Init(uint32 max_queries_per_frame) override;
+        virtual void Shutdown() override;
+        virtual uint64 GetFrequency() const override;
+        virtual void WriteTimestamp(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 query_idx) override;
+        virtual void Resolve(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 num_queries) override;
+        virtual void ReadTimestamps(uint32 frame_idx, uint32 num_queries, uint64* out_ticks) override;
+
+    private:
+        ComPtr<ID3D12QueryHeap> query_heap_;
+        ComPtr<ID3D12Resource> readback_buffer_;
+        uint32 max_queries_per_frame_ = 0;
+        uint64 frequency_ = 0;
+    };
+
+    /**
+     * @brief Measures GPU time of named passes with timestamp queries.
+     * Results are read back once the GPU is done with a frame and kept in a rolling history, which does the reporting.
+     */
+    class GPUProfiler
+    {
+    public:
+        static inline constexpr uint32 MAX_MARKERS_PER_FRAME = 64;
+
+        void Init(UniquePtr<ITimestampBackend> backend);
+        void Shutdown();
+        bool IsInitialized() const { return backend_ != nullptr; }
+
+        /**
+         * @brief Collects the results of the frame previously recorded in this frame in flight slot and starts a new frame.
+         * Call right after the command list has been reset, once the slot's fence has been waited on.
+         */
+        void BeginFrame(ID3D12GraphicsCommandList* command_list);
+
+        /**
+         * @brief Writes the final timestamp and resolves all queries of the frame. Call before closing the command list.
+         */
+        void EndFrame(ID3D12GraphicsCommandList* command_list);
+
+        /**
+         * @return Handle to pass to EndMarker. Markers may nest but have to be closed in reverse order.
+         */
+        uint32 BeginMarker(ID3D12GraphicsCommandList* command_list, const char* name);
+        void EndMarker(ID3D12GraphicsCommandList* command_list, uint32 marker);
+
+        const GPUTimingHistory& GetHistory() const
+        {
+            return history_;
+        }
+
+    private:
+        using Clock = std::chrono::high_resolution_clock;
+        static inline constexpr uint32 INVALID_QUERY = TimestampMarker::INVALID_QUERY;
+
+        struct FrameData
+        {
+            uint64 frame_idx = 0;
+            std::vector<TimestampMarker> markers;
+            uint32 num_queries = 0;
+            double cpu_frame_ms = 0.0;
+            bool has_results = false;
+        };
+
+        uint32 AllocateQuery(ID3D12GraphicsCommandList* command_list);
+        void CollectResults(FrameData& frame);
+
+        UniquePtr<ITimestampBackend> backend_;
+        FrameResource<FrameData> frames_;
+        uint32 current_depth_ = 0;
+        Clock::time_point cpu_frame_start_;
+        GPUTimingHistory history_;
+        std::vector<uint64> ticks_scratch_;
+    };
+
+    struct ScopedGPUMarker
+    {
+        ScopedGPUMarker(GPUProfiler& profiler, ID3D12GraphicsCommandList* command_list, const char* name)
+            : profiler_(profiler), command_list_(command_list), marker_(profiler.BeginMarker(command_list, name))
+        {
+        }
+
+        ~ScopedGPUMarker()
+        {
+            profiler_.EndMarker(command_list_, marker_);
+        }
+
+        ScopedGPUMarker(const ScopedGPUMarker&) = delete;
+        ScopedGPUMarker& operator=(const ScopedGPUMarker&) = delete;
+
+    private:
+        GPUProfiler& profiler_;
+        ID3D12GraphicsCommandList* command_list_;
+        uint32 marker_;
+    };
+}
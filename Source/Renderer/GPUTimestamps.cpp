@@ -0,0 +1,165 @@
+#include "Renderer/GPUTimestamps.h"
+
+namespace gfx
+{
+    //////////////////////////////////////////////////////////////////////////
+
+    NullTimestampBackend::NullTimestampBackend(double mean_interval_ms, uint32 seed)
+        : mean_interval_ms_(mean_interval_ms), rng_state_(seed != 0 ? seed : 1)
+    {
+    }
+
+    void NullTimestampBackend::Init(uint32 max_queries_per_frame)
+    {
+        max_queries_per_frame_ = max_queries_per_frame;
+        written_ticks_.assign(max_queries_per_frame_ * MAX_FRAMES_IN_FLIGHT, 0);
+        resolved_ticks_.assign(max_queries_per_frame_ * MAX_FRAMES_IN_FLIGHT, 0);
+        clock_ = 0;
+    }
+
+    void NullTimestampBackend::Shutdown()
+    {
+        written_ticks_.clear();
+        resolved_ticks_.clear();
+    }
+
+    uint64 NullTimestampBackend::GetFrequency() const
+    {
+        return FREQUENCY;
+    }
+
+    void NullTimestampBackend::WriteTimestamp(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 query_idx)
+    {
+        CHECK(query_idx < max_queries_per_frame_);
+        clock_ += NextInterval();
+        written_ticks_[frame_idx * max_queries_per_frame_ + query_idx] = clock_;
+    }
+
+    void NullTimestampBackend::Resolve(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 num_queries)
+    {
+        const uint32 first_query = frame_idx * max_queries_per_frame_;
+        std::copy_n(written_ticks_.begin() + first_query, num_queries, resolved_ticks_.begin() + first_query);
+    }
+
+    void NullTimestampBackend::ReadTimestamps(uint32 frame_idx, uint32 num_queries, uint64* out_ticks)
+    {
+        std::copy_n(resolved_ticks_.begin() + frame_idx * max_queries_per_frame_, num_queries, out_ticks);
+    }
+
+    uint64 NullTimestampBackend::NextInterval()
+    {
+        // xorshift32, uniformly distributed in [0.5, 1.5) * mean
+        rng_state_ ^= rng_state_ << 13;
+        rng_state_ ^= rng_state_ >> 17;
+        rng_state_ ^= rng_state_ << 5;
+        const double random_01 = static_cast<double>(rng_state_) / static_cast<double>(std::numeric_limits<uint32>::max());
+        const double interval_ms = mean_interval_ms_ * (0.5 + random_01);
+        return static_cast<uint64>(interval_ms * 1e-3 * FREQUENCY);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    void GPUTimingHistory::AddFrame(uint64 frame_idx, std::span<const TimestampMarker> markers, std::span<const uint64> ticks, uint64 frequency, double cpu_frame_ms)
+    {
+        CHECK(ticks.size() >= 2 && frequency > 0);
+        const double ms_per_tick = 1000.0 / static_cast<double>(frequency);
+        auto ticks_to_ms = [&](uint32 begin_query, uint32 end_query)
+        {
+            const uint64 begin = ticks[begin_query];
+            const uint64 end = ticks[end_query];
+            return end > begin ? static_cast<double>(end - begin) * ms_per_tick : 0.0;
+        };
+
+        FrameTimings timings;
+        timings.frame_idx = frame_idx;
+        timings.gpu_frame_ms = ticks_to_ms(0, static_cast<uint32>(ticks.size() - 1));
+        timings.cpu_frame_ms = cpu_frame_ms;
+        timings.is_gpu_bound = timings.gpu_frame_ms > timings.cpu_frame_ms;
+        timings.passes.reserve(markers.size());
+        for (const TimestampMarker& marker : markers)
+        {
+            CHECK(marker.end_query < ticks.size() && marker.begin_query < marker.end_query);
+            timings.passes.push_back({ .name = marker.name, .depth = marker.depth, .duration_ms = ticks_to_ms(marker.begin_query, marker.end_query) });
+        }
+
+        frames_.push_back(std::move(timings));
+        if (frames_.size() > HISTORY_SIZE)
+        {
+            frames_.pop_front();
+        }
+    }
+
+    void GPUTimingHistory::Clear()
+    {
+        frames_.clear();
+    }
+
+    double GPUTimingHistory::GetAveragePassMs(const String& name, uint32 num_frames) const
+    {
+        double total_ms = 0.0;
+        uint32 num_samples = 0;
+        const size_t first = frames_.size() - std::min<size_t>(num_frames, frames_.size());
+        for (size_t i = first; i < frames_.size(); ++i)
+        {
+            for (const PassTiming& pass : frames_[i].passes)
+            {
+                if (pass.name == name)
+                {
+                    total_ms += pass.duration_ms;
+                    ++num_samples;
+                }
+            }
+        }
+        return num_samples > 0 ? total_ms / num_samples : 0.0;
+    }
+
+    double GPUTimingHistory::GetAverageGPUFrameMs(uint32 num_frames) const
+    {
+        const size_t num_samples = std::min<size_t>(num_frames, frames_.size());
+        double total_ms = 0.0;
+        for (size_t i = frames_.size() - num_samples; i < frames_.size(); ++i)
+        {
+            total_ms += frames_[i].gpu_frame_ms;
+        }
+        return num_samples > 0 ? total_ms / num_samples : 0.0;
+    }
+
+    double GPUTimingHistory::GetAverageCPUFrameMs(uint32 num_frames) const
+    {
+        const size_t num_samples = std::min<size_t>(num_frames, frames_.size());
+        double total_ms = 0.0;
+        for (size_t i = frames_.size() - num_samples; i < frames_.size(); ++i)
+        {
+            total_ms += frames_[i].cpu_frame_ms;
+        }
+        return num_samples > 0 ? total_ms / num_samples : 0.0;
+    }
+
+    float GPUTimingHistory::GetGPUBoundRatio(uint32 num_frames) const
+    {
+        const size_t num_samples = std::min<size_t>(num_frames, frames_.size());
+        uint32 num_gpu_bound = 0;
+        for (size_t i = frames_.size() - num_samples; i < frames_.size(); ++i)
+        {
+            num_gpu_bound += frames_[i].is_gpu_bound ? 1 : 0;
+        }
+        return num_samples > 0 ? static_cast<float>(num_gpu_bound) / num_samples : 0.0f;
+    }
+
+    void GPUTimingHistory::LogReport(uint32 num_frames) const
+    {
+        if (frames_.empty())
+        {
+            return;
+        }
+
+        LOG("GPU {:.3f} ms | CPU {:.3f} ms | GPU bound in {:.0f}% of the last {} frames",
+            GetAverageGPUFrameMs(num_frames), GetAverageCPUFrameMs(num_frames), GetGPUBoundRatio(num_frames) * 100.0f,
+            std::min<size_t>(num_frames, frames_.size()));
+
+        for (const PassTiming& pass : frames_.back().passes)
+        {
+            LOG("  {:>{}}{}: {:.3f} ms", "", pass.depth * 2, pass.name, GetAveragePassMs(pass.name, num_frames));
+        }
+    }
+}
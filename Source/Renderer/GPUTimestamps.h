@@ -0,0 +1,127 @@
+#pragma once
+#include <span>
+
+#include "Renderer/FrameResource.h"
+
+// Backends record into D3D12 command lists, but nothing here needs more than the pointer
+struct ID3D12GraphicsCommandList;
+
+namespace gfx
+{
+    /**
+     * @brief Source of GPU timestamps. Queries are addressed per frame in flight, so the profiler can read back
+     * a frame's results once the GPU is done with it while later frames are still being recorded.
+     */
+    class ITimestampBackend
+    {
+    public:
+        virtual ~ITimestampBackend() = default;
+
+        virtual void Init(uint32 max_queries_per_frame) = 0;
+        virtual void Shutdown() = 0;
+
+        // Ticks per second
+        virtual uint64 GetFrequency() const = 0;
+
+        virtual void WriteTimestamp(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 query_idx) = 0;
+        virtual void Resolve(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 num_queries) = 0;
+
+        // Only valid once the GPU finished the frame which resolved the queries
+        virtual void ReadTimestamps(uint32 frame_idx, uint32 num_queries, uint64* out_ticks) = 0;
+    };
+
+    /**
+     * @brief Produces synthetic timestamps without touching a device. Command lists are ignored and may be null.
+     * Every query advances a fake GPU clock by a deterministic pseudo random amount around the given mean,
+     * so aggregation and reporting can be exercised without a GPU.
+     */
+    class NullTimestampBackend : public ITimestampBackend
+    {
+    public:
+        static inline constexpr uint64 FREQUENCY = 1'000'000'000;  // 1 tick = 1 ns
+
+        explicit NullTimestampBackend(double mean_interval_ms = 1.0, uint32 seed = 1);
+
+        virtual void Init(uint32 max_queries_per_frame) override;
+        virtual void Shutdown() override;
+        virtual uint64 GetFrequency() const override;
+        virtual void WriteTimestamp(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 query_idx) override;
+        virtual void Resolve(ID3D12GraphicsCommandList* command_list, uint32 frame_idx, uint32 num_queries) override;
+        virtual void ReadTimestamps(uint32 frame_idx, uint32 num_queries, uint64* out_ticks) override;
+
+    private:
+        uint64 NextInterval();
+
+        double mean_interval_ms_ = 1.0;
+        uint32 rng_state_ = 1;
+        uint64 clock_ = 0;
+        uint32 max_queries_per_frame_ = 0;
+        std::vector<uint64> written_ticks_;
+        std::vector<uint64> resolved_ticks_;
+    };
+
+    // A named pass of a frame, bracketed by two of the frame's timestamp queries
+    struct TimestampMarker
+    {
+        static inline constexpr uint32 INVALID_QUERY = ~0u;
+
+        const char* name = nullptr;
+        uint32 depth = 0;
+        uint32 begin_query = INVALID_QUERY;
+        uint32 end_query = INVALID_QUERY;
+    };
+
+    struct PassTiming
+    {
+        String name;
+        uint32 depth = 0;           // Nesting level of the marker
+        double duration_ms = 0.0;
+    };
+
+    struct FrameTimings
+    {
+        uint64 frame_idx = 0;
+        std::vector<PassTiming> passes;
+        double gpu_frame_ms = 0.0;  // First to last timestamp of the frame
+        double cpu_frame_ms = 0.0;  // CPU time spent recording the frame
+        bool is_gpu_bound = false;
+    };
+
+    /**
+     * @brief Rolling history of per frame GPU timings, with the averages and GPU / CPU bound classification reported
+     * from it. Knows nothing about devices, so it can be fed synthetic timestamps.
+     */
+    class GPUTimingHistory
+    {
+    public:
+        static inline constexpr uint32 HISTORY_SIZE = 256;
+
+        /**
+         * @brief Turns a frame's resolved timestamps into pass durations and appends it, dropping the oldest frame once full.
+         * The first and last timestamp bracket the frame. It counts as GPU bound if the GPU took longer than the CPU took to record it.
+         */
+        void AddFrame(uint64 frame_idx, std::span<const TimestampMarker> markers, std::span<const uint64> ticks, uint64 frequency, double cpu_frame_ms);
+        void Clear();
+
+        const std::deque<FrameTimings>& GetFrames() const
+        {
+            return frames_;
+        }
+
+        /**
+         * @brief Average duration of a pass over the last num_frames frames. 0 if it never ran.
+         */
+        double GetAveragePassMs(const String& name, uint32 num_frames = HISTORY_SIZE) const;
+
+        double GetAverageGPUFrameMs(uint32 num_frames = HISTORY_SIZE) const;
+        double GetAverageCPUFrameMs(uint32 num_frames = HISTORY_SIZE) const;
+
+        // Fraction of the last num_frames frames which were GPU bound
+        float GetGPUBoundRatio(uint32 num_frames = HISTORY_SIZE) const;
+
+        void LogReport(uint32 num_frames = 60) const;
+
+    private:
+        std::deque<FrameTimings> frames_;
+    };
+}
@@ -12,7 +12,7 @@ extern IRenderer* CreateRenderer();
 
 namespace gfx
 {
-    void Init(Window* window)
+    void Init(Window* window, FramePacing pacing, const DynamicResolutionSettings& dynamic_resolution_settings)
     {
         LOG("Initializing Graphics Context");
         CHECK(IsInitialized() == false);
@@ -56,18 +56,41 @@ namespace gfx
         queue_desc.Type = D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_COPY;
         DX_VERIFY(gfx::device->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(&gfx::command_queue_copy)));
 
-        CreateSwapchain(static_cast<uint32>(render_resolution.x), static_cast<uint32>(render_resolution.y), NUM_FRAMES_IN_FLIGHT, hwnd);
+        fence_direct.Init(command_queue_direct, L"Direct Queue Timeline");
+        fence_compute.Init(command_queue_compute, L"Compute Queue Timeline");
+        fence_copy.Init(command_queue_copy, L"Copy Queue Timeline");
+        fence_event = CreateEventHandle();
 
-        for (int32 i = 0; i < NUM_FRAMES_IN_FLIGHT; ++i)
-        {
-            const D3D12_COMMAND_LIST_TYPE cmd_list_type = D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_DIRECT;
-            command_allocators.push_back(CreateCommandAllocator(cmd_list_type));
-            command_lists.push_back(CreateGraphicsCommandList(command_allocators[i], cmd_list_type));
-        }
+        command_pool_direct.Init(D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_DIRECT, fence_direct, L"Direct Command List");
+        command_pool_compute.Init(D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_COMPUTE, fence_compute, L"Compute Command List");
+        command_pool_copy.Init(D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_COPY, fence_copy, L"Copy Command List");
+
+        upload_queue.Init(command_pool_copy);
+        staging_descriptor_heap.Init(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, STAGING_DESCRIPTOR_HEAP_SIZE, L"Staging Descriptor Heap");
+        view_cache.Init(MakeUnique<D3D12DescriptorViewBackend>(staging_descriptor_heap));
+
+        frame_pacing = pacing;
+        num_frames_in_flight = GetNumFramesInFlight(pacing);
+        CHECK(num_frames_in_flight >= MIN_FRAMES_IN_FLIGHT && num_frames_in_flight <= MAX_FRAMES_IN_FLIGHT);
+        LOG("Frame pacing: {} ({} frames in flight)", ToString(frame_pacing), num_frames_in_flight);
+
+        // One backbuffer per frame in flight, so the backbuffer index doubles as frame in flight index
+        CreateSwapchain(static_cast<uint32>(render_resolution.x), static_cast<uint32>(render_resolution.y), num_frames_in_flight, hwnd);
 
-        SetRenderResolution(window->GetWidth(), window->GetHeight());
-        SetViewport(render_resolution.x, render_resolution.y);
+        command_recorder.Init(command_queue_direct, command_pool_direct);
+
+        gpu_profiler.Init(MakeUnique<D3D12TimestampBackend>());
+        dynamic_resolution.Init(dynamic_resolution_settings);
+        present_stats = {};
+        present_tracking = {};
+
+        output_resolution = Vec2(static_cast<float>(window->GetWidth()), static_cast<float>(window->GetHeight()));
+        ApplyRenderScale();
         renderer = CreateRenderer();
+
+        // After the renderer's PSO builds and uploads, which would otherwise count as the first frame
+        present_tracking.last_present_time = std::chrono::high_resolution_clock::now();
+        present_tracking.last_report_time = present_tracking.last_present_time;
     }
 
     void Shutdown()
@@ -75,27 +98,30 @@ namespace gfx
         LOG("Shutting down Graphics Context");
         CHECK(IsInitialized());
 
-        FlushAllQueues();
-
-        CloseHandle(fence_event);
+        WaitForSignaledWork();
+        upload_queue.Shutdown();
+        gpu_profiler.Shutdown();
 
         delete renderer;
         renderer = nullptr;
 
-        for (auto& cmd_list : command_lists)
-        {
-            cmd_list.Reset();
-        }
+        deferred_release_queue.Flush();
+        view_cache.Shutdown();
+        staging_descriptor_heap.Shutdown();
+
+        command_recorder.Shutdown();
+        command_pool_direct.Shutdown();
+        command_pool_compute.Shutdown();
+        command_pool_copy.Shutdown();
+
+        fence_direct.Shutdown();
+        fence_compute.Shutdown();
+        fence_copy.Shutdown();
+        CloseHandle(fence_event);
 
-        backbuffer_fence.Reset();
         descriptor_heap_rtv.Reset();
         descriptor_heap_cbv_uav_srv.Reset();
         descriptor_heap_dsv.Reset();
-        for (auto& allocator : command_allocators)
-        {
-            allocator.Reset();
-        }
-
         for(auto& backbuffer : backbuffers)
         {
             backbuffer.Reset();
@@ -114,6 +140,16 @@ namespace gfx
         dxgi_factory.Reset();
     }
 
+    uint32 GetNumFramesInFlight()
+    {
+        return num_frames_in_flight;
+    }
+
+    uint32 GetFrameInFlightIdx()
+    {
+        return current_backbuffer_idx;
+    }
+
     bool IsInitialized()
     {
         return device != nullptr &&
@@ -127,7 +163,6 @@ namespace gfx
         CHECK(height > 0.0f);
         if(viewport.Width != width || viewport.Height != height)
         {
-            LOG("Set viewport - w: {} h: {}", width, height);
             viewport = CD3DX12_VIEWPORT(0.0f, 0.0f, width, height);
         }
     }
@@ -151,6 +186,20 @@ namespace gfx
         return gfx::render_resolution;
     }
 
+    Vec2 GetOutputResolution()
+    {
+        return gfx::output_resolution;
+    }
+
+    void ApplyRenderScale()
+    {
+        const float scale = dynamic_resolution.GetScale();
+        const uint32 width = std::max(1u, static_cast<uint32>(std::round(output_resolution.x * scale)));
+        const uint32 height = std::max(1u, static_cast<uint32>(std::round(output_resolution.y * scale)));
+        SetRenderResolution(width, height);
+        SetViewport(static_cast<float>(width), static_cast<float>(height));
+    }
+
     void CreateSwapchain(uint32 width, uint32 height, uint32 num_buffers, const HWND& hwnd)
     {
         DXGI_SWAP_CHAIN_DESC1 swapchain_desc = {};
@@ -192,6 +241,15 @@ namespace gfx
         descriptor_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
         DX_VERIFY(gfx::device->CreateDescriptorHeap(&descriptor_heap_desc, IID_PPV_ARGS(&gfx::descriptor_heap_cbv_uav_srv)));
 
+        CreateBackbufferRTVs(num_buffers);
+
+        gfx::backbuffer_fence_values = std::vector<uint64>(num_buffers, 0);
+    }
+
+    void CreateBackbufferRTVs(uint32 num_buffers)
+    {
+        CHECK(gfx::backbuffers.empty());
+
         // Create RTV for each back buffer
         for (uint32 i = 0; i < num_buffers; ++i)
         {
@@ -207,10 +265,61 @@ namespace gfx
             gfx::backbuffers.push_back(std::move(back_buffer));
         }
         CHECK(gfx::backbuffers.size() == num_buffers);
+    }
 
-        gfx::backbuffer_fence = CreateFence();
-        gfx::fence_event = CreateEventHandle();
-        gfx::backbuffer_fence_values = std::vector<uint64>(num_buffers, 0);
+    void RequestResize(uint32 width, uint32 height)
+    {
+        // Only remember the latest size. Dragging the window sends a stream of these, each of them restarts the wait.
+        pending_resize = DirectX::XMUINT2(width, height);
+        pending_resize_time = std::chrono::high_resolution_clock::now();
+    }
+
+    bool ApplyPendingResize()
+    {
+        if (pending_resize.has_value() == false)
+        {
+            return false;
+        }
+
+        // Resizing waits for the direct queue, so doing it every frame of a drag would stall every frame. The swapchain
+        // stretches the old buffers to the window until the size stops changing.
+        const double ms_since_request = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pending_resize_time).count();
+        if (ms_since_request < RESIZE_SETTLE_MS)
+        {
+            return false;
+        }
+
+        const uint32 width = pending_resize->x;
+        const uint32 height = pending_resize->y;
+        pending_resize.reset();
+
+        if (width == 0 || height == 0)
+        {
+            return false;   // Minimized, keep the old buffers around until we are visible again
+        }
+
+        DXGI_SWAP_CHAIN_DESC1 swapchain_desc = {};
+        DX_VERIFY(swapchain->GetDesc1(&swapchain_desc));
+        if (swapchain_desc.Width == width && swapchain_desc.Height == height)
+        {
+            return false;
+        }
+
+        LOG("Resizing swapchain - w: {} h: {}", width, height);
+
+        // ResizeBuffers requires all backbuffer references to be released and the GPU to be done with them.
+        // Only the direct queue ever touches the backbuffers, so that's the only timeline we wait for.
+        gfx::fence_direct.WaitForLastSignal();
+        gfx::backbuffers.clear();
+
+        DX_VERIFY(swapchain->ResizeBuffers(swapchain_desc.BufferCount, width, height, swapchain_desc.Format, swapchain_desc.Flags));
+        CreateBackbufferRTVs(swapchain_desc.BufferCount);
+        current_backbuffer_idx = static_cast<uint8>(swapchain->GetCurrentBackBufferIndex());
+
+        output_resolution = Vec2(static_cast<float>(width), static_cast<float>(height));
+        dynamic_resolution.Reset();
+        ApplyRenderScale();
+        return true;
     }
 
     ComPtr<ID3D12CommandAllocator> CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE type)
@@ -261,19 +370,20 @@ namespace gfx
         }
     }
 
-    void FlushQueue(const ComPtr<ID3D12CommandQueue>& queue, const ComPtr<ID3D12Fence>& fence, uint64_t fence_value, HANDLE fence_event)
+    void FlushAllQueues()
     {
-        Signal(queue, fence, fence_value);
-        WaitForFence(fence, fence_value, fence_event);
+        const uint64 direct_value = fence_direct.Signal();
+        const uint64 compute_value = fence_compute.Signal();
+        const uint64 copy_value = fence_copy.Signal();
+        WaitForFences({ { &fence_direct, direct_value }, { &fence_compute, compute_value }, { &fence_copy, copy_value } });
     }
 
-    void FlushAllQueues()
+    void WaitForSignaledWork()
     {
-        ComPtr<ID3D12Fence> flush_fence = CreateFence();
-        FlushQueue(gfx::command_queue_direct, flush_fence, 0, fence_event);
-        FlushQueue(gfx::command_queue_compute, flush_fence, 1, fence_event);
-        FlushQueue(gfx::command_queue_copy, flush_fence, 2, fence_event);
-        WaitForFence(flush_fence, 2, fence_event);
+        WaitForFences({
+            { &fence_direct, fence_direct.GetLastSignaledValue() },
+            { &fence_compute, fence_compute.GetLastSignaledValue() },
+            { &fence_copy, fence_copy.GetLastSignaledValue() } });
     }
 
     void Present()
@@ -281,15 +391,67 @@ namespace gfx
         DX_VERIFY(swapchain->Present(0 /* no vsync*/, DXGI_PRESENT_ALLOW_TEARING));
 
         // Enqueue signal so we can check when rendering is complete and we can reuse the resources
-        const uint64 fence_value = ++current_frame_idx;
-        Signal(gfx::command_queue_direct, gfx::backbuffer_fence, fence_value);
-        gfx::backbuffer_fence_values[gfx::current_backbuffer_idx] = fence_value;
+        ++current_frame_idx;
+        gfx::backbuffer_fence_values[gfx::current_backbuffer_idx] = fence_direct.Signal();
+
+        // Release staging memory of uploads and retired resources the GPU is done with
+        upload_queue.Update();
+        deferred_release_queue.Process();
 
         // When FLIP_DISCARD, we can't rely on sequential backbuffer indices, so we have to query the swapchain.
         current_backbuffer_idx = gfx::swapchain->GetCurrentBackBufferIndex();
 
         // Stall until we can be sure that we can access the resources accessed by the next back buffer
-        WaitForFence(gfx::backbuffer_fence, gfx::backbuffer_fence_values[gfx::current_backbuffer_idx], gfx::fence_event);
+        const auto wait_start = std::chrono::high_resolution_clock::now();
+        fence_direct.Wait(gfx::backbuffer_fence_values[gfx::current_backbuffer_idx]);
+        const auto wait_end = std::chrono::high_resolution_clock::now();
+
+        present_stats.last_frame_ms = std::chrono::duration<double, std::milli>(wait_end - present_tracking.last_present_time).count();
+        present_stats.last_wait_ms = std::chrono::duration<double, std::milli>(wait_end - wait_start).count();
+        present_tracking.last_present_time = wait_end;
+
+        // Pick the render scale for the next frame. GPU timings arrive a few frames late, only feed new ones.
+        double gpu_frame_ms = 0.0;
+        const std::deque<FrameTimings>& gpu_frames = gpu_profiler.GetHistory().GetFrames();
+        if (gpu_frames.empty() == false && gpu_frames.back().frame_idx != present_tracking.last_gpu_timed_frame_idx)
+        {
+            present_tracking.last_gpu_timed_frame_idx = gpu_frames.back().frame_idx;
+            gpu_frame_ms = gpu_frames.back().gpu_frame_ms;
+        }
+        dynamic_resolution.Update(present_stats.last_frame_ms - present_stats.last_wait_ms, gpu_frame_ms);
+        ApplyRenderScale();
+
+        // Track how long the CPU stalls on the GPU for the chosen number of frames in flight
+        static constexpr double REPORT_INTERVAL_S = 1.0;
+        present_tracking.accumulated_wait_ms += present_stats.last_wait_ms;
+        present_tracking.max_wait_ms = std::max(present_tracking.max_wait_ms, present_stats.last_wait_ms);
+        ++present_tracking.num_frames;
+
+        if (std::chrono::duration<double>(wait_end - present_tracking.last_report_time).count() >= REPORT_INTERVAL_S)
+        {
+            const uint32 num_frames = present_tracking.num_frames;
+            present_stats.avg_wait_ms = present_tracking.accumulated_wait_ms / num_frames;
+            present_stats.max_wait_ms = present_tracking.max_wait_ms;
+            LOG("Present CPU wait [{} - {} frames in flight]: avg {:.3f} ms, max {:.3f} ms over {} frames",
+                ToString(frame_pacing), num_frames_in_flight, present_stats.avg_wait_ms, present_stats.max_wait_ms, num_frames);
+            gpu_profiler.GetHistory().LogReport(num_frames);
+            if (dynamic_resolution.IsEnabled())
+            {
+                LOG("Dynamic resolution: scale {:.3f} ({}x{} of {}x{}), GPU {:.3f} ms, target {:.3f} ms",
+                    dynamic_resolution.GetScale(), render_resolution.x, render_resolution.y, output_resolution.x, output_resolution.y,
+                    dynamic_resolution.GetLastMeasuredMs(), dynamic_resolution.GetSettings().target_frame_ms);
+            }
+
+            present_tracking.accumulated_wait_ms = 0.0;
+            present_tracking.max_wait_ms = 0.0;
+            present_tracking.num_frames = 0;
+            present_tracking.last_report_time = wait_end;
+        }
+    }
+
+    const PresentStats& GetPresentStats()
+    {
+        return present_stats;
     }
 
     void TransitionResource(const ComPtr<ID3D12GraphicsCommandList>& command_list, const ComPtr<ID3D12Resource>& resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
@@ -1,24 +1,69 @@
 #pragma once
+#include <chrono>
 #include <dxgi1_6.h>
 #include "d3dx12.h"
 
 #include "Renderer/DXUtils.h"
 #include "Renderer/Camera.h"
+#include "Renderer/CommandListPool.h"
+#include "Renderer/DeferredReleaseQueue.h"
+#include "Renderer/DescriptorViewCache.h"
+#include "Renderer/DynamicResolution.h"
+#include "Renderer/FrameResource.h"
+#include "Renderer/GPUProfiler.h"
+#include "Renderer/ParallelCommandRecorder.h"
+#include "Renderer/StagingDescriptorHeap.h"
+#include "Renderer/TimelineFence.h"
+#include "Renderer/UploadQueue.h"
 
 class IRenderer;
 class Window;
 
 namespace gfx
 {
-    void Init(Window* window);
+    static inline constexpr uint32 STAGING_DESCRIPTOR_HEAP_SIZE = 4096;
+    static inline constexpr double RESIZE_SETTLE_MS = 100.0;    // How long a requested size has to be stable before it's applied
+
+    /**
+     * @brief Creates device, queues and swapchain.
+     * @param window The window to present to
+     * @param frame_pacing Determines the number of frames in flight. Fixed for the lifetime of the context.
+     * @param dynamic_resolution_settings Target frame time and limits of the render scale.
+     */
+    void Init(Window* window, FramePacing frame_pacing = FramePacing::LOW_LATENCY, const DynamicResolutionSettings& dynamic_resolution_settings = {});
     void Shutdown();
     bool IsInitialized();
 
     void SetViewport(float width, float height);
     const D3D12_VIEWPORT& GetViewport();
     void SetRenderResolution(uint32 width, uint32 height);
+
+    // Resolution the scene is rendered at, i.e. output resolution * render scale
     Vec2 GetRenderResolution();
+
+    // Resolution of the swapchain the scene is upscaled to
+    Vec2 GetOutputResolution();
+
+    /**
+     * @brief Updates render resolution & viewport from the output resolution and the current dynamic resolution scale.
+     */
+    void ApplyRenderScale();
     void CreateSwapchain(uint32 width, uint32 height, uint32 num_buffers, const HWND& hwnd);
+    void CreateBackbufferRTVs(uint32 num_buffers);
+
+    /**
+     * @brief Queues a swapchain resize. Requests collapse into the latest one, which is applied once no new request
+     * arrived for RESIZE_SETTLE_MS. While dragging the window the old buffers are stretched to it instead.
+     */
+    void RequestResize(uint32 width, uint32 height);
+
+    /**
+     * @brief Resizes swapchain buffers, recreates their RTVs and updates output resolution, render resolution & viewport if a resize is pending
+     * and has settled.
+     * Only waits for the direct queue to be done with the backbuffers, other queues keep running.
+     * @return True if the swapchain has been resized, i.e. size dependent resources have to be recreated.
+     */
+    bool ApplyPendingResize();
 
     ComPtr<ID3D12CommandAllocator> CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE type);
 
@@ -41,21 +86,38 @@ namespace gfx
     void WaitForFence(const ComPtr<ID3D12Fence>& fence, uint64 value, HANDLE fence_event);
 
     /**
-     * @brief Stalls thread until given command queue is empty
-     * @param queue The command queue to flush
-     * @param fence The fence to signal
-     * @param fence_value The fence value to wait for
-     * @param fence_event The OS event fired when the fence reaches the given value. Used to stall the thread.
+     * Stalls thread until all command queues are empty
      */
-    void FlushQueue(const ComPtr<ID3D12CommandQueue>& queue, const ComPtr<ID3D12Fence>& fence, uint64_t fence_value, HANDLE fence_event);
+    void FlushAllQueues();
 
     /**
-     * Stalls thread until all command queues are empty
+     * @brief Stalls thread until every value signaled so far on any queue has completed.
+     * Unlike FlushAllQueues this doesn't enqueue new signals, so it only waits for work we're actually tracking.
      */
-    void FlushAllQueues();
+    void WaitForSignaledWork();
 
     void Present();
 
+    struct PresentStats
+    {
+        double last_wait_ms = 0.0;      // CPU time blocked in Present waiting for the next frame's resources
+        double avg_wait_ms = 0.0;       // Average over the last report interval
+        double max_wait_ms = 0.0;       // Max over the last report interval
+        double last_frame_ms = 0.0;     // CPU time between the last two presents
+    };
+    const PresentStats& GetPresentStats();
+
+    // Bookkeeping of Present() between frames
+    struct PresentTracking
+    {
+        std::chrono::high_resolution_clock::time_point last_present_time;
+        std::chrono::high_resolution_clock::time_point last_report_time;
+        double accumulated_wait_ms = 0.0;       // Since the last report
+        double max_wait_ms = 0.0;               // Since the last report
+        uint32 num_frames = 0;                  // Since the last report
+        uint64 last_gpu_timed_frame_idx = std::numeric_limits<uint64>::max();  // Latest frame fed to dynamic resolution
+    };
+
     void TransitionResource(const ComPtr<ID3D12GraphicsCommandList>& command_list, const ComPtr<ID3D12Resource>& resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
 
     D3D12_CPU_DESCRIPTOR_HANDLE GetDescriptorByIdx(D3D12_CPU_DESCRIPTOR_HANDLE start, uint32 idx, uint32 descriptor_size);
@@ -69,26 +131,48 @@ namespace gfx
     inline ComPtr<ID3D12CommandQueue> command_queue_compute;  // Can execute compute & copy commands
     inline ComPtr<ID3D12CommandQueue> command_queue_copy;     // Can only execute copy commands
 
-    static inline constexpr int32 NUM_FRAMES_IN_FLIGHT = 2;
+    inline FramePacing frame_pacing = FramePacing::LOW_LATENCY;
+    inline uint32 num_frames_in_flight = MIN_FRAMES_IN_FLIGHT;
     inline uint64 current_frame_idx = 0;
     inline uint8 current_backbuffer_idx = 0;
     inline ComPtr<IDXGISwapChain3> swapchain;
     inline ComPtr<ID3D12DescriptorHeap> descriptor_heap_rtv;
     inline ComPtr<ID3D12DescriptorHeap> descriptor_heap_cbv_uav_srv;
     inline ComPtr<ID3D12DescriptorHeap> descriptor_heap_dsv;
+    inline StagingDescriptorHeap staging_descriptor_heap;   // CBVs / SRVs / UAVs, copied into shader visible heaps on flush
+    inline DescriptorViewCache view_cache;                  // Deduplicated views in the staging heap
 
     inline std::vector<ComPtr<ID3D12Resource>> backbuffers;
-    inline HANDLE fence_event;
-    inline ComPtr<ID3D12Fence> backbuffer_fence;
-    inline std::vector<uint64> backbuffer_fence_values;
+    inline std::vector<uint64> backbuffer_fence_values;   // Direct queue timeline values
+    inline PresentStats present_stats;
+    inline PresentTracking present_tracking;
+
+    // Per queue timelines
+    inline TimelineFence fence_direct;
+    inline TimelineFence fence_compute;
+    inline TimelineFence fence_copy;
+    inline HANDLE fence_event;  // Used for waits spanning multiple fences
 
-    inline std::vector<ComPtr<ID3D12CommandAllocator>> command_allocators;
-    inline std::vector<ComPtr<ID3D12GraphicsCommandList>> command_lists;
+    // Per queue command lists, recycled once their timeline passed the submission
+    inline CommandListPool command_pool_direct;
+    inline CommandListPool command_pool_compute;
+    inline CommandListPool command_pool_copy;
+
+    inline ParallelCommandRecorder command_recorder;  // Direct queue lists of the frame
+
+    inline UploadQueue upload_queue;
+    inline DeferredReleaseQueue deferred_release_queue;
+    inline GPUProfiler gpu_profiler;
+    inline DynamicResolutionController dynamic_resolution;
 
     inline IRenderer* renderer = nullptr;
 
+    inline std::optional<DirectX::XMUINT2> pending_resize;
+    inline std::chrono::high_resolution_clock::time_point pending_resize_time;     // Of the latest request
+
+    inline Vec2 output_resolution = Vec2::ZERO;
     inline Vec2 render_resolution = Vec2::ZERO;
-    inline CD3DX12_VIEWPORT viewport;
+    inline CD3DX12_VIEWPORT viewport;   // Covers the render resolution
 
     // Scene Data
     inline Camera camera = Camera();
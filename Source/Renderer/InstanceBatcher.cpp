@@ -0,0 +1,82 @@
+#include "Renderer/InstanceBatcher.h"
+
+namespace gfx
+{
+    uint32 InstanceBatcher::AddPrototype(const DrawCommand& prototype, uint32 instance_offset_constant_idx)
+    {
+        CHECK(instance_offset_constant_idx < prototype.num_root_constants);
+        prototypes_.push_back({ .command = prototype, .instance_offset_constant_idx = instance_offset_constant_idx });
+        return static_cast<uint32>(prototypes_.size() - 1);
+    }
+
+    void InstanceBatcher::Reset()
+    {
+        instances_.clear();
+        sort_entries_.clear();
+        stats_ = {};
+    }
+
+    void InstanceBatcher::Add(uint64 group_key, uint32 prototype_idx, uint32 depth_bucket, const InstanceData& instance)
+    {
+        CHECK(prototype_idx < prototypes_.size());
+        CHECK_MSG(((group_key >> DrawKey::DEPTH_SHIFT) & ((1ull << DrawKey::DEPTH_BITS) - 1)) == 0, "Group keys must not contain a depth bucket");
+
+        sort_entries_.push_back({ .key = group_key, .value = static_cast<uint32>(instances_.size()) });
+        instances_.push_back({ .prototype_idx = prototype_idx, .depth_bucket = depth_bucket, .data = instance });
+    }
+
+    void InstanceBatcher::Build(InstanceData* instance_buffer, uint32 max_instances, DrawList& draw_list)
+    {
+        CHECK(instance_buffer != nullptr || max_instances == 0);
+
+        // Stable, so instances keep their submission order within a batch
+        RadixSort(sort_entries_, sort_scratch_);
+
+        const uint32 num_entries = static_cast<uint32>(sort_entries_.size());
+        uint32 num_written = 0;
+        uint32 group_begin = 0;
+        while (group_begin < num_entries)
+        {
+            const uint64 group_key = sort_entries_[group_begin].key;
+            const uint32 prototype_idx = instances_[sort_entries_[group_begin].value].prototype_idx;
+
+            uint32 group_end = group_begin;
+            uint32 min_depth_bucket = std::numeric_limits<uint32>::max();
+            const uint32 instance_offset = num_written;
+            while (group_end < num_entries && sort_entries_[group_end].key == group_key)
+            {
+                const Instance& instance = instances_[sort_entries_[group_end].value];
+                CHECK_MSG(instance.prototype_idx == prototype_idx, "Instances sharing a group key must share the prototype");
+                if (num_written < max_instances)
+                {
+                    instance_buffer[num_written++] = instance.data;
+                    min_depth_bucket = std::min(min_depth_bucket, instance.depth_bucket);
+                }
+                else
+                {
+                    ++stats_.num_dropped_instances;
+                }
+                ++group_end;
+            }
+
+            const uint32 instance_count = num_written - instance_offset;
+            if (instance_count > 0)
+            {
+                const Prototype& prototype = prototypes_[prototype_idx];
+                DrawCommand command = prototype.command;
+                command.instance_count = instance_count;
+                command.root_constants[prototype.instance_offset_constant_idx] = instance_offset;
+                draw_list.Add(group_key | (static_cast<uint64>(min_depth_bucket) << DrawKey::DEPTH_SHIFT), command);
+                ++stats_.num_batches;
+            }
+
+            group_begin = group_end;
+        }
+
+        stats_.num_instances = num_written;
+        if (stats_.num_dropped_instances > 0)
+        {
+            LOG_WARN("Instance buffer full, dropped {} instances", stats_.num_dropped_instances);
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "Core/RadixSort.h"
+#include "Renderer/DrawList.h"
+
+namespace gfx
+{
+    // Matches InstanceData in bindless_vs.hlsl, 48 bytes per instance
+    struct InstanceData
+    {
+        Affine3x4 world;
+    };
+
+    struct InstanceBatcherStats
+    {
+        uint32 num_instances = 0;
+        uint32 num_batches = 0;
+        uint32 num_dropped_instances = 0;
+    };
+
+    /**
+     * @brief Groups visible draws sharing the same group key (pass, PSO, material and mesh) into instanced draws.
+     * Instance data of each group is written contiguously and each group is emitted as a single draw whose
+     * root constants carry the offset of its first instance. The vertex shader fetches instance data at
+     * instance_offset + SV_InstanceID, since SV_InstanceID does not include StartInstanceLocation.
+     */
+    class InstanceBatcher
+    {
+    public:
+        /**
+         * @brief Registers the draw all instances of a batch share. Instance count and offset are filled in by Build().
+         * @return Index to pass to Add().
+         */
+        uint32 AddPrototype(const DrawCommand& prototype, uint32 instance_offset_constant_idx);
+
+        // For updating per frame state such as root constants
+        DrawCommand& GetPrototype(uint32 prototype_idx)
+        {
+            CHECK(prototype_idx < prototypes_.size());
+            return prototypes_[prototype_idx].command;
+        }
+
+        // Clears the instances, prototypes stay registered
+        void Reset();
+
+        /**
+         * @param group_key Draw key with the depth bucket left at zero. Instances with the same key end up in the same draw.
+         * @param prototype_idx Prototype of the draw. All instances sharing a group key have to share the prototype.
+         * @param depth_bucket Depth bucket of the instance. A batch is sorted by the depth bucket of its nearest instance.
+         */
+        void Add(uint64 group_key, uint32 prototype_idx, uint32 depth_bucket, const InstanceData& instance);
+
+        /**
+         * @brief Sorts the instances into groups, writes them contiguously to the instance buffer and adds one draw per group.
+         * @param instance_buffer Mapped instance buffer the vertex shader reads from.
+         * @param max_instances Capacity of instance_buffer. Instances that do not fit are dropped.
+         * @param draw_list Receives the batched draws.
+         */
+        void Build(InstanceData* instance_buffer, uint32 max_instances, DrawList& draw_list);
+
+        const InstanceBatcherStats& GetStats() const
+        {
+            return stats_;
+        }
+
+    private:
+        struct Prototype
+        {
+            DrawCommand command;
+            uint32 instance_offset_constant_idx = 0;
+        };
+
+        struct Instance
+        {
+            uint32 prototype_idx = 0;
+            uint32 depth_bucket = 0;
+            InstanceData data;
+        };
+
+        std::vector<Prototype> prototypes_;
+        std::vector<Instance> instances_;
+        std::vector<RadixSortEntry> sort_entries_;
+        std::vector<RadixSortEntry> sort_scratch_;
+        InstanceBatcherStats stats_;
+    };
+}
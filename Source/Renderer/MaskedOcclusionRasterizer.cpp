@@ -0,0 +1,476 @@
+#include "Renderer/MaskedOcclusionRasterizer.h"
+
+#include <chrono>
+
+#include "Core/JobSystem.h"
+#include "Core/SimdLanes.h"
+
+namespace gfx
+{
+    namespace
+    {
+        using namespace simd;
+        using Clock = std::chrono::high_resolution_clock;
+
+        // Top left pixel of each subtile relative to its tile, lanes in the same order as the Tile arrays
+        alignas(32) static constexpr float SUBTILE_OFFSET_X[8] = { 0.0f, 8.0f, 16.0f, 24.0f, 0.0f, 8.0f, 16.0f, 24.0f };
+        alignas(32) static constexpr float SUBTILE_OFFSET_Y[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 4.0f, 4.0f, 4.0f, 4.0f };
+
+        // Boxes and triangles with vertices this close to the eye are not projected
+        static inline constexpr float MIN_W = 1e-5f;
+
+        inline Vec4 TransformPoint(float x, float y, float z, const Mat4& m)
+        {
+            return Vec4(
+                x * m._11 + y * m._21 + z * m._31 + m._41,
+                x * m._12 + y * m._22 + z * m._32 + m._42,
+                x * m._13 + y * m._23 + z * m._33 + m._43,
+                x * m._14 + y * m._24 + z * m._34 + m._44);
+        }
+
+        inline Vec4 Lerp(const Vec4& a, const Vec4& b, float t)
+        {
+            return Vec4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+        }
+    }
+
+    void MaskedOcclusionRasterizer::Init(uint32 width, uint32 height)
+    {
+        CHECK(width > 0 && height > 0);
+        width_ = MathUtils::AlignToBytes(width, TILE_WIDTH);
+        height_ = MathUtils::AlignToBytes(height, TILE_HEIGHT);
+        num_tiles_x_ = width_ / TILE_WIDTH;
+        num_tiles_y_ = height_ / TILE_HEIGHT;
+
+        tiles_.resize(num_tiles_x_ * num_tiles_y_);
+        tile_max_z_.resize(tiles_.size());
+        tile_row_bins_.resize(num_tiles_y_);
+        BeginFrame(Mat4::IDENTITY);
+    }
+
+    void MaskedOcclusionRasterizer::BeginFrame(const Mat4& view_projection)
+    {
+        view_projection_ = view_projection;
+        for (Tile& tile : tiles_)
+        {
+            for (uint32 i = 0; i < NUM_SUBTILES; ++i)
+            {
+                tile.mask[i] = 0;
+                tile.z0[i] = 1.0f;
+                tile.z1[i] = 0.0f;
+            }
+        }
+        std::fill(tile_max_z_.begin(), tile_max_z_.end(), 1.0f);
+        stats_ = {};
+    }
+
+    void MaskedOcclusionRasterizer::RenderOccluders(std::span<const OccluderMesh> occluders)
+    {
+        CHECK(tiles_.empty() == false);
+        const auto start = Clock::now();
+
+        // Setup writes per occluder lists, so it needs no synchronization
+        const uint32 num_occluders = static_cast<uint32>(occluders.size());
+        if (occluder_triangles_.size() < num_occluders)
+        {
+            occluder_triangles_.resize(num_occluders);
+        }
+        jobs::ParallelFor(num_occluders, 4, [&](uint32 begin, uint32 end)
+        {
+            for (uint32 i = begin; i < end; ++i)
+            {
+                occluder_triangles_[i].clear();
+                SetupTriangles(occluders[i], occluder_triangles_[i]);
+            }
+        });
+
+        // Binning in occluder order keeps the rasterization order, and with it the result, deterministic
+        for (std::vector<const TriangleSetup*>& bin : tile_row_bins_)
+        {
+            bin.clear();
+        }
+        for (uint32 i = 0; i < num_occluders; ++i)
+        {
+            for (const TriangleSetup& triangle : occluder_triangles_[i])
+            {
+                for (uint32 tile_y = triangle.min_tile_y; tile_y <= triangle.max_tile_y; ++tile_y)
+                {
+                    tile_row_bins_[tile_y].push_back(&triangle);
+                }
+                stats_.num_binned_triangles += triangle.max_tile_y - triangle.min_tile_y + 1;
+            }
+            stats_.num_occluder_triangles += static_cast<uint32>(occluder_triangles_[i].size());
+        }
+
+        jobs::Dispatch(num_tiles_y_, [this](uint32 tile_y) { RasterizeTileRow(tile_y); });
+
+        stats_.rasterize_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    OcclusionResult MaskedOcclusionRasterizer::TestBox(const Box& world_box) const
+    {
+        float min_x = std::numeric_limits<float>::max();
+        float max_x = std::numeric_limits<float>::lowest();
+        float min_y = std::numeric_limits<float>::max();
+        float max_y = std::numeric_limits<float>::lowest();
+        float min_z = std::numeric_limits<float>::max();
+        for (uint32 i = 0; i < 8; ++i)
+        {
+            const Vec4 clip = TransformPoint(
+                (i & 1) ? world_box.max_x : world_box.min_x,
+                (i & 2) ? world_box.max_y : world_box.min_y,
+                (i & 4) ? world_box.max_z : world_box.min_z,
+                view_projection_);
+
+            // Boxes reaching through the near plane have no sensible screen rect, but they are too close to be hidden anyway
+            if (clip.w <= MIN_W || clip.z < 0.0f)
+            {
+                return OcclusionResult::VISIBLE;
+            }
+
+            const float inv_w = 1.0f / clip.w;
+            const float x = (clip.x * inv_w * 0.5f + 0.5f) * width_;
+            const float y = (0.5f - clip.y * inv_w * 0.5f) * height_;
+            min_x = std::min(min_x, x);
+            max_x = std::max(max_x, x);
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+            min_z = std::min(min_z, clip.z * inv_w);
+        }
+
+        if (max_x <= 0.0f || min_x >= static_cast<float>(width_) || max_y <= 0.0f || min_y >= static_cast<float>(height_) || min_z > 1.0f)
+        {
+            return OcclusionResult::VIEW_CULLED;
+        }
+
+        // Every pixel the screen rect touches, in whole pixels
+        const int32 pixel_min_x = std::max(0, static_cast<int32>(std::floor(min_x)));
+        const int32 pixel_max_x = std::min(static_cast<int32>(width_), static_cast<int32>(std::ceil(max_x)));
+        const int32 pixel_min_y = std::max(0, static_cast<int32>(std::floor(min_y)));
+        const int32 pixel_max_y = std::min(static_cast<int32>(height_), static_cast<int32>(std::ceil(max_y)));
+
+        const FloatLanes box_min_x = Splat(static_cast<float>(pixel_min_x));
+        const FloatLanes box_max_x = Splat(static_cast<float>(pixel_max_x));
+        const FloatLanes box_min_y = Splat(static_cast<float>(pixel_min_y));
+        const FloatLanes box_max_y = Splat(static_cast<float>(pixel_max_y));
+        const FloatLanes box_z = Splat(min_z);
+        const FloatLanes subtile_offset_x = Load(SUBTILE_OFFSET_X);
+        const FloatLanes subtile_offset_y = Load(SUBTILE_OFFSET_Y);
+        const FloatLanes subtile_width = Splat(static_cast<float>(SUBTILE_WIDTH));
+        const FloatLanes subtile_height = Splat(static_cast<float>(SUBTILE_HEIGHT));
+
+        const uint32 min_tile_x = pixel_min_x / TILE_WIDTH;
+        const uint32 max_tile_x = (pixel_max_x - 1) / TILE_WIDTH;
+        const uint32 min_tile_y = pixel_min_y / TILE_HEIGHT;
+        const uint32 max_tile_y = (pixel_max_y - 1) / TILE_HEIGHT;
+        for (uint32 tile_y = min_tile_y; tile_y <= max_tile_y; ++tile_y)
+        {
+            for (uint32 tile_x = min_tile_x; tile_x <= max_tile_x; ++tile_x)
+            {
+                const uint32 tile_idx = tile_y * num_tiles_x_ + tile_x;
+                if (tile_max_z_[tile_idx] < min_z)
+                {
+                    continue;   // Hidden behind every subtile of the tile
+                }
+
+                const FloatLanes subtile_x = Splat(static_cast<float>(tile_x * TILE_WIDTH)) + subtile_offset_x;
+                const FloatLanes subtile_y = Splat(static_cast<float>(tile_y * TILE_HEIGHT)) + subtile_offset_y;
+                const MaskLanes overlaps = (box_max_x > subtile_x) & (subtile_x + subtile_width > box_min_x)
+                    & (box_max_y > subtile_y) & (subtile_y + subtile_height > box_min_y);
+                const MaskLanes in_front = Load(tiles_[tile_idx].z0) >= box_z;
+                if (Any(overlaps & in_front))
+                {
+                    return OcclusionResult::VISIBLE;
+                }
+            }
+        }
+
+        return OcclusionResult::OCCLUDED;
+    }
+
+    void MaskedOcclusionRasterizer::TestBoxes(std::span<const Box> world_boxes, std::span<OcclusionResult> out_results)
+    {
+        CHECK(out_results.size() >= world_boxes.size());
+        const auto start = Clock::now();
+
+        const uint32 num_boxes = static_cast<uint32>(world_boxes.size());
+        jobs::ParallelFor(num_boxes, 256, [&](uint32 begin, uint32 end)
+        {
+            for (uint32 i = begin; i < end; ++i)
+            {
+                out_results[i] = TestBox(world_boxes[i]);
+            }
+        });
+
+        for (uint32 i = 0; i < num_boxes; ++i)
+        {
+            stats_.num_occluded += out_results[i] == OcclusionResult::OCCLUDED ? 1 : 0;
+            stats_.num_view_culled += out_results[i] == OcclusionResult::VIEW_CULLED ? 1 : 0;
+        }
+        stats_.num_tested += num_boxes;
+        stats_.test_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void MaskedOcclusionRasterizer::ReadDepth(std::vector<float>& out_depth) const
+    {
+        out_depth.resize(width_ * height_);
+        for (uint32 y = 0; y < height_; ++y)
+        {
+            for (uint32 x = 0; x < width_; ++x)
+            {
+                const Tile& tile = tiles_[(y / TILE_HEIGHT) * num_tiles_x_ + x / TILE_WIDTH];
+                const uint32 subtile_idx = (x % TILE_WIDTH) / SUBTILE_WIDTH + ((y % TILE_HEIGHT) / SUBTILE_HEIGHT) * (TILE_WIDTH / SUBTILE_WIDTH);
+                out_depth[y * width_ + x] = tile.z0[subtile_idx];
+            }
+        }
+    }
+
+    void MaskedOcclusionRasterizer::SetupTriangles(const OccluderMesh& occluder, std::vector<TriangleSetup>& out_triangles) const
+    {
+        CHECK(occluder.positions != nullptr && occluder.indices != nullptr);
+        CHECK(occluder.num_indices % 3 == 0);
+
+        thread_local std::vector<Vec4> clip_positions;
+        clip_positions.resize(occluder.num_vertices);
+
+        const Mat4 world_view_projection = occluder.world * view_projection_;
+        const uint8* position_bytes = static_cast<const uint8*>(occluder.positions);
+        for (uint32 i = 0; i < occluder.num_vertices; ++i)
+        {
+            const float* p = reinterpret_cast<const float*>(position_bytes + i * occluder.position_stride);
+            clip_positions[i] = TransformPoint(p[0], p[1], p[2], world_view_projection);
+        }
+
+        for (uint32 i = 0; i < occluder.num_indices; i += 3)
+        {
+            CHECK(occluder.indices[i] < occluder.num_vertices && occluder.indices[i + 1] < occluder.num_vertices && occluder.indices[i + 2] < occluder.num_vertices);
+            const Vec4 v[3] = { clip_positions[occluder.indices[i]], clip_positions[occluder.indices[i + 1]], clip_positions[occluder.indices[i + 2]] };
+
+            // Trivially outside one of the side or far planes
+            const bool is_outside = (v[0].x > v[0].w && v[1].x > v[1].w && v[2].x > v[2].w)
+                || (v[0].x < -v[0].w && v[1].x < -v[1].w && v[2].x < -v[2].w)
+                || (v[0].y > v[0].w && v[1].y > v[1].w && v[2].y > v[2].w)
+                || (v[0].y < -v[0].w && v[1].y < -v[1].w && v[2].y < -v[2].w)
+                || (v[0].z > v[0].w && v[1].z > v[1].w && v[2].z > v[2].w);
+            if (is_outside)
+            {
+                continue;
+            }
+
+            const uint32 num_in_front = (v[0].z >= 0.0f ? 1 : 0) + (v[1].z >= 0.0f ? 1 : 0) + (v[2].z >= 0.0f ? 1 : 0);
+            if (num_in_front == 0)
+            {
+                continue;
+            }
+            if (num_in_front == 3)
+            {
+                SetupTriangle(v[0], v[1], v[2], occluder.backface_culling, out_triangles);
+                continue;
+            }
+
+            // Clip against the near plane, which leaves a triangle or a quad with the same winding
+            Vec4 clipped[4];
+            uint32 num_clipped = 0;
+            for (uint32 j = 0; j < 3; ++j)
+            {
+                const Vec4& current = v[j];
+                const Vec4& next = v[(j + 1) % 3];
+                if (current.z >= 0.0f)
+                {
+                    clipped[num_clipped++] = current;
+                }
+                if ((current.z >= 0.0f) != (next.z >= 0.0f))
+                {
+                    clipped[num_clipped++] = Lerp(current, next, current.z / (current.z - next.z));
+                }
+            }
+
+            for (uint32 j = 2; j < num_clipped; ++j)
+            {
+                SetupTriangle(clipped[0], clipped[j - 1], clipped[j], occluder.backface_culling, out_triangles);
+            }
+        }
+    }
+
+    void MaskedOcclusionRasterizer::SetupTriangle(const Vec4& v0, const Vec4& v1, const Vec4& v2, bool backface_culling, std::vector<TriangleSetup>& out_triangles) const
+    {
+        if (v0.w <= MIN_W || v1.w <= MIN_W || v2.w <= MIN_W)
+        {
+            return;
+        }
+
+        // Screen space with y pointing down, so clockwise triangles have a positive area
+        Vec3 p[3];
+        const Vec4* clip[3] = { &v0, &v1, &v2 };
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            const float inv_w = 1.0f / clip[i]->w;
+            p[i] = Vec3(
+                (clip[i]->x * inv_w * 0.5f + 0.5f) * width_,
+                (0.5f - clip[i]->y * inv_w * 0.5f) * height_,
+                std::clamp(clip[i]->z * inv_w, 0.0f, 1.0f));
+        }
+
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+        if (area == 0.0f || (backface_culling && area < 0.0f))
+        {
+            return;
+        }
+        if (area < 0.0f)
+        {
+            std::swap(p[1], p[2]);
+            area = -area;
+        }
+
+        const float min_x = std::min({ p[0].x, p[1].x, p[2].x });
+        const float max_x = std::max({ p[0].x, p[1].x, p[2].x });
+        const float min_y = std::min({ p[0].y, p[1].y, p[2].y });
+        const float max_y = std::max({ p[0].y, p[1].y, p[2].y });
+        if (max_x <= 0.0f || min_x >= static_cast<float>(width_) || max_y <= 0.0f || min_y >= static_cast<float>(height_))
+        {
+            return;
+        }
+
+        TriangleSetup triangle;
+        triangle.min_tile_x = static_cast<uint32>(std::max(min_x, 0.0f)) / TILE_WIDTH;
+        triangle.max_tile_x = std::min(static_cast<uint32>(max_x), width_ - 1) / TILE_WIDTH;
+        triangle.min_tile_y = static_cast<uint32>(std::max(min_y, 0.0f)) / TILE_HEIGHT;
+        triangle.max_tile_y = std::min(static_cast<uint32>(max_y), height_ - 1) / TILE_HEIGHT;
+
+        // Edge functions a * x + b * y + c, non negative inside
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            const Vec3& a = p[i];
+            const Vec3& b = p[(i + 1) % 3];
+            triangle.edge_a[i] = a.y - b.y;
+            triangle.edge_b[i] = b.x - a.x;
+            triangle.edge_c[i] = -(triangle.edge_a[i] * a.x + triangle.edge_b[i] * a.y);
+        }
+
+        // Depth plane through the three vertices
+        const Vec3 d1(p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z);
+        const Vec3 d2(p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z);
+        const float inv_area = 1.0f / area;
+        triangle.z_a = (d1.z * d2.y - d2.z * d1.y) * inv_area;
+        triangle.z_b = (d2.z * d1.x - d1.z * d2.x) * inv_area;
+        triangle.z_c = p[0].z - triangle.z_a * p[0].x - triangle.z_b * p[0].y;
+        triangle.z_max = std::max({ p[0].z, p[1].z, p[2].z });
+
+        out_triangles.push_back(triangle);
+    }
+
+    void MaskedOcclusionRasterizer::RasterizeTileRow(uint32 tile_y)
+    {
+        for (const TriangleSetup* triangle : tile_row_bins_[tile_y])
+        {
+            for (uint32 tile_x = triangle->min_tile_x; tile_x <= triangle->max_tile_x; ++tile_x)
+            {
+                RasterizeTriangleInTile(*triangle, tile_x, tile_y);
+            }
+        }
+    }
+
+    void MaskedOcclusionRasterizer::RasterizeTriangleInTile(const TriangleSetup& triangle, uint32 tile_x, uint32 tile_y)
+    {
+        const float tile_min_x = static_cast<float>(tile_x * TILE_WIDTH);
+        const float tile_min_y = static_cast<float>(tile_y * TILE_HEIGHT);
+
+        // Skip tiles entirely outside one of the edges, which the bounding rect of long thin triangles is full of
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            const float x = triangle.edge_a[i] > 0.0f ? tile_min_x + TILE_WIDTH : tile_min_x;
+            const float y = triangle.edge_b[i] > 0.0f ? tile_min_y + TILE_HEIGHT : tile_min_y;
+            if (triangle.edge_a[i] * x + triangle.edge_b[i] * y + triangle.edge_c[i] < 0.0f)
+            {
+                return;
+            }
+        }
+
+        const FloatLanes subtile_x = Splat(tile_min_x) + Load(SUBTILE_OFFSET_X);
+        const FloatLanes subtile_y = Splat(tile_min_y) + Load(SUBTILE_OFFSET_Y);
+
+        // Coverage of all eight subtiles at once, stepping the edge functions over the 8x4 pixel centers
+        FloatLanes edge_a[3];
+        FloatLanes edge_b[3];
+        FloatLanes row_start[3];
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            edge_a[i] = Splat(triangle.edge_a[i]);
+            edge_b[i] = Splat(triangle.edge_b[i]);
+            row_start[i] = edge_a[i] * (subtile_x + Splat(0.5f)) + edge_b[i] * (subtile_y + Splat(0.5f)) + Splat(triangle.edge_c[i]);
+        }
+
+        const FloatLanes zero = Splat(0.0f);
+        MaskLanes coverage = SplatMask(0);
+        for (uint32 y = 0; y < SUBTILE_HEIGHT; ++y)
+        {
+            FloatLanes e0 = row_start[0];
+            FloatLanes e1 = row_start[1];
+            FloatLanes e2 = row_start[2];
+            for (uint32 x = 0; x < SUBTILE_WIDTH; ++x)
+            {
+                const MaskLanes inside = Min(Min(e0, e1), e2) >= zero;
+                coverage = coverage | (inside & SplatMask(1u << (x + y * SUBTILE_WIDTH)));
+                e0 = e0 + edge_a[0];
+                e1 = e1 + edge_a[1];
+                e2 = e2 + edge_a[2];
+            }
+            for (uint32 i = 0; i < 3; ++i)
+            {
+                row_start[i] = row_start[i] + edge_b[i];
+            }
+        }
+
+        const MaskLanes no_mask = SplatMask(0);
+        const MaskLanes is_covered = AndNot(coverage == no_mask, SplatMask(~0u));
+        if (Any(is_covered) == false)
+        {
+            return;
+        }
+
+        // Conservative triangle depth per subtile: the plane at the subtile corner furthest away, capped by the vertices
+        const float far_corner_x = std::max(triangle.z_a * SUBTILE_WIDTH, 0.0f);
+        const float far_corner_y = std::max(triangle.z_b * SUBTILE_HEIGHT, 0.0f);
+        const FloatLanes z_triangle = Min(Splat(triangle.z_a) * subtile_x + Splat(triangle.z_b) * subtile_y + Splat(triangle.z_c + far_corner_x + far_corner_y),
+            Splat(triangle.z_max));
+
+        Tile& tile = tiles_[tile_y * num_tiles_x_ + tile_x];
+        FloatLanes z0 = Load(tile.z0);
+        FloatLanes z1 = Load(tile.z1);
+        MaskLanes mask = LoadMask(tile.mask);
+
+        const MaskLanes is_alive = is_covered & (z_triangle < z0);
+        if (Any(is_alive) == false)
+        {
+            return;
+        }
+
+        // Merge heuristic: if the triangle is further from the working layer than from the reference layer,
+        // merging would push the working layer back for little gain, so it is dropped and started over
+        const FloatLanes distance_1 = Max(z_triangle - z1, z1 - z_triangle);
+        const FloatLanes distance_0 = z0 - z_triangle;
+        const MaskLanes discard = is_alive & (distance_1 > distance_0);
+        mask = Select(discard, no_mask, mask);
+        z1 = Select(discard, zero, z1);
+
+        mask = Select(is_alive, mask | coverage, mask);
+        z1 = Select(is_alive, Max(z1, z_triangle), z1);
+
+        // A full working layer becomes the new reference layer
+        const MaskLanes is_full = mask == SplatMask(~0u);
+        z0 = Select(is_full, Min(z0, z1), z0);
+        mask = Select(is_full, no_mask, mask);
+        z1 = Select(is_full, zero, z1);
+
+        Store(tile.z0, z0);
+        Store(tile.z1, z1);
+        StoreMask(tile.mask, mask);
+
+        float tile_max_z = tile.z0[0];
+        for (uint32 i = 1; i < NUM_SUBTILES; ++i)
+        {
+            tile_max_z = std::max(tile_max_z, tile.z0[i]);
+        }
+        tile_max_z_[tile_y * num_tiles_x_ + tile_x] = tile_max_z;
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <span>
+
+namespace gfx
+{
+    struct OccluderMesh
+    {
+        const void* positions = nullptr;        // Object space, x y z as the first three floats of each vertex
+        uint32 position_stride = sizeof(Vec3);
+        uint32 num_vertices = 0;
+        const uint32* indices = nullptr;
+        uint32 num_indices = 0;
+        Mat4 world = Mat4::IDENTITY;
+        bool backface_culling = true;           // Clockwise front faces, same as the default rasterizer state
+    };
+
+    enum class OcclusionResult : uint8
+    {
+        VISIBLE,
+        OCCLUDED,
+        VIEW_CULLED     // Entirely outside the screen
+    };
+
+    struct OcclusionStats
+    {
+        uint32 num_occluder_triangles = 0;      // After clipping and backface culling
+        uint32 num_binned_triangles = 0;        // Triangle / tile row pairs
+        double rasterize_ms = 0.0;
+        double test_ms = 0.0;
+        uint32 num_tested = 0;
+        uint32 num_occluded = 0;
+        uint32 num_view_culled = 0;
+    };
+
+    /**
+     * @brief CPU rasterizer for occluders into a low resolution hierarchical depth buffer, queried with bounding boxes.
+     * The buffer is split into 32x8 pixel tiles of eight 8x4 subtiles, which are processed as one SIMD register
+     * (AVX2 if available, two SSE registers otherwise). Instead of per pixel depth, each subtile keeps a coverage mask
+     * and two depth layers like masked software occlusion culling: layer 0 is a conservative max depth of the whole
+     * subtile, layer 1 is merged from triangles until their coverage fills the subtile and it replaces layer 0.
+     * A per tile max of layer 0 forms the next hierarchy level, so most box tests never touch subtiles.
+     * Occluders are set up in parallel, binned by tile row and each row is rasterized by one job, so the result
+     * does not depend on the number of threads.
+     */
+    class MaskedOcclusionRasterizer
+    {
+    public:
+        static inline constexpr uint32 TILE_WIDTH = 32;
+        static inline constexpr uint32 TILE_HEIGHT = 8;
+        static inline constexpr uint32 SUBTILE_WIDTH = 8;
+        static inline constexpr uint32 SUBTILE_HEIGHT = 4;
+        static inline constexpr uint32 NUM_SUBTILES = (TILE_WIDTH / SUBTILE_WIDTH) * (TILE_HEIGHT / SUBTILE_HEIGHT);
+
+        /**
+         * @brief Allocates the depth buffer. Sizes are rounded up to whole tiles.
+         * Low resolutions like 512x256 are plenty, the buffer only needs to resolve occluder silhouettes.
+         */
+        void Init(uint32 width, uint32 height);
+
+        /**
+         * @brief Clears the depth buffer and sets the view projection used by all following calls, e.g. Camera::GetViewProjection().
+         */
+        void BeginFrame(const Mat4& view_projection);
+
+        void RenderOccluders(std::span<const OccluderMesh> occluders);
+
+        OcclusionResult TestBox(const Box& world_box) const;
+
+        /**
+         * @brief Tests boxes in parallel.
+         * @param out_results One entry per box
+         */
+        void TestBoxes(std::span<const Box> world_boxes, std::span<OcclusionResult> out_results);
+
+        uint32 GetWidth() const
+        {
+            return width_;
+        }
+
+        uint32 GetHeight() const
+        {
+            return height_;
+        }
+
+        const OcclusionStats& GetStats() const
+        {
+            return stats_;
+        }
+
+        /**
+         * @brief Resolves the conservative depth of every pixel, i.e. layer 0 of its subtile. For debugging.
+         */
+        void ReadDepth(std::vector<float>& out_depth) const;
+
+    private:
+        struct alignas(32) Tile
+        {
+            uint32 mask[NUM_SUBTILES];  // Layer 1 coverage, bit x + y * SUBTILE_WIDTH
+            float z0[NUM_SUBTILES];     // Every pixel of the subtile has an occluder at this depth or closer
+            float z1[NUM_SUBTILES];     // Max depth of the triangles merged into the mask so far
+        };
+
+        struct TriangleSetup
+        {
+            float edge_a[3];
+            float edge_b[3];
+            float edge_c[3];
+            float z_a = 0.0f;
+            float z_b = 0.0f;
+            float z_c = 0.0f;
+            float z_max = 0.0f;
+            uint32 min_tile_x = 0;
+            uint32 max_tile_x = 0;
+            uint32 min_tile_y = 0;
+            uint32 max_tile_y = 0;
+        };
+
+        void SetupTriangles(const OccluderMesh& occluder, std::vector<TriangleSetup>& out_triangles) const;
+        void SetupTriangle(const Vec4& v0, const Vec4& v1, const Vec4& v2, bool backface_culling, std::vector<TriangleSetup>& out_triangles) const;
+        void RasterizeTileRow(uint32 tile_y);
+        void RasterizeTriangleInTile(const TriangleSetup& triangle, uint32 tile_x, uint32 tile_y);
+
+        uint32 width_ = 0;
+        uint32 height_ = 0;
+        uint32 num_tiles_x_ = 0;
+        uint32 num_tiles_y_ = 0;
+        Mat4 view_projection_ = Mat4::IDENTITY;
+
+        std::vector<Tile> tiles_;
+        std::vector<float> tile_max_z_;     // Max of z0 over the tile's subtiles
+
+        std::vector<std::vector<TriangleSetup>> occluder_triangles_;   // Per occluder, reused across frames
+        std::vector<std::vector<const TriangleSetup*>> tile_row_bins_;
+
+        OcclusionStats stats_;
+    };
+}
@@ -0,0 +1,101 @@
+#include "Renderer/OcclusionBenchmark.h"
+
+#include <random>
+
+#include "Renderer/Camera.h"
+#include "Renderer/MaskedOcclusionRasterizer.h"
+#include "Renderer/Mesh.h"
+
+namespace gfx
+{
+    namespace
+    {
+        static inline constexpr uint32 DEPTH_BUFFER_WIDTH = 512;
+        static inline constexpr uint32 DEPTH_BUFFER_HEIGHT = 256;
+
+        // Grid of buildings in front of the camera, streets every fourth row and column
+        static inline constexpr int32 NUM_BLOCKS_X = 13;
+        static inline constexpr int32 NUM_BLOCKS_Z = 10;
+        static inline constexpr float BLOCK_SPACING = 12.0f;
+        static inline constexpr float BUILDING_HALF_EXTENT = 4.5f;
+    }
+
+    void RunOcclusionBenchmark(uint32 num_occludees, uint32 num_iterations)
+    {
+        CHECK(num_iterations > 0);
+        std::mt19937 rng(1337);
+
+        Camera camera(Vec3(0.0f, 1.7f, 0.0f), 16.0f / 9.0f, Camera::DEFAULT_FOV, 0.1f, 500.0f);
+        camera.LookAt(Vec3(0.0f, 1.7f, 1.0f));
+        camera.UpdateMatrices();
+
+        // Occluders are the cube mesh scaled into buildings, plus a ground slab everything below the street hides behind
+        std::vector<OccluderMesh> occluders;
+        OccluderMesh cube;
+        cube.positions = CubeMeshData::POS.data();
+        cube.position_stride = sizeof(Vec4);
+        cube.num_vertices = static_cast<uint32>(CubeMeshData::POS.size());
+        cube.indices = CubeMeshData::INDICES.data();
+        cube.num_indices = static_cast<uint32>(CubeMeshData::INDICES.size());
+
+        std::uniform_real_distribution<float> building_height(4.0f, 20.0f);
+        for (int32 z = 0; z < NUM_BLOCKS_Z; ++z)
+        {
+            for (int32 x = -NUM_BLOCKS_X / 2; x <= NUM_BLOCKS_X / 2; ++x)
+            {
+                if (x % 4 == 0 || z % 4 == 3)
+                {
+                    continue;
+                }
+                const float half_height = building_height(rng) * 0.5f;
+                cube.world = Mat4::Scaling(BUILDING_HALF_EXTENT, half_height, BUILDING_HALF_EXTENT)
+                    * Mat4::Translation(x * BLOCK_SPACING, half_height, 10.0f + z * BLOCK_SPACING);
+                occluders.push_back(cube);
+            }
+        }
+        cube.world = Mat4::Scaling(200.0f, 0.5f, 200.0f) * Mat4::Translation(0.0f, -0.5f, 100.0f);
+        occluders.push_back(cube);
+
+        // Occludees are small props scattered through and beyond the city, some below the street
+        const float city_half_width = (NUM_BLOCKS_X / 2 + 0.5f) * BLOCK_SPACING;
+        const float city_depth = 10.0f + NUM_BLOCKS_Z * BLOCK_SPACING;
+        std::uniform_real_distribution<float> occludee_x(-city_half_width, city_half_width);
+        std::uniform_real_distribution<float> occludee_y(-2.0f, 12.0f);
+        std::uniform_real_distribution<float> occludee_z(2.0f, city_depth);
+        std::uniform_real_distribution<float> occludee_extent(0.25f, 1.5f);
+        std::vector<Box> occludees;
+        occludees.reserve(num_occludees);
+        for (uint32 i = 0; i < num_occludees; ++i)
+        {
+            const float x = occludee_x(rng);
+            const float y = occludee_y(rng);
+            const float z = occludee_z(rng);
+            const float extent = occludee_extent(rng);
+            occludees.emplace_back(x - extent, x + extent, y - extent, y + extent, z - extent, z + extent);
+        }
+
+        MaskedOcclusionRasterizer rasterizer;
+        rasterizer.Init(DEPTH_BUFFER_WIDTH, DEPTH_BUFFER_HEIGHT);
+        std::vector<OcclusionResult> results(occludees.size());
+
+        double total_rasterize_ms = 0.0;
+        double total_test_ms = 0.0;
+        for (uint32 i = 0; i < num_iterations; ++i)
+        {
+            rasterizer.BeginFrame(camera.GetViewProjection());
+            rasterizer.RenderOccluders(occluders);
+            rasterizer.TestBoxes(occludees, results);
+            total_rasterize_ms += rasterizer.GetStats().rasterize_ms;
+            total_test_ms += rasterizer.GetStats().test_ms;
+        }
+
+        const OcclusionStats& stats = rasterizer.GetStats();
+        LOG("Occlusion benchmark: {} occluders ({} triangles), {} occludees at {}x{}, {} iterations",
+            occluders.size(), stats.num_occluder_triangles, occludees.size(), rasterizer.GetWidth(), rasterizer.GetHeight(), num_iterations);
+        LOG("Rasterize {:.3f} ms, test {:.3f} ms per iteration",
+            total_rasterize_ms / num_iterations, total_test_ms / num_iterations);
+        LOG("Occluded {} ({:.1f}%), view culled {} ({:.1f}%)",
+            stats.num_occluded, 100.0 * stats.num_occluded / stats.num_tested,
+            stats.num_view_culled, 100.0 * stats.num_view_culled / stats.num_tested);
+    }
+}
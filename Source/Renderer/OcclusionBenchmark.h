@@ -0,0 +1,11 @@
+#pragma once
+
+namespace gfx
+{
+    /**
+     * @brief Renders a city block of building occluders into a MaskedOcclusionRasterizer and tests randomly placed
+     * boxes against it, logging setup + rasterization time, test time and how many boxes were culled.
+     * Runs without a window or device. Expects the job system to be initialized.
+     */
+    void RunOcclusionBenchmark(uint32 num_occludees = 100000, uint32 num_iterations = 32);
+}
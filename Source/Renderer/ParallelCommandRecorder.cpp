@@ -0,0 +1,97 @@
+#include "Renderer/ParallelCommandRecorder.h"
+
+#include "Core/JobSystem.h"
+
+namespace gfx
+{
+    void ParallelCommandRecorder::Init(const ComPtr<ID3D12CommandQueue>& queue, CommandListPool& pool)
+    {
+        CHECK(queue != nullptr);
+        CHECK(queue->GetDesc().Type == pool.GetType());
+        queue_ = queue;
+        pool_ = &pool;
+    }
+
+    void ParallelCommandRecorder::Shutdown()
+    {
+        CHECK_MSG(submission_order_.empty(), "Recorded lists have not been submitted");
+        queue_.Reset();
+        pool_ = nullptr;
+    }
+
+    ID3D12GraphicsCommandList* ParallelCommandRecorder::AcquireList()
+    {
+        CloseOpenList();
+        submission_order_.push_back({ .pooled = pool_->Acquire() });
+        is_list_open_ = true;
+        return submission_order_.back().pooled.command_list.Get();
+    }
+
+    void ParallelCommandRecorder::RecordParallel(uint32 count, uint32 min_batch_size, const RecordFunction& record_fn)
+    {
+        CloseOpenList();
+        if (count == 0)
+        {
+            return;
+        }
+
+        const uint32 batch_size = GetBatchSize(count, min_batch_size);
+        const uint32 num_batches = (count + batch_size - 1) / batch_size;
+
+        batch_lists_.resize(num_batches);
+        jobs::Dispatch(num_batches, [&](uint32 batch_idx)
+        {
+            const uint32 begin = batch_idx * batch_size;
+            const uint32 end = std::min(begin + batch_size, count);
+
+            RecordedList& batch = batch_lists_[batch_idx];
+            batch.pooled = pool_->Acquire(end - begin);
+            batch.num_items = end - begin;
+            record_fn(batch.pooled.command_list.Get(), begin, end);
+            DX_VERIFY(batch.pooled.command_list->Close());
+        });
+
+        std::move(batch_lists_.begin(), batch_lists_.end(), std::back_inserter(submission_order_));
+        batch_lists_.clear();
+    }
+
+    uint32 ParallelCommandRecorder::GetBatchSize(uint32 count, uint32 min_batch_size)
+    {
+        const uint32 num_threads = jobs::GetNumThreads();
+        return std::max({ 1u, min_batch_size, (count + num_threads - 1) / num_threads });
+    }
+
+    void ParallelCommandRecorder::Submit()
+    {
+        CloseOpenList();
+        num_submitted_lists_ = static_cast<uint32>(submission_order_.size());
+        if (submission_order_.empty())
+        {
+            return;
+        }
+
+        submitted_lists_.clear();
+        for (const RecordedList& recorded : submission_order_)
+        {
+            submitted_lists_.push_back(recorded.pooled.command_list.Get());
+        }
+        queue_->ExecuteCommandLists(num_submitted_lists_, submitted_lists_.data());
+
+        // The lists are done once the signal following this submission completed
+        const uint64 fence_value = pool_->GetFence().GetNextValue();
+        for (RecordedList& recorded : submission_order_)
+        {
+            pool_->Release(std::move(recorded.pooled), fence_value, recorded.num_items);
+        }
+        submission_order_.clear();
+    }
+
+    void ParallelCommandRecorder::CloseOpenList()
+    {
+        if (is_list_open_)
+        {
+            DX_VERIFY(submission_order_.back().pooled.command_list->Close());
+            is_list_open_ = false;
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "Renderer/CommandListPool.h"
+#include "Renderer/DXUtils.h"
+
+namespace gfx
+{
+    /**
+     * @brief Hands out command lists for a frame and records work on them across the job system's threads.
+     * Lists come from a CommandListPool, which recycles allocators once the queue timeline passed their submission.
+     * All lists of a frame are submitted with a single ExecuteCommandLists, in the order they were acquired,
+     * independent of which thread recorded them.
+     */
+    class ParallelCommandRecorder
+    {
+    public:
+        using RecordFunction = std::function<void(ID3D12GraphicsCommandList* command_list, uint32 begin, uint32 end)>;
+
+        /**
+         * @param queue The queue lists are submitted to. Has to match the pool's list type.
+         * @param pool Source of the lists. Its timeline's next signal has to follow Submit().
+         */
+        void Init(const ComPtr<ID3D12CommandQueue>& queue, CommandListPool& pool);
+        void Shutdown();
+
+        /**
+         * @brief Opens a list on the calling thread and appends it to the submission order.
+         * It stays open until the next call to AcquireList(), RecordParallel() or Submit().
+         */
+        ID3D12GraphicsCommandList* AcquireList();
+
+        /**
+         * @brief Splits [0, count) into batches and records each batch on its own list, in parallel.
+         * Lists are appended to the submission order by batch index, so the result is deterministic.
+         * Lists start without any bound state, record_fn has to set up everything it relies on.
+         * @param min_batch_size Minimum number of items per list. Small batches cost more in list overhead than they save.
+         */
+        void RecordParallel(uint32 count, uint32 min_batch_size, const RecordFunction& record_fn);
+
+        /**
+         * @brief Items per list RecordParallel() uses: the range spread evenly over all job system threads, at least min_batch_size.
+         */
+        static uint32 GetBatchSize(uint32 count, uint32 min_batch_size);
+
+        /**
+         * @brief Closes all lists, submits them in order with a single ExecuteCommandLists and returns them to the pool.
+         */
+        void Submit();
+
+        // Lists recorded during the last submitted frame
+        uint32 GetNumSubmittedLists() const
+        {
+            return num_submitted_lists_;
+        }
+
+    private:
+        struct RecordedList
+        {
+            PooledCommandList pooled;
+            uint32 num_items = 0;   // Passed to the pool as used size
+        };
+
+        void CloseOpenList();
+
+        ComPtr<ID3D12CommandQueue> queue_;
+        CommandListPool* pool_ = nullptr;
+
+        std::vector<RecordedList> submission_order_;
+        std::vector<RecordedList> batch_lists_;
+        std::vector<ID3D12CommandList*> submitted_lists_;
+        bool is_list_open_ = false;     // Last entry of submission_order_ is open
+        uint32 num_submitted_lists_ = 0;
+    };
+}
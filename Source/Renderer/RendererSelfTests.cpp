@@ -0,0 +1,437 @@
+#include "Renderer/RendererSelfTests.h"
+
+#include <random>
+
+#include "Core/SelfTest.h"
+#include "Renderer/AsyncComputeScheduler.h"
+#include "Renderer/CommandContext.h"
+#include "Renderer/DescriptorViewCache.h"
+#include "Renderer/GPUTimestamps.h"
+#include "Renderer/MaskedOcclusionRasterizer.h"
+#include "Renderer/Mesh.h"
+#include "Renderer/StagingDescriptorHeap.h"
+
+namespace gfx
+{
+    bool RunGPUProfilerSelfTest()
+    {
+        SelfTest test("GPU profiler self test");
+
+        // Queries in the order the profiler allocates them: frame begin, Scene begin, Opaque begin, Opaque end, Scene end, frame end
+        const std::array<TimestampMarker, 2> markers = { {
+            { .name = "Scene", .depth = 0, .begin_query = 1, .end_query = 4 },
+            { .name = "Opaque", .depth = 1, .begin_query = 2, .end_query = 3 } } };
+        static constexpr uint32 NUM_QUERIES = 6;
+
+        // Hand-made ticks at 1 MHz, a 4 ms frame recorded once in 3 ms and once in 5 ms of CPU time
+        {
+            GPUTimingHistory history;
+            const std::array<uint64, NUM_QUERIES> ticks = { 1000, 1500, 2000, 2500, 3500, 5000 };
+            history.AddFrame(0, markers, ticks, 1'000'000, 3.0);
+            history.AddFrame(1, markers, ticks, 1'000'000, 5.0);
+
+            const FrameTimings& frame = history.GetFrames().front();
+            test.Expect(IsNear(frame.gpu_frame_ms, 4.0), "the frame to span the first to the last timestamp");
+            test.Expect(frame.passes.size() == 2 && frame.passes[0].name == "Scene" && frame.passes[1].depth == 1, "passes in marker order with their depth");
+            test.Expect(IsNear(frame.passes[0].duration_ms, 2.0) && IsNear(frame.passes[1].duration_ms, 0.5), "pass durations from their begin and end queries");
+            test.Expect(frame.is_gpu_bound && history.GetFrames().back().is_gpu_bound == false, "GPU bound only while the GPU took longer than the CPU");
+            test.Expect(IsNear(history.GetGPUBoundRatio(), 0.5), "half of the frames to be GPU bound");
+            test.Expect(IsNear(history.GetAverageCPUFrameMs(), 4.0) && IsNear(history.GetAverageGPUFrameMs(1), 4.0), "CPU and GPU frame averages");
+            test.Expect(IsNear(history.GetAveragePassMs("Opaque"), 0.5) && history.GetAveragePassMs("Shadows") == 0.0, "pass averages, 0 for passes which never ran");
+        }
+
+        // Synthetic timestamps, read back a frame later like the profiler does, alternating between GPU and CPU bound frames
+        {
+            static constexpr double MEAN_INTERVAL_MS = 0.25;
+            static constexpr uint32 NUM_FRAMES = GPUTimingHistory::HISTORY_SIZE + 64;
+            static constexpr uint32 NUM_FRAMES_IN_FLIGHT = 2;
+
+            NullTimestampBackend backend(MEAN_INTERVAL_MS, 1337);
+            backend.Init(NUM_QUERIES);
+            GPUTimingHistory history;
+            std::array<uint64, NUM_QUERIES> ticks = {};
+            bool all_ordered = true;
+            for (uint32 frame_idx = 0; frame_idx < NUM_FRAMES; ++frame_idx)
+            {
+                const uint32 slot = frame_idx % NUM_FRAMES_IN_FLIGHT;
+                if (frame_idx >= NUM_FRAMES_IN_FLIGHT)
+                {
+                    backend.ReadTimestamps(slot, NUM_QUERIES, ticks.data());
+                    const uint64 recorded_frame_idx = frame_idx - NUM_FRAMES_IN_FLIGHT;
+                    const double cpu_frame_ms = recorded_frame_idx % 2 == 0 ? 0.0 : 1000.0;
+                    history.AddFrame(recorded_frame_idx, markers, ticks, backend.GetFrequency(), cpu_frame_ms);
+
+                    const FrameTimings& frame = history.GetFrames().back();
+                    all_ordered &= frame.passes[1].duration_ms > 0.0 && frame.passes[1].duration_ms < frame.passes[0].duration_ms
+                        && frame.passes[0].duration_ms < frame.gpu_frame_ms;
+                }
+
+                for (uint32 query_idx = 0; query_idx < NUM_QUERIES; ++query_idx)
+                {
+                    backend.WriteTimestamp(nullptr, slot, query_idx);
+                }
+                backend.Resolve(nullptr, slot, NUM_QUERIES);
+            }
+
+            // Five intervals per frame, each within [0.5, 1.5) of the mean
+            const double average_gpu_frame_ms = history.GetAverageGPUFrameMs();
+            test.Expect(all_ordered, "nested passes to be shorter than their parent and the frame");
+            test.Expect(history.GetFrames().size() == GPUTimingHistory::HISTORY_SIZE, "the history to be capped");
+            test.Expect(history.GetFrames().back().frame_idx == NUM_FRAMES - NUM_FRAMES_IN_FLIGHT - 1
+                && history.GetFrames().front().frame_idx == NUM_FRAMES - NUM_FRAMES_IN_FLIGHT - GPUTimingHistory::HISTORY_SIZE, "the oldest frames to be dropped");
+            test.Expect(IsNear(history.GetGPUBoundRatio(), 0.5), "alternating frames to be GPU bound");
+            test.Expect(average_gpu_frame_ms >= 2.5 * MEAN_INTERVAL_MS && average_gpu_frame_ms < 7.5 * MEAN_INTERVAL_MS, "the average GPU frame to be about five intervals");
+            history.LogReport();
+        }
+
+        return test.Finish();
+    }
+
+    bool RunCommandContextSelfTest()
+    {
+        SelfTest test("Command context self test");
+        RecordingCommandList command_list;
+        RecordingCommandContext context;
+        context.Begin(&command_list);
+
+        // Only compared, never dereferenced
+        ID3D12RootSignature* root_signature_a = reinterpret_cast<ID3D12RootSignature*>(0x100);
+        ID3D12RootSignature* root_signature_b = reinterpret_cast<ID3D12RootSignature*>(0x200);
+        ID3D12PipelineState* pso_a = reinterpret_cast<ID3D12PipelineState*>(0x300);
+        ID3D12PipelineState* pso_b = reinterpret_cast<ID3D12PipelineState*>(0x400);
+        const D3D12_INDEX_BUFFER_VIEW index_buffer_view = { .BufferLocation = 0x10000, .SizeInBytes = 72, .Format = DXGI_FORMAT_R16_UINT };
+        const D3D12_VIEWPORT viewport = { .TopLeftX = 0.0f, .TopLeftY = 0.0f, .Width = 1280.0f, .Height = 720.0f, .MinDepth = 0.0f, .MaxDepth = 1.0f };
+        const D3D12_RECT scissor_rect = { .left = 0, .top = 0, .right = 1280, .bottom = 720 };
+
+        // The same state for every draw only reaches the command list once
+        static constexpr uint32 NUM_DRAWS = 100;
+        for (uint32 i = 0; i < NUM_DRAWS; ++i)
+        {
+            context.SetPipelineState(pso_a);
+            context.SetGraphicsRootSignature(root_signature_a);
+            context.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            context.IASetIndexBuffer(&index_buffer_view);
+            context.RSSetViewport(viewport);
+            context.RSSetScissorRect(scissor_rect);
+            context.DrawIndexedInstanced(36, 1, 0, 0, 0);
+        }
+        const CommandContextStats& stats = context.GetStats();
+        bool is_filtered = true;
+        for (const StateCall call : { StateCall::PIPELINE_STATE, StateCall::ROOT_SIGNATURE, StateCall::PRIMITIVE_TOPOLOGY, StateCall::INDEX_BUFFER, StateCall::VIEWPORT, StateCall::SCISSOR_RECT })
+        {
+            is_filtered &= stats.num_issued[static_cast<size_t>(call)] == 1 && stats.num_filtered[static_cast<size_t>(call)] == NUM_DRAWS - 1;
+        }
+        test.Expect(is_filtered, "repeated state to be issued once and filtered afterwards");
+        test.Expect(command_list.GetCalls().size() == 6 + NUM_DRAWS, "only the first state calls and every draw to reach the command list");
+
+        // Root constants upload the changed subrange only
+        auto set_constants = [&](std::initializer_list<uint32> values, uint32 dest_offset)
+        {
+            const size_t num_calls = command_list.GetCalls().size();
+            context.SetGraphicsRoot32BitConstants(0, static_cast<uint32>(values.size()), values.begin(), dest_offset);
+            return command_list.GetCalls().size() > num_calls ? command_list.GetCalls().back() : RecordingCommandList::RecordedCall{};
+        };
+        auto is_upload = [](const RecordingCommandList::RecordedCall& call, uint32 num_values, uint32 dest_offset)
+        {
+            return call.call == StateCall::ROOT_CONSTANTS && call.num_values == num_values && call.dest_offset == dest_offset;
+        };
+        test.Expect(is_upload(set_constants({ 1, 2, 3, 4 }, 0), 4, 0), "new root constants to be uploaded in full");
+        test.Expect(set_constants({ 1, 2, 3, 4 }, 0).call == StateCall::COUNT, "identical root constants to be filtered");
+        test.Expect(set_constants({ 2, 3 }, 1).call == StateCall::COUNT, "an identical subrange to be filtered");
+        test.Expect(is_upload(set_constants({ 1, 2, 7, 4 }, 0), 1, 2), "a single changed value to be uploaded alone");
+        test.Expect(is_upload(set_constants({ 1, 5, 7, 6 }, 0), 3, 1), "the range between the first and last changed value to be uploaded");
+        test.Expect(is_upload(set_constants({ 9, 9 }, 4), 2, 4), "values past the bound ones to be uploaded");
+
+        // Switching the PSO keeps root arguments, switching the root signature drops them
+        context.SetPipelineState(pso_b);
+        test.Expect(command_list.GetCalls().back().call == StateCall::PIPELINE_STATE, "a new PSO to be issued");
+        test.Expect(set_constants({ 1, 5, 7, 6 }, 0).call == StateCall::COUNT, "root constants to survive a PSO change");
+        context.SetGraphicsRootSignature(root_signature_a);
+        test.Expect(set_constants({ 1, 5, 7, 6 }, 0).call == StateCall::COUNT, "re-setting the bound root signature to keep root constants");
+        context.SetGraphicsRootSignature(root_signature_b);
+        test.Expect(command_list.GetCalls().back().call == StateCall::ROOT_SIGNATURE, "a new root signature to be issued");
+        test.Expect(is_upload(set_constants({ 1, 5, 7, 6 }, 0), 4, 0), "root constants to be uploaded again after a root signature change");
+        context.SetPipelineState(pso_a);
+        test.Expect(command_list.GetCalls().back().call == StateCall::PIPELINE_STATE, "switching back to a previous PSO to be issued");
+
+        // Invalidate() forgets everything
+        context.Invalidate();
+        const size_t num_calls_before_invalidate = command_list.GetCalls().size();
+        context.SetPipelineState(pso_a);
+        context.SetGraphicsRootSignature(root_signature_b);
+        context.IASetIndexBuffer(&index_buffer_view);
+        context.RSSetViewport(viewport);
+        set_constants({ 1, 5, 7, 6 }, 0);
+        test.Expect(command_list.GetCalls().size() == num_calls_before_invalidate + 5, "all state to be issued again after Invalidate()");
+
+        // The stats count exactly what reached the command list
+        bool stats_match = true;
+        for (uint32 call_idx = 0; call_idx < static_cast<uint32>(StateCall::COUNT); ++call_idx)
+        {
+            stats_match &= stats.num_issued[call_idx] == command_list.GetNumCalls(static_cast<StateCall>(call_idx));
+        }
+        test.Expect(stats_match, "issued counts to match the recorded calls");
+        LOG("Command context self test: {} state calls issued, {} filtered", stats.GetTotalIssued(), stats.GetTotalFiltered());
+
+        return test.Finish();
+    }
+
+    bool RunAsyncComputeSelfTest()
+    {
+        SelfTest test("Async compute self test");
+        AsyncComputeScheduler scheduler;
+        NullQueueBackend backend;
+
+        auto simulate = [&](bool allow_async)
+        {
+            scheduler.Compile(allow_async);
+            backend.Reset();
+            scheduler.Execute(backend);
+            return backend.Evaluate(scheduler.GetPasses());
+        };
+
+        // SSAO on async compute overlaps with shadows, which hides 2 of the 6 ms
+        {
+            const PassHandle depth = scheduler.AddPass({ .name = "Depth", .estimated_cost_ms = 1.0 });
+            const PassHandle ssao = scheduler.AddPass({ .name = "SSAO", .queue = PassQueue::ASYNC_COMPUTE, .dependencies = { depth }, .estimated_cost_ms = 2.0 });
+            scheduler.AddPass({ .name = "Shadows", .estimated_cost_ms = 2.0 });
+            scheduler.AddPass({ .name = "Lighting", .dependencies = { ssao }, .estimated_cost_ms = 1.0 });
+
+            const SimulatedTimeline timeline = simulate(true);
+            test.Expect(timeline.num_dependency_violations == 0 && timeline.num_invalid_waits == 0, "a valid schedule for the hand-made frame");
+            test.Expect(IsNear(timeline.serial_ms, 6.0) && IsNear(timeline.makespan_ms, 4.0), "SSAO to overlap with shadows");
+            test.Expect(scheduler.GetStats().num_async_passes == 1 && scheduler.GetStats().num_waits == 2, "one wait for the depth and one for SSAO");
+
+            const SimulatedTimeline serialized = simulate(false);
+            test.Expect(IsNear(serialized.makespan_ms, 6.0) && scheduler.GetStats().num_waits == 0, "Compile(false) to serialize on graphics");
+        }
+
+        // Random DAGs in a valid topological order, both queues and a varying number of dependencies
+        static constexpr uint32 NUM_GRAPHS = 1000;
+        static constexpr uint32 MAX_PASSES = 32;
+        static constexpr uint32 MAX_DEPENDENCIES = 3;
+        std::mt19937 rng(1337);
+        std::uniform_int_distribution<uint32> num_passes_distribution(1, MAX_PASSES);
+        std::uniform_int_distribution<uint32> num_dependencies_distribution(0, MAX_DEPENDENCIES);
+        std::uniform_real_distribution<double> cost_distribution(0.05, 2.0);
+        std::bernoulli_distribution async_distribution(0.4);
+
+        uint32 num_violations = 0;
+        uint32 num_invalid_waits = 0;
+        uint32 num_slower = 0;
+        uint32 num_unjoined = 0;
+        double total_serial_ms = 0.0;
+        double total_async_makespan_ms = 0.0;
+        double max_overlap_ratio = 0.0;
+        for (uint32 graph_idx = 0; graph_idx < NUM_GRAPHS; ++graph_idx)
+        {
+            scheduler.Reset();
+            const uint32 num_passes = num_passes_distribution(rng);
+            for (PassHandle pass = 0; pass < num_passes; ++pass)
+            {
+                PassDesc desc = { .name = "Random", .queue = async_distribution(rng) ? PassQueue::ASYNC_COMPUTE : PassQueue::GRAPHICS, .estimated_cost_ms = cost_distribution(rng) };
+                const uint32 num_dependencies = pass > 0 ? std::min(num_dependencies_distribution(rng), pass) : 0;
+                for (uint32 i = 0; i < num_dependencies; ++i)
+                {
+                    desc.dependencies.push_back(std::uniform_int_distribution<PassHandle>(0, pass - 1)(rng));
+                }
+                scheduler.AddPass(std::move(desc));
+            }
+
+            const SimulatedTimeline serialized = simulate(false);
+            const SimulatedTimeline timeline = simulate(true);
+            num_violations += serialized.num_dependency_violations + timeline.num_dependency_violations;
+            num_invalid_waits += serialized.num_invalid_waits + timeline.num_invalid_waits;
+            num_slower += timeline.makespan_ms > serialized.makespan_ms + 1e-9 ? 1 : 0;
+            num_unjoined += scheduler.GetSegments().back().queue != PassQueue::GRAPHICS ? 1 : 0;
+
+            total_serial_ms += timeline.serial_ms;
+            total_async_makespan_ms += timeline.makespan_ms;
+            max_overlap_ratio = std::max(max_overlap_ratio, timeline.overlap_ms / timeline.serial_ms);
+        }
+
+        test.Expect(num_violations == 0, "no pass to start before its dependencies finished");
+        test.Expect(num_invalid_waits == 0, "every wait to refer to a signaled value");
+        test.Expect(num_slower == 0, "async compute to never lengthen the simulated frame");
+        test.Expect(num_unjoined == 0, "async compute to be joined back into graphics");
+        LOG("Async compute self test: {} random graphs, {:.1f} ms serial vs. {:.1f} ms with async compute ({:.1f}% overlap on average, {:.1f}% max)",
+            NUM_GRAPHS, total_serial_ms, total_async_makespan_ms, 100.0 * (1.0 - total_async_makespan_ms / total_serial_ms), 100.0 * max_overlap_ratio);
+
+        return test.Finish();
+    }
+
+    bool RunDescriptorSelfTest()
+    {
+        SelfTest test("Descriptor self test");
+
+        // Staging copies, coalesced into as few ranges as possible
+        {
+            std::vector<DescriptorCopy> copies;
+            std::vector<DescriptorRange> destination_ranges;
+            std::vector<DescriptorRange> source_ranges;
+            auto is_range = [](const DescriptorRange& range, uint32 first_idx, uint32 num_descriptors)
+            {
+                return range.first_idx == first_idx && range.num_descriptors == num_descriptors;
+            };
+
+            copies = { { 3, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 } };
+            uint32 num_descriptors = StagingDescriptorHeap::CoalesceCopies(copies, destination_ranges, source_ranges);
+            test.Expect(num_descriptors == 4 && destination_ranges.size() == 1 && is_range(destination_ranges[0], 0, 4)
+                && source_ranges.size() == 1 && is_range(source_ranges[0], 4, 4), "unordered contiguous copies to become a single range");
+
+            copies = { { 0, 4 }, { 2, 5 }, { 3, 6 } };
+            num_descriptors = StagingDescriptorHeap::CoalesceCopies(copies, destination_ranges, source_ranges);
+            test.Expect(num_descriptors == 3 && destination_ranges.size() == 2 && is_range(destination_ranges[1], 2, 2)
+                && source_ranges.size() == 1 && is_range(source_ranges[0], 4, 3), "destination and source runs to be coalesced independently");
+
+            copies = { { 0, 4 }, { 1, 5 }, { 1, 9 }, { 2, 6 } };
+            num_descriptors = StagingDescriptorHeap::CoalesceCopies(copies, destination_ranges, source_ranges);
+            test.Expect(num_descriptors == 3 && destination_ranges.size() == 1 && is_range(destination_ranges[0], 0, 3)
+                && source_ranges.size() == 3 && is_range(source_ranges[1], 9, 1), "the last copy to a slot to win");
+
+            // Random copies expanded from their ranges have to write what was queued last to every slot
+            static constexpr uint32 NUM_ROUNDS = 100;
+            static constexpr uint32 NUM_SLOTS = 64;
+            std::mt19937 rng(1337);
+            std::uniform_int_distribution<uint32> slot(0, NUM_SLOTS - 1);
+            bool all_match = true;
+            for (uint32 round = 0; round < NUM_ROUNDS; ++round)
+            {
+                std::array<uint32, NUM_SLOTS> expected_sources;
+                expected_sources.fill(~0u);
+                copies.clear();
+                for (uint32 i = 0; i < NUM_SLOTS; ++i)
+                {
+                    const DescriptorCopy copy = { .destination_idx = slot(rng), .source_idx = round % 2 == 0 ? slot(rng) : i };
+                    copies.push_back(copy);
+                    expected_sources[copy.destination_idx] = copy.source_idx;
+                }
+                num_descriptors = StagingDescriptorHeap::CoalesceCopies(copies, destination_ranges, source_ranges);
+
+                std::array<uint32, NUM_SLOTS> copied_sources;
+                copied_sources.fill(~0u);
+                size_t source_range_idx = 0;
+                uint32 source_offset = 0;
+                uint32 num_copied = 0;
+                for (const DescriptorRange& range : destination_ranges)
+                {
+                    for (uint32 i = 0; i < range.num_descriptors && source_range_idx < source_ranges.size(); ++i)
+                    {
+                        copied_sources[range.first_idx + i] = source_ranges[source_range_idx].first_idx + source_offset;
+                        ++num_copied;
+                        if (++source_offset == source_ranges[source_range_idx].num_descriptors)
+                        {
+                            ++source_range_idx;
+                            source_offset = 0;
+                        }
+                    }
+                }
+                all_match &= copied_sources == expected_sources && num_copied == num_descriptors && source_range_idx == source_ranges.size();
+            }
+            test.Expect(all_match, "random copies to write the last queued source to every slot");
+        }
+
+        // View cache on a backend without a device. Null views, so the cache holds no resources.
+        {
+            auto backend_owner = MakeUnique<NullDescriptorViewBackend>();
+            NullDescriptorViewBackend& backend = *backend_owner;
+            DescriptorViewCache view_cache;
+            view_cache.Init(std::move(backend_owner));
+
+            D3D12_CONSTANT_BUFFER_VIEW_DESC cbv_desc_a = {};
+            cbv_desc_a.BufferLocation = 0x10000;
+            cbv_desc_a.SizeInBytes = 256;
+            D3D12_CONSTANT_BUFFER_VIEW_DESC cbv_desc_b = cbv_desc_a;
+            cbv_desc_b.BufferLocation = 0x20000;
+            D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+            srv_desc.Format = DXGI_FORMAT_R32_UINT;
+            srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+            srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+            const uint32 cbv_a = view_cache.AcquireCBV(cbv_desc_a);
+            const uint32 cbv_a_again = view_cache.AcquireCBV(cbv_desc_a);
+            const uint32 cbv_b = view_cache.AcquireCBV(cbv_desc_b);
+            const uint32 srv = view_cache.AcquireSRV(nullptr, &srv_desc);
+            srv_desc.Format = DXGI_FORMAT_R16_UINT;
+            const uint32 srv_other_format = view_cache.AcquireSRV(nullptr, &srv_desc);
+            DescriptorViewCacheStats stats = view_cache.GetStats();
+            test.Expect(cbv_a == cbv_a_again && backend.GetNumCreatedViews() == 4, "an identical view to be created once");
+            test.Expect(cbv_b != cbv_a && srv != cbv_a && srv != srv_other_format, "differing descriptions to get their own slots");
+            test.Expect(stats.num_hits == 1 && stats.num_misses == 4 && stats.num_views == 4 && stats.num_references == 5, "hits, misses and references to be counted");
+
+            // The view only goes with its last reference and its slot only once the frame is done
+            view_cache.Release(cbv_a);
+            test.Expect(view_cache.GetStats().num_views == 4 && backend.GetNumDeferredFrees() == 0, "a view to outlive all but its last reference");
+            view_cache.Release(cbv_a_again);
+            stats = view_cache.GetStats();
+            test.Expect(stats.num_views == 3 && stats.num_references == 3 && backend.GetNumDeferredFrees() == 1 && backend.GetNumAllocatedSlots() == 4,
+                "the last reference to defer freeing the slot");
+
+            const uint32 cbv_a_recreated = view_cache.AcquireCBV(cbv_desc_a);
+            test.Expect(cbv_a_recreated != cbv_a && backend.GetNumCreatedViews() == 5, "a released view to be created again in a fresh slot");
+            backend.FlushDeferredFrees();
+            test.Expect(backend.GetNumAllocatedSlots() == 4 && view_cache.AcquireCBV(cbv_desc_b) == cbv_b, "live views to survive the deferred free");
+            srv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+            test.Expect(view_cache.AcquireSRV(nullptr, &srv_desc) == cbv_a, "the freed slot to be reused once the frame is done");
+
+            view_cache.Shutdown();
+        }
+
+        return test.Finish();
+    }
+
+    bool RunOcclusionSelfTest()
+    {
+        SelfTest test("Occlusion self test");
+
+        // Camera at the origin looking down +z, a 10x10 wall 10 units in front of it
+        const Mat4 view_projection = Mat4::PerspectiveFovLH(MathUtils::DegToRad(90.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+        OccluderMesh wall;
+        wall.positions = CubeMeshData::POS.data();
+        wall.position_stride = sizeof(Vec4);
+        wall.num_vertices = static_cast<uint32>(CubeMeshData::POS.size());
+        wall.indices = CubeMeshData::INDICES.data();
+        wall.num_indices = static_cast<uint32>(CubeMeshData::INDICES.size());
+        wall.world = Mat4::Scaling(5.0f, 5.0f, 0.5f) * Mat4::Translation(0.0f, 0.0f, 10.0f);
+
+        const Box hidden(-1.0f, 1.0f, -1.0f, 1.0f, 19.0f, 21.0f);
+        const Box in_front(-1.0f, 1.0f, -1.0f, 1.0f, 4.0f, 6.0f);
+        const Box beside(14.0f, 16.0f, -1.0f, 1.0f, 19.0f, 21.0f);
+        const Box straddling(9.0f, 11.0f, -1.0f, 1.0f, 19.0f, 21.0f);
+        const Box larger(-12.0f, 12.0f, -12.0f, 12.0f, 19.0f, 21.0f);
+        const Box off_screen(-200.0f, -190.0f, -1.0f, 1.0f, 19.0f, 21.0f);
+
+        MaskedOcclusionRasterizer rasterizer;
+        rasterizer.Init(512, 256);
+        rasterizer.BeginFrame(view_projection);
+        test.Expect(rasterizer.TestBox(hidden) == OcclusionResult::VISIBLE, "nothing to be occluded without occluders");
+
+        rasterizer.RenderOccluders(std::span(&wall, 1));
+        test.Expect(rasterizer.GetStats().num_occluder_triangles > 0, "the wall to be rasterized");
+        test.Expect(rasterizer.TestBox(hidden) == OcclusionResult::OCCLUDED, "a box behind the wall to be occluded");
+        test.Expect(rasterizer.TestBox(in_front) == OcclusionResult::VISIBLE, "a box in front of the wall to be visible");
+        test.Expect(rasterizer.TestBox(beside) == OcclusionResult::VISIBLE, "a box beside the wall to be visible");
+        test.Expect(rasterizer.TestBox(straddling) == OcclusionResult::VISIBLE, "a box straddling the wall's silhouette to be visible");
+        test.Expect(rasterizer.TestBox(larger) == OcclusionResult::VISIBLE, "a box larger than the wall to be visible");
+        test.Expect(rasterizer.TestBox(off_screen) == OcclusionResult::VIEW_CULLED, "a box off screen to be view culled");
+
+        // The parallel path has to agree with the single box tests
+        const std::array<Box, 6> boxes = { hidden, in_front, beside, straddling, larger, off_screen };
+        std::array<OcclusionResult, boxes.size()> results;
+        rasterizer.TestBoxes(boxes, results);
+        bool results_match = true;
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            results_match &= results[i] == rasterizer.TestBox(boxes[i]);
+        }
+        test.Expect(results_match, "TestBoxes() to match TestBox()");
+        test.Expect(rasterizer.GetStats().num_occluded == 1 && rasterizer.GetStats().num_view_culled == 1, "the stats to count the batch");
+
+#if defined(__AVX2__)
+        LOG("Occlusion self test: 8 wide AVX2 lanes");
+#else
+        LOG("Occlusion self test: 8 lanes as two SSE2 registers");
+#endif
+        return test.Finish();
+    }
+}
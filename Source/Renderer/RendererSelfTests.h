@@ -0,0 +1,40 @@
+#pragma once
+
+namespace gfx
+{
+    /**
+     * @brief Feeds hand-made and NullTimestampBackend timestamps into a GPUTimingHistory and checks pass durations,
+     * nesting, the GPU / CPU bound classification and the history size limit.
+     * Runs without a window or device, like all self tests. Failures are logged, not asserted, so release builds report them too.
+     * @return True if every check passed.
+     */
+    bool RunGPUProfilerSelfTest();
+
+    /**
+     * @brief Drives a RecordingCommandContext and checks which calls the state filter lets through: issued vs. filtered
+     * counts, uploading only the changed root constant subrange and invalidation when the root signature or PSO changes.
+     * @return True if every check passed.
+     */
+    bool RunCommandContextSelfTest();
+
+    /**
+     * @brief Compiles random pass DAGs with and without async compute, executes them on a NullQueueBackend and checks
+     * that no pass starts before its dependencies finished and every wait has been signaled. Logs the simulated overlap.
+     * @return True if every check passed.
+     */
+    bool RunAsyncComputeSelfTest();
+
+    /**
+     * @brief Checks how staging descriptor copies coalesce into CopyDescriptors ranges, and view cache hits, reference counts
+     * and deferred frees on a NullDescriptorViewBackend.
+     * @return True if every check passed.
+     */
+    bool RunDescriptorSelfTest();
+
+    /**
+     * @brief Renders a wall into a MaskedOcclusionRasterizer and checks boxes with a known result against it: hidden behind the wall,
+     * in front of it, beside it, straddling its silhouette and off screen. Expects the job system to be initialized.
+     * @return True if every check passed.
+     */
+    bool RunOcclusionSelfTest();
+}
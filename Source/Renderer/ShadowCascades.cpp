@@ -0,0 +1,169 @@
+#include "Renderer/ShadowCascades.h"
+
+#include <atomic>
+#include <chrono>
+
+#include "Core/JobSystem.h"
+#include "Renderer/Camera.h"
+#include "Scene/Scene.h"
+
+namespace gfx
+{
+    namespace
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        // Rotation of a row vector by the upper 3x3 of m
+        inline Vec3 RotateVector(const Vec3& v, const Mat4& m)
+        {
+            return Vec3(
+                v.x * m._11 + v.y * m._21 + v.z * m._31,
+                v.x * m._12 + v.y * m._22 + v.z * m._32,
+                v.x * m._13 + v.y * m._23 + v.z * m._33);
+        }
+    }
+
+    void ShadowCascades::Init(uint32 num_cascades, uint32 resolution, float max_distance, float split_lambda, float caster_distance)
+    {
+        CHECK(num_cascades > 0 && num_cascades <= MAX_SHADOW_CASCADES);
+        CHECK(resolution > 0 && max_distance > 0.0f && split_lambda >= 0.0f && split_lambda <= 1.0f && caster_distance >= 0.0f);
+        num_cascades_ = num_cascades;
+        resolution_ = resolution;
+        max_distance_ = max_distance;
+        split_lambda_ = split_lambda;
+        caster_distance_ = caster_distance;
+    }
+
+    void ShadowCascades::Update(Camera& camera, const Vec3& light_direction)
+    {
+        CHECK(num_cascades_ > 0);
+        const float near_clip = camera.GetNearClip();
+        const float far_clip = std::min(camera.GetFarClip(), max_distance_);
+        const float tan_half_fov_y = std::tan(camera.GetFov() * 0.5f);
+        const float tan_half_fov_x = tan_half_fov_y * camera.GetAspectRatio();
+        const float corner_slope_sq = tan_half_fov_x * tan_half_fov_x + tan_half_fov_y * tan_half_fov_y;
+        const Affine3x4 camera_to_world = Affine3x4(camera.GetView()).InverseAffine();
+
+        // Only the rotation, so cascades snap in a frame that doesn't move with the camera
+        const Vec3& up = std::abs(light_direction.y) > 0.99f ? Vec3::FORWARD : Vec3::UP;
+        light_view_ = Mat4::LookAt(Vec3::ZERO, light_direction, up);
+
+        float split_near = near_clip;
+        for (uint32 cascade_idx = 0; cascade_idx < num_cascades_; ++cascade_idx)
+        {
+            const float split_fraction = static_cast<float>(cascade_idx + 1) / num_cascades_;
+            const float log_split = near_clip * std::pow(far_clip / near_clip, split_fraction);
+            const float uniform_split = near_clip + (far_clip - near_clip) * split_fraction;
+            const float split_far = uniform_split + (log_split - uniform_split) * split_lambda_;
+
+            // Smallest sphere around the slice with its center on the view axis. Its radius doesn't change when the
+            // camera turns, so neither does the texel size. Rounded so float noise can't change it either.
+            const float center_z = std::min(0.5f * (split_near + split_far) * (1.0f + corner_slope_sq), split_far);
+            float radius = std::sqrt(split_far * split_far * corner_slope_sq + (split_far - center_z) * (split_far - center_z));
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+            const float texel_size = 2.0f * radius / resolution_;
+
+            // Moving the center in whole texels keeps every texel's world footprint fixed
+            const Vec3 light_center = camera_to_world.TransformPoint(Vec3(0.0f, 0.0f, center_z)) * light_view_;
+            const float center_x = std::floor(light_center.x / texel_size) * texel_size;
+            const float center_y = std::floor(light_center.y / texel_size) * texel_size;
+            const float near_z = light_center.z - radius - caster_distance_;
+            const float far_z = light_center.z + radius;
+
+            ShadowCascade& cascade = cascades_[cascade_idx];
+            cascade.view_projection = light_view_ * Mat4::OrthographicLH(center_x - radius, center_x + radius, center_y - radius, center_y + radius, near_z, far_z);
+            cascade.split_near = split_near;
+            cascade.split_far = split_far;
+            cascade.texel_size = texel_size;
+
+            // Casters only matter where they can shadow the slice itself, which is tighter than the sphere's square
+            CasterVolume& volume = caster_volumes_[cascade_idx];
+            volume = {
+                .min_x = std::numeric_limits<float>::max(),
+                .min_y = std::numeric_limits<float>::max(),
+                .max_x = std::numeric_limits<float>::lowest(),
+                .max_y = std::numeric_limits<float>::lowest(),
+                .min_z = near_z,
+                .max_z = std::numeric_limits<float>::lowest()
+            };
+            for (const float depth : { split_near, split_far })
+            {
+                for (const float sign_x : { -1.0f, 1.0f })
+                {
+                    for (const float sign_y : { -1.0f, 1.0f })
+                    {
+                        const Vec3 view_corner(sign_x * depth * tan_half_fov_x, sign_y * depth * tan_half_fov_y, depth);
+                        const Vec3 light_corner = camera_to_world.TransformPoint(view_corner) * light_view_;
+                        volume.min_x = std::min(volume.min_x, light_corner.x);
+                        volume.min_y = std::min(volume.min_y, light_corner.y);
+                        volume.max_x = std::max(volume.max_x, light_corner.x);
+                        volume.max_y = std::max(volume.max_y, light_corner.y);
+                        volume.max_z = std::max(volume.max_z, light_corner.z);
+                    }
+                }
+            }
+            volume.min_x = std::max(volume.min_x, center_x - radius);
+            volume.min_y = std::max(volume.min_y, center_y - radius);
+            volume.max_x = std::min(volume.max_x, center_x + radius);
+            volume.max_y = std::min(volume.max_y, center_y + radius);
+
+            split_near = split_far;
+        }
+    }
+
+    void ShadowCascades::CullCasters(std::span<const Box> world_bounds, std::span<const uint32> flags, std::vector<uint8>& out_cascade_masks)
+    {
+        CHECK(world_bounds.size() == flags.size());
+        const auto start = Clock::now();
+        const uint32 num_objects = static_cast<uint32>(world_bounds.size());
+        out_cascade_masks.resize(num_objects);
+
+        std::array<std::atomic<uint32>, MAX_SHADOW_CASCADES> num_casters = {};
+        jobs::ParallelFor(num_objects, MIN_OBJECTS_PER_JOB, [&](uint32 begin, uint32 end)
+        {
+            std::array<uint32, MAX_SHADOW_CASCADES> num_batch_casters = {};
+            for (uint32 i = begin; i < end; ++i)
+            {
+                if ((flags[i] & EntityFlags::CAST_SHADOWS) == 0)
+                {
+                    out_cascade_masks[i] = 0;
+                    continue;
+                }
+
+                // To light space once for all cascades, as center and extents (Arvo)
+                const Box& box = world_bounds[i];
+                const Vec3 center = RotateVector(Vec3((box.min_x + box.max_x) * 0.5f, (box.min_y + box.max_y) * 0.5f, (box.min_z + box.max_z) * 0.5f), light_view_);
+                const float extent_x = (box.max_x - box.min_x) * 0.5f;
+                const float extent_y = (box.max_y - box.min_y) * 0.5f;
+                const float extent_z = (box.max_z - box.min_z) * 0.5f;
+                const float light_extent_x = extent_x * std::abs(light_view_._11) + extent_y * std::abs(light_view_._21) + extent_z * std::abs(light_view_._31);
+                const float light_extent_y = extent_x * std::abs(light_view_._12) + extent_y * std::abs(light_view_._22) + extent_z * std::abs(light_view_._32);
+                const float light_extent_z = extent_x * std::abs(light_view_._13) + extent_y * std::abs(light_view_._23) + extent_z * std::abs(light_view_._33);
+
+                uint8 mask = 0;
+                for (uint32 cascade_idx = 0; cascade_idx < num_cascades_; ++cascade_idx)
+                {
+                    const CasterVolume& volume = caster_volumes_[cascade_idx];
+                    const bool is_caster = center.x + light_extent_x >= volume.min_x && center.x - light_extent_x <= volume.max_x
+                        && center.y + light_extent_y >= volume.min_y && center.y - light_extent_y <= volume.max_y
+                        && center.z + light_extent_z >= volume.min_z && center.z - light_extent_z <= volume.max_z;
+                    mask |= static_cast<uint8>(is_caster) << cascade_idx;
+                    num_batch_casters[cascade_idx] += is_caster ? 1 : 0;
+                }
+                out_cascade_masks[i] = mask;
+            }
+
+            for (uint32 cascade_idx = 0; cascade_idx < num_cascades_; ++cascade_idx)
+            {
+                num_casters[cascade_idx] += num_batch_casters[cascade_idx];
+            }
+        });
+
+        stats_.num_objects = num_objects;
+        for (uint32 cascade_idx = 0; cascade_idx < MAX_SHADOW_CASCADES; ++cascade_idx)
+        {
+            stats_.num_casters[cascade_idx] = num_casters[cascade_idx];
+        }
+        stats_.cull_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
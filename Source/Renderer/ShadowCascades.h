@@ -0,0 +1,94 @@
+#pragma once
+#include <span>
+
+class Camera;
+
+namespace gfx
+{
+    static inline constexpr uint32 MAX_SHADOW_CASCADES = 4;
+
+    struct ShadowCascade
+    {
+        Mat4 view_projection;       // World to the cascade's shadow map, D3D depth range
+        float split_near = 0.0f;    // View depth range the cascade covers
+        float split_far = 0.0f;
+        float texel_size = 0.0f;    // World units per shadow map texel
+    };
+
+    struct ShadowCascadesStats
+    {
+        std::array<uint32, MAX_SHADOW_CASCADES> num_casters = {};     // Per cascade, of the last CullCasters()
+        uint32 num_objects = 0;
+        double cull_ms = 0.0;
+    };
+
+    /**
+     * @brief Cascaded shadow maps for a directional light. The view frustum up to the shadow distance is split with the
+     * practical split scheme, a blend of logarithmic and uniform splits (Zhang et al.). Each cascade covers its slice's
+     * bounding sphere with an orthographic projection snapped to whole shadow map texels, so the shadow edges don't
+     * shimmer while the camera moves or turns.
+     * Casters are culled for all cascades in one pass, each object getting a bit per cascade it may cast into.
+     */
+    class ShadowCascades
+    {
+    public:
+        /**
+         * @param split_lambda 0 is uniform, 1 is logarithmic, the latter resolving more detail close to the camera.
+         * @param caster_distance How far casters in front of a cascade, towards the light, are still rendered.
+         */
+        void Init(uint32 num_cascades = MAX_SHADOW_CASCADES, uint32 resolution = 2048, float max_distance = 200.0f, float split_lambda = 0.75f, float caster_distance = 100.0f);
+
+        /**
+         * @param light_direction Direction the light travels in, normalized
+         */
+        void Update(Camera& camera, const Vec3& light_direction);
+
+        /**
+         * @brief One pass over all objects. Bit c of out_cascade_masks[i] is set if object i casts shadows and its world
+         * bounds may cast onto what cascade c sees. Objects without EntityFlags::CAST_SHADOWS get 0.
+         */
+        void CullCasters(std::span<const Box> world_bounds, std::span<const uint32> flags, std::vector<uint8>& out_cascade_masks);
+
+        uint32 GetNumCascades() const
+        {
+            return num_cascades_;
+        }
+
+        const ShadowCascade& GetCascade(uint32 cascade_idx) const
+        {
+            CHECK(cascade_idx < num_cascades_);
+            return cascades_[cascade_idx];
+        }
+
+        const ShadowCascadesStats& GetStats() const
+        {
+            return stats_;
+        }
+
+    private:
+        static inline constexpr uint32 MIN_OBJECTS_PER_JOB = 4096;
+
+        // Light space rectangle and depth range where casters affect a cascade's receivers
+        struct CasterVolume
+        {
+            float min_x = 0.0f;
+            float min_y = 0.0f;
+            float max_x = 0.0f;
+            float max_y = 0.0f;
+            float min_z = 0.0f;
+            float max_z = 0.0f;
+        };
+
+        uint32 num_cascades_ = 0;
+        uint32 resolution_ = 0;
+        float max_distance_ = 0.0f;
+        float split_lambda_ = 0.0f;
+        float caster_distance_ = 0.0f;
+
+        Mat4 light_view_;   // Rotation only, shared by all cascades
+        std::array<ShadowCascade, MAX_SHADOW_CASCADES> cascades_;
+        std::array<CasterVolume, MAX_SHADOW_CASCADES> caster_volumes_;
+
+        ShadowCascadesStats stats_;
+    };
+}
@@ -0,0 +1,183 @@
+#include "Renderer/StagingDescriptorHeap.h"
+
+#include "Renderer/GraphicsContext.h"
+
+namespace gfx
+{
+    void StagingDescriptorHeap::Init(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32 capacity, const wchar_t* name)
+    {
+        CHECK(gfx::device != nullptr);
+        CHECK(capacity > 0);
+
+        D3D12_DESCRIPTOR_HEAP_DESC descriptor_heap_desc = {};
+        descriptor_heap_desc.NumDescriptors = capacity;
+        descriptor_heap_desc.Type = type;
+        descriptor_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;   // CopyDescriptors can only read from CPU only heaps
+        DX_VERIFY(gfx::device->CreateDescriptorHeap(&descriptor_heap_desc, IID_PPV_ARGS(&heap_)));
+        heap_->SetName(name);
+
+        type_ = type;
+        heap_start_ = heap_->GetCPUDescriptorHandleForHeapStart();
+        descriptor_size_ = gfx::device->GetDescriptorHandleIncrementSize(type);
+        capacity_ = capacity;
+
+        free_indices_.resize(capacity);
+        for (uint32 i = 0; i < capacity; ++i)
+        {
+            free_indices_[i] = capacity - 1 - i;
+        }
+    }
+
+    void StagingDescriptorHeap::Shutdown()
+    {
+        std::scoped_lock lock(mutex_);
+        pending_copies_.clear();    // Their destination heaps are gone by now
+        free_indices_.clear();
+        stats_ = {};
+        heap_.Reset();
+        capacity_ = 0;
+    }
+
+    uint32 StagingDescriptorHeap::Allocate()
+    {
+        std::scoped_lock lock(mutex_);
+        CHECK_MSG(free_indices_.empty() == false, "Staging descriptor heap is full ({} descriptors)", capacity_);
+        const uint32 idx = free_indices_.back();
+        free_indices_.pop_back();
+        ++stats_.num_allocated;
+        return idx;
+    }
+
+    void StagingDescriptorHeap::Free(uint32 idx)
+    {
+        std::scoped_lock lock(mutex_);
+        CHECK(idx < capacity_);
+        std::erase_if(pending_copies_, [idx](const PendingCopy& copy) { return copy.source_idx == idx; });
+        stats_.num_pending_copies = static_cast<uint32>(pending_copies_.size());
+        free_indices_.push_back(idx);
+        --stats_.num_allocated;
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE StagingDescriptorHeap::GetCPUHandle(uint32 idx) const
+    {
+        CHECK(idx < capacity_);
+        return GetDescriptorByIdx(heap_start_, idx, descriptor_size_);
+    }
+
+    void StagingDescriptorHeap::QueueCopy(uint32 source_idx, ID3D12DescriptorHeap* destination_heap, uint32 destination_idx)
+    {
+        CHECK(source_idx < capacity_);
+        CHECK(destination_heap != nullptr);
+
+        std::scoped_lock lock(mutex_);
+        pending_copies_.push_back({ .destination_heap = destination_heap, .destination_idx = destination_idx, .source_idx = source_idx });
+        stats_.num_pending_copies = static_cast<uint32>(pending_copies_.size());
+    }
+
+    uint32 StagingDescriptorHeap::Flush(ID3D12DescriptorHeap* destination_heap)
+    {
+        CHECK(destination_heap != nullptr);
+
+        std::scoped_lock lock(mutex_);
+
+        // Pull out the heap's copies, keeping queue order so the last copy to a slot can win
+        const auto flushed_it = std::stable_partition(pending_copies_.begin(), pending_copies_.end(),
+            [destination_heap](const PendingCopy& copy) { return copy.destination_heap != destination_heap; });
+        flush_copies_.clear();
+        for (auto copy_it = flushed_it; copy_it != pending_copies_.end(); ++copy_it)
+        {
+            flush_copies_.push_back({ .destination_idx = copy_it->destination_idx, .source_idx = copy_it->source_idx });
+        }
+        pending_copies_.erase(flushed_it, pending_copies_.end());
+        stats_.num_pending_copies = static_cast<uint32>(pending_copies_.size());
+
+        if (flush_copies_.empty())
+        {
+            return 0;
+        }
+
+        const uint32 num_descriptors = CoalesceCopies(flush_copies_, destination_ranges_, source_ranges_);
+
+        destination_range_starts_.clear();
+        destination_range_sizes_.clear();
+        source_range_starts_.clear();
+        source_range_sizes_.clear();
+
+        const D3D12_CPU_DESCRIPTOR_HANDLE destination_start = destination_heap->GetCPUDescriptorHandleForHeapStart();
+        for (const DescriptorRange& range : destination_ranges_)
+        {
+            destination_range_starts_.push_back(GetDescriptorByIdx(destination_start, range.first_idx, descriptor_size_));
+            destination_range_sizes_.push_back(range.num_descriptors);
+        }
+        for (const DescriptorRange& range : source_ranges_)
+        {
+            source_range_starts_.push_back(GetCPUHandle(range.first_idx));
+            source_range_sizes_.push_back(range.num_descriptors);
+        }
+
+        gfx::device->CopyDescriptors(
+            static_cast<uint32>(destination_range_starts_.size()), destination_range_starts_.data(), destination_range_sizes_.data(),
+            static_cast<uint32>(source_range_starts_.size()), source_range_starts_.data(), source_range_sizes_.data(),
+            type_);
+
+        stats_.total_flushed_descriptors += num_descriptors;
+        stats_.last_flush_descriptors = num_descriptors;
+        stats_.last_flush_destination_ranges = static_cast<uint32>(destination_range_starts_.size());
+        stats_.last_flush_source_ranges = static_cast<uint32>(source_range_starts_.size());
+        return num_descriptors;
+    }
+
+    StagingDescriptorHeapStats StagingDescriptorHeap::GetStats() const
+    {
+        std::scoped_lock lock(mutex_);
+        return stats_;
+    }
+
+    uint32 StagingDescriptorHeap::CoalesceCopies(std::vector<DescriptorCopy>& in_out_copies, std::vector<DescriptorRange>& out_destination_ranges,
+        std::vector<DescriptorRange>& out_source_ranges)
+    {
+        std::stable_sort(in_out_copies.begin(), in_out_copies.end(),
+            [](const DescriptorCopy& a, const DescriptorCopy& b) { return a.destination_idx < b.destination_idx; });
+
+        // Destination and source ranges are coalesced independently, CopyDescriptors only needs their total sizes to match
+        out_destination_ranges.clear();
+        out_source_ranges.clear();
+
+        uint32 num_descriptors = 0;
+        uint32 last_destination_idx = 0;
+        uint32 last_source_idx = 0;
+        for (size_t i = 0; i < in_out_copies.size(); ++i)
+        {
+            const DescriptorCopy& copy = in_out_copies[i];
+            const bool is_overwritten = i + 1 < in_out_copies.size() && in_out_copies[i + 1].destination_idx == copy.destination_idx;
+            if (is_overwritten)
+            {
+                continue;
+            }
+
+            if (num_descriptors > 0 && copy.destination_idx == last_destination_idx + 1)
+            {
+                ++out_destination_ranges.back().num_descriptors;
+            }
+            else
+            {
+                out_destination_ranges.push_back({ .first_idx = copy.destination_idx, .num_descriptors = 1 });
+            }
+
+            if (num_descriptors > 0 && copy.source_idx == last_source_idx + 1)
+            {
+                ++out_source_ranges.back().num_descriptors;
+            }
+            else
+            {
+                out_source_ranges.push_back({ .first_idx = copy.source_idx, .num_descriptors = 1 });
+            }
+
+            last_destination_idx = copy.destination_idx;
+            last_source_idx = copy.source_idx;
+            ++num_descriptors;
+        }
+
+        return num_descriptors;
+    }
+}
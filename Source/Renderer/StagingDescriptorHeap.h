@@ -0,0 +1,105 @@
+#pragma once
+#include <mutex>
+
+#include "Renderer/DXUtils.h"
+
+namespace gfx
+{
+    struct StagingDescriptorHeapStats
+    {
+        uint32 num_allocated = 0;
+        uint32 num_pending_copies = 0;
+        uint64 total_flushed_descriptors = 0;
+        uint32 last_flush_descriptors = 0;
+        uint32 last_flush_destination_ranges = 0;
+        uint32 last_flush_source_ranges = 0;
+    };
+
+    struct DescriptorCopy
+    {
+        uint32 destination_idx = 0;
+        uint32 source_idx = 0;
+    };
+
+    // Consecutive descriptors, copied with a single range of a CopyDescriptors call
+    struct DescriptorRange
+    {
+        uint32 first_idx = 0;
+        uint32 num_descriptors = 0;
+    };
+
+    /**
+     * @brief Non shader visible heap which views are created in once, then copied into shader visible heaps.
+     * Creating a view runs through the driver, copying it is a plain memcpy. So a resource used from several
+     * shader visible heaps (e.g. one per frame in flight) only pays for view creation once.
+     * Copies are queued and only written on Flush(), batched into a single CopyDescriptors call per destination heap
+     * with contiguous source and destination ranges coalesced. Thread safe.
+     */
+    class StagingDescriptorHeap
+    {
+    public:
+        void Init(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32 capacity, const wchar_t* name);
+        void Shutdown();
+
+        uint32 Allocate();
+
+        /**
+         * @brief Returns the slot to the heap. Pending copies from it are dropped, their destinations are stale by now.
+         */
+        void Free(uint32 idx);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(uint32 idx) const;
+
+        /**
+         * @brief Queues a copy of a staging descriptor into a shader visible heap.
+         * The staging slot is read on flush, so views recreated in place before that are picked up.
+         * If the same destination slot is queued more than once, the last copy wins.
+         */
+        void QueueCopy(uint32 source_idx, ID3D12DescriptorHeap* destination_heap, uint32 destination_idx);
+
+        /**
+         * @brief Writes all copies queued for the given heap. The GPU must not be reading the heap anymore,
+         * so call it once the frame owning the heap has been waited for.
+         * @return Number of descriptors written
+         */
+        uint32 Flush(ID3D12DescriptorHeap* destination_heap);
+
+        StagingDescriptorHeapStats GetStats() const;
+
+        /**
+         * @brief Sorts copies into one heap by destination, drops all but the last queued copy to each destination slot
+         * and coalesces consecutive destination and source slots into ranges. Doesn't touch the device.
+         * @return Number of descriptors to copy
+         */
+        static uint32 CoalesceCopies(std::vector<DescriptorCopy>& in_out_copies, std::vector<DescriptorRange>& out_destination_ranges,
+            std::vector<DescriptorRange>& out_source_ranges);
+
+    private:
+        struct PendingCopy
+        {
+            ID3D12DescriptorHeap* destination_heap = nullptr;
+            uint32 destination_idx = 0;
+            uint32 source_idx = 0;
+        };
+
+        D3D12_DESCRIPTOR_HEAP_TYPE type_ = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+        ComPtr<ID3D12DescriptorHeap> heap_;
+        D3D12_CPU_DESCRIPTOR_HANDLE heap_start_ = {};
+        uint32 descriptor_size_ = 0;
+        uint32 capacity_ = 0;
+
+        mutable std::mutex mutex_;
+        std::vector<uint32> free_indices_;      // Back is the lowest index, so allocations start out contiguous
+        std::vector<PendingCopy> pending_copies_;
+        StagingDescriptorHeapStats stats_;
+
+        // Reused across flushes
+        std::vector<DescriptorCopy> flush_copies_;
+        std::vector<DescriptorRange> destination_ranges_;
+        std::vector<DescriptorRange> source_ranges_;
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> destination_range_starts_;
+        std::vector<uint32> destination_range_sizes_;
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> source_range_starts_;
+        std::vector<uint32> source_range_sizes_;
+    };
+}
@@ -0,0 +1,119 @@
+#include "Renderer/TimelineFence.h"
+
+#include "Renderer/GraphicsContext.h"
+
+namespace gfx
+{
+    void TimelineFence::Init(const ComPtr<ID3D12CommandQueue>& queue, const wchar_t* name)
+    {
+        CHECK(queue != nullptr);
+        queue_ = queue;
+        fence_ = CreateFence();
+        fence_->SetName(name);
+        fence_event_ = CreateEventHandle();
+        last_signaled_value_ = 0;
+        last_completed_value_ = 0;
+    }
+
+    void TimelineFence::Shutdown()
+    {
+        CloseHandle(fence_event_);
+        fence_event_ = nullptr;
+        fence_.Reset();
+        queue_.Reset();
+    }
+
+    uint64 TimelineFence::Signal()
+    {
+        gfx::Signal(queue_, fence_, ++last_signaled_value_);
+        return last_signaled_value_;
+    }
+
+    bool TimelineFence::IsComplete(uint64 value)
+    {
+        if (value > last_signaled_value_)
+        {
+            return false;   // Not even signaled yet
+        }
+
+        if (value <= GetLastCompletedValue())
+        {
+            return true;
+        }
+
+        return value <= Poll();
+    }
+
+    uint64 TimelineFence::Poll()
+    {
+        UpdateCompletedValue(fence_->GetCompletedValue());
+        return GetLastCompletedValue();
+    }
+
+    void TimelineFence::Wait(uint64 value)
+    {
+        CHECK_MSG(value <= last_signaled_value_, "Waiting for a value which was never signaled would never return");
+        if (IsComplete(value))
+        {
+            return;
+        }
+
+        WaitForFence(fence_, value, fence_event_);
+        UpdateCompletedValue(value);
+    }
+
+    void TimelineFence::WaitForLastSignal()
+    {
+        Wait(last_signaled_value_);
+    }
+
+    void TimelineFence::EnqueueWait(const ComPtr<ID3D12CommandQueue>& queue, uint64 value) const
+    {
+        CHECK(queue != nullptr);
+        CHECK(queue != queue_);   // A queue waiting on itself would deadlock
+        DX_VERIFY(queue->Wait(fence_.Get(), value));
+    }
+
+    void TimelineFence::UpdateCompletedValue(uint64 completed_value)
+    {
+        // Monotonic max, other threads might have observed a later value in the meantime
+        uint64 cached_value = last_completed_value_.load(std::memory_order_relaxed);
+        while (cached_value < completed_value &&
+            last_completed_value_.compare_exchange_weak(cached_value, completed_value, std::memory_order_release, std::memory_order_relaxed) == false)
+        {
+        }
+    }
+
+    void WaitForFences(std::initializer_list<FenceWait> waits)
+    {
+        std::vector<ID3D12Fence*> pending_fences;
+        std::vector<uint64> pending_values;
+        pending_fences.reserve(waits.size());
+        pending_values.reserve(waits.size());
+
+        for (const FenceWait& wait : waits)
+        {
+            CHECK(wait.fence != nullptr);
+            if (wait.fence->IsComplete(wait.value) == false)
+            {
+                pending_fences.push_back(wait.fence->GetFence().Get());
+                pending_values.push_back(wait.value);
+            }
+        }
+
+        if (pending_fences.empty())
+        {
+            return;
+        }
+
+        CHECK(gfx::fence_event);
+        DX_VERIFY(gfx::device->SetEventOnMultipleFenceCompletion(pending_fences.data(), pending_values.data(),
+            static_cast<uint32>(pending_fences.size()), D3D12_MULTIPLE_FENCE_WAIT_FLAG_ALL, gfx::fence_event));
+        WaitForSingleObject(gfx::fence_event, INFINITE);
+
+        for (const FenceWait& wait : waits)
+        {
+            wait.fence->Poll();
+        }
+    }
+}
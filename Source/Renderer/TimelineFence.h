@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+
+#include "Renderer/DXUtils.h"
+
+namespace gfx
+{
+    /**
+     * @brief Monotonically increasing fence tracking the progress of a single command queue.
+     * Every Signal() enqueues the next value on the timeline, so any value <= GetLastSignaledValue() identifies
+     * a point in the queue's submission history. The last completed value is cached to avoid redundant GetCompletedValue calls.
+     */
+    class TimelineFence
+    {
+    public:
+        void Init(const ComPtr<ID3D12CommandQueue>& queue, const wchar_t* name);
+        void Shutdown();
+
+        /**
+         * @brief Enqueues a signal with the next value on the timeline.
+         * @return The signaled value
+         */
+        uint64 Signal();
+
+        /**
+         * @brief Non-blocking check whether the queue has reached the given value.
+         * Only queries the fence if the cached completed value isn't sufficient.
+         */
+        bool IsComplete(uint64 value);
+
+        /**
+         * @brief Refreshes the cached completed value. Non-blocking.
+         * @return The completed value
+         */
+        uint64 Poll();
+
+        /**
+         * @brief Stalls thread until the queue has reached the given value.
+         */
+        void Wait(uint64 value);
+
+        /**
+         * @brief Stalls thread until all work signaled so far has completed. Does not enqueue a new signal.
+         */
+        void WaitForLastSignal();
+
+        /**
+         * @brief Makes another queue wait GPU-side until this timeline has reached the given value.
+         */
+        void EnqueueWait(const ComPtr<ID3D12CommandQueue>& queue, uint64 value) const;
+
+        uint64 GetLastCompletedValue() const
+        {
+            return last_completed_value_.load(std::memory_order_acquire);
+        }
+
+        uint64 GetLastSignaledValue() const
+        {
+            return last_signaled_value_;
+        }
+
+        // Value the next Signal() will enqueue, i.e. the one marking completion of currently recorded work
+        uint64 GetNextValue() const
+        {
+            return last_signaled_value_ + 1;
+        }
+
+        const ComPtr<ID3D12Fence>& GetFence() const
+        {
+            return fence_;
+        }
+
+        const ComPtr<ID3D12CommandQueue>& GetQueue() const
+        {
+            return queue_;
+        }
+
+    private:
+        void UpdateCompletedValue(uint64 completed_value);
+
+        ComPtr<ID3D12CommandQueue> queue_;
+        ComPtr<ID3D12Fence> fence_;
+        HANDLE fence_event_ = nullptr;
+
+        uint64 last_signaled_value_ = 0;
+        std::atomic<uint64> last_completed_value_ = 0;
+    };
+
+    struct FenceWait
+    {
+        TimelineFence* fence = nullptr;
+        uint64 value = 0;
+    };
+
+    /**
+     * @brief Stalls thread until every given fence has reached its value.
+     * Waits for all of them with a single OS wait instead of one wait per queue.
+     */
+    void WaitForFences(std::initializer_list<FenceWait> waits);
+}
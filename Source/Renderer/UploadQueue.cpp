@@ -0,0 +1,174 @@
+#include "Renderer/UploadQueue.h"
+
+#include "d3dx12.h"
+
+#include "Renderer/GraphicsContext.h"
+
+namespace gfx
+{
+    void UploadQueue::Init(CommandListPool& pool)
+    {
+        CHECK(gfx::device != nullptr);
+        CHECK(pool.GetType() == D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_COPY);
+        CHECK(&pool.GetFence() == &gfx::fence_copy);
+        pool_ = &pool;
+        last_update_time_ = Clock::now();
+    }
+
+    void UploadQueue::Shutdown()
+    {
+        WaitIdle();
+        RetireCompletedBatches();
+        CHECK(batches_in_flight_.empty());
+
+        open_batch_ = {};
+        is_batch_open_ = false;
+        last_waited_values_.clear();
+        pool_ = nullptr;
+    }
+
+    void UploadQueue::UploadBuffer(const ComPtr<ID3D12Resource>& destination, const void* data, uint64 size, uint64 destination_offset)
+    {
+        CHECK(destination != nullptr);
+        CHECK(data != nullptr);
+        CHECK(size > 0);
+
+        if (is_batch_open_ == false)
+        {
+            OpenBatch();
+        }
+
+        ComPtr<ID3D12Resource> staging_buffer;
+        {
+            const D3D12_HEAP_PROPERTIES heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+            const CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+            DX_VERIFY(gfx::device->CreateCommittedResource(
+                &heap_properties,
+                D3D12_HEAP_FLAG_NONE,
+                &buffer_desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(&staging_buffer)));
+            staging_buffer->SetName(L"Upload Queue Staging Buffer");
+        }
+
+        static const CD3DX12_RANGE ZERO_READ_RANGE(0, 0); // no CPU read
+        void* mapped_ptr = nullptr;
+        DX_VERIFY(staging_buffer->Map(0, &ZERO_READ_RANGE, &mapped_ptr));
+        memcpy(mapped_ptr, data, size);
+        staging_buffer->Unmap(0, nullptr);
+
+        open_batch_.command_list.command_list->CopyBufferRegion(destination.Get(), destination_offset, staging_buffer.Get(), 0, size);
+        open_batch_.staging_buffers.push_back(std::move(staging_buffer));
+        open_batch_.num_bytes += size;
+        ++open_batch_.num_copies;
+        stats_.bytes_pending += size;
+    }
+
+    uint64 UploadQueue::Submit()
+    {
+        if (is_batch_open_ == false)
+        {
+            return 0;
+        }
+
+        DX_VERIFY(open_batch_.command_list.command_list->Close());
+        ID3D12CommandList* const submitted_command_lists[] = { open_batch_.command_list.command_list.Get() };
+        gfx::command_queue_copy->ExecuteCommandLists(_countof(submitted_command_lists), submitted_command_lists);
+
+        open_batch_.fence_value = gfx::fence_copy.Signal();
+        pool_->Release(std::move(open_batch_.command_list), open_batch_.fence_value, open_batch_.num_copies);
+        last_submitted_value_ = open_batch_.fence_value;
+        open_batch_.submit_time = Clock::now();
+
+        stats_.bytes_pending -= open_batch_.num_bytes;
+        stats_.bytes_in_flight += open_batch_.num_bytes;
+        ++stats_.batches_in_flight;
+
+        batches_in_flight_.push_back(std::move(open_batch_));
+        open_batch_ = {};
+        is_batch_open_ = false;
+
+        return last_submitted_value_;
+    }
+
+    void UploadQueue::Sync(const ComPtr<ID3D12CommandQueue>& queue)
+    {
+        CHECK(queue != nullptr);
+        Submit();
+
+        if (last_submitted_value_ == 0 || IsComplete(last_submitted_value_))
+        {
+            return;
+        }
+
+        // Only insert a wait if the queue isn't already waiting on this (or a later) value
+        uint64& last_waited_value = last_waited_values_[queue.Get()];
+        if (last_waited_value < last_submitted_value_)
+        {
+            gfx::fence_copy.EnqueueWait(queue, last_submitted_value_);
+            last_waited_value = last_submitted_value_;
+        }
+    }
+
+    void UploadQueue::Update()
+    {
+        const Clock::time_point now = Clock::now();
+        const double delta_time = std::chrono::duration<double>(now - last_update_time_).count();
+        last_update_time_ = now;
+
+        const bool was_busy = batches_in_flight_.empty() == false;
+        RetireCompletedBatches();
+
+        // Treat the copy queue as busy for the whole interval if it had work in flight when we last looked.
+        // Coarse, but good enough to tell whether uploads are saturating the queue.
+        static constexpr double OCCUPANCY_SMOOTHING = 0.05;
+        if (delta_time > 0.0)
+        {
+            const double busy_fraction = was_busy ? 1.0 : 0.0;
+            stats_.occupancy += (busy_fraction - stats_.occupancy) * OCCUPANCY_SMOOTHING;
+        }
+    }
+
+    void UploadQueue::WaitIdle()
+    {
+        Submit();
+        gfx::fence_copy.Wait(last_submitted_value_);
+    }
+
+    bool UploadQueue::IsComplete(uint64 fence_value)
+    {
+        return gfx::fence_copy.IsComplete(fence_value);
+    }
+
+    void UploadQueue::OpenBatch()
+    {
+        CHECK(is_batch_open_ == false);
+        open_batch_.command_list = pool_->Acquire();
+        is_batch_open_ = true;
+    }
+
+    void UploadQueue::RetireCompletedBatches()
+    {
+        const uint64 completed_value = gfx::fence_copy.Poll();
+        const Clock::time_point now = Clock::now();
+
+        while (batches_in_flight_.empty() == false && batches_in_flight_.front().fence_value <= completed_value)
+        {
+            Batch& batch = batches_in_flight_.front();
+
+            static constexpr double LATENCY_SMOOTHING = 0.1;
+            stats_.last_latency_ms = std::chrono::duration<double, std::milli>(now - batch.submit_time).count();
+            stats_.avg_latency_ms = stats_.total_batches_completed == 0 ?
+                stats_.last_latency_ms : stats_.avg_latency_ms + (stats_.last_latency_ms - stats_.avg_latency_ms) * LATENCY_SMOOTHING;
+
+            stats_.bytes_in_flight -= batch.num_bytes;
+            stats_.total_bytes_uploaded += batch.num_bytes;
+            --stats_.batches_in_flight;
+            ++stats_.total_batches_completed;
+
+            // Staging memory can go, the pool recycles the allocator on its own
+            batches_in_flight_.pop_front();
+        }
+    }
+}
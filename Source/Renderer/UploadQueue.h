@@ -0,0 +1,101 @@
+#pragma once
+#include <chrono>
+
+#include "Renderer/CommandListPool.h"
+#include "Renderer/DXUtils.h"
+
+namespace gfx
+{
+    struct UploadQueueStats
+    {
+        uint32 batches_in_flight = 0;       // Submitted to the copy queue, not yet completed
+        uint64 bytes_in_flight = 0;
+        uint64 bytes_pending = 0;           // Recorded, but not yet submitted
+        uint64 total_bytes_uploaded = 0;
+        uint64 total_batches_completed = 0;
+        double last_latency_ms = 0.0;       // Time between submission and the CPU observing completion
+        double avg_latency_ms = 0.0;        // Exponential moving average of the latency
+        double occupancy = 0.0;             // Moving average of the fraction of time the copy queue had work in flight
+    };
+
+    /**
+     * @brief Streams data to GPU resources via the copy queue.
+     * Copies are recorded on lists from the copy command list pool and completion is tracked on the copy queue timeline.
+     * Consumers make their queue wait GPU-side on that timeline, so the CPU never stalls for uploads.
+     */
+    class UploadQueue
+    {
+    public:
+        void Init(CommandListPool& pool);
+        void Shutdown();
+
+        /**
+         * @brief Records a copy of the given data into a buffer.
+         * The destination has to be a buffer in the COMMON state. Buffers decay back to COMMON once the copy queue
+         * is done with them, so the consuming queue can implicitly promote them to the read state it needs.
+         * @param destination The buffer to copy to
+         * @param data The source data. Copied into staging memory immediately, so it may be freed after the call.
+         * @param size Number of bytes to copy
+         * @param destination_offset Byte offset into the destination buffer
+         */
+        void UploadBuffer(const ComPtr<ID3D12Resource>& destination, const void* data, uint64 size, uint64 destination_offset = 0);
+
+        /**
+         * @brief Submits all recorded copies to the copy queue.
+         * @return The copy queue timeline value signaled once the batch has completed. 0 if there was nothing to submit.
+         */
+        uint64 Submit();
+
+        /**
+         * @brief Submits pending copies and makes the given queue wait GPU-side until all uploads submitted so far are done.
+         * Does not block the calling thread.
+         * @param queue The queue consuming the uploaded data
+         */
+        void Sync(const ComPtr<ID3D12CommandQueue>& queue);
+
+        /**
+         * @brief Retires completed batches, releases their staging memory and updates the stats. Call once per frame.
+         */
+        void Update();
+
+        /**
+         * @brief Stalls thread until all submitted uploads are done.
+         */
+        void WaitIdle();
+
+        bool IsComplete(uint64 fence_value);
+
+        const UploadQueueStats& GetStats() const
+        {
+            return stats_;
+        }
+
+    private:
+        using Clock = std::chrono::high_resolution_clock;
+
+        struct Batch
+        {
+            PooledCommandList command_list;     // Returned to the pool on submission
+            std::vector<ComPtr<ID3D12Resource>> staging_buffers;
+            uint64 fence_value = 0;
+            uint64 num_bytes = 0;
+            uint32 num_copies = 0;
+            Clock::time_point submit_time;
+        };
+
+        void OpenBatch();
+        void RetireCompletedBatches();
+
+        CommandListPool* pool_ = nullptr;
+        uint64 last_submitted_value_ = 0;
+
+        Batch open_batch_;
+        bool is_batch_open_ = false;
+        std::deque<Batch> batches_in_flight_;
+
+        std::unordered_map<ID3D12CommandQueue*, uint64> last_waited_values_;
+
+        UploadQueueStats stats_;
+        Clock::time_point last_update_time_;
+    };
+}
@@ -0,0 +1,864 @@
+#include "Scene/BoundingVolumeHierarchy.h"
+
+#include "Core/JobSystem.h"
+
+BoundingVolumeHierarchy::Bounds BoundingVolumeHierarchy::Bounds::FromBox(const Box& box)
+{
+    return { box.min_x, box.min_y, box.min_z, box.max_x, box.max_y, box.max_z };
+}
+
+BoundingVolumeHierarchy::Bounds BoundingVolumeHierarchy::Bounds::Union(const Bounds& a, const Bounds& b)
+{
+    Bounds out = a;
+    out.Grow(b);
+    return out;
+}
+
+Box BoundingVolumeHierarchy::Bounds::ToBox() const
+{
+    return Box(min_x, max_x, min_y, max_y, min_z, max_z);
+}
+
+void BoundingVolumeHierarchy::Bounds::Grow(const Bounds& other)
+{
+    min_x = std::min(min_x, other.min_x);
+    min_y = std::min(min_y, other.min_y);
+    min_z = std::min(min_z, other.min_z);
+    max_x = std::max(max_x, other.max_x);
+    max_y = std::max(max_y, other.max_y);
+    max_z = std::max(max_z, other.max_z);
+}
+
+void BoundingVolumeHierarchy::Bounds::Grow(const Vec3& point)
+{
+    min_x = std::min(min_x, point.x);
+    min_y = std::min(min_y, point.y);
+    min_z = std::min(min_z, point.z);
+    max_x = std::max(max_x, point.x);
+    max_y = std::max(max_y, point.y);
+    max_z = std::max(max_z, point.z);
+}
+
+float BoundingVolumeHierarchy::Bounds::SurfaceArea() const
+{
+    if (min_x > max_x)
+    {
+        return 0.0f;
+    }
+
+    const float size_x = max_x - min_x;
+    const float size_y = max_y - min_y;
+    const float size_z = max_z - min_z;
+    return 2.0f * (size_x * size_y + size_y * size_z + size_z * size_x);
+}
+
+bool BoundingVolumeHierarchy::Bounds::Overlaps(const Bounds& other) const
+{
+    return min_x <= other.max_x && max_x >= other.min_x
+        && min_y <= other.max_y && max_y >= other.min_y
+        && min_z <= other.max_z && max_z >= other.min_z;
+}
+
+void BoundingVolumeHierarchy::Build(std::span<const Box> boxes)
+{
+    Clear();
+    const uint32 num_boxes = static_cast<uint32>(boxes.size());
+    if (num_boxes == 0)
+    {
+        return;
+    }
+
+    // Leaves first, so the proxy of boxes[i] is i. Internal nodes follow in the order they're split off.
+    nodes_.resize(2 * num_boxes - 1);
+    std::vector<uint32> refs(num_boxes);
+    std::vector<Vec3> centroids(num_boxes);
+    jobs::ParallelFor(num_boxes, 4096, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            const Box& box = boxes[i];
+            nodes_[i].bounds = Bounds::FromBox(box);
+            nodes_[i].user_id = i;
+            refs[i] = i;
+            centroids[i] = Vec3((box.min_x + box.max_x) * 0.5f, (box.min_y + box.max_y) * 0.5f, (box.min_z + box.max_z) * 0.5f);
+        }
+    });
+
+    std::atomic<uint32> next_internal = num_boxes;
+    root_ = BuildRange(refs, centroids, INVALID_NODE, next_internal);
+    stats_.num_proxies = num_boxes;
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+    nodes_.clear();
+    free_nodes_.clear();
+    root_ = INVALID_NODE;
+    stats_ = {};
+}
+
+uint32 BoundingVolumeHierarchy::CreateProxy(const Box& box, uint32 user_id)
+{
+    const uint32 leaf = AllocateNode();
+    nodes_[leaf].bounds = Bounds::FromBox(box);
+    nodes_[leaf].user_id = user_id;
+
+    stats_.num_rotations = 0;
+    InsertLeaf(leaf);
+    ++stats_.num_proxies;
+    return leaf;
+}
+
+void BoundingVolumeHierarchy::DestroyProxy(uint32 proxy)
+{
+    GetLeaf(proxy);
+    stats_.num_rotations = 0;
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --stats_.num_proxies;
+}
+
+void BoundingVolumeHierarchy::MoveProxy(uint32 proxy, const Box& box)
+{
+    GetLeaf(proxy);
+    const Bounds new_bounds = Bounds::FromBox(box);
+    const bool has_jumped = nodes_[proxy].bounds.Overlaps(new_bounds) == false;
+    nodes_[proxy].bounds = new_bounds;
+    stats_.num_rotations = 0;
+
+    // Rotations only repair local damage, a proxy that jumped elsewhere is better off in a new spot
+    if (has_jumped)
+    {
+        RemoveLeaf(proxy);
+        InsertLeaf(proxy);
+    }
+    else
+    {
+        FixUpwards(nodes_[proxy].parent);
+    }
+}
+
+void BoundingVolumeHierarchy::SetProxyBounds(uint32 proxy, const Box& box)
+{
+    GetLeaf(proxy);
+    nodes_[proxy].bounds = Bounds::FromBox(box);
+}
+
+void BoundingVolumeHierarchy::Refit(bool rotate)
+{
+    stats_.num_rotations = 0;
+    if (root_ == INVALID_NODE)
+    {
+        return;
+    }
+
+    std::vector<uint32> subtrees;
+    std::vector<uint32> upper_nodes;
+    CollectSubtrees(jobs::GetNumThreads() * NUM_SUBTREES_PER_THREAD, subtrees, &upper_nodes);
+
+    // Reverse pre-order visits children before their parents. A rotation only touches the node's children and
+    // grandchildren, which are done by then, so subtrees don't interfere with each other.
+    std::atomic<uint32> num_rotations = 0;
+    jobs::Dispatch(static_cast<uint32>(subtrees.size()), [&](uint32 subtree_idx)
+    {
+        std::vector<uint32> internal_nodes;
+        std::vector<uint32> stack = { subtrees[subtree_idx] };
+        while (stack.empty() == false)
+        {
+            const uint32 node_idx = stack.back();
+            stack.pop_back();
+            const Node& node = nodes_[node_idx];
+            if (node.IsLeaf() == false)
+            {
+                internal_nodes.push_back(node_idx);
+                stack.push_back(node.children[0]);
+                stack.push_back(node.children[1]);
+            }
+        }
+
+        uint32 num_subtree_rotations = 0;
+        for (auto it = internal_nodes.rbegin(); it != internal_nodes.rend(); ++it)
+        {
+            if (rotate && Rotate(*it))
+            {
+                ++num_subtree_rotations;
+            }
+            RefitNode(*it);
+        }
+        num_rotations += num_subtree_rotations;
+    });
+
+    for (auto it = upper_nodes.rbegin(); it != upper_nodes.rend(); ++it)
+    {
+        if (rotate && Rotate(*it))
+        {
+            ++num_rotations;
+        }
+        RefitNode(*it);
+    }
+    stats_.num_rotations = num_rotations;
+}
+
+uint32 BoundingVolumeHierarchy::GetUserId(uint32 proxy) const
+{
+    return GetLeaf(proxy).user_id;
+}
+
+Box BoundingVolumeHierarchy::GetProxyBounds(uint32 proxy) const
+{
+    return GetLeaf(proxy).bounds.ToBox();
+}
+
+void BoundingVolumeHierarchy::QueryBox(const Box& box, std::vector<uint32>& out_user_ids) const
+{
+    if (root_ == INVALID_NODE)
+    {
+        return;
+    }
+
+    const Bounds query = Bounds::FromBox(box);
+    std::vector<uint32> stack = { root_ };
+    while (stack.empty() == false)
+    {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+        if (node.bounds.Overlaps(query) == false)
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            out_user_ids.push_back(node.user_id);
+        }
+        else
+        {
+            stack.push_back(node.children[1]);
+            stack.push_back(node.children[0]);
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const Mat4& view_projection, std::vector<uint32>& out_user_ids) const
+{
+    out_user_ids.clear();
+    if (root_ == INVALID_NODE)
+    {
+        return;
+    }
+
+    const Frustum frustum(view_projection);
+    std::vector<uint32> subtrees;
+    CollectSubtrees(jobs::GetNumThreads() * NUM_SUBTREES_PER_THREAD, subtrees, nullptr);
+
+    // Subtrees collect separately and are concatenated in order, like Scene::CullFrustum()
+    std::vector<std::vector<uint32>> subtree_user_ids(subtrees.size());
+    jobs::Dispatch(static_cast<uint32>(subtrees.size()), [&](uint32 subtree_idx)
+    {
+        std::vector<uint32>& user_ids = subtree_user_ids[subtree_idx];
+        std::vector<uint32> stack = { subtrees[subtree_idx] };
+        while (stack.empty() == false)
+        {
+            const uint32 node_idx = stack.back();
+            stack.pop_back();
+            const Node& node = nodes_[node_idx];
+            const Containment containment = frustum.Classify(node.bounds.ToBox());
+            if (containment == Containment::OUTSIDE)
+            {
+                continue;
+            }
+
+            if (node.IsLeaf())
+            {
+                user_ids.push_back(node.user_id);
+            }
+            else if (containment == Containment::INSIDE)
+            {
+                CollectLeaves(node_idx, user_ids);
+            }
+            else
+            {
+                stack.push_back(node.children[1]);
+                stack.push_back(node.children[0]);
+            }
+        }
+    });
+
+    for (const std::vector<uint32>& user_ids : subtree_user_ids)
+    {
+        out_user_ids.insert(out_user_ids.end(), user_ids.begin(), user_ids.end());
+    }
+}
+
+template <typename OnLeaf>
+void BoundingVolumeHierarchy::TraverseRay(const Ray& ray, OnLeaf&& on_leaf) const
+{
+    if (root_ == INVALID_NODE)
+    {
+        return;
+    }
+
+    float max_distance = ray.max_distance;
+    // Clamped, an infinity for a zero component would give NaN for an origin on a node's slab plane
+    const Vec3 inv_dir = ray.GetInverseDirection();
+    const float inv_dir_x = inv_dir.x;
+    const float inv_dir_y = inv_dir.y;
+    const float inv_dir_z = inv_dir.z;
+    const auto intersect = [&](const Bounds& bounds, float& out_entry)
+    {
+        const float t_x1 = (bounds.min_x - ray.origin.x) * inv_dir_x;
+        const float t_x2 = (bounds.max_x - ray.origin.x) * inv_dir_x;
+        const float t_y1 = (bounds.min_y - ray.origin.y) * inv_dir_y;
+        const float t_y2 = (bounds.max_y - ray.origin.y) * inv_dir_y;
+        const float t_z1 = (bounds.min_z - ray.origin.z) * inv_dir_z;
+        const float t_z2 = (bounds.max_z - ray.origin.z) * inv_dir_z;
+        const float t_entry = std::max({ std::min(t_x1, t_x2), std::min(t_y1, t_y2), std::min(t_z1, t_z2), 0.0f });
+        const float t_exit = std::min({ std::max(t_x1, t_x2), std::max(t_y1, t_y2), std::max(t_z1, t_z2), max_distance });
+        out_entry = t_entry;
+        return t_entry <= t_exit;
+    };
+
+    struct StackEntry
+    {
+        uint32 node_idx;
+        float entry;
+    };
+    std::vector<StackEntry> stack;
+    float root_entry = 0.0f;
+    if (intersect(nodes_[root_].bounds, root_entry))
+    {
+        stack.push_back({ root_, root_entry });
+    }
+
+    while (stack.empty() == false)
+    {
+        const StackEntry entry = stack.back();
+        stack.pop_back();
+        if (entry.entry > max_distance)
+        {
+            continue;
+        }
+
+        const Node& node = nodes_[entry.node_idx];
+        if (node.IsLeaf())
+        {
+            max_distance = on_leaf(node.user_id, entry.entry);
+            continue;
+        }
+
+        float entry_0 = 0.0f;
+        float entry_1 = 0.0f;
+        const bool is_hit_0 = intersect(nodes_[node.children[0]].bounds, entry_0);
+        const bool is_hit_1 = intersect(nodes_[node.children[1]].bounds, entry_1);
+        if (is_hit_0 && is_hit_1)
+        {
+            // Far child first, so the near one is popped next
+            if (entry_0 <= entry_1)
+            {
+                stack.push_back({ node.children[1], entry_1 });
+                stack.push_back({ node.children[0], entry_0 });
+            }
+            else
+            {
+                stack.push_back({ node.children[0], entry_0 });
+                stack.push_back({ node.children[1], entry_1 });
+            }
+        }
+        else if (is_hit_0)
+        {
+            stack.push_back({ node.children[0], entry_0 });
+        }
+        else if (is_hit_1)
+        {
+            stack.push_back({ node.children[1], entry_1 });
+        }
+    }
+}
+
+BvhRayHit BoundingVolumeHierarchy::Raycast(const Ray& ray) const
+{
+    BvhRayHit hit;
+    TraverseRay(ray, [&](uint32 user_id, float entry)
+    {
+        hit = { .user_id = user_id, .distance = entry };
+        return entry;
+    });
+    return hit;
+}
+
+void BoundingVolumeHierarchy::RaycastLeaves(const Ray& ray, const std::function<float(uint32 user_id, float max_distance)>& on_leaf) const
+{
+    float max_distance = ray.max_distance;
+    TraverseRay(ray, [&](uint32 user_id, float)
+    {
+        max_distance = std::min(max_distance, on_leaf(user_id, max_distance));
+        return max_distance;
+    });
+}
+
+void BoundingVolumeHierarchy::RaycastPacket(RayPacket& packet, const std::function<void(uint32 user_id, uint32 lane_mask)>& on_leaf) const
+{
+    if (root_ == INVALID_NODE)
+    {
+        return;
+    }
+
+    // The children's entries decide the order, for the nearest active lane. Nodes are retested when popped because
+    // leaves found in the meantime may have shortened the rays.
+    std::vector<uint32> stack = { root_ };
+    alignas(32) float entries[simd::NUM_LANES];
+    while (stack.empty() == false)
+    {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+
+        simd::FloatLanes entry;
+        const Bounds& bounds = node.bounds;
+        const uint32 lane_mask = ray_kernels::IntersectBox(packet, bounds.min_x, bounds.min_y, bounds.min_z, bounds.max_x, bounds.max_y, bounds.max_z, entry);
+        if (lane_mask == 0)
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            on_leaf(node.user_id, lane_mask);
+            continue;
+        }
+
+        std::array<float, 2> nearest_entries;
+        for (uint32 child = 0; child < 2; ++child)
+        {
+            const Bounds& child_bounds = nodes_[node.children[child]].bounds;
+            const uint32 child_mask = ray_kernels::IntersectBox(packet, child_bounds.min_x, child_bounds.min_y, child_bounds.min_z, child_bounds.max_x, child_bounds.max_y, child_bounds.max_z, entry);
+            simd::Store(entries, entry);
+            nearest_entries[child] = std::numeric_limits<float>::max();
+            for (uint32 lane = 0; lane < simd::NUM_LANES; ++lane)
+            {
+                if ((child_mask >> lane) & 1)
+                {
+                    nearest_entries[child] = std::min(nearest_entries[child], entries[lane]);
+                }
+            }
+        }
+
+        const uint32 near_child = nearest_entries[0] <= nearest_entries[1] ? 0 : 1;
+        if (nearest_entries[1 - near_child] != std::numeric_limits<float>::max())
+        {
+            stack.push_back(node.children[1 - near_child]);
+        }
+        if (nearest_entries[near_child] != std::numeric_limits<float>::max())
+        {
+            stack.push_back(node.children[near_child]);
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::QueryBoxes(std::span<const Box> boxes, std::vector<BvhQueryRange>& out_ranges, std::vector<uint32>& out_user_ids) const
+{
+    const uint32 num_queries = static_cast<uint32>(boxes.size());
+    out_ranges.resize(num_queries);
+    out_user_ids.clear();
+
+    // Fixed size chunks with their own results, offsets are made global once all are done
+    const uint32 num_chunks = (num_queries + MIN_QUERIES_PER_JOB - 1) / MIN_QUERIES_PER_JOB;
+    std::vector<std::vector<uint32>> chunk_user_ids(num_chunks);
+    jobs::Dispatch(num_chunks, [&](uint32 chunk_idx)
+    {
+        std::vector<uint32>& user_ids = chunk_user_ids[chunk_idx];
+        const uint32 end = std::min(num_queries, (chunk_idx + 1) * MIN_QUERIES_PER_JOB);
+        for (uint32 i = chunk_idx * MIN_QUERIES_PER_JOB; i < end; ++i)
+        {
+            const uint32 offset = static_cast<uint32>(user_ids.size());
+            QueryBox(boxes[i], user_ids);
+            out_ranges[i] = { .offset = offset, .count = static_cast<uint32>(user_ids.size()) - offset };
+        }
+    });
+
+    for (uint32 chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx)
+    {
+        const uint32 chunk_offset = static_cast<uint32>(out_user_ids.size());
+        const uint32 end = std::min(num_queries, (chunk_idx + 1) * MIN_QUERIES_PER_JOB);
+        for (uint32 i = chunk_idx * MIN_QUERIES_PER_JOB; i < end; ++i)
+        {
+            out_ranges[i].offset += chunk_offset;
+        }
+        out_user_ids.insert(out_user_ids.end(), chunk_user_ids[chunk_idx].begin(), chunk_user_ids[chunk_idx].end());
+    }
+}
+
+void BoundingVolumeHierarchy::Raycasts(std::span<const Ray> rays, std::span<BvhRayHit> out_hits) const
+{
+    CHECK(rays.size() == out_hits.size());
+    jobs::ParallelFor(static_cast<uint32>(rays.size()), MIN_QUERIES_PER_JOB, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            out_hits[i] = Raycast(rays[i]);
+        }
+    });
+}
+
+float BoundingVolumeHierarchy::CalculateCost() const
+{
+    if (root_ == INVALID_NODE || nodes_[root_].IsLeaf())
+    {
+        return 0.0f;
+    }
+
+    double area_sum = 0.0;
+    for (const Node& node : nodes_)
+    {
+        if (node.parent != FREE_NODE && node.IsLeaf() == false)
+        {
+            area_sum += node.bounds.SurfaceArea();
+        }
+    }
+    return static_cast<float>(area_sum / std::max(nodes_[root_].bounds.SurfaceArea(), std::numeric_limits<float>::min()));
+}
+
+uint32 BoundingVolumeHierarchy::AllocateNode()
+{
+    if (free_nodes_.empty())
+    {
+        nodes_.emplace_back();
+        return static_cast<uint32>(nodes_.size() - 1);
+    }
+
+    const uint32 node_idx = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[node_idx] = Node();
+    return node_idx;
+}
+
+void BoundingVolumeHierarchy::FreeNode(uint32 node_idx)
+{
+    nodes_[node_idx] = Node();
+    nodes_[node_idx].parent = FREE_NODE;
+    free_nodes_.push_back(node_idx);
+}
+
+const BoundingVolumeHierarchy::Node& BoundingVolumeHierarchy::GetLeaf(uint32 proxy) const
+{
+    CHECK_MSG(proxy < nodes_.size() && nodes_[proxy].parent != FREE_NODE && nodes_[proxy].IsLeaf(), "Invalid BVH proxy {}", proxy);
+    return nodes_[proxy];
+}
+
+uint32 BoundingVolumeHierarchy::BuildRange(std::span<uint32> refs, std::span<const Vec3> centroids, uint32 parent, std::atomic<uint32>& next_internal)
+{
+    if (refs.size() == 1)
+    {
+        nodes_[refs[0]].parent = parent;
+        return refs[0];
+    }
+
+    Bounds bounds;
+    Bounds centroid_bounds;
+    for (const uint32 ref : refs)
+    {
+        bounds.Grow(nodes_[ref].bounds);
+        centroid_bounds.Grow(centroids[ref]);
+    }
+
+    // Bin centroids along their largest extent (Wald)
+    const float centroid_extents[3] = {
+        centroid_bounds.max_x - centroid_bounds.min_x,
+        centroid_bounds.max_y - centroid_bounds.min_y,
+        centroid_bounds.max_z - centroid_bounds.min_z
+    };
+    const uint32 axis = centroid_extents[0] >= centroid_extents[1]
+        ? (centroid_extents[0] >= centroid_extents[2] ? 0 : 2)
+        : (centroid_extents[1] >= centroid_extents[2] ? 1 : 2);
+    const float centroid_min = axis == 0 ? centroid_bounds.min_x : (axis == 1 ? centroid_bounds.min_y : centroid_bounds.min_z);
+    const float bin_scale = centroid_extents[axis] > 0.0f ? NUM_SAH_BINS * 0.9999f / centroid_extents[axis] : 0.0f;
+    const auto get_bin = [&](uint32 ref)
+    {
+        const float centroid = axis == 0 ? centroids[ref].x : (axis == 1 ? centroids[ref].y : centroids[ref].z);
+        return std::min(static_cast<uint32>((centroid - centroid_min) * bin_scale), NUM_SAH_BINS - 1);
+    };
+
+    struct Bin
+    {
+        Bounds bounds;
+        uint32 count = 0;
+    };
+    std::array<Bin, NUM_SAH_BINS> bins;
+    for (const uint32 ref : refs)
+    {
+        Bin& bin = bins[get_bin(ref)];
+        bin.bounds.Grow(nodes_[ref].bounds);
+        ++bin.count;
+    }
+
+    // Cost of splitting after each bin is area * count on both sides
+    std::array<float, NUM_SAH_BINS> right_costs;
+    Bounds right_bounds;
+    uint32 right_count = 0;
+    for (uint32 bin = NUM_SAH_BINS - 1; bin > 0; --bin)
+    {
+        right_bounds.Grow(bins[bin].bounds);
+        right_count += bins[bin].count;
+        right_costs[bin] = right_bounds.SurfaceArea() * right_count;
+    }
+
+    float best_cost = std::numeric_limits<float>::max();
+    uint32 best_split = 0;
+    Bounds left_bounds;
+    uint32 left_count = 0;
+    for (uint32 split = 1; split < NUM_SAH_BINS; ++split)
+    {
+        left_bounds.Grow(bins[split - 1].bounds);
+        left_count += bins[split - 1].count;
+        const float cost = left_bounds.SurfaceArea() * left_count + right_costs[split];
+        if (left_count > 0 && left_count < refs.size() && cost < best_cost)
+        {
+            best_cost = cost;
+            best_split = split;
+        }
+    }
+
+    // Without a usable split, e.g. all centroids in one spot, halve the range
+    size_t num_left = refs.size() / 2;
+    if (best_split > 0)
+    {
+        const auto middle = std::partition(refs.begin(), refs.end(), [&](uint32 ref) { return get_bin(ref) < best_split; });
+        num_left = static_cast<size_t>(middle - refs.begin());
+    }
+
+    const uint32 node_idx = next_internal++;
+    std::array<uint32, 2> children;
+    const std::array<std::span<uint32>, 2> child_refs = { refs.first(num_left), refs.subspan(num_left) };
+    if (refs.size() >= MIN_PARALLEL_BUILD_SIZE)
+    {
+        jobs::Dispatch(2, [&](uint32 child)
+        {
+            children[child] = BuildRange(child_refs[child], centroids, node_idx, next_internal);
+        });
+    }
+    else
+    {
+        children[0] = BuildRange(child_refs[0], centroids, node_idx, next_internal);
+        children[1] = BuildRange(child_refs[1], centroids, node_idx, next_internal);
+    }
+
+    Node& node = nodes_[node_idx];
+    node.bounds = bounds;
+    node.parent = parent;
+    node.children[0] = children[0];
+    node.children[1] = children[1];
+    return node_idx;
+}
+
+void BoundingVolumeHierarchy::InsertLeaf(uint32 leaf)
+{
+    if (root_ == INVALID_NODE)
+    {
+        root_ = leaf;
+        nodes_[leaf].parent = INVALID_NODE;
+        return;
+    }
+
+    // Descend towards the cheapest sibling, stopping when making a new parent here is cheaper than going further down
+    const Bounds leaf_bounds = nodes_[leaf].bounds;
+    uint32 sibling = root_;
+    while (nodes_[sibling].IsLeaf() == false)
+    {
+        const Node& node = nodes_[sibling];
+        const float combined_area = Bounds::Union(node.bounds, leaf_bounds).SurfaceArea();
+        const float cost_here = 2.0f * combined_area;
+        const float inherited_cost = 2.0f * (combined_area - node.bounds.SurfaceArea());
+
+        std::array<float, 2> child_costs;
+        for (uint32 child = 0; child < 2; ++child)
+        {
+            const Node& child_node = nodes_[node.children[child]];
+            child_costs[child] = Bounds::Union(child_node.bounds, leaf_bounds).SurfaceArea() + inherited_cost;
+            if (child_node.IsLeaf() == false)
+            {
+                child_costs[child] -= child_node.bounds.SurfaceArea();
+            }
+        }
+
+        if (cost_here < child_costs[0] && cost_here < child_costs[1])
+        {
+            break;
+        }
+        sibling = child_costs[0] < child_costs[1] ? node.children[0] : node.children[1];
+    }
+
+    const uint32 old_parent = nodes_[sibling].parent;
+    const uint32 new_parent = AllocateNode();
+    Node& parent_node = nodes_[new_parent];
+    parent_node.bounds = Bounds::Union(nodes_[sibling].bounds, leaf_bounds);
+    parent_node.parent = old_parent;
+    parent_node.children[0] = sibling;
+    parent_node.children[1] = leaf;
+    nodes_[sibling].parent = new_parent;
+    nodes_[leaf].parent = new_parent;
+
+    if (old_parent == INVALID_NODE)
+    {
+        root_ = new_parent;
+    }
+    else
+    {
+        Node& old_parent_node = nodes_[old_parent];
+        old_parent_node.children[old_parent_node.children[0] == sibling ? 0 : 1] = new_parent;
+        FixUpwards(old_parent);
+    }
+}
+
+void BoundingVolumeHierarchy::RemoveLeaf(uint32 leaf)
+{
+    if (leaf == root_)
+    {
+        root_ = INVALID_NODE;
+        return;
+    }
+
+    // The sibling takes the parent's place
+    const uint32 parent = nodes_[leaf].parent;
+    const uint32 grandparent = nodes_[parent].parent;
+    const uint32 sibling = nodes_[parent].children[nodes_[parent].children[0] == leaf ? 1 : 0];
+    nodes_[sibling].parent = grandparent;
+    FreeNode(parent);
+
+    if (grandparent == INVALID_NODE)
+    {
+        root_ = sibling;
+    }
+    else
+    {
+        Node& grandparent_node = nodes_[grandparent];
+        grandparent_node.children[grandparent_node.children[0] == parent ? 0 : 1] = sibling;
+        FixUpwards(grandparent);
+    }
+}
+
+void BoundingVolumeHierarchy::FixUpwards(uint32 node_idx)
+{
+    while (node_idx != INVALID_NODE)
+    {
+        if (Rotate(node_idx))
+        {
+            ++stats_.num_rotations;
+        }
+        RefitNode(node_idx);
+        node_idx = nodes_[node_idx].parent;
+    }
+}
+
+bool BoundingVolumeHierarchy::Rotate(uint32 node_idx)
+{
+    // Swapping a child with a grandchild on the other side leaves this node's bounds as they are, but can shrink the
+    // other child. Pick the swap that shrinks it the most.
+    Node& node = nodes_[node_idx];
+    float best_gain = 0.0f;
+    uint32 best_side = 2;
+    uint32 best_grandchild = 0;
+    for (uint32 side = 0; side < 2; ++side)
+    {
+        const Node& other = nodes_[node.children[1 - side]];
+        if (other.IsLeaf())
+        {
+            continue;
+        }
+
+        const Bounds& child_bounds = nodes_[node.children[side]].bounds;
+        const float other_area = other.bounds.SurfaceArea();
+        for (uint32 grandchild = 0; grandchild < 2; ++grandchild)
+        {
+            const Bounds& remaining_bounds = nodes_[other.children[1 - grandchild]].bounds;
+            const float gain = other_area - Bounds::Union(child_bounds, remaining_bounds).SurfaceArea();
+            if (gain > best_gain)
+            {
+                best_gain = gain;
+                best_side = side;
+                best_grandchild = grandchild;
+            }
+        }
+    }
+
+    if (best_side == 2)
+    {
+        return false;
+    }
+
+    const uint32 child = node.children[best_side];
+    const uint32 other_idx = node.children[1 - best_side];
+    Node& other = nodes_[other_idx];
+    const uint32 grandchild = other.children[best_grandchild];
+
+    node.children[best_side] = grandchild;
+    nodes_[grandchild].parent = node_idx;
+    other.children[best_grandchild] = child;
+    nodes_[child].parent = other_idx;
+    RefitNode(other_idx);
+    return true;
+}
+
+void BoundingVolumeHierarchy::RefitNode(uint32 node_idx)
+{
+    Node& node = nodes_[node_idx];
+    node.bounds = Bounds::Union(nodes_[node.children[0]].bounds, nodes_[node.children[1]].bounds);
+}
+
+void BoundingVolumeHierarchy::CollectSubtrees(uint32 num_subtrees, std::vector<uint32>& out_subtrees, std::vector<uint32>* out_upper_nodes) const
+{
+    out_subtrees.clear();
+    if (root_ == INVALID_NODE)
+    {
+        return;
+    }
+
+    // Expands one level at a time, leaves stay as they are
+    out_subtrees.push_back(root_);
+    std::vector<uint32> next_subtrees;
+    while (out_subtrees.size() < num_subtrees)
+    {
+        next_subtrees.clear();
+        bool was_expanded = false;
+        for (const uint32 node_idx : out_subtrees)
+        {
+            const Node& node = nodes_[node_idx];
+            if (node.IsLeaf())
+            {
+                next_subtrees.push_back(node_idx);
+                continue;
+            }
+
+            if (out_upper_nodes != nullptr)
+            {
+                out_upper_nodes->push_back(node_idx);
+            }
+            next_subtrees.push_back(node.children[0]);
+            next_subtrees.push_back(node.children[1]);
+            was_expanded = true;
+        }
+
+        if (was_expanded == false)
+        {
+            break;
+        }
+        std::swap(out_subtrees, next_subtrees);
+    }
+}
+
+void BoundingVolumeHierarchy::CollectLeaves(uint32 node_idx, std::vector<uint32>& out_user_ids) const
+{
+    std::vector<uint32> stack = { node_idx };
+    while (stack.empty() == false)
+    {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+        if (node.IsLeaf())
+        {
+            out_user_ids.push_back(node.user_id);
+        }
+        else
+        {
+            stack.push_back(node.children[1]);
+            stack.push_back(node.children[0]);
+        }
+    }
+}
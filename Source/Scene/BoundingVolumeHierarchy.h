@@ -0,0 +1,198 @@
+#pragma once
+#include <atomic>
+#include <span>
+
+#include "Core/RayPacket.h"
+
+struct BvhRayHit
+{
+    static inline constexpr uint32 INVALID_USER_ID = std::numeric_limits<uint32>::max();
+
+    uint32 user_id = INVALID_USER_ID;
+    float distance = std::numeric_limits<float>::max();
+
+    bool IsHit() const
+    {
+        return user_id != INVALID_USER_ID;
+    }
+};
+
+// Results of one query of a batch, in the shared result array
+struct BvhQueryRange
+{
+    uint32 offset = 0;
+    uint32 count = 0;
+};
+
+struct BvhStats
+{
+    uint32 num_proxies = 0;
+    uint32 num_rotations = 0;   // Applied by the last MoveProxy() or Refit()
+};
+
+/**
+ * @brief Binary tree of boxes with one proxy per leaf, for queries that would otherwise test every object.
+ * Static geometry is best built at once with Build(), which splits by the surface area heuristic. Moving proxies
+ * refit their ancestors and rotate nodes on the way up (Kopta et al.) so the tree quality doesn't decay over time.
+ * Proxies are node indices and stay stable until destroyed. Queries are const and may run concurrently.
+ */
+class BoundingVolumeHierarchy
+{
+public:
+    static inline constexpr uint32 INVALID_NODE = std::numeric_limits<uint32>::max();
+
+    /**
+     * @brief Replaces the tree with a binned SAH build. The proxy and user id of boxes[i] are both i.
+     * Large subtrees are built in parallel.
+     */
+    void Build(std::span<const Box> boxes);
+    void Clear();
+
+    /**
+     * @brief Inserts a leaf next to the sibling that increases the surface area the least.
+     */
+    uint32 CreateProxy(const Box& box, uint32 user_id);
+    void DestroyProxy(uint32 proxy);
+
+    /**
+     * @brief Updates the bounds and refits all ancestors, rotating them where that reduces the surface area.
+     * Proxies whose new bounds don't overlap the old ones are reinserted instead.
+     */
+    void MoveProxy(uint32 proxy, const Box& box);
+
+    /**
+     * @brief Only updates the leaf bounds, call Refit() after moving many proxies at once.
+     */
+    void SetProxyBounds(uint32 proxy, const Box& box);
+
+    /**
+     * @brief Recomputes every internal node bottom up, subtrees in parallel.
+     * @param rotate Also rotates nodes where that reduces the surface area, which keeps the tree good for moving objects.
+     */
+    void Refit(bool rotate = true);
+
+    uint32 GetUserId(uint32 proxy) const;
+    Box GetProxyBounds(uint32 proxy) const;
+
+    /**
+     * @brief Appends the user ids of leaves overlapping box.
+     */
+    void QueryBox(const Box& box, std::vector<uint32>& out_user_ids) const;
+
+    /**
+     * @brief Collects the user ids of leaves intersecting the frustum. Subtrees are traversed in parallel and
+     * subtrees fully inside the frustum are collected without further tests. The order is deterministic.
+     */
+    void QueryFrustum(const Mat4& view_projection, std::vector<uint32>& out_user_ids) const;
+
+    /**
+     * @brief Closest leaf box hit by the ray, nearer children first so far subtrees are pruned early.
+     */
+    BvhRayHit Raycast(const Ray& ray) const;
+
+    /**
+     * @brief Visits the leaves whose boxes the ray hits, nearer subtrees first. on_leaf tests whatever the leaf stands
+     * for and returns the distance of the closest hit so far, or max_distance, and the traversal stops at that distance.
+     */
+    void RaycastLeaves(const Ray& ray, const std::function<float(uint32 user_id, float max_distance)>& on_leaf) const;
+
+    /**
+     * @brief Traverses with all rays of the packet at once, so each node is loaded once for eight coherent rays.
+     * on_leaf gets the lanes whose rays hit the leaf's box and may shorten their max distance in the packet.
+     */
+    void RaycastPacket(RayPacket& packet, const std::function<void(uint32 user_id, uint32 lane_mask)>& on_leaf) const;
+
+    /**
+     * @brief Runs QueryBox() for every box in parallel. Results of boxes[i] are the out_ranges[i] part of out_user_ids.
+     */
+    void QueryBoxes(std::span<const Box> boxes, std::vector<BvhQueryRange>& out_ranges, std::vector<uint32>& out_user_ids) const;
+
+    /**
+     * @brief Runs Raycast() for every ray in parallel.
+     */
+    void Raycasts(std::span<const Ray> rays, std::span<BvhRayHit> out_hits) const;
+
+    /**
+     * @brief Sum of the surface areas of all internal nodes relative to the root's, lower is better.
+     */
+    float CalculateCost() const;
+
+    uint32 GetNumProxies() const
+    {
+        return stats_.num_proxies;
+    }
+
+    const BvhStats& GetStats() const
+    {
+        return stats_;
+    }
+
+private:
+    static inline constexpr uint32 FREE_NODE = INVALID_NODE - 1;
+    static inline constexpr uint32 NUM_SAH_BINS = 16;
+    static inline constexpr uint32 MIN_PARALLEL_BUILD_SIZE = 4096;
+    static inline constexpr uint32 NUM_SUBTREES_PER_THREAD = 4;
+    static inline constexpr uint32 MIN_QUERIES_PER_JOB = 64;
+
+    struct Bounds
+    {
+        float min_x = std::numeric_limits<float>::max();
+        float min_y = std::numeric_limits<float>::max();
+        float min_z = std::numeric_limits<float>::max();
+        float max_x = std::numeric_limits<float>::lowest();
+        float max_y = std::numeric_limits<float>::lowest();
+        float max_z = std::numeric_limits<float>::lowest();
+
+        static Bounds FromBox(const Box& box);
+        static Bounds Union(const Bounds& a, const Bounds& b);
+        Box ToBox() const;
+
+        void Grow(const Bounds& other);
+        void Grow(const Vec3& point);
+        float SurfaceArea() const;
+        bool Overlaps(const Bounds& other) const;
+    };
+
+    struct Node
+    {
+        Bounds bounds;
+        uint32 parent = INVALID_NODE;
+        uint32 children[2] = { INVALID_NODE, INVALID_NODE };
+        uint32 user_id = 0;     // Leaves only
+
+        bool IsLeaf() const
+        {
+            return children[0] == INVALID_NODE;
+        }
+    };
+
+    uint32 AllocateNode();
+    void FreeNode(uint32 node_idx);
+    const Node& GetLeaf(uint32 proxy) const;
+
+    uint32 BuildRange(std::span<uint32> refs, std::span<const Vec3> centroids, uint32 parent, std::atomic<uint32>& next_internal);
+    void InsertLeaf(uint32 leaf);
+    void RemoveLeaf(uint32 leaf);
+
+    // Refits and rotates from node_idx up to the root
+    void FixUpwards(uint32 node_idx);
+    bool Rotate(uint32 node_idx);
+    void RefitNode(uint32 node_idx);
+
+    /**
+     * @brief Splits the tree top down into at least num_subtrees roots where possible, e.g. one job each.
+     * @param out_upper_nodes Internal nodes above the subtrees, parents before children.
+     */
+    void CollectSubtrees(uint32 num_subtrees, std::vector<uint32>& out_subtrees, std::vector<uint32>* out_upper_nodes) const;
+    void CollectLeaves(uint32 node_idx, std::vector<uint32>& out_user_ids) const;
+
+    // on_leaf(user_id, entry_distance) returns the new max distance
+    template <typename OnLeaf>
+    void TraverseRay(const Ray& ray, OnLeaf&& on_leaf) const;
+
+    std::vector<Node> nodes_;
+    std::vector<uint32> free_nodes_;
+    uint32 root_ = INVALID_NODE;
+
+    BvhStats stats_;
+};
@@ -0,0 +1,104 @@
+#include "Scene/LodSelector.h"
+
+#include "Core/SimdLanes.h"
+#include "Renderer/Camera.h"
+
+void LodSelector::Init(const LodSettings& settings)
+{
+    CHECK(settings.num_lods > 0 && settings.num_lods <= LodSettings::MAX_LODS);
+    CHECK(settings.max_pixel_error > 0.0f && settings.hysteresis >= 0.0f && settings.hysteresis < 1.0f && settings.max_bias >= 0.0f);
+    for (uint32 lod = 1; lod < settings.num_lods; ++lod)
+    {
+        CHECK_MSG(settings.relative_errors[lod] > settings.relative_errors[lod - 1], "LOD errors have to increase, LOD {} doesn't", lod);
+    }
+
+    settings_ = settings;
+    bias_ = 0.0f;
+    UpdateLimits();
+}
+
+void LodSelector::Update(const Camera& camera, float viewport_height)
+{
+    camera_position_ = camera.GetPosition();
+    near_clip_ = camera.GetNearClip();
+    projection_scale_ = 0.5f * viewport_height / std::tan(0.5f * camera.GetFov());
+}
+
+void LodSelector::UpdateBias(double frame_ms)
+{
+    if (settings_.target_frame_ms <= 0.0f || frame_ms <= 0.0)
+    {
+        return;
+    }
+
+    // Normalized, positive if over budget. Integrates, so a steady overshoot keeps coarsening until frames fit.
+    const float error = static_cast<float>((frame_ms - settings_.target_frame_ms) / settings_.target_frame_ms);
+    SetBias(bias_ + settings_.bias_gain * error);
+}
+
+void LodSelector::SetBias(float bias)
+{
+    bias_ = std::clamp(bias, 0.0f, settings_.max_bias);
+    UpdateLimits();
+}
+
+void LodSelector::SelectLods(const Box* world_bounds, uint32 count, uint8* in_out_lods) const
+{
+    using namespace simd;
+    CHECK(count <= NUM_LANES);
+
+    // Bounding spheres of the boxes, relative to the camera. Unused lanes sit at the camera with radius 0, their LODs aren't stored.
+    alignas(32) float offset_x[NUM_LANES] = {};
+    alignas(32) float offset_y[NUM_LANES] = {};
+    alignas(32) float offset_z[NUM_LANES] = {};
+    alignas(32) float radius_sq[NUM_LANES] = {};
+    alignas(32) float last_lods[NUM_LANES] = {};
+    for (uint32 lane = 0; lane < count; ++lane)
+    {
+        const Box& box = world_bounds[lane];
+        const float extent_x = box.max_x - box.min_x;
+        const float extent_y = box.max_y - box.min_y;
+        const float extent_z = box.max_z - box.min_z;
+        offset_x[lane] = (box.min_x + box.max_x) * 0.5f - camera_position_.x;
+        offset_y[lane] = (box.min_y + box.max_y) * 0.5f - camera_position_.y;
+        offset_z[lane] = (box.min_z + box.max_z) * 0.5f - camera_position_.z;
+        radius_sq[lane] = 0.25f * (extent_x * extent_x + extent_y * extent_y + extent_z * extent_z);
+        last_lods[lane] = static_cast<float>(in_out_lods[lane]);
+    }
+
+    const FloatLanes x = Load(offset_x);
+    const FloatLanes y = Load(offset_y);
+    const FloatLanes z = Load(offset_z);
+    const FloatLanes distance = Max(Sqrt(x * x + y * y + z * z), Splat(near_clip_));
+    const FloatLanes projected_radius = Sqrt(Load(radius_sq)) * Splat(projection_scale_) / distance;
+
+    // Limits decrease with the LOD, so the number of limits an object is within is its LOD
+    const FloatLanes last_lod = Load(last_lods);
+    const FloatLanes one = Splat(1.0f);
+    const FloatLanes zero = Splat(0.0f);
+    FloatLanes lod = zero;
+    for (uint32 lod_idx = 1; lod_idx < settings_.num_lods; ++lod_idx)
+    {
+        const FloatLanes limit = Splat(radius_limits_[lod_idx]);
+        const FloatLanes coarsening_limit = Splat(radius_limits_[lod_idx] * (1.0f - settings_.hysteresis));
+        const FloatLanes threshold = Select(last_lod >= Splat(static_cast<float>(lod_idx)), limit, coarsening_limit);
+        lod = lod + Select(projected_radius <= threshold, one, zero);
+    }
+
+    alignas(32) float lods[NUM_LANES];
+    Store(lods, lod);
+    for (uint32 lane = 0; lane < count; ++lane)
+    {
+        in_out_lods[lane] = static_cast<uint8>(lods[lane]);
+    }
+}
+
+void LodSelector::UpdateLimits()
+{
+    const float max_error = settings_.max_pixel_error * std::exp2(bias_);
+    radius_limits_[0] = std::numeric_limits<float>::max();
+    for (uint32 lod = 1; lod < settings_.num_lods; ++lod)
+    {
+        radius_limits_[lod] = max_error / settings_.relative_errors[lod];
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+class Camera;
+
+struct LodSettings
+{
+    static inline constexpr uint32 MAX_LODS = 4;
+
+    uint32 num_lods = MAX_LODS;
+    std::array<float, MAX_LODS> relative_errors = { 0.0f, 0.01f, 0.03f, 0.1f };     // Geometric error per LOD as a fraction of the bounding radius, increasing
+    float max_pixel_error = 1.0f;               // Largest screen space error a LOD may have
+    float hysteresis = 0.2f;                    // Coarser LODs are only picked once their error is this fraction below the limit
+    float target_frame_ms = 0.0f;               // Frame time budget steering the bias, 0 disables
+    float bias_gain = 0.1f;                     // Bias change per frame for a frame time off by 100%
+    float max_bias = 3.0f;                      // In doublings of the allowed error
+};
+
+/**
+ * @brief Picks a LOD per object from the screen space error of its LODs, i.e. each LOD's geometric error projected at the
+ * object's distance. The coarsest LOD within max_pixel_error is chosen.
+ * Hysteresis keeps objects at their LOD until the error is clearly below the next limit, so objects hovering around a
+ * limit don't pop back and forth. Refining is never delayed, so the error bound holds.
+ * A bias scales the allowed error, raised while frames are over budget and lowered again once they fit.
+ */
+class LodSelector
+{
+public:
+    void Init(const LodSettings& settings);
+
+    /**
+     * @brief Per frame, before selecting. Pixels are square, so the vertical FOV and viewport height give the projection scale.
+     */
+    void Update(const Camera& camera, float viewport_height);
+
+    /**
+     * @brief Feeds the last frame time into the bias. No-op if target_frame_ms is 0.
+     */
+    void UpdateBias(double frame_ms);
+
+    void SetBias(float bias);
+    float GetBias() const
+    {
+        return bias_;
+    }
+
+    /**
+     * @brief Selects the LODs of up to simd::NUM_LANES objects at once from their world bounds.
+     * @param in_out_lods Last LODs for the hysteresis, overwritten by the new ones.
+     */
+    void SelectLods(const Box* world_bounds, uint32 count, uint8* in_out_lods) const;
+
+    const LodSettings& GetSettings() const
+    {
+        return settings_;
+    }
+
+private:
+    void UpdateLimits();
+
+    LodSettings settings_;
+    float bias_ = 0.0f;
+
+    Vec3 camera_position_ = Vec3::ZERO;
+    float near_clip_ = 0.1f;
+    float projection_scale_ = 1.0f;     // Pixels per world unit at distance 1
+
+    // Largest projected bounding radius in pixels at which each LOD is within the error limit
+    std::array<float, LodSettings::MAX_LODS> radius_limits_ = {};
+};
@@ -0,0 +1,232 @@
+#include "Scene/MeshRaycaster.h"
+
+#include "Core/JobSystem.h"
+#include "Core/RadixSort.h"
+
+namespace
+{
+    // Spreads the lower 10 bits of v so there are two zero bits between each
+    uint32 SpreadBits(uint32 v)
+    {
+        v = (v | (v << 16)) & 0x030000FF;
+        v = (v | (v << 8)) & 0x0300F00F;
+        v = (v | (v << 4)) & 0x030C30C3;
+        v = (v | (v << 2)) & 0x09249249;
+        return v;
+    }
+}
+
+void MeshRaycaster::Init(std::span<const RaycastMesh> meshes)
+{
+    // World space corners, three per triangle
+    std::vector<uint32> triangle_offsets(meshes.size() + 1, 0);
+    for (uint32 mesh_idx = 0; mesh_idx < meshes.size(); ++mesh_idx)
+    {
+        CHECK_MSG(meshes[mesh_idx].num_indices % 3 == 0, "Mesh {} is not a triangle list", mesh_idx);
+        triangle_offsets[mesh_idx + 1] = triangle_offsets[mesh_idx] + meshes[mesh_idx].num_indices / 3;
+    }
+    num_triangles_ = triangle_offsets.back();
+
+    std::vector<Vec3> corners(3 * num_triangles_);
+    std::vector<uint32> triangle_meshes(num_triangles_);
+    jobs::Dispatch(static_cast<uint32>(meshes.size()), [&](uint32 mesh_idx)
+    {
+        const RaycastMesh& mesh = meshes[mesh_idx];
+        const uint8* positions = static_cast<const uint8*>(mesh.positions);
+        std::vector<Vec3> world_positions(mesh.num_vertices);
+        for (uint32 i = 0; i < mesh.num_vertices; ++i)
+        {
+            const float* position = reinterpret_cast<const float*>(positions + i * mesh.position_stride);
+            world_positions[i] = Vec3(position[0], position[1], position[2]) * mesh.world;
+        }
+
+        const uint32 first_triangle = triangle_offsets[mesh_idx];
+        for (uint32 i = 0; i < mesh.num_indices; ++i)
+        {
+            CHECK(mesh.indices[i] < mesh.num_vertices);
+            corners[3 * first_triangle + i] = world_positions[mesh.indices[i]];
+        }
+        std::fill(triangle_meshes.begin() + first_triangle, triangle_meshes.begin() + triangle_offsets[mesh_idx + 1], mesh_idx);
+    });
+
+    // Morton order of the centroids, so the triangles of a block are close to each other and its bounds stay tight
+    Box bounds;
+    for (const Vec3& corner : corners)
+    {
+        bounds.min_x = std::min(bounds.min_x, corner.x);
+        bounds.min_y = std::min(bounds.min_y, corner.y);
+        bounds.min_z = std::min(bounds.min_z, corner.z);
+        bounds.max_x = std::max(bounds.max_x, corner.x);
+        bounds.max_y = std::max(bounds.max_y, corner.y);
+        bounds.max_z = std::max(bounds.max_z, corner.z);
+    }
+    const float scale_x = 1023.0f / std::max(bounds.max_x - bounds.min_x, 1e-6f);
+    const float scale_y = 1023.0f / std::max(bounds.max_y - bounds.min_y, 1e-6f);
+    const float scale_z = 1023.0f / std::max(bounds.max_z - bounds.min_z, 1e-6f);
+
+    std::vector<RadixSortEntry> order(num_triangles_);
+    jobs::ParallelFor(num_triangles_, 4096, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            const Vec3& a = corners[3 * i];
+            const Vec3& b = corners[3 * i + 1];
+            const Vec3& c = corners[3 * i + 2];
+            const uint32 x = static_cast<uint32>(((a.x + b.x + c.x) / 3.0f - bounds.min_x) * scale_x);
+            const uint32 y = static_cast<uint32>(((a.y + b.y + c.y) / 3.0f - bounds.min_y) * scale_y);
+            const uint32 z = static_cast<uint32>(((a.z + b.z + c.z) / 3.0f - bounds.min_z) * scale_z);
+            order[i] = { .key = (SpreadBits(x) << 2) | (SpreadBits(y) << 1) | SpreadBits(z), .value = i };
+        }
+    });
+    std::vector<RadixSortEntry> scratch;
+    RadixSort(order, scratch);
+
+    const uint32 num_blocks = (num_triangles_ + simd::NUM_LANES - 1) / simd::NUM_LANES;
+    blocks_.assign(num_blocks, TriangleLanes());
+    mesh_indices_.assign(num_blocks * simd::NUM_LANES, MeshRayHit::INVALID_IDX);
+    triangle_indices_.assign(num_blocks * simd::NUM_LANES, MeshRayHit::INVALID_IDX);
+    std::vector<Box> block_bounds(num_blocks);
+    jobs::ParallelFor(num_blocks, 1024, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 block_idx = begin; block_idx < end; ++block_idx)
+        {
+            TriangleLanes& block = blocks_[block_idx];
+            Box& box = block_bounds[block_idx];
+            for (uint32 lane = 0; lane < simd::NUM_LANES; ++lane)
+            {
+                const uint32 slot = block_idx * simd::NUM_LANES + lane;
+                if (slot >= num_triangles_)
+                {
+                    break;
+                }
+
+                const uint32 triangle = order[slot].value;
+                const Vec3& v0 = corners[3 * triangle];
+                const Vec3& v1 = corners[3 * triangle + 1];
+                const Vec3& v2 = corners[3 * triangle + 2];
+                block.v0_x[lane] = v0.x;
+                block.v0_y[lane] = v0.y;
+                block.v0_z[lane] = v0.z;
+                block.edge_1_x[lane] = v1.x - v0.x;
+                block.edge_1_y[lane] = v1.y - v0.y;
+                block.edge_1_z[lane] = v1.z - v0.z;
+                block.edge_2_x[lane] = v2.x - v0.x;
+                block.edge_2_y[lane] = v2.y - v0.y;
+                block.edge_2_z[lane] = v2.z - v0.z;
+
+                const uint32 mesh_idx = triangle_meshes[triangle];
+                mesh_indices_[slot] = mesh_idx;
+                triangle_indices_[slot] = triangle - triangle_offsets[mesh_idx];
+
+                for (const Vec3* corner : { &v0, &v1, &v2 })
+                {
+                    box.min_x = std::min(box.min_x, corner->x);
+                    box.min_y = std::min(box.min_y, corner->y);
+                    box.min_z = std::min(box.min_z, corner->z);
+                    box.max_x = std::max(box.max_x, corner->x);
+                    box.max_y = std::max(box.max_y, corner->y);
+                    box.max_z = std::max(box.max_z, corner->z);
+                }
+            }
+        }
+    });
+
+    bvh_.Build(block_bounds);
+}
+
+MeshRayHit MeshRaycaster::Raycast(const Ray& ray, RayQuery query) const
+{
+    MeshRayHit hit;
+    alignas(32) float distances[simd::NUM_LANES];
+    alignas(32) float us[simd::NUM_LANES];
+    alignas(32) float vs[simd::NUM_LANES];
+    bvh_.RaycastLeaves(ray, [&](uint32 block_idx, float max_distance)
+    {
+        TriangleLaneHits lane_hits;
+        uint32 hit_mask = ray_kernels::IntersectTriangles(ray, max_distance, blocks_[block_idx], lane_hits);
+        if (hit_mask == 0)
+        {
+            return max_distance;
+        }
+
+        simd::Store(distances, lane_hits.distance);
+        simd::Store(us, lane_hits.u);
+        simd::Store(vs, lane_hits.v);
+        for (; hit_mask != 0; hit_mask &= hit_mask - 1)
+        {
+            const uint32 lane = std::countr_zero(hit_mask);
+            if (distances[lane] <= max_distance)
+            {
+                const uint32 slot = block_idx * simd::NUM_LANES + lane;
+                hit = { .mesh_idx = mesh_indices_[slot], .triangle_idx = triangle_indices_[slot], .distance = distances[lane], .u = us[lane], .v = vs[lane] };
+                max_distance = distances[lane];
+            }
+        }
+
+        // A negative distance ends the traversal
+        return query == RayQuery::ANY_HIT ? -1.0f : max_distance;
+    });
+    return hit;
+}
+
+void MeshRaycaster::Raycasts(std::span<const Ray> rays, std::span<MeshRayHit> out_hits, RayQuery query) const
+{
+    CHECK(rays.size() == out_hits.size());
+    const uint32 num_rays = static_cast<uint32>(rays.size());
+    const uint32 num_packets = (num_rays + simd::NUM_LANES - 1) / simd::NUM_LANES;
+    jobs::ParallelFor(num_packets, MIN_PACKETS_PER_JOB, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 packet_idx = begin; packet_idx < end; ++packet_idx)
+        {
+            const uint32 first_ray = packet_idx * simd::NUM_LANES;
+            const uint32 packet_size = std::min(simd::NUM_LANES, num_rays - first_ray);
+            RaycastPacket(rays.subspan(first_ray, packet_size), out_hits.subspan(first_ray, packet_size), query);
+        }
+    });
+}
+
+void MeshRaycaster::RaycastPacket(std::span<const Ray> rays, std::span<MeshRayHit> out_hits, RayQuery query) const
+{
+    RayPacket packet = RayPacket::Load(rays);
+    std::array<MeshRayHit, simd::NUM_LANES> hits;
+    alignas(32) float distances[simd::NUM_LANES];
+    alignas(32) float us[simd::NUM_LANES];
+    alignas(32) float vs[simd::NUM_LANES];
+    bvh_.RaycastPacket(packet, [&](uint32 block_idx, uint32 lane_mask)
+    {
+        // Eight rays against each triangle of the block
+        const TriangleLanes& block = blocks_[block_idx];
+        for (uint32 triangle_lane = 0; triangle_lane < simd::NUM_LANES; ++triangle_lane)
+        {
+            const uint32 slot = block_idx * simd::NUM_LANES + triangle_lane;
+            if (triangle_indices_[slot] == MeshRayHit::INVALID_IDX)
+            {
+                break;
+            }
+
+            const Vec3 v0(block.v0_x[triangle_lane], block.v0_y[triangle_lane], block.v0_z[triangle_lane]);
+            const Vec3 edge_1(block.edge_1_x[triangle_lane], block.edge_1_y[triangle_lane], block.edge_1_z[triangle_lane]);
+            const Vec3 edge_2(block.edge_2_x[triangle_lane], block.edge_2_y[triangle_lane], block.edge_2_z[triangle_lane]);
+            TriangleLaneHits lane_hits;
+            uint32 hit_mask = ray_kernels::IntersectTriangle(packet, v0, edge_1, edge_2, lane_hits) & lane_mask;
+            if (hit_mask == 0)
+            {
+                continue;
+            }
+
+            simd::Store(distances, lane_hits.distance);
+            simd::Store(us, lane_hits.u);
+            simd::Store(vs, lane_hits.v);
+            for (; hit_mask != 0; hit_mask &= hit_mask - 1)
+            {
+                const uint32 ray_lane = std::countr_zero(hit_mask);
+                hits[ray_lane] = { .mesh_idx = mesh_indices_[slot], .triangle_idx = triangle_indices_[slot], .distance = distances[ray_lane], .u = us[ray_lane], .v = vs[ray_lane] };
+
+                // Shorter rays skip everything behind the hit, negative ones are done
+                packet.max_distance[ray_lane] = query == RayQuery::ANY_HIT ? -1.0f : distances[ray_lane];
+            }
+        }
+    });
+
+    std::copy_n(hits.begin(), out_hits.size(), out_hits.begin());
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <span>
+
+#include "Scene/BoundingVolumeHierarchy.h"
+
+/**
+ * @brief Triangle list as index and position streams, e.g. the ones uploaded for rendering.
+ */
+struct RaycastMesh
+{
+    const void* positions = nullptr;        // Object space, x y z as the first three floats of each vertex
+    uint32 position_stride = sizeof(Vec3);
+    uint32 num_vertices = 0;
+    const uint32* indices = nullptr;
+    uint32 num_indices = 0;
+    Mat4 world = Mat4::IDENTITY;
+};
+
+struct MeshRayHit
+{
+    static inline constexpr uint32 INVALID_IDX = std::numeric_limits<uint32>::max();
+
+    uint32 mesh_idx = INVALID_IDX;
+    uint32 triangle_idx = INVALID_IDX;      // Its indices start at 3 * triangle_idx
+    float distance = std::numeric_limits<float>::max();
+    float u = 0.0f;                         // Barycentrics of the triangle's second and third vertex
+    float v = 0.0f;
+
+    bool IsHit() const
+    {
+        return triangle_idx != INVALID_IDX;
+    }
+};
+
+enum class RayQuery : uint8
+{
+    CLOSEST_HIT,
+    ANY_HIT         // Stops at the first hit found, e.g. for line of sight. That hit isn't necessarily the closest.
+};
+
+/**
+ * @brief Casts rays against static triangle meshes on the CPU, e.g. for picking, line of sight or light baking.
+ * Init() transforms all triangles to world space, orders them along a Morton curve and packs them into blocks of eight,
+ * so one SIMD test covers a block. A BVH over the blocks finds the ones a ray can hit.
+ * Batches are split into packets of eight rays that traverse the BVH together, which pays off for coherent rays
+ * such as neighbouring camera rays or rays leaving one probe.
+ */
+class MeshRaycaster
+{
+public:
+    void Init(std::span<const RaycastMesh> meshes);
+
+    MeshRayHit Raycast(const Ray& ray, RayQuery query = RayQuery::CLOSEST_HIT) const;
+
+    /**
+     * @brief Packets of eight consecutive rays, spread across the job system.
+     */
+    void Raycasts(std::span<const Ray> rays, std::span<MeshRayHit> out_hits, RayQuery query = RayQuery::CLOSEST_HIT) const;
+
+    uint32 GetNumTriangles() const
+    {
+        return num_triangles_;
+    }
+
+private:
+    static inline constexpr uint32 MIN_PACKETS_PER_JOB = 16;
+
+    void RaycastPacket(std::span<const Ray> rays, std::span<MeshRayHit> out_hits, RayQuery query) const;
+
+    std::vector<TriangleLanes> blocks_;
+    std::vector<uint32> mesh_indices_;          // Per block lane, INVALID_IDX for unused lanes
+    std::vector<uint32> triangle_indices_;      // Per block lane
+    BoundingVolumeHierarchy bvh_;               // Over block bounds, user id is the block index
+    uint32 num_triangles_ = 0;
+};
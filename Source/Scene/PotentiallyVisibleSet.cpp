@@ -0,0 +1,276 @@
+#include "Scene/PotentiallyVisibleSet.h"
+
+#include <chrono>
+#include <random>
+#include <string_view>
+
+#include "Core/JobSystem.h"
+
+namespace
+{
+    bool Overlaps(const Box& a, const Box& b)
+    {
+        return a.min_x <= b.max_x && a.max_x >= b.min_x
+            && a.min_y <= b.max_y && a.max_y >= b.min_y
+            && a.min_z <= b.max_z && a.max_z >= b.min_z;
+    }
+}
+
+void PotentiallyVisibleSet::Bake(std::span<const RaycastMesh> objects, const PvsBakeSettings& settings)
+{
+    CHECK(settings.cell_size > 0.0f && settings.num_origins_per_cell > 0 && settings.cube_map_size > 0);
+    const auto bake_start = std::chrono::high_resolution_clock::now();
+    Clear();
+
+    view_region_ = settings.view_region;
+    cell_size_ = settings.cell_size;
+    num_cells_x_ = std::max(static_cast<uint32>(std::ceil((view_region_.max_x - view_region_.min_x) / cell_size_)), 1u);
+    num_cells_y_ = std::max(static_cast<uint32>(std::ceil((view_region_.max_y - view_region_.min_y) / cell_size_)), 1u);
+    num_cells_z_ = std::max(static_cast<uint32>(std::ceil((view_region_.max_z - view_region_.min_z) / cell_size_)), 1u);
+    num_objects_ = static_cast<uint32>(objects.size());
+    const uint32 num_cells = num_cells_x_ * num_cells_y_ * num_cells_z_;
+
+    MeshRaycaster raycaster;
+    raycaster.Init(objects);
+
+    std::vector<Box> object_bounds(num_objects_);
+    jobs::ParallelFor(num_objects_, 256, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 object_idx = begin; object_idx < end; ++object_idx)
+        {
+            const RaycastMesh& object = objects[object_idx];
+            const uint8* positions = static_cast<const uint8*>(object.positions);
+            Box& bounds = object_bounds[object_idx];
+            for (uint32 i = 0; i < object.num_vertices; ++i)
+            {
+                const float* position = reinterpret_cast<const float*>(positions + i * object.position_stride);
+                const Vec3 world_position = Vec3(position[0], position[1], position[2]) * object.world;
+                bounds.min_x = std::min(bounds.min_x, world_position.x);
+                bounds.min_y = std::min(bounds.min_y, world_position.y);
+                bounds.min_z = std::min(bounds.min_z, world_position.z);
+                bounds.max_x = std::max(bounds.max_x, world_position.x);
+                bounds.max_y = std::max(bounds.max_y, world_position.y);
+                bounds.max_z = std::max(bounds.max_z, world_position.z);
+            }
+        }
+    });
+
+    // Each origin casts the texels of a jittered cube map, row by row, so packets of consecutive rays stay coherent
+    const uint32 map_size = settings.cube_map_size;
+    const uint32 num_rays_per_origin = 6 * map_size * map_size;
+    std::vector<Ray> rays(settings.num_origins_per_cell * num_rays_per_origin);
+    std::vector<MeshRayHit> hits(rays.size());
+
+    const uint32 num_words = (num_objects_ + 63) / 64;
+    baked_objects_.assign(num_words, 0);
+    for (uint32 object_idx = 0; object_idx < num_objects_; ++object_idx)
+    {
+        if (objects[object_idx].num_indices >= 3)
+        {
+            baked_objects_[object_idx / 64] |= 1ull << (object_idx % 64);
+        }
+    }
+
+    std::vector<uint64> visible(num_words);
+    std::vector<uint8> compressed;
+    std::unordered_multimap<size_t, uint32> unique_cells;   // Hash of the compressed set to the first cell using it
+    uint64 num_visible = 0;
+
+    cell_offsets_.resize(num_cells);
+    cell_sizes_.resize(num_cells);
+    for (uint32 cell_idx = 0; cell_idx < num_cells; ++cell_idx)
+    {
+        const Box cell_bounds = GetCellBounds(cell_idx);
+        jobs::ParallelFor(settings.num_origins_per_cell, 1, [&](uint32 begin, uint32 end)
+        {
+            for (uint32 origin_idx = begin; origin_idx < end; ++origin_idx)
+            {
+                std::mt19937 rng(cell_idx * settings.num_origins_per_cell + origin_idx);
+                std::uniform_real_distribution<float> jitter(0.0f, 1.0f);
+                const Vec3 origin(
+                    cell_bounds.min_x + jitter(rng) * (cell_bounds.max_x - cell_bounds.min_x),
+                    cell_bounds.min_y + jitter(rng) * (cell_bounds.max_y - cell_bounds.min_y),
+                    cell_bounds.min_z + jitter(rng) * (cell_bounds.max_z - cell_bounds.min_z));
+
+                Ray* origin_rays = &rays[origin_idx * num_rays_per_origin];
+                for (uint32 face = 0; face < 6; ++face)
+                {
+                    const uint32 axis = face / 2;
+                    const float sign = (face % 2) == 0 ? 1.0f : -1.0f;
+                    for (uint32 y = 0; y < map_size; ++y)
+                    {
+                        for (uint32 x = 0; x < map_size; ++x)
+                        {
+                            float direction[3];
+                            direction[axis] = sign;
+                            direction[(axis + 1) % 3] = (x + jitter(rng)) / map_size * 2.0f - 1.0f;
+                            direction[(axis + 2) % 3] = (y + jitter(rng)) / map_size * 2.0f - 1.0f;
+                            *origin_rays++ = Ray(origin, Vec3(direction[0], direction[1], direction[2]));
+                        }
+                    }
+                }
+            }
+        });
+        raycaster.Raycasts(rays, hits);
+
+        std::fill(visible.begin(), visible.end(), 0);
+        for (const MeshRayHit& hit : hits)
+        {
+            if (hit.IsHit())
+            {
+                visible[hit.mesh_idx / 64] |= 1ull << (hit.mesh_idx % 64);
+            }
+        }
+        for (uint32 object_idx = 0; object_idx < num_objects_; ++object_idx)
+        {
+            if (Overlaps(object_bounds[object_idx], cell_bounds))
+            {
+                visible[object_idx / 64] |= 1ull << (object_idx % 64);
+            }
+        }
+        for (const uint64 word : visible)
+        {
+            num_visible += std::popcount(word);
+        }
+
+        compressed.clear();
+        Compress({ reinterpret_cast<const uint8*>(visible.data()), num_words * sizeof(uint64) }, compressed);
+        const std::string_view compressed_view(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+        const size_t hash = std::hash<std::string_view>()(compressed_view);
+
+        cell_sizes_[cell_idx] = static_cast<uint32>(compressed.size());
+        cell_offsets_[cell_idx] = static_cast<uint32>(data_.size());
+        const auto [first, last] = unique_cells.equal_range(hash);
+        const auto same_cell = std::find_if(first, last, [&](const std::pair<const size_t, uint32>& entry)
+        {
+            const uint32 other_cell = entry.second;
+            return cell_sizes_[other_cell] == compressed.size()
+                && std::equal(compressed.begin(), compressed.end(), data_.begin() + cell_offsets_[other_cell]);
+        });
+        if (same_cell != last)
+        {
+            cell_offsets_[cell_idx] = cell_offsets_[same_cell->second];
+        }
+        else
+        {
+            data_.insert(data_.end(), compressed.begin(), compressed.end());
+            unique_cells.emplace(hash, cell_idx);
+        }
+    }
+
+    stats_ = {
+        .num_cells = num_cells,
+        .num_objects = num_objects_,
+        .num_unique_cells = static_cast<uint32>(unique_cells.size()),
+        .compressed_bytes = static_cast<uint32>(data_.size()),
+        .uncompressed_bytes = num_cells * num_words * static_cast<uint32>(sizeof(uint64)),
+        .average_visible = static_cast<float>(static_cast<double>(num_visible) / num_cells),
+        .bake_time_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - bake_start).count()
+    };
+}
+
+void PotentiallyVisibleSet::Clear()
+{
+    num_cells_x_ = 0;
+    num_cells_y_ = 0;
+    num_cells_z_ = 0;
+    num_objects_ = 0;
+    baked_objects_.clear();
+    cell_offsets_.clear();
+    cell_sizes_.clear();
+    data_.clear();
+    selected_cell_ = INVALID_CELL;
+    selected_visible_.clear();
+    stats_ = {};
+}
+
+uint32 PotentiallyVisibleSet::GetCellIdx(const Vec3& position) const
+{
+    if (IsBaked() == false
+        || position.x < view_region_.min_x || position.y < view_region_.min_y || position.z < view_region_.min_z
+        || position.x > view_region_.max_x || position.y > view_region_.max_y || position.z > view_region_.max_z)
+    {
+        return INVALID_CELL;
+    }
+
+    // The max side belongs to the last cell
+    const uint32 x = std::min(static_cast<uint32>((position.x - view_region_.min_x) / cell_size_), num_cells_x_ - 1);
+    const uint32 y = std::min(static_cast<uint32>((position.y - view_region_.min_y) / cell_size_), num_cells_y_ - 1);
+    const uint32 z = std::min(static_cast<uint32>((position.z - view_region_.min_z) / cell_size_), num_cells_z_ - 1);
+    return (z * num_cells_y_ + y) * num_cells_x_ + x;
+}
+
+Box PotentiallyVisibleSet::GetCellBounds(uint32 cell_idx) const
+{
+    CHECK(cell_idx < num_cells_x_ * num_cells_y_ * num_cells_z_);
+    const uint32 x = cell_idx % num_cells_x_;
+    const uint32 y = (cell_idx / num_cells_x_) % num_cells_y_;
+    const uint32 z = cell_idx / (num_cells_x_ * num_cells_y_);
+    const float min_x = view_region_.min_x + x * cell_size_;
+    const float min_y = view_region_.min_y + y * cell_size_;
+    const float min_z = view_region_.min_z + z * cell_size_;
+    return Box(
+        min_x, std::min(min_x + cell_size_, view_region_.max_x),
+        min_y, std::min(min_y + cell_size_, view_region_.max_y),
+        min_z, std::min(min_z + cell_size_, view_region_.max_z));
+}
+
+void PotentiallyVisibleSet::DecompressCell(uint32 cell_idx, std::vector<uint64>& out_visible) const
+{
+    CHECK(cell_idx < cell_offsets_.size());
+    out_visible.assign((num_objects_ + 63) / 64, 0);
+    uint8* out_bytes = reinterpret_cast<uint8*>(out_visible.data());
+    const uint8* data = &data_[cell_offsets_[cell_idx]];
+    const uint8* data_end = data + cell_sizes_[cell_idx];
+    while (data < data_end)
+    {
+        if (*data != 0)
+        {
+            *out_bytes++ = *data++;
+        }
+        else
+        {
+            // Already zeroed
+            out_bytes += data[1];
+            data += 2;
+        }
+    }
+}
+
+void PotentiallyVisibleSet::SelectCell(const Vec3& position)
+{
+    const uint32 cell_idx = GetCellIdx(position);
+    if (cell_idx != selected_cell_)
+    {
+        selected_cell_ = cell_idx;
+        if (cell_idx != INVALID_CELL)
+        {
+            DecompressCell(cell_idx, selected_visible_);
+        }
+        else
+        {
+            selected_visible_.clear();
+        }
+    }
+}
+
+void PotentiallyVisibleSet::Compress(std::span<const uint8> bytes, std::vector<uint8>& out_data)
+{
+    for (size_t i = 0; i < bytes.size();)
+    {
+        if (bytes[i] != 0)
+        {
+            out_data.push_back(bytes[i++]);
+            continue;
+        }
+
+        uint8 num_zeros = 0;
+        while (i < bytes.size() && bytes[i] == 0 && num_zeros < std::numeric_limits<uint8>::max())
+        {
+            ++num_zeros;
+            ++i;
+        }
+        out_data.push_back(0);
+        out_data.push_back(num_zeros);
+    }
+}
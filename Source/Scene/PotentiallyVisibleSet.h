@@ -0,0 +1,108 @@
+#pragma once
+#include <span>
+
+#include "Scene/MeshRaycaster.h"
+
+struct PvsBakeSettings
+{
+    Box view_region;                    // Where the camera can be, tiled by cells
+    float cell_size = 16.0f;
+    uint32 num_origins_per_cell = 32;   // Jittered sample points inside each cell
+    uint32 cube_map_size = 16;          // Rays per origin are the texels of a cube map of this size
+};
+
+struct PvsStats
+{
+    uint32 num_cells = 0;
+    uint32 num_objects = 0;
+    uint32 num_unique_cells = 0;        // Cells with identical sets share their data
+    uint32 compressed_bytes = 0;
+    uint32 uncompressed_bytes = 0;      // One bit per object and cell
+    float average_visible = 0.0f;       // Objects per cell
+    double bake_time_ms = 0.0;
+};
+
+/**
+ * @brief Precomputed potentially visible sets for static scenes. The view region is split into a grid of cells and each
+ * cell stores which objects can be seen from anywhere inside it, so at runtime the camera's cell rejects most of a level
+ * before any per object test runs.
+ * Visibility is sampled with ray casts from points inside each cell, cube maps of rays each, so objects smaller than the
+ * ray spacing at their distance may be missed. Objects overlapping a cell are always visible from it.
+ * Sets are bitsets compressed by run lengths of zero bytes, identical sets are stored once.
+ * Unused at runtime: Renderer::Render doesn't cull with it, there is no baked data for the demo scene. Only -pvs_benchmark
+ * and -pvs_selftest bake and query sets.
+ */
+class PotentiallyVisibleSet
+{
+public:
+    static inline constexpr uint32 INVALID_CELL = std::numeric_limits<uint32>::max();
+
+    /**
+     * @brief Object i is objects[i], so bit i of a cell's set. Objects without triangles, e.g. free entity slots, aren't baked.
+     * Rays are cast across all cores, one cell after another.
+     */
+    void Bake(std::span<const RaycastMesh> objects, const PvsBakeSettings& settings);
+    void Clear();
+
+    bool IsBaked() const
+    {
+        return cell_offsets_.empty() == false;
+    }
+
+    /**
+     * @brief INVALID_CELL outside the view region.
+     */
+    uint32 GetCellIdx(const Vec3& position) const;
+    Box GetCellBounds(uint32 cell_idx) const;
+
+    /**
+     * @brief Expands the cell's set to one bit per object, bit i of word i / 64.
+     */
+    void DecompressCell(uint32 cell_idx, std::vector<uint64>& out_visible) const;
+
+    /**
+     * @brief Selects the cell containing position for IsVisible(), only decompressed when the cell changes.
+     */
+    void SelectCell(const Vec3& position);
+
+    /**
+     * @brief Whether object_idx can be seen from the selected cell. Objects which weren't baked, i.e. past the end or without
+     * triangles at bake time, are always visible, as is everything while the camera is outside the view region.
+     */
+    bool IsVisible(uint32 object_idx) const
+    {
+        if (selected_cell_ == INVALID_CELL || object_idx >= num_objects_)
+        {
+            return true;
+        }
+
+        const uint64 bit = 1ull << (object_idx % 64);
+        return (baked_objects_[object_idx / 64] & bit) == 0 || (selected_visible_[object_idx / 64] & bit) != 0;
+    }
+
+    const PvsStats& GetStats() const
+    {
+        return stats_;
+    }
+
+private:
+    // A zero byte is followed by the number of zero bytes it stands for
+    static void Compress(std::span<const uint8> bytes, std::vector<uint8>& out_data);
+
+    Box view_region_;
+    float cell_size_ = 1.0f;
+    uint32 num_cells_x_ = 0;
+    uint32 num_cells_y_ = 0;
+    uint32 num_cells_z_ = 0;
+    uint32 num_objects_ = 0;
+    std::vector<uint64> baked_objects_; // Bit per object with triangles
+
+    std::vector<uint32> cell_offsets_;  // Into data_, per cell
+    std::vector<uint32> cell_sizes_;    // Compressed bytes, per cell
+    std::vector<uint8> data_;
+
+    uint32 selected_cell_ = INVALID_CELL;
+    std::vector<uint64> selected_visible_;
+
+    PvsStats stats_;
+};
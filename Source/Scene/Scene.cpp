@@ -0,0 +1,241 @@
+#include "Scene/Scene.h"
+
+#include <atomic>
+
+#include "Core/JobSystem.h"
+#include "Core/SimdLanes.h"
+#include "Scene/LodSelector.h"
+#include "Scene/PotentiallyVisibleSet.h"
+
+namespace
+{
+    // Bounds of the transformed box, from its center and extents (Arvo)
+    Box TransformBox(const Box& box, const Affine3x4& m)
+    {
+        const float center_x = (box.min_x + box.max_x) * 0.5f;
+        const float center_y = (box.min_y + box.max_y) * 0.5f;
+        const float center_z = (box.min_z + box.max_z) * 0.5f;
+        const float extent_x = (box.max_x - box.min_x) * 0.5f;
+        const float extent_y = (box.max_y - box.min_y) * 0.5f;
+        const float extent_z = (box.max_z - box.min_z) * 0.5f;
+
+        const Vec4& row_x = m.rows[0];
+        const Vec4& row_y = m.rows[1];
+        const Vec4& row_z = m.rows[2];
+        const float world_center_x = center_x * row_x.x + center_y * row_x.y + center_z * row_x.z + row_x.w;
+        const float world_center_y = center_x * row_y.x + center_y * row_y.y + center_z * row_y.z + row_y.w;
+        const float world_center_z = center_x * row_z.x + center_y * row_z.y + center_z * row_z.z + row_z.w;
+        const float world_extent_x = extent_x * std::abs(row_x.x) + extent_y * std::abs(row_x.y) + extent_z * std::abs(row_x.z);
+        const float world_extent_y = extent_x * std::abs(row_y.x) + extent_y * std::abs(row_y.y) + extent_z * std::abs(row_y.z);
+        const float world_extent_z = extent_x * std::abs(row_z.x) + extent_y * std::abs(row_z.y) + extent_z * std::abs(row_z.z);
+
+        return Box(
+            world_center_x - world_extent_x, world_center_x + world_extent_x,
+            world_center_y - world_extent_y, world_center_y + world_extent_y,
+            world_center_z - world_extent_z, world_center_z + world_extent_z);
+    }
+}
+
+EntityHandle Scene::CreateEntity(const EntityDesc& desc)
+{
+    uint32 slot_idx = 0;
+    if (free_slots_.empty() == false)
+    {
+        slot_idx = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else
+    {
+        slot_idx = static_cast<uint32>(slots_.size());
+        slots_.emplace_back();
+    }
+
+    const uint32 dense_idx = GetNumEntities();
+    slots_[slot_idx].dense_idx = dense_idx;
+
+    slot_indices_.push_back(slot_idx);
+    translations_.push_back(desc.translation);
+    rotations_.push_back(desc.rotation);
+    scales_.push_back(desc.scale);
+    world_transforms_.push_back(Affine3x4::IDENTITY);
+    local_bounds_.push_back(desc.local_bounds);
+    world_bounds_.push_back(desc.local_bounds);
+    mesh_ids_.push_back(desc.mesh_id);
+    material_ids_.push_back(desc.material_id);
+    flags_.push_back(desc.flags | EntityFlags::TRANSFORM_DIRTY);
+    lods_.push_back(0);
+
+    stats_.num_entities = GetNumEntities();
+    return { .idx = slot_idx, .generation = slots_[slot_idx].generation };
+}
+
+void Scene::DestroyEntity(EntityHandle handle)
+{
+    const uint32 dense_idx = GetDenseIdx(handle);
+    const uint32 last_idx = GetNumEntities() - 1;
+
+    // Move the last entity into the hole
+    if (dense_idx != last_idx)
+    {
+        slot_indices_[dense_idx] = slot_indices_[last_idx];
+        translations_[dense_idx] = translations_[last_idx];
+        rotations_[dense_idx] = rotations_[last_idx];
+        scales_[dense_idx] = scales_[last_idx];
+        world_transforms_[dense_idx] = world_transforms_[last_idx];
+        local_bounds_[dense_idx] = local_bounds_[last_idx];
+        world_bounds_[dense_idx] = world_bounds_[last_idx];
+        mesh_ids_[dense_idx] = mesh_ids_[last_idx];
+        material_ids_[dense_idx] = material_ids_[last_idx];
+        flags_[dense_idx] = flags_[last_idx];
+        lods_[dense_idx] = lods_[last_idx];
+        slots_[slot_indices_[dense_idx]].dense_idx = dense_idx;
+    }
+
+    slot_indices_.pop_back();
+    translations_.pop_back();
+    rotations_.pop_back();
+    scales_.pop_back();
+    world_transforms_.pop_back();
+    local_bounds_.pop_back();
+    world_bounds_.pop_back();
+    mesh_ids_.pop_back();
+    material_ids_.pop_back();
+    flags_.pop_back();
+    lods_.pop_back();
+
+    ++slots_[handle.idx].generation;
+    free_slots_.push_back(handle.idx);
+    stats_.num_entities = GetNumEntities();
+}
+
+bool Scene::IsAlive(EntityHandle handle) const
+{
+    return handle.idx < slots_.size() && slots_[handle.idx].generation == handle.generation;
+}
+
+uint32 Scene::GetDenseIdx(EntityHandle handle) const
+{
+    CHECK_MSG(IsAlive(handle), "Entity {} (generation {}) is not alive", handle.idx, handle.generation);
+    return slots_[handle.idx].dense_idx;
+}
+
+EntityHandle Scene::GetHandle(uint32 dense_idx) const
+{
+    CHECK(dense_idx < GetNumEntities());
+    const uint32 slot_idx = slot_indices_[dense_idx];
+    return { .idx = slot_idx, .generation = slots_[slot_idx].generation };
+}
+
+void Scene::SetLocalTransform(EntityHandle handle, const Vec3& translation, const Quat& rotation, const Vec3& scale)
+{
+    const uint32 dense_idx = GetDenseIdx(handle);
+    translations_[dense_idx] = translation;
+    rotations_[dense_idx] = rotation;
+    scales_[dense_idx] = scale;
+    flags_[dense_idx] |= EntityFlags::TRANSFORM_DIRTY;
+}
+
+void Scene::SetTranslation(EntityHandle handle, const Vec3& translation)
+{
+    const uint32 dense_idx = GetDenseIdx(handle);
+    translations_[dense_idx] = translation;
+    flags_[dense_idx] |= EntityFlags::TRANSFORM_DIRTY;
+}
+
+void Scene::SetFlags(EntityHandle handle, uint32 flags)
+{
+    const uint32 dense_idx = GetDenseIdx(handle);
+    flags_[dense_idx] = (flags & ~EntityFlags::TRANSFORM_DIRTY) | (flags_[dense_idx] & EntityFlags::TRANSFORM_DIRTY);
+}
+
+void Scene::UpdateTransforms()
+{
+    std::atomic<uint32> num_updated = 0;
+    jobs::ParallelFor(GetNumEntities(), 1024, [&](uint32 begin, uint32 end)
+    {
+        uint32 num_batch_updated = 0;
+        for (uint32 i = begin; i < end; ++i)
+        {
+            if ((flags_[i] & EntityFlags::TRANSFORM_DIRTY) == 0)
+            {
+                continue;
+            }
+
+            world_transforms_[i] = Affine3x4::SRT(scales_[i], rotations_[i], translations_[i]);
+            world_bounds_[i] = TransformBox(local_bounds_[i], world_transforms_[i]);
+            flags_[i] &= ~EntityFlags::TRANSFORM_DIRTY;
+            ++num_batch_updated;
+        }
+        num_updated += num_batch_updated;
+    });
+    stats_.num_updated = num_updated;
+}
+
+void Scene::CullFrustum(const Mat4& view_projection, std::vector<uint32>& out_visible, const PotentiallyVisibleSet* pvs,
+    const LodSelector* lod_selector)
+{
+    const Frustum frustum(view_projection);
+
+    // Chunks collect their survivors separately and are concatenated in order, so the output doesn't depend on scheduling
+    const uint32 num_entities = GetNumEntities();
+    const uint32 num_chunks = (num_entities + CULL_CHUNK_SIZE - 1) / CULL_CHUNK_SIZE;
+    if (chunk_visible_.size() < num_chunks)
+    {
+        chunk_visible_.resize(num_chunks);
+    }
+
+    jobs::Dispatch(num_chunks, [&](uint32 chunk_idx)
+    {
+        std::vector<uint32>& visible = chunk_visible_[chunk_idx];
+        visible.clear();
+
+        const uint32 end = std::min(num_entities, (chunk_idx + 1) * CULL_CHUNK_SIZE);
+        for (uint32 group_begin = chunk_idx * CULL_CHUNK_SIZE; group_begin < end; group_begin += simd::NUM_LANES)
+        {
+            // Bounds of a group are still in cache for the LOD selection
+            const uint32 group_end = std::min(end, group_begin + simd::NUM_LANES);
+            const size_t num_visible_before = visible.size();
+            for (uint32 i = group_begin; i < group_end; ++i)
+            {
+                if ((flags_[i] & EntityFlags::VISIBLE) == 0)
+                {
+                    continue;
+                }
+
+                if (pvs != nullptr && pvs->IsVisible(slot_indices_[i]) == false)
+                {
+                    continue;
+                }
+
+                if (frustum.Intersects(world_bounds_[i]))
+                {
+                    visible.push_back(i);
+                }
+            }
+
+            if (lod_selector != nullptr && visible.size() != num_visible_before)
+            {
+                lod_selector->SelectLods(&world_bounds_[group_begin], group_end - group_begin, &lods_[group_begin]);
+            }
+        }
+    });
+
+    out_visible.clear();
+    for (uint32 chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx)
+    {
+        out_visible.insert(out_visible.end(), chunk_visible_[chunk_idx].begin(), chunk_visible_[chunk_idx].end());
+    }
+    stats_.num_visible = static_cast<uint32>(out_visible.size());
+}
+
+void Scene::GatherWorldTransforms(std::span<const uint32> dense_indices, Affine3x4* out_world_transforms) const
+{
+    jobs::ParallelFor(static_cast<uint32>(dense_indices.size()), 4096, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            CHECK(dense_indices[i] < GetNumEntities());
+            out_world_transforms[i] = world_transforms_[dense_indices[i]];
+        }
+    });
+}
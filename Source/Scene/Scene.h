@@ -0,0 +1,180 @@
+#pragma once
+#include <span>
+
+class LodSelector;
+class PotentiallyVisibleSet;
+
+/**
+ * @brief Reference to a scene entity. The generation changes whenever the entity's slot is reused,
+ * so handles to destroyed entities are detected instead of silently referring to whatever lives there now.
+ */
+struct EntityHandle
+{
+    static inline constexpr uint32 INVALID_IDX = std::numeric_limits<uint32>::max();
+
+    uint32 idx = INVALID_IDX;
+    uint32 generation = 0;
+
+    bool IsValid() const
+    {
+        return idx != INVALID_IDX;
+    }
+
+    bool operator==(const EntityHandle& other) const = default;
+};
+
+struct EntityFlags
+{
+    static inline constexpr uint32 VISIBLE = 1u << 0;           // Considered by culling
+    static inline constexpr uint32 CAST_SHADOWS = 1u << 1;
+    static inline constexpr uint32 TRANSFORM_DIRTY = 1u << 2;   // Set by transform changes, cleared by UpdateTransforms()
+};
+
+struct EntityDesc
+{
+    Vec3 translation = Vec3::ZERO;
+    Quat rotation = Quat::IDENTITY;
+    Vec3 scale = Vec3::ONE;
+    Box local_bounds = Box(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+    uint32 mesh_id = 0;
+    uint32 material_id = 0;
+    uint32 flags = EntityFlags::VISIBLE;
+};
+
+struct SceneStats
+{
+    uint32 num_entities = 0;
+    uint32 num_updated = 0;     // Transforms recomputed by the last UpdateTransforms()
+    uint32 num_visible = 0;     // Entities passing the last CullFrustum()
+};
+
+/**
+ * @brief Entities stored as packed arrays, one per attribute, so systems iterate contiguous memory.
+ * Arrays are indexed by dense index, which is only stable until the next DestroyEntity(): destroying moves the last
+ * entity into the hole to keep the arrays packed. Handles stay valid across that and map to the current dense index.
+ * Not thread safe, but the bulk operations split their work across the job system.
+ */
+class Scene
+{
+public:
+    EntityHandle CreateEntity(const EntityDesc& desc);
+    void DestroyEntity(EntityHandle handle);
+    bool IsAlive(EntityHandle handle) const;
+
+    uint32 GetNumEntities() const
+    {
+        return static_cast<uint32>(slot_indices_.size());
+    }
+
+    uint32 GetDenseIdx(EntityHandle handle) const;
+    EntityHandle GetHandle(uint32 dense_idx) const;
+
+    void SetLocalTransform(EntityHandle handle, const Vec3& translation, const Quat& rotation, const Vec3& scale);
+    void SetTranslation(EntityHandle handle, const Vec3& translation);
+    void SetFlags(EntityHandle handle, uint32 flags);
+
+    /**
+     * @brief Recomputes world transforms and world bounds of entities whose transform changed since the last call.
+     */
+    void UpdateTransforms();
+
+    /**
+     * @brief Fills out_visible with the dense indices of visible entities whose world bounds intersect the frustum, in dense order.
+     * @param pvs Optional, baked with one object per entity slot (EntityHandle::idx) and the camera's cell selected.
+     * Entities it can't see are skipped, slots which were free or didn't exist at bake time are kept.
+     * @param lod_selector Optional, also selects the LODs of the visible entities in the same pass, eight at a time. See GetLods().
+     */
+    void CullFrustum(const Mat4& view_projection, std::vector<uint32>& out_visible, const PotentiallyVisibleSet* pvs = nullptr,
+        const LodSelector* lod_selector = nullptr);
+
+    /**
+     * @brief Copies the world transforms of the given entities to out_world_transforms, e.g. a mapped instance buffer.
+     */
+    void GatherWorldTransforms(std::span<const uint32> dense_indices, Affine3x4* out_world_transforms) const;
+
+    std::span<const Vec3> GetTranslations() const
+    {
+        return translations_;
+    }
+
+    std::span<const Quat> GetRotations() const
+    {
+        return rotations_;
+    }
+
+    std::span<const Vec3> GetScales() const
+    {
+        return scales_;
+    }
+
+    // Stored in the instance data layout, so they are copied to the GPU as they are
+    std::span<const Affine3x4> GetWorldTransforms() const
+    {
+        return world_transforms_;
+    }
+
+    std::span<const Box> GetLocalBounds() const
+    {
+        return local_bounds_;
+    }
+
+    std::span<const Box> GetWorldBounds() const
+    {
+        return world_bounds_;
+    }
+
+    std::span<const uint32> GetMeshIds() const
+    {
+        return mesh_ids_;
+    }
+
+    std::span<const uint32> GetMaterialIds() const
+    {
+        return material_ids_;
+    }
+
+    std::span<const uint32> GetFlags() const
+    {
+        return flags_;
+    }
+
+    // Selected by CullFrustum() with a LodSelector, 0 until then. Updated for every entity of a group of eight dense
+    // indices with a visible one, culled ones included. Groups without any keep their older LODs.
+    std::span<const uint8> GetLods() const
+    {
+        return lods_;
+    }
+
+    const SceneStats& GetStats() const
+    {
+        return stats_;
+    }
+
+private:
+    static inline constexpr uint32 CULL_CHUNK_SIZE = 4096;
+
+    struct Slot
+    {
+        uint32 dense_idx = 0;
+        uint32 generation = 0;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<uint32> free_slots_;
+
+    // Dense arrays, all of the same size
+    std::vector<uint32> slot_indices_;
+    std::vector<Vec3> translations_;
+    std::vector<Quat> rotations_;
+    std::vector<Vec3> scales_;
+    std::vector<Affine3x4> world_transforms_;
+    std::vector<Box> local_bounds_;
+    std::vector<Box> world_bounds_;
+    std::vector<uint32> mesh_ids_;
+    std::vector<uint32> material_ids_;
+    std::vector<uint32> flags_;
+    std::vector<uint8> lods_;
+
+    std::vector<std::vector<uint32>> chunk_visible_;   // Per cull chunk, reused across frames
+    SceneStats stats_;
+};
@@ -0,0 +1,458 @@
+#include "Scene/SceneBenchmark.h"
+
+#include <chrono>
+#include <random>
+
+#include "Core/JobSystem.h"
+#include "Renderer/Camera.h"
+#include "Renderer/Mesh.h"
+#include "Renderer/ShadowCascades.h"
+#include "Scene/BoundingVolumeHierarchy.h"
+#include "Scene/LodSelector.h"
+#include "Scene/MeshRaycaster.h"
+#include "Scene/PotentiallyVisibleSet.h"
+#include "Scene/Scene.h"
+#include "Scene/TransformHierarchy.h"
+
+namespace
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    static inline constexpr float WORLD_HALF_EXTENT = 500.0f;
+
+    double ElapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Cubes on a grid with random heights, standing on y = 0 with streets between them
+    std::vector<Mat4> CreateCity(uint32 num_cubes, float& out_half_extent)
+    {
+        static constexpr float SPACING = 4.0f;
+        const uint32 grid_size = static_cast<uint32>(std::ceil(std::sqrt(static_cast<float>(num_cubes))));
+        out_half_extent = 0.5f * SPACING * grid_size;
+
+        std::mt19937 rng(1337);
+        std::uniform_real_distribution<float> height(1.0f, 8.0f);
+        std::vector<Mat4> world_matrices(num_cubes);
+        for (uint32 i = 0; i < num_cubes; ++i)
+        {
+            const float h = height(rng);
+            const float x = (i % grid_size) * SPACING - out_half_extent;
+            const float z = (i / grid_size) * SPACING - out_half_extent;
+            world_matrices[i] = Mat4::Scaling(Vec3(1.0f, h, 1.0f)) * Mat4::Translation(x, h, z);
+        }
+        return world_matrices;
+    }
+
+    // References the cube's vertex and index data
+    RaycastMesh MakeCubeMesh(const Mat4& world)
+    {
+        return {
+            .positions = CubeMeshData::POS.data(),
+            .position_stride = sizeof(Vec4),
+            .num_vertices = static_cast<uint32>(CubeMeshData::POS.size()),
+            .indices = CubeMeshData::INDICES.data(),
+            .num_indices = static_cast<uint32>(CubeMeshData::INDICES.size()),
+            .world = world
+        };
+    }
+}
+
+void RunSceneBenchmark(uint32 num_entities, uint32 num_iterations)
+{
+    CHECK(num_iterations > 0);
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> position(-WORLD_HALF_EXTENT, WORLD_HALF_EXTENT);
+    std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+
+    Scene scene;
+    std::vector<EntityHandle> handles;
+    handles.reserve(num_entities);
+    const auto create_start = Clock::now();
+    for (uint32 i = 0; i < num_entities; ++i)
+    {
+        EntityDesc desc;
+        desc.translation = Vec3(position(rng), position(rng), position(rng));
+        desc.rotation = Quat::FromAxisAngle(Vec3::UP, angle(rng));
+        desc.scale = Vec3(scale(rng));
+        desc.mesh_id = i % 16;
+        desc.material_id = i % 64;
+        desc.flags = EntityFlags::VISIBLE | EntityFlags::CAST_SHADOWS;
+        handles.push_back(scene.CreateEntity(desc));
+    }
+    const double create_ms = ElapsedMs(create_start);
+
+    Camera camera(Vec3::ZERO, Camera::DEFAULT_ASPECT_RATIO, Camera::DEFAULT_FOV, 0.1f, 2.0f * WORLD_HALF_EXTENT);
+    camera.UpdateMatrices();
+
+    gfx::ShadowCascades shadow_cascades;
+    shadow_cascades.Init(gfx::MAX_SHADOW_CASCADES, 2048, WORLD_HALF_EXTENT);
+    const Vec3 light_direction = Vec3::Normalize(Vec3(0.3f, -1.0f, 0.4f));
+
+    LodSelector lod_selector;
+    lod_selector.Init(LodSettings());
+    lod_selector.Update(camera, 1080.0f);
+
+    std::vector<uint32> visible;
+    std::vector<Affine3x4> gathered(num_entities);
+    std::vector<uint8> cascade_masks;
+    double update_ms = 0.0;
+    double cull_ms = 0.0;
+    double lod_cull_ms = 0.0;
+    double shadow_cull_ms = 0.0;
+    double gather_ms = 0.0;
+    for (uint32 iteration = 0; iteration < num_iterations; ++iteration)
+    {
+        // Everything moves, which is the worst case for the transform update
+        const auto update_start = Clock::now();
+        const std::span<const Vec3> translations = scene.GetTranslations();
+        for (uint32 i = 0; i < num_entities; ++i)
+        {
+            const Vec3& translation = translations[i];
+            scene.SetTranslation(scene.GetHandle(i), Vec3(translation.x, translation.y + 0.01f, translation.z));
+        }
+        scene.UpdateTransforms();
+        update_ms += ElapsedMs(update_start);
+
+        const auto cull_start = Clock::now();
+        scene.CullFrustum(camera.GetViewProjection(), visible);
+        cull_ms += ElapsedMs(cull_start);
+
+        const auto lod_cull_start = Clock::now();
+        scene.CullFrustum(camera.GetViewProjection(), visible, nullptr, &lod_selector);
+        lod_cull_ms += ElapsedMs(lod_cull_start);
+
+        // All cascades in one pass
+        const auto shadow_cull_start = Clock::now();
+        shadow_cascades.Update(camera, light_direction);
+        shadow_cascades.CullCasters(scene.GetWorldBounds(), scene.GetFlags(), cascade_masks);
+        shadow_cull_ms += ElapsedMs(shadow_cull_start);
+
+        const auto gather_start = Clock::now();
+        scene.GatherWorldTransforms(visible, gathered.data());
+        gather_ms += ElapsedMs(gather_start);
+    }
+
+    LOG("Scene benchmark: {} entities created in {:.3f} ms, {} iterations", num_entities, create_ms, num_iterations);
+    LOG("Update {:.3f} ms, cull {:.3f} ms, gather {:.3f} ms per iteration, {} visible ({:.1f}%)",
+        update_ms / num_iterations, cull_ms / num_iterations, gather_ms / num_iterations,
+        visible.size(), 100.0 * visible.size() / std::max(num_entities, 1u));
+    std::array<uint32, LodSettings::MAX_LODS> num_per_lod = {};
+    for (const uint32 entity_idx : visible)
+    {
+        ++num_per_lod[scene.GetLods()[entity_idx]];
+    }
+    LOG("Cull with LOD selection {:.3f} ms per iteration, visible per LOD {} / {} / {} / {}",
+        lod_cull_ms / num_iterations, num_per_lod[0], num_per_lod[1], num_per_lod[2], num_per_lod[3]);
+    const std::array<uint32, gfx::MAX_SHADOW_CASCADES>& num_casters = shadow_cascades.GetStats().num_casters;
+    LOG("Shadow caster cull {:.3f} ms per iteration for {} cascades, casters per cascade {} / {} / {} / {}",
+        shadow_cull_ms / num_iterations, shadow_cascades.GetNumCascades(), num_casters[0], num_casters[1], num_casters[2], num_casters[3]);
+}
+
+void RunTransformHierarchyBenchmark(uint32 num_nodes, float changed_fraction, uint32 num_iterations)
+{
+    CHECK(num_nodes > 0 && num_iterations > 0);
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+
+    // A few hundred roots, every other node hangs below a random earlier one, which gives trees of depth ~15
+    const uint32 num_roots = std::max(num_nodes / 1000, 1u);
+    TransformHierarchy hierarchy;
+    std::vector<TransformHandle> handles;
+    handles.reserve(num_nodes);
+    for (uint32 i = 0; i < num_nodes; ++i)
+    {
+        const TransformHandle parent = i < num_roots ? TransformHandle() : handles[std::uniform_int_distribution<uint32>(0, i - 1)(rng)];
+        const Mat4 local_matrix = Mat4::SRT(Vec3::ONE, Quat::FromAxisAngle(Vec3::UP, angle(rng)), Vec3(offset(rng), offset(rng), offset(rng)));
+        handles.push_back(hierarchy.CreateNode(parent, local_matrix));
+    }
+
+    const auto build_start = Clock::now();
+    hierarchy.Update();
+    const double build_ms = ElapsedMs(build_start);
+    const uint32 num_levels = hierarchy.GetStats().num_levels;
+
+    const uint32 num_changed = std::max(static_cast<uint32>(num_nodes * changed_fraction), 1u);
+    std::uniform_int_distribution<uint32> node(0, num_nodes - 1);
+    double partial_ms = 0.0;
+    uint64 num_partial_updated = 0;
+    for (uint32 iteration = 0; iteration < num_iterations; ++iteration)
+    {
+        for (uint32 i = 0; i < num_changed; ++i)
+        {
+            const TransformHandle handle = handles[node(rng)];
+            hierarchy.SetLocalTransform(handle, Vec3::ONE, Quat::FromAxisAngle(Vec3::UP, angle(rng)), Vec3(offset(rng), offset(rng), offset(rng)));
+        }
+
+        const auto update_start = Clock::now();
+        hierarchy.Update();
+        partial_ms += ElapsedMs(update_start);
+        num_partial_updated += hierarchy.GetStats().num_updated;
+    }
+
+    // Worst case, every root moves
+    double full_ms = 0.0;
+    for (uint32 iteration = 0; iteration < num_iterations; ++iteration)
+    {
+        for (uint32 i = 0; i < num_roots; ++i)
+        {
+            hierarchy.SetLocalMatrix(handles[i], Mat4::Translation(offset(rng), 0.0f, 0.0f));
+        }
+
+        const auto update_start = Clock::now();
+        hierarchy.Update();
+        full_ms += ElapsedMs(update_start);
+    }
+
+    LOG("Transform hierarchy benchmark: {} nodes in {} levels, first update (incl. ordering) {:.3f} ms", num_nodes, num_levels, build_ms);
+    LOG("{} changed per frame: {:.3f} ms, {} world matrices recomputed on average. All dirty: {:.3f} ms",
+        num_changed, partial_ms / num_iterations, num_partial_updated / num_iterations, full_ms / num_iterations);
+}
+
+void RunBvhBenchmark(uint32 max_boxes, uint32 num_queries)
+{
+    CHECK(num_queries > 0);
+    for (uint32 num_boxes = 100000; num_boxes <= max_boxes; num_boxes *= 10)
+    {
+        // Same density for every size
+        const float half_extent = WORLD_HALF_EXTENT * std::cbrt(num_boxes / 1000000.0f);
+        std::mt19937 rng(1337);
+        std::uniform_real_distribution<float> position(-half_extent, half_extent);
+        std::uniform_real_distribution<float> size(0.25f, 2.0f);
+        std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+        const auto make_box = [](const Vec3& center, float half_size)
+        {
+            return Box(center.x - half_size, center.x + half_size, center.y - half_size, center.y + half_size, center.z - half_size, center.z + half_size);
+        };
+
+        std::vector<Box> boxes(num_boxes);
+        for (Box& box : boxes)
+        {
+            box = make_box(Vec3(position(rng), position(rng), position(rng)), size(rng));
+        }
+
+        BoundingVolumeHierarchy bvh;
+        const auto build_start = Clock::now();
+        bvh.Build(boxes);
+        const double build_ms = ElapsedMs(build_start);
+        const float build_cost = bvh.CalculateCost();
+
+        // Everything moves a little, then one refit
+        for (uint32 i = 0; i < num_boxes; ++i)
+        {
+            Box& box = boxes[i];
+            const float dx = offset(rng);
+            box = Box(box.min_x + dx, box.max_x + dx, box.min_y, box.max_y, box.min_z, box.max_z);
+            bvh.SetProxyBounds(i, box);
+        }
+        const auto refit_start = Clock::now();
+        bvh.Refit();
+        const double refit_ms = ElapsedMs(refit_start);
+        const uint32 num_refit_rotations = bvh.GetStats().num_rotations;
+
+        // 1% moves further, one proxy at a time
+        const uint32 num_moved = std::max(num_boxes / 100, 1u);
+        std::uniform_int_distribution<uint32> proxy(0, num_boxes - 1);
+        std::vector<std::pair<uint32, Box>> moves(num_moved);
+        for (std::pair<uint32, Box>& move : moves)
+        {
+            move.first = proxy(rng);
+            const Box& box = boxes[move.first];
+            const Vec3 center((box.min_x + box.max_x) * 0.5f, (box.min_y + box.max_y) * 0.5f, (box.min_z + box.max_z) * 0.5f);
+            move.second = make_box(Vec3(center.x + 4.0f * offset(rng), center.y + 4.0f * offset(rng), center.z + 4.0f * offset(rng)), size(rng));
+        }
+        const auto move_start = Clock::now();
+        for (const std::pair<uint32, Box>& move : moves)
+        {
+            bvh.MoveProxy(move.first, move.second);
+            boxes[move.first] = move.second;
+        }
+        const double move_ms = ElapsedMs(move_start);
+        const float moved_cost = bvh.CalculateCost();
+
+        Camera camera(Vec3::ZERO, Camera::DEFAULT_ASPECT_RATIO, Camera::DEFAULT_FOV, 0.1f, half_extent);
+        camera.UpdateMatrices();
+        std::vector<uint32> visible;
+        const auto frustum_start = Clock::now();
+        bvh.QueryFrustum(camera.GetViewProjection(), visible);
+        const double frustum_ms = ElapsedMs(frustum_start);
+
+        const Frustum frustum(camera.GetViewProjection());
+        uint32 num_linear_visible = 0;
+        const auto linear_start = Clock::now();
+        for (const Box& box : boxes)
+        {
+            num_linear_visible += frustum.Intersects(box) ? 1 : 0;
+        }
+        const double linear_ms = ElapsedMs(linear_start);
+
+        std::vector<Box> query_boxes(num_queries);
+        std::vector<Ray> rays(num_queries);
+        for (uint32 i = 0; i < num_queries; ++i)
+        {
+            query_boxes[i] = make_box(Vec3(position(rng), position(rng), position(rng)), 5.0f);
+            rays[i] = Ray(Vec3(position(rng), position(rng), position(rng)), Vec3(offset(rng), offset(rng), offset(rng)), 2.0f * half_extent);
+        }
+
+        std::vector<BvhQueryRange> ranges;
+        std::vector<uint32> overlaps;
+        const auto boxes_start = Clock::now();
+        bvh.QueryBoxes(query_boxes, ranges, overlaps);
+        const double boxes_ms = ElapsedMs(boxes_start);
+
+        std::vector<BvhRayHit> hits(num_queries);
+        const auto rays_start = Clock::now();
+        bvh.Raycasts(rays, hits);
+        const double rays_ms = ElapsedMs(rays_start);
+        const size_t num_hits = std::count_if(hits.begin(), hits.end(), [](const BvhRayHit& hit) { return hit.IsHit(); });
+
+        LOG("BVH benchmark: {} boxes, SAH build {:.3f} ms (cost {:.1f}), refit {:.3f} ms ({} rotations), {} moves {:.3f} ms (cost {:.1f})",
+            num_boxes, build_ms, build_cost, refit_ms, num_refit_rotations, num_moved, move_ms, moved_cost);
+        LOG("Frustum {:.3f} ms for {} visible, testing every box {:.3f} ms for {}. {} box queries {:.3f} ms, {:.1f} overlaps each. {} rays {:.3f} ms, {} hits",
+            frustum_ms, visible.size(), linear_ms, num_linear_visible, num_queries, boxes_ms, static_cast<double>(overlaps.size()) / num_queries,
+            num_queries, rays_ms, num_hits);
+    }
+}
+
+void RunRaycastBenchmark(uint32 num_cubes, uint32 num_rays)
+{
+    CHECK(num_cubes > 0 && num_rays > 0);
+
+    float half_extent = 0.0f;
+    const std::vector<Mat4> city = CreateCity(num_cubes, half_extent);
+    std::vector<RaycastMesh> meshes(num_cubes);
+    for (uint32 i = 0; i < num_cubes; ++i)
+    {
+        meshes[i] = MakeCubeMesh(city[i]);
+    }
+
+    MeshRaycaster raycaster;
+    const auto init_start = Clock::now();
+    raycaster.Init(meshes);
+    const double init_ms = ElapsedMs(init_start);
+    LOG("Raycast benchmark: {} triangles, init {:.3f} ms", raycaster.GetNumTriangles(), init_ms);
+
+    // Camera rays over the city, rows of neighbouring pixels form the packets. Random rays are the incoherent worst case.
+    const uint32 image_width = static_cast<uint32>(std::sqrt(static_cast<float>(num_rays)));
+    const Vec3 eye(0.0f, 30.0f, -half_extent);
+    std::vector<Ray> camera_rays(num_rays);
+    for (uint32 i = 0; i < num_rays; ++i)
+    {
+        const float sx = static_cast<float>(i % image_width) / image_width - 0.5f;
+        const float sy = static_cast<float>(i / image_width) / image_width - 0.5f;
+        camera_rays[i] = Ray(eye, Vec3::Normalize(Vec3(sx, sy - 0.3f, 1.0f)), 4.0f * half_extent);
+    }
+
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> position(-half_extent, half_extent);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> ray_height(0.0f, 20.0f);
+    std::vector<Ray> random_rays(num_rays);
+    for (Ray& ray : random_rays)
+    {
+        ray = Ray(Vec3(position(rng), ray_height(rng), position(rng)), Vec3::Normalize(Vec3(offset(rng), offset(rng), offset(rng))), 4.0f * half_extent);
+    }
+
+    std::vector<MeshRayHit> hits(num_rays);
+    const auto count_hits = [&]()
+    {
+        return std::count_if(hits.begin(), hits.end(), [](const MeshRayHit& hit) { return hit.IsHit(); });
+    };
+    const auto mrays_per_second = [&](double ms)
+    {
+        return num_rays / (ms * 1000.0);
+    };
+
+    for (const auto& [name, rays] : { std::pair<const char*, const std::vector<Ray>&>("Camera", camera_rays), { "Random", random_rays } })
+    {
+        // One ray at a time against eight triangles per test
+        const auto single_start = Clock::now();
+        jobs::ParallelFor(num_rays, 256, [&](uint32 begin, uint32 end)
+        {
+            for (uint32 i = begin; i < end; ++i)
+            {
+                hits[i] = raycaster.Raycast(rays[i]);
+            }
+        });
+        const double single_ms = ElapsedMs(single_start);
+        const size_t num_single_hits = count_hits();
+
+        const auto packet_start = Clock::now();
+        raycaster.Raycasts(rays, hits);
+        const double packet_ms = ElapsedMs(packet_start);
+        const size_t num_packet_hits = count_hits();
+
+        const auto any_start = Clock::now();
+        raycaster.Raycasts(rays, hits, RayQuery::ANY_HIT);
+        const double any_ms = ElapsedMs(any_start);
+        const size_t num_any_hits = count_hits();
+
+        LOG("{} rays: single {:.3f} ms ({:.1f} Mrays/s, {} hits), packets {:.3f} ms ({:.1f} Mrays/s, {} hits), any hit packets {:.3f} ms ({:.1f} Mrays/s, {} hits)",
+            name, single_ms, mrays_per_second(single_ms), num_single_hits, packet_ms, mrays_per_second(packet_ms), num_packet_hits,
+            any_ms, mrays_per_second(any_ms), num_any_hits);
+    }
+}
+
+void RunPvsBenchmark(uint32 num_cubes, uint32 num_views)
+{
+    CHECK(num_cubes > 0 && num_views > 0);
+    float half_extent = 0.0f;
+    const std::vector<Mat4> city = CreateCity(num_cubes, half_extent);
+
+    // Entities of a fresh scene have matching dense and slot indices, so object i is entity i
+    Scene scene;
+    std::vector<RaycastMesh> objects(num_cubes);
+    for (uint32 i = 0; i < num_cubes; ++i)
+    {
+        const Mat4& world = city[i];
+        scene.CreateEntity({ .translation = Vec3(world._41, world._42, world._43), .scale = Vec3(1.0f, world._22, 1.0f) });
+        objects[i] = MakeCubeMesh(world);
+    }
+    scene.UpdateTransforms();
+
+    // The camera walks the streets
+    PvsBakeSettings settings;
+    settings.view_region = Box(-half_extent, half_extent, 0.5f, 2.5f, -half_extent, half_extent);
+    PotentiallyVisibleSet pvs;
+    pvs.Bake(objects, settings);
+    const PvsStats& stats = pvs.GetStats();
+    LOG("PVS benchmark: {} objects, {} cells ({} unique), bake {:.3f} ms, {:.1f} visible per cell, {} KB compressed from {} KB",
+        stats.num_objects, stats.num_cells, stats.num_unique_cells, stats.bake_time_ms, stats.average_visible,
+        stats.compressed_bytes / 1024, stats.uncompressed_bytes / 1024);
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-half_extent, half_extent);
+    std::uniform_real_distribution<float> eye_height(0.5f, 2.5f);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+    std::vector<uint32> visible;
+    uint64 num_frustum_visible = 0;
+    uint64 num_pvs_visible = 0;
+    double frustum_ms = 0.0;
+    double pvs_ms = 0.0;
+    for (uint32 view = 0; view < num_views; ++view)
+    {
+        const Vec3 eye(position(rng), eye_height(rng), position(rng));
+        const float yaw = angle(rng);
+        Camera camera(eye, Camera::DEFAULT_ASPECT_RATIO, Camera::DEFAULT_FOV, 0.1f, 2.0f * half_extent);
+        camera.LookAt(Vec3(eye.x + std::sin(yaw), eye.y, eye.z + std::cos(yaw)));
+        camera.UpdateMatrices();
+
+        const auto frustum_start = Clock::now();
+        scene.CullFrustum(camera.GetViewProjection(), visible);
+        frustum_ms += ElapsedMs(frustum_start);
+        num_frustum_visible += visible.size();
+
+        const auto pvs_start = Clock::now();
+        pvs.SelectCell(eye);
+        scene.CullFrustum(camera.GetViewProjection(), visible, &pvs);
+        pvs_ms += ElapsedMs(pvs_start);
+        num_pvs_visible += visible.size();
+    }
+
+    LOG("{} views: frustum culling {:.3f} ms for {:.1f} visible, with PVS {:.3f} ms for {:.1f} visible",
+        num_views, frustum_ms / num_views, static_cast<double>(num_frustum_visible) / num_views,
+        pvs_ms / num_views, static_cast<double>(num_pvs_visible) / num_views);
+}
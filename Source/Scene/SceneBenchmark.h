@@ -0,0 +1,33 @@
+#pragma once
+
+/**
+ * @brief Fills a Scene with entities scattered around the camera and times, per iteration, moving all of them and
+ * updating their transforms, frustum culling with and without LOD selection, culling shadow casters for four cascades
+ * and gathering the world transforms of the visible ones.
+ * Runs without a window or device. Expects the job system to be initialized.
+ */
+void RunSceneBenchmark(uint32 num_entities = 1000000, uint32 num_iterations = 16);
+
+/**
+ * @brief Builds a random forest of transform nodes and times Update() while a fraction of them change every frame.
+ * Also times a full update of every node for comparison.
+ */
+void RunTransformHierarchyBenchmark(uint32 num_nodes = 500000, float changed_fraction = 0.01f, uint32 num_iterations = 32);
+
+/**
+ * @brief Times BoundingVolumeHierarchy builds, refits, incremental moves and batched frustum, box and ray queries
+ * for 100K boxes, then ten times as many up to max_boxes. The frustum query is compared against testing every box.
+ */
+void RunBvhBenchmark(uint32 max_boxes = 10000000, uint32 num_queries = 100000);
+
+/**
+ * @brief Times MeshRaycaster init and closest and any hit queries against a grid of cubes, one ray at a time and in
+ * packets, for coherent camera rays and random rays.
+ */
+void RunRaycastBenchmark(uint32 num_cubes = 100000, uint32 num_rays = 1000000);
+
+/**
+ * @brief Bakes a PotentiallyVisibleSet for a grid of cubes seen from street level, then compares frustum culling with
+ * and without the camera cell's set prefiltering it over random views.
+ */
+void RunPvsBenchmark(uint32 num_cubes = 10000, uint32 num_views = 256);
@@ -0,0 +1,293 @@
+#include "Scene/SceneSelfTests.h"
+
+#include <random>
+
+#include "Core/JobSystem.h"
+#include "Core/SelfTest.h"
+#include "Renderer/Mesh.h"
+#include "Scene/MeshRaycaster.h"
+#include "Scene/PotentiallyVisibleSet.h"
+
+namespace
+{
+    // References the cube's vertex and index data
+    RaycastMesh MakeCubeMesh(const Mat4& world)
+    {
+        return {
+            .positions = CubeMeshData::POS.data(),
+            .position_stride = sizeof(Vec4),
+            .num_vertices = static_cast<uint32>(CubeMeshData::POS.size()),
+            .indices = CubeMeshData::INDICES.data(),
+            .num_indices = static_cast<uint32>(CubeMeshData::INDICES.size()),
+            .world = world
+        };
+    }
+
+    struct WorldTriangle
+    {
+        Vec3 v0;
+        Vec3 v1;
+        Vec3 v2;
+        uint32 mesh_idx = 0;
+        uint32 triangle_idx = 0;
+    };
+
+    // Every triangle in world space, in mesh order. Triangle t of mesh m is at out_first_triangles[m] + t.
+    std::vector<WorldTriangle> GatherWorldTriangles(std::span<const RaycastMesh> meshes, std::vector<uint32>& out_first_triangles)
+    {
+        std::vector<WorldTriangle> triangles;
+        out_first_triangles.clear();
+        for (uint32 mesh_idx = 0; mesh_idx < meshes.size(); ++mesh_idx)
+        {
+            const RaycastMesh& mesh = meshes[mesh_idx];
+            out_first_triangles.push_back(static_cast<uint32>(triangles.size()));
+            const auto corner = [&](uint32 i)
+            {
+                const float* position = reinterpret_cast<const float*>(static_cast<const uint8*>(mesh.positions) + mesh.indices[i] * mesh.position_stride);
+                return Vec3(position[0], position[1], position[2]) * mesh.world;
+            };
+
+            for (uint32 triangle_idx = 0; triangle_idx < mesh.num_indices / 3; ++triangle_idx)
+            {
+                triangles.push_back({ corner(3 * triangle_idx), corner(3 * triangle_idx + 1), corner(3 * triangle_idx + 2), mesh_idx, triangle_idx });
+            }
+        }
+        return triangles;
+    }
+
+    // Tests every triangle, the reference for MeshRaycaster
+    MeshRayHit RaycastBruteForce(const Ray& ray, std::span<const WorldTriangle> triangles)
+    {
+        MeshRayHit hit;
+        Ray closest_ray = ray;
+        for (const WorldTriangle& triangle : triangles)
+        {
+            float distance = 0.0f;
+            float u = 0.0f;
+            float v = 0.0f;
+            if (closest_ray.IntersectTriangle(triangle.v0, triangle.v1, triangle.v2, distance, u, v))
+            {
+                hit = { .mesh_idx = triangle.mesh_idx, .triangle_idx = triangle.triangle_idx, .distance = distance, .u = u, .v = v };
+                closest_ray.max_distance = distance;
+            }
+        }
+        return hit;
+    }
+}
+
+bool RunRaycastSelfTest()
+{
+    SelfTest test("Raycast self test");
+    if (jobs::GetNumThreads() == 1)
+    {
+        LOG_WARN("Raycast self test: single threaded, the primitives are sorted in one chunk");
+    }
+
+    // 4096 cubes of random height on a grid, 49K triangles. RadixSort splits more than 32K entries into several chunks.
+    static constexpr uint32 GRID_SIZE = 64;
+    static constexpr float SPACING = 4.0f;
+    static constexpr float HALF_EXTENT = 0.5f * SPACING * GRID_SIZE;
+    std::mt19937 rng(2024);
+    std::uniform_real_distribution<float> height(1.0f, 8.0f);
+    std::vector<RaycastMesh> meshes(GRID_SIZE * GRID_SIZE);
+    for (uint32 i = 0; i < meshes.size(); ++i)
+    {
+        const float h = height(rng);
+        const float x = (i % GRID_SIZE) * SPACING - HALF_EXTENT;
+        const float z = (i / GRID_SIZE) * SPACING - HALF_EXTENT;
+        meshes[i] = MakeCubeMesh(Mat4::Scaling(Vec3(1.0f, h, 1.0f)) * Mat4::Translation(x, h, z));
+    }
+
+    MeshRaycaster raycaster;
+    raycaster.Init(meshes);
+    std::vector<uint32> first_triangles;
+    const std::vector<WorldTriangle> triangles = GatherWorldTriangles(meshes, first_triangles);
+    test.Expect(raycaster.GetNumTriangles() == triangles.size(), "every triangle of every mesh to be added");
+
+    // From above and between the cubes towards random points of the city, every third ray ends early
+    static constexpr uint32 NUM_RAYS = 4096;
+    std::uniform_real_distribution<float> position(-HALF_EXTENT, HALF_EXTENT);
+    std::uniform_real_distribution<float> origin_height(0.0f, 30.0f);
+    std::uniform_real_distribution<float> target_height(0.0f, 16.0f);
+    std::vector<Ray> rays(NUM_RAYS);
+    for (uint32 i = 0; i < NUM_RAYS; ++i)
+    {
+        const Vec3 origin(position(rng), origin_height(rng), position(rng));
+        const Vec3 target(position(rng), target_height(rng), position(rng));
+        const Vec3 direction = Vec3::Normalize(Vec3(target.x - origin.x, target.y - origin.y, target.z - origin.z));
+        rays[i] = Ray(origin, direction, i % 3 == 0 ? 10.0f : 4.0f * HALF_EXTENT);
+    }
+
+    std::vector<MeshRayHit> expected_hits(NUM_RAYS);
+    std::vector<MeshRayHit> single_hits(NUM_RAYS);
+    std::vector<MeshRayHit> single_any_hits(NUM_RAYS);
+    jobs::ParallelFor(NUM_RAYS, 64, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            expected_hits[i] = RaycastBruteForce(rays[i], triangles);
+            single_hits[i] = raycaster.Raycast(rays[i]);
+            single_any_hits[i] = raycaster.Raycast(rays[i], RayQuery::ANY_HIT);
+        }
+    });
+
+    std::vector<MeshRayHit> packet_hits(NUM_RAYS);
+    std::vector<MeshRayHit> packet_any_hits(NUM_RAYS);
+    raycaster.Raycasts(rays, packet_hits);
+    raycaster.Raycasts(rays, packet_any_hits, RayQuery::ANY_HIT);
+
+    // Rays through a shared edge may report either triangle, so the reported triangle is tested again instead of compared
+    const auto is_valid_hit = [&](const Ray& ray, const MeshRayHit& hit)
+    {
+        if (hit.mesh_idx >= meshes.size() || hit.triangle_idx >= meshes[hit.mesh_idx].num_indices / 3)
+        {
+            return false;
+        }
+
+        const WorldTriangle& triangle = triangles[first_triangles[hit.mesh_idx] + hit.triangle_idx];
+        float distance = 0.0f;
+        float u = 0.0f;
+        float v = 0.0f;
+        return ray.IntersectTriangle(triangle.v0, triangle.v1, triangle.v2, distance, u, v) && IsNear(distance, hit.distance, 1e-3 * std::max(1.0f, distance));
+    };
+    const auto count_mismatches = [&](const std::vector<MeshRayHit>& hits, RayQuery query)
+    {
+        uint32 num_mismatches = 0;
+        for (uint32 i = 0; i < NUM_RAYS; ++i)
+        {
+            const MeshRayHit& hit = hits[i];
+            const MeshRayHit& expected = expected_hits[i];
+            bool is_match = hit.IsHit() == expected.IsHit();
+            if (is_match && hit.IsHit())
+            {
+                is_match = is_valid_hit(rays[i], hit)
+                    && (query == RayQuery::ANY_HIT || IsNear(hit.distance, expected.distance, 1e-3 * std::max(1.0f, expected.distance)));
+            }
+            num_mismatches += is_match ? 0 : 1;
+        }
+        return num_mismatches;
+    };
+
+    test.Expect(count_mismatches(single_hits, RayQuery::CLOSEST_HIT) == 0, "single closest hits to match testing every triangle");
+    test.Expect(count_mismatches(packet_hits, RayQuery::CLOSEST_HIT) == 0, "packet closest hits to match testing every triangle");
+    test.Expect(count_mismatches(single_any_hits, RayQuery::ANY_HIT) == 0, "single any hits to be hits exactly where testing every triangle finds one");
+    test.Expect(count_mismatches(packet_any_hits, RayQuery::ANY_HIT) == 0, "packet any hits to be hits exactly where testing every triangle finds one");
+
+    const size_t num_hits = std::count_if(expected_hits.begin(), expected_hits.end(), [](const MeshRayHit& hit) { return hit.IsHit(); });
+    test.Expect(num_hits > NUM_RAYS / 4 && num_hits < NUM_RAYS, "a mix of hits and misses");
+    LOG("Raycast self test: {} triangles, {} of {} rays hit", triangles.size(), num_hits, NUM_RAYS);
+    return test.Finish();
+}
+
+bool RunPvsSelfTest()
+{
+    SelfTest test("PVS self test");
+
+    // The camera stays in a 16 x 16 area, split into four cells. A wall 16 units in front of it hides a 64 x 96 grid of
+    // cubes, 74K triangles, so the bake's raycaster sorts several chunks. Eight large cubes around the area are in the open.
+    std::vector<RaycastMesh> objects;
+    objects.push_back(MakeCubeMesh(Mat4::Scaling(200.0f, 40.0f, 0.5f) * Mat4::Translation(0.0f, 20.0f, 24.0f)));
+    const uint32 wall_idx = 0;
+
+    const uint32 first_open_idx = static_cast<uint32>(objects.size());
+    static constexpr uint32 NUM_OPEN = 8;
+    for (uint32 i = 0; i < NUM_OPEN; ++i)
+    {
+        const float angle = 2.0f * PI * i / NUM_OPEN;
+        objects.push_back(MakeCubeMesh(Mat4::Scaling(2.0f) * Mat4::Translation(16.0f * std::sin(angle), 2.0f, 16.0f * std::cos(angle))));
+    }
+
+    // Not baked, a free entity slot
+    const uint32 empty_idx = static_cast<uint32>(objects.size());
+    objects.push_back({});
+
+    const uint32 first_hidden_idx = static_cast<uint32>(objects.size());
+    std::mt19937 rng(2024);
+    std::uniform_real_distribution<float> height(1.0f, 4.0f);
+    for (uint32 z = 0; z < 96; ++z)
+    {
+        for (uint32 x = 0; x < 64; ++x)
+        {
+            const float h = height(rng);
+            objects.push_back(MakeCubeMesh(Mat4::Scaling(Vec3(1.0f, h, 1.0f)) * Mat4::Translation(x * 4.0f - 128.0f, h, 40.0f + z * 4.0f)));
+        }
+    }
+    const uint32 num_objects = static_cast<uint32>(objects.size());
+
+    PvsBakeSettings settings;
+    settings.view_region = Box(-8.0f, 8.0f, 0.5f, 2.5f, -8.0f, 8.0f);
+    settings.cell_size = 8.0f;
+    PotentiallyVisibleSet pvs;
+    pvs.Bake(objects, settings);
+    const PvsStats& stats = pvs.GetStats();
+    test.Expect(stats.num_objects == num_objects && stats.num_cells == 4, "one bit per object and four cells");
+
+    // Known answers from every cell
+    bool is_open_visible = true;
+    bool is_hidden_culled = true;
+    bool is_empty_kept = true;
+    for (uint32 cell_idx = 0; cell_idx < stats.num_cells; ++cell_idx)
+    {
+        const Box cell = pvs.GetCellBounds(cell_idx);
+        pvs.SelectCell(Vec3((cell.min_x + cell.max_x) * 0.5f, (cell.min_y + cell.max_y) * 0.5f, (cell.min_z + cell.max_z) * 0.5f));
+        is_open_visible &= pvs.IsVisible(wall_idx);
+        for (uint32 object_idx = first_open_idx; object_idx < first_open_idx + NUM_OPEN; ++object_idx)
+        {
+            is_open_visible &= pvs.IsVisible(object_idx);
+        }
+        for (uint32 object_idx = first_hidden_idx; object_idx < num_objects; ++object_idx)
+        {
+            is_hidden_culled &= pvs.IsVisible(object_idx) == false;
+        }
+        is_empty_kept &= pvs.IsVisible(empty_idx) && pvs.IsVisible(num_objects) && pvs.IsVisible(num_objects + 100);
+    }
+    test.Expect(is_open_visible, "the wall and the cubes in the open to be visible from every cell");
+    test.Expect(is_hidden_culled, "the cubes behind the wall to be culled in every cell");
+    test.Expect(is_empty_kept, "the free slot and slots past the baked objects to be kept");
+
+    pvs.SelectCell(Vec3(0.0f, 100.0f, 0.0f));
+    test.Expect(pvs.IsVisible(first_hidden_idx), "everything to be kept outside the view region");
+
+    // Whatever a ray from inside a cell hits first has to be in that cell's set. Rays aim around the region, so most hit.
+    std::vector<uint32> first_triangles;
+    const std::vector<WorldTriangle> triangles = GatherWorldTriangles(objects, first_triangles);
+    static constexpr uint32 NUM_RAYS = 2048;
+    std::uniform_real_distribution<float> position(-8.0f, 8.0f);
+    std::uniform_real_distribution<float> eye_height(0.5f, 2.5f);
+    std::uniform_real_distribution<float> target_position(-32.0f, 32.0f);
+    std::uniform_real_distribution<float> target_height(0.0f, 8.0f);
+    std::vector<Ray> rays(NUM_RAYS);
+    for (Ray& ray : rays)
+    {
+        const Vec3 origin(position(rng), eye_height(rng), position(rng));
+        const Vec3 target(target_position(rng), target_height(rng), target_position(rng));
+        ray = Ray(origin, Vec3::Normalize(Vec3(target.x - origin.x, target.y - origin.y, target.z - origin.z)), 1000.0f);
+    }
+
+    std::vector<MeshRayHit> hits(NUM_RAYS);
+    jobs::ParallelFor(NUM_RAYS, 64, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            hits[i] = RaycastBruteForce(rays[i], triangles);
+        }
+    });
+
+    uint32 num_hits = 0;
+    uint32 num_missing = 0;
+    for (uint32 i = 0; i < NUM_RAYS; ++i)
+    {
+        if (hits[i].IsHit())
+        {
+            pvs.SelectCell(rays[i].origin);
+            ++num_hits;
+            num_missing += pvs.IsVisible(hits[i].mesh_idx) ? 0 : 1;
+        }
+    }
+    test.Expect(num_hits > NUM_RAYS / 2, "most rays from the view region to hit something");
+    test.Expect(num_missing == 0, "every object hit by a ray from a cell to be in that cell's set");
+
+    LOG("PVS self test: {} objects, {:.1f} visible per cell, {} of {} rays hit, bake {:.3f} ms",
+        num_objects, stats.average_visible, num_hits, NUM_RAYS, stats.bake_time_ms);
+    return test.Finish();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+ * @brief Casts random rays into a grid of cubes with more triangles than one radix sort chunk holds, and checks
+ * MeshRaycaster's closest and any hits, single and in packets, against testing every triangle.
+ * Expects the job system to be initialized, with a single thread the primitives are sorted in one chunk.
+ * Runs without a window or device, like all self tests. Failures are logged, not asserted, so release builds report them too.
+ * @return True if every check passed.
+ */
+bool RunRaycastSelfTest();
+
+/**
+ * @brief Bakes a PotentiallyVisibleSet for a view region with a wall in front of it. Checks that the cubes around the
+ * region are visible and the cubes behind the wall aren't, from every cell, and that every object random rays from
+ * the region hit first, testing every triangle, is in the set of the ray origin's cell. Also checks that a free slot,
+ * slots past the baked objects and everything outside the view region are kept. Expects the job system to be initialized.
+ * @return True if every check passed.
+ */
+bool RunPvsSelfTest();
@@ -0,0 +1,267 @@
+#include "Scene/TransformHierarchy.h"
+
+#include <atomic>
+
+#include "Core/JobSystem.h"
+
+TransformHandle TransformHierarchy::CreateNode(TransformHandle parent, const Mat4& local_matrix)
+{
+    uint32 parent_slot = INVALID_ORDER_IDX;
+    if (parent.IsValid())
+    {
+        GetSlot(parent);
+        parent_slot = parent.idx;
+        ++slots_[parent_slot].num_children;
+    }
+
+    uint32 slot_idx = 0;
+    if (free_slots_.empty() == false)
+    {
+        slot_idx = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else
+    {
+        slot_idx = static_cast<uint32>(slots_.size());
+        slots_.emplace_back();
+    }
+
+    // Appended for now, moves to its level on the next rebuild
+    Slot& slot = slots_[slot_idx];
+    slot.order_idx = static_cast<uint32>(order_slots_.size());
+    slot.parent_slot = parent_slot;
+    slot.num_children = 0;
+    slot.is_alive = true;
+    order_slots_.push_back(slot_idx);
+    order_parents_.push_back(INVALID_ORDER_IDX);
+    local_matrices_.push_back(local_matrix);
+    world_matrices_.push_back(local_matrix);
+    dirty_.push_back(1);
+
+    ++num_alive_;
+    is_order_dirty_ = true;
+    has_dirty_nodes_ = true;
+    return { .idx = slot_idx, .generation = slot.generation };
+}
+
+void TransformHierarchy::DestroyNode(TransformHandle handle)
+{
+    const Slot& slot = GetSlot(handle);
+    CHECK_MSG(slot.num_children == 0, "Node {} still has {} children", handle.idx, slot.num_children);
+    if (slot.parent_slot != INVALID_ORDER_IDX)
+    {
+        --slots_[slot.parent_slot].num_children;
+    }
+
+    // Its entry in the ordered arrays is dropped on the next rebuild
+    Slot& mutable_slot = slots_[handle.idx];
+    mutable_slot.is_alive = false;
+    mutable_slot.order_idx = INVALID_ORDER_IDX;
+    ++mutable_slot.generation;
+    free_slots_.push_back(handle.idx);
+
+    --num_alive_;
+    is_order_dirty_ = true;
+}
+
+bool TransformHierarchy::IsAlive(TransformHandle handle) const
+{
+    return handle.idx < slots_.size() && slots_[handle.idx].is_alive && slots_[handle.idx].generation == handle.generation;
+}
+
+void TransformHierarchy::SetParent(TransformHandle handle, TransformHandle parent)
+{
+    const Slot& slot = GetSlot(handle);
+    const uint32 new_parent_slot = parent.IsValid() ? parent.idx : INVALID_ORDER_IDX;
+    if (new_parent_slot == slot.parent_slot)
+    {
+        return;
+    }
+
+    if (parent.IsValid())
+    {
+        GetSlot(parent);
+        for (uint32 ancestor = new_parent_slot; ancestor != INVALID_ORDER_IDX; ancestor = slots_[ancestor].parent_slot)
+        {
+            CHECK_MSG(ancestor != handle.idx, "Parenting node {} to {} would create a cycle", handle.idx, parent.idx);
+        }
+        ++slots_[new_parent_slot].num_children;
+    }
+    if (slot.parent_slot != INVALID_ORDER_IDX)
+    {
+        --slots_[slot.parent_slot].num_children;
+    }
+
+    slots_[handle.idx].parent_slot = new_parent_slot;
+    dirty_[slot.order_idx] = 1;
+    is_order_dirty_ = true;
+    has_dirty_nodes_ = true;
+}
+
+TransformHandle TransformHierarchy::GetParent(TransformHandle handle) const
+{
+    const Slot& slot = GetSlot(handle);
+    if (slot.parent_slot == INVALID_ORDER_IDX)
+    {
+        return {};
+    }
+    return { .idx = slot.parent_slot, .generation = slots_[slot.parent_slot].generation };
+}
+
+void TransformHierarchy::SetLocalMatrix(TransformHandle handle, const Mat4& local_matrix)
+{
+    const Slot& slot = GetSlot(handle);
+    local_matrices_[slot.order_idx] = local_matrix;
+    dirty_[slot.order_idx] = 1;
+    has_dirty_nodes_ = true;
+}
+
+void TransformHierarchy::SetLocalTransform(TransformHandle handle, const Vec3& scaling, const Quat& rotation, const Vec3& translation)
+{
+    SetLocalMatrix(handle, Mat4::SRT(scaling, rotation, translation));
+}
+
+const Mat4& TransformHierarchy::GetLocalMatrix(TransformHandle handle) const
+{
+    return local_matrices_[GetSlot(handle).order_idx];
+}
+
+const Mat4& TransformHierarchy::GetWorldMatrix(TransformHandle handle) const
+{
+    return world_matrices_[GetSlot(handle).order_idx];
+}
+
+void TransformHierarchy::Update()
+{
+    stats_.was_reordered = is_order_dirty_;
+    if (is_order_dirty_)
+    {
+        RebuildOrder();
+    }
+
+    stats_.num_nodes = num_alive_;
+    stats_.num_levels = level_offsets_.empty() ? 0 : static_cast<uint32>(level_offsets_.size() - 1);
+    stats_.num_updated = 0;
+    if (has_dirty_nodes_ == false)
+    {
+        return;
+    }
+
+    // Levels run one after another, nodes within a level only depend on the previous one
+    std::atomic<uint32> num_updated = 0;
+    for (uint32 level = 0; level + 1 < level_offsets_.size(); ++level)
+    {
+        const uint32 level_begin = level_offsets_[level];
+        jobs::ParallelFor(level_offsets_[level + 1] - level_begin, MIN_NODES_PER_JOB, [&](uint32 begin, uint32 end)
+        {
+            uint32 num_batch_updated = 0;
+            for (uint32 i = level_begin + begin; i < level_begin + end; ++i)
+            {
+                const uint32 parent = order_parents_[i];
+                const bool is_parent_dirty = parent != INVALID_ORDER_IDX && dirty_[parent] != 0;
+                if (dirty_[i] == 0 && is_parent_dirty == false)
+                {
+                    continue;
+                }
+
+                // Row vectors, so the local transform applies first. Mat4's multiply is DirectXMath's SSE one.
+                world_matrices_[i] = parent == INVALID_ORDER_IDX ? local_matrices_[i] : local_matrices_[i] * world_matrices_[parent];
+                dirty_[i] = 1;
+                ++num_batch_updated;
+            }
+            num_updated += num_batch_updated;
+        });
+    }
+
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+    has_dirty_nodes_ = false;
+    stats_.num_updated = num_updated;
+}
+
+const TransformHierarchy::Slot& TransformHierarchy::GetSlot(TransformHandle handle) const
+{
+    CHECK_MSG(IsAlive(handle), "Transform node {} (generation {}) is not alive", handle.idx, handle.generation);
+    return slots_[handle.idx];
+}
+
+void TransformHierarchy::RebuildOrder()
+{
+    // Depth of every live slot, walking up until a known depth
+    static constexpr uint32 UNKNOWN_DEPTH = std::numeric_limits<uint32>::max();
+    std::vector<uint32> depths(slots_.size(), UNKNOWN_DEPTH);
+    std::vector<uint32> chain;
+    uint32 num_levels = 0;
+    for (uint32 slot_idx = 0; slot_idx < slots_.size(); ++slot_idx)
+    {
+        if (slots_[slot_idx].is_alive == false || depths[slot_idx] != UNKNOWN_DEPTH)
+        {
+            continue;
+        }
+
+        chain.clear();
+        uint32 current = slot_idx;
+        while (current != INVALID_ORDER_IDX && depths[current] == UNKNOWN_DEPTH)
+        {
+            chain.push_back(current);
+            current = slots_[current].parent_slot;
+        }
+
+        uint32 depth = current == INVALID_ORDER_IDX ? 0 : depths[current] + 1;
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+        {
+            depths[*it] = depth++;
+        }
+        num_levels = std::max(num_levels, depth);
+    }
+
+    // Counting sort by depth, slots in index order within a level
+    level_offsets_.assign(num_levels + 1, 0);
+    for (uint32 slot_idx = 0; slot_idx < slots_.size(); ++slot_idx)
+    {
+        if (slots_[slot_idx].is_alive)
+        {
+            ++level_offsets_[depths[slot_idx] + 1];
+        }
+    }
+    for (uint32 level = 1; level <= num_levels; ++level)
+    {
+        level_offsets_[level] += level_offsets_[level - 1];
+    }
+
+    std::vector<uint32> new_order_slots(num_alive_);
+    std::vector<uint32> level_cursors(level_offsets_.begin(), level_offsets_.end() - 1);
+    for (uint32 slot_idx = 0; slot_idx < slots_.size(); ++slot_idx)
+    {
+        if (slots_[slot_idx].is_alive)
+        {
+            new_order_slots[level_cursors[depths[slot_idx]]++] = slot_idx;
+        }
+    }
+
+    std::vector<uint32> new_order_parents(num_alive_);
+    std::vector<Mat4> new_local_matrices(num_alive_);
+    std::vector<Mat4> new_world_matrices(num_alive_);
+    std::vector<uint8> new_dirty(num_alive_);
+    for (uint32 i = 0; i < num_alive_; ++i)
+    {
+        const uint32 old_order_idx = slots_[new_order_slots[i]].order_idx;
+        new_local_matrices[i] = local_matrices_[old_order_idx];
+        new_world_matrices[i] = world_matrices_[old_order_idx];
+        new_dirty[i] = dirty_[old_order_idx];
+    }
+
+    // Parents are placed before their children, so their new order index is known by the time a child needs it
+    for (uint32 i = 0; i < num_alive_; ++i)
+    {
+        Slot& slot = slots_[new_order_slots[i]];
+        slot.order_idx = i;
+        new_order_parents[i] = slot.parent_slot == INVALID_ORDER_IDX ? INVALID_ORDER_IDX : slots_[slot.parent_slot].order_idx;
+    }
+
+    order_slots_ = std::move(new_order_slots);
+    order_parents_ = std::move(new_order_parents);
+    local_matrices_ = std::move(new_local_matrices);
+    world_matrices_ = std::move(new_world_matrices);
+    dirty_ = std::move(new_dirty);
+    is_order_dirty_ = false;
+}
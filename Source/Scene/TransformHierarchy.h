@@ -0,0 +1,104 @@
+#pragma once
+
+/**
+ * @brief Reference to a node of a TransformHierarchy. Stale handles are detected the same way as EntityHandles.
+ */
+struct TransformHandle
+{
+    static inline constexpr uint32 INVALID_IDX = std::numeric_limits<uint32>::max();
+
+    uint32 idx = INVALID_IDX;
+    uint32 generation = 0;
+
+    bool IsValid() const
+    {
+        return idx != INVALID_IDX;
+    }
+
+    bool operator==(const TransformHandle& other) const = default;
+};
+
+struct TransformHierarchyStats
+{
+    uint32 num_nodes = 0;
+    uint32 num_levels = 0;
+    uint32 num_updated = 0;     // World matrices recomputed by the last Update()
+    bool was_reordered = false; // Whether the last Update() had to rebuild the breadth first order
+};
+
+/**
+ * @brief Parent / child transforms stored breadth first in flat arrays: all roots, then all nodes at depth 1, and so on.
+ * Every parent comes before its children, so one pass over a level only reads world matrices finished by the previous
+ * level, and each level can be split across threads. Changing a local transform marks the node dirty, Update()
+ * pushes that down to its children and only recomputes the dirty subtrees.
+ * Structural changes (create, destroy, reparent) are cheap and rebuild the order once on the next Update().
+ */
+class TransformHierarchy
+{
+public:
+    TransformHandle CreateNode(TransformHandle parent = {}, const Mat4& local_matrix = Mat4::IDENTITY);
+
+    /**
+     * @brief Children have to be destroyed or moved to another parent first.
+     */
+    void DestroyNode(TransformHandle handle);
+
+    bool IsAlive(TransformHandle handle) const;
+
+    // @param parent Invalid handle to make the node a root
+    void SetParent(TransformHandle handle, TransformHandle parent);
+    TransformHandle GetParent(TransformHandle handle) const;
+
+    void SetLocalMatrix(TransformHandle handle, const Mat4& local_matrix);
+    void SetLocalTransform(TransformHandle handle, const Vec3& scaling, const Quat& rotation, const Vec3& translation);
+    const Mat4& GetLocalMatrix(TransformHandle handle) const;
+
+    /**
+     * @brief World matrix as of the last Update().
+     */
+    const Mat4& GetWorldMatrix(TransformHandle handle) const;
+
+    void Update();
+
+    uint32 GetNumNodes() const
+    {
+        return num_alive_;
+    }
+
+    const TransformHierarchyStats& GetStats() const
+    {
+        return stats_;
+    }
+
+private:
+    static inline constexpr uint32 INVALID_ORDER_IDX = std::numeric_limits<uint32>::max();
+    static inline constexpr uint32 MIN_NODES_PER_JOB = 512;
+
+    struct Slot
+    {
+        uint32 order_idx = INVALID_ORDER_IDX;
+        uint32 generation = 0;
+        uint32 parent_slot = INVALID_ORDER_IDX;
+        uint32 num_children = 0;
+        bool is_alive = false;
+    };
+
+    const Slot& GetSlot(TransformHandle handle) const;
+    void RebuildOrder();
+
+    std::vector<Slot> slots_;
+    std::vector<uint32> free_slots_;
+    uint32 num_alive_ = 0;
+
+    // Breadth first order, except for nodes created or moved since the last rebuild, which are appended
+    std::vector<uint32> order_slots_;
+    std::vector<uint32> order_parents_;     // Order index of the parent, INVALID_ORDER_IDX for roots
+    std::vector<Mat4> local_matrices_;
+    std::vector<Mat4> world_matrices_;
+    std::vector<uint8> dirty_;
+    std::vector<uint32> level_offsets_;     // Start of each depth level plus the end of the last one
+    bool is_order_dirty_ = false;
+    bool has_dirty_nodes_ = false;
+
+    TransformHierarchyStats stats_;
+};
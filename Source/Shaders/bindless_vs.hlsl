@@ -5,11 +5,18 @@ cbuffer PerDrawConstants : register(b0, space0)
     uint32 pos_buffer_index;
     uint32 uv_buffer_index;
     uint32 scene_data_buffer_index;
+    uint32 instance_buffer_index;
+    uint32 instance_offset;     // SV_InstanceID does not include StartInstanceLocation
 };
 
 struct SceneData 
 {
-    float4x4 wvp;
+    float4x4 view_projection;
+};
+
+struct InstanceData
+{
+    float3x4 world;     // Transposed affine transform, see Affine3x4
 };
 
 struct VSOutput
@@ -18,16 +25,19 @@ struct VSOutput
     float2 uv : UV0;
 };
 
-VSOutput Main(uint vertex_id : SV_VertexID)
+VSOutput Main(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID)
 {
     StructuredBuffer<float4> pos_buffer = ResourceDescriptorHeap[pos_buffer_index];
     StructuredBuffer<float2> uv_buffer = ResourceDescriptorHeap[uv_buffer_index];
     ConstantBuffer<SceneData> scene_data = ResourceDescriptorHeap[scene_data_buffer_index];
+    StructuredBuffer<InstanceData> instance_buffer = ResourceDescriptorHeap[instance_buffer_index];
     float4 pos = pos_buffer[vertex_id];
     float2 uv = uv_buffer[vertex_id];
+    InstanceData instance = instance_buffer[instance_offset + instance_id];
 
     VSOutput output;
-    output.pos = mul(pos, scene_data.wvp);
+    float3 world_pos = mul(instance.world, float4(pos.xyz, 1.0));
+    output.pos = mul(float4(world_pos, 1.0), scene_data.view_projection);
     output.uv = uv;
     return output;
 }
@@ -0,0 +1,23 @@
+#include "common.hlsl"
+
+cbuffer UpscaleConstants : register(b0, space0)
+{
+    float2 uv_scale;    // Render resolution / size of the source texture
+    float2 uv_max;      // Keeps bilinear taps inside the rendered region
+    uint32 source_texture_index;
+};
+
+SamplerState linear_clamp_sampler : register(s0, space0);
+
+struct PSInput
+{
+    float4 pos : SV_POSITION;
+    float2 uv : UV0;
+};
+
+float4 Main(PSInput input) : SV_TARGET
+{
+    Texture2D<float4> source_texture = ResourceDescriptorHeap[source_texture_index];
+    float2 uv = min(input.uv * uv_scale, uv_max);
+    return source_texture.SampleLevel(linear_clamp_sampler, uv, 0);
+}
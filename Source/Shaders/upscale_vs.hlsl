@@ -0,0 +1,18 @@
+#include "common.hlsl"
+
+struct VSOutput
+{
+    float4 pos : SV_POSITION;
+    float2 uv : UV0;
+};
+
+// Fullscreen triangle, no vertex buffers. Draw with 3 vertices.
+VSOutput Main(uint vertex_id : SV_VertexID)
+{
+    float2 uv = float2((vertex_id << 1) & 2, vertex_id & 2);
+
+    VSOutput output;
+    output.pos = float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+    output.uv = uv;
+    return output;
+}
@@ -1,9 +1,173 @@
 #include "App.h"
+#include "Core/CoreSelfTests.h"
+#include "Core/JobSystem.h"
+#include "Core/MathsBenchmark.h"
+#include "Renderer/DrawBenchmark.h"
+#include "Renderer/OcclusionBenchmark.h"
+#include "Renderer/RendererSelfTests.h"
+#include "Scene/SceneSelfTests.h"
+#include "Scene/SceneBenchmark.h"
 
-int main()
+namespace
+{
+    // -latency | -balanced | -throughput
+    gfx::FramePacing ParseFramePacing(int argc, char* argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const String arg = argv[i];
+            if (arg == "-latency")
+            {
+                return gfx::FramePacing::LOW_LATENCY;
+            }
+            if (arg == "-balanced")
+            {
+                return gfx::FramePacing::BALANCED;
+            }
+            if (arg == "-throughput")
+            {
+                return gfx::FramePacing::THROUGHPUT;
+            }
+        }
+
+        return gfx::FramePacing::LOW_LATENCY;
+    }
+
+    // -target_fps <fps>, 0 disables dynamic resolution
+    gfx::DynamicResolutionSettings ParseDynamicResolution(int argc, char* argv[])
+    {
+        gfx::DynamicResolutionSettings settings;
+        for (int i = 1; i < argc - 1; ++i)
+        {
+            const String arg = argv[i];
+            if (arg == "-target_fps")
+            {
+                const float target_fps = std::max(0.0f, static_cast<float>(std::atof(argv[i + 1])));
+                settings.target_frame_ms = target_fps > 0.0f ? 1000.0f / target_fps : 0.0f;
+            }
+        }
+
+        return settings;
+    }
+
+    // Flags without a value, e.g. -occlusion_benchmark
+    bool HasFlag(int argc, char* argv[], const char* flag)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (String(argv[i]) == flag)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+int main(int argc, char* argv[])
 {
     Log::Init();
+    // Benchmarks and self tests run instead of the app
+    const bool run_occlusion_benchmark = HasFlag(argc, argv, "-occlusion_benchmark");
+    const bool run_scene_benchmark = HasFlag(argc, argv, "-scene_benchmark");
+    const bool run_hierarchy_benchmark = HasFlag(argc, argv, "-hierarchy_benchmark");
+    const bool run_bvh_benchmark = HasFlag(argc, argv, "-bvh_benchmark");
+    const bool run_raycast_benchmark = HasFlag(argc, argv, "-raycast_benchmark");
+    const bool run_pvs_benchmark = HasFlag(argc, argv, "-pvs_benchmark");
+    const bool run_sort_benchmark = HasFlag(argc, argv, "-sort_benchmark");
+    const bool run_record_benchmark = HasFlag(argc, argv, "-record_benchmark");
+    const bool run_inverse_benchmark = HasFlag(argc, argv, "-inverse_benchmark");
+    const bool run_gpu_profiler_selftest = HasFlag(argc, argv, "-gpu_profiler_selftest");
+    const bool run_command_context_selftest = HasFlag(argc, argv, "-command_context_selftest");
+    const bool run_async_compute_selftest = HasFlag(argc, argv, "-async_compute_selftest");
+    const bool run_descriptor_selftest = HasFlag(argc, argv, "-descriptor_selftest");
+    const bool run_occlusion_selftest = HasFlag(argc, argv, "-occlusion_selftest");
+    const bool run_sort_selftest = HasFlag(argc, argv, "-sort_selftest");
+    const bool run_raycast_selftest = HasFlag(argc, argv, "-raycast_selftest");
+    const bool run_pvs_selftest = HasFlag(argc, argv, "-pvs_selftest");
+    if (run_occlusion_benchmark || run_scene_benchmark || run_hierarchy_benchmark || run_bvh_benchmark || run_raycast_benchmark
+        || run_pvs_benchmark || run_sort_benchmark || run_record_benchmark || run_inverse_benchmark
+        || run_gpu_profiler_selftest || run_command_context_selftest || run_async_compute_selftest || run_descriptor_selftest
+        || run_occlusion_selftest || run_sort_selftest || run_raycast_selftest || run_pvs_selftest)
+    {
+        jobs::Init();
+        bool passed = true;
+        if (run_occlusion_benchmark)
+        {
+            gfx::RunOcclusionBenchmark();
+        }
+        if (run_scene_benchmark)
+        {
+            RunSceneBenchmark();
+        }
+        if (run_hierarchy_benchmark)
+        {
+            RunTransformHierarchyBenchmark();
+        }
+        if (run_bvh_benchmark)
+        {
+            RunBvhBenchmark();
+        }
+        if (run_raycast_benchmark)
+        {
+            RunRaycastBenchmark();
+        }
+        if (run_pvs_benchmark)
+        {
+            RunPvsBenchmark();
+        }
+        if (run_sort_benchmark)
+        {
+            gfx::RunSortBenchmark();
+        }
+        if (run_record_benchmark)
+        {
+            gfx::RunRecordBenchmark();
+        }
+        if (run_inverse_benchmark)
+        {
+            RunInverseBenchmark();
+        }
+        if (run_gpu_profiler_selftest)
+        {
+            passed &= gfx::RunGPUProfilerSelfTest();
+        }
+        if (run_command_context_selftest)
+        {
+            passed &= gfx::RunCommandContextSelfTest();
+        }
+        if (run_async_compute_selftest)
+        {
+            passed &= gfx::RunAsyncComputeSelfTest();
+        }
+        if (run_descriptor_selftest)
+        {
+            passed &= gfx::RunDescriptorSelfTest();
+        }
+        if (run_occlusion_selftest)
+        {
+            passed &= gfx::RunOcclusionSelfTest();
+        }
+        if (run_sort_selftest)
+        {
+            passed &= RunSortSelfTest();
+        }
+        if (run_raycast_selftest)
+        {
+            passed &= RunRaycastSelfTest();
+        }
+        if (run_pvs_selftest)
+        {
+            passed &= RunPvsSelfTest();
+        }
+        jobs::Shutdown();
+        return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     App app;
+    app.SetFramePacing(ParseFramePacing(argc, argv));
+    app.SetDynamicResolution(ParseDynamicResolution(argc, argv));
     app.Run();
 
     return EXIT_SUCCESS;